@@ -0,0 +1,108 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Benchmark of the lazy expressions in ArrayExpr.h and of CHArray move semantics
+//Each expression is timed eagerly (a temporary array per operation), lazily (one loop) and as a hand-written loop
+//Arguments: [number of points, default 1000000]
+
+#include "BenchCommon.h"
+#include "ArrayExpr.h"
+#include <utility>
+#include <math.h>
+
+static void PrintLine(const char* name, double seconds, int n)
+{
+	printf("%-36s %9.3f ms %8.2f ns/point\n",name,seconds*1e3,seconds*1e9/n);
+}
+
+static CHArray<double> MakeArray(int n, double value)
+{
+	CHArray<double> result(n,true);
+	result=value;
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	int n=(int)BenchArg(argc,argv,1,1e6);
+
+	CHArray<double> a(n,true), b(n,true), c(n,true), r;
+	for(int i=0; i<n; i++)
+	{
+		a[i]=i*0.5;
+		b[i]=1.0+i%7;
+		c[i]=3.0-i%5;
+	}
+
+	printf("%i points\n",n);
+
+	//r = a*b + c*2
+	PrintLine("a*b+c*2 eager",BenchBest([&](){r=a*b+c*2.0;}),n);
+	BenchKeep(r[n/2]);
+	PrintLine("a*b+c*2 lazy",BenchBest([&](){r=Lazy(a)*b+Lazy(c)*2.0;}),n);
+	BenchKeep(r[n/2]);
+	PrintLine("a*b+c*2 loop",BenchBest([&]()
+	{
+		r.ResizeArray(n,true);
+		for(int i=0; i<n; i++) r[i]=a[i]*b[i]+c[i]*2.0;
+	}),n);
+	BenchKeep(r[n/2]);
+
+	//r = sqrt(a*a + b*b)
+	PrintLine("Sqrt(a*a+b*b) lazy",BenchBest([&](){r=Sqrt(Lazy(a)*a+Lazy(b)*b);}),n);
+	BenchKeep(r[n/2]);
+	PrintLine("Sqrt(a*a+b*b) loop",BenchBest([&]()
+	{
+		r.ResizeArray(n,true);
+		for(int i=0; i<n; i++) r[i]=sqrt(a[i]*a[i]+b[i]*b[i]);
+	}),n);
+	BenchKeep(r[n/2]);
+
+	//In place, the target is also an operand
+	PrintLine("c = c*0.5+1 lazy, in place",BenchBest([&](){c=Lazy(c)*0.5+1.0;}),n);
+	BenchKeep(c[n/2]);
+
+	//Returning and handing over arrays
+	PrintLine("copy assignment",BenchBest([&](){r=a;}),n);
+	BenchKeep(r[n/2]);
+	PrintLine("return by value + move assignment",BenchBest([&](){r=MakeArray(n,1.0);}),n);
+	BenchKeep(r[n/2]);
+	PrintLine("move construction + move back",BenchBest([&]()
+	{
+		CHArray<double> moved(std::move(a));
+		a=std::move(moved);
+	}),n);
+	BenchKeep(a[n/2]);
+
+	//Growing an array of arrays moves the inner arrays instead of copying them
+	int numInner=n/100;
+	CHArray<CHArray<double>> outer;
+	PrintLine("grow array of 100-point arrays x2",BenchBest([&]()
+	{
+		outer.ResizeArray(numInner,true);
+		for(int i=0; i<numInner; i++) outer[i]=MakeArray(100,i);
+		outer.ResizeArrayKeepPoints(2*numInner);
+	}),n);
+	BenchKeep(outer[numInner/2][0]);
+
+	return 0;
+}
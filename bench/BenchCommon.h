@@ -0,0 +1,65 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#pragma once
+#include "Timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//Shared helpers of the benchmark programs in bench/, see bench/README.md for how to build and run them
+//Every program prints one line per measurement and takes optional numeric arguments to change the problem size
+
+//Runs func until minTime seconds have passed (at least once), returns the fastest single run in seconds
+template <class funcType>
+double BenchBest(funcType func, double minTime = 0.3)
+{
+	CTimer timer;
+	double best=1e300;
+	double total=0;
+
+	do
+	{
+		timer.SetTimerZero(0);
+		func();
+		double t=timer.GetCurTime(0);
+
+		if(t<best) best=t;
+		total+=t;
+	}
+	while(total<minTime);
+
+	return best;
+}
+
+//Numeric command line argument number index (1-based), or defaultValue when it is not given
+inline double BenchArg(int argc, char** argv, int index, double defaultValue)
+{
+	if(index>=argc) return defaultValue;
+	return atof(argv[index]);
+}
+
+//Keeps the compiler from discarding a computed result
+inline void BenchKeep(double value)
+{
+	static volatile double sink=0;
+	sink+=value;
+}
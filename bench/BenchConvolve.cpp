@@ -0,0 +1,114 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Benchmark of CHArray convolution and of CFft
+//Direct vs FFT convolution over a range of kernel lengths, with the path Convolve() picks
+//Forward+inverse transforms of 2^a*3^b*5^c sizes, and the effect of the plan cache on transforms of many sizes
+//Arguments: [longer signal length, default 100000]
+
+#include "BenchCommon.h"
+#include "Array.h"
+#include "Fft.h"
+#include <vector>
+#include <algorithm>
+
+static void RunConvolution(int n)
+{
+	CHArray<double> signal(n,true);
+	for(int i=0; i<n; i++) signal[i]=sin(i*0.01)+(i%17)*0.1;
+
+	for(int m=16; m<=4096 && m<=n; m*=4)
+	{
+		CHArray<double> kernel(m,true);
+		for(int i=0; i<m; i++) kernel[i]=1.0/(1+i%5);
+
+		CHArray<double> direct, fft, chosen;
+		double tDirect=BenchBest([&](){signal.ConvolveDirect(kernel,direct);},0.1);
+		double tFft=BenchBest([&](){signal.ConvolveFft(kernel,fft);},0.1);
+		double tChosen=BenchBest([&](){signal.Convolve(kernel,chosen);},0.1);
+
+		double maxDiff=0;
+		for(int i=0; i<direct.Count(); i++) maxDiff=std::max(maxDiff,fabs(direct[i]-fft[i]));
+
+		bool fPicksDirect=CFft::DirectConvolutionCost(n,m)<=CFft::FftConvolutionCost(n,m);
+		printf("convolve N=%7i M=%5i  direct %9.3f ms  fft %8.3f ms  Convolve %8.3f ms (%s)  max diff %.2g\n",
+			n,m,tDirect*1e3,tFft*1e3,tChosen*1e3,fPicksDirect ? "direct" : "fft",maxDiff);
+	}
+}
+
+static void RunTransforms()
+{
+	long long sizes[6]={1024,1<<20,3*3*3*3*3*3*3*3*3*3*3*2,390625*2,1000*1000,CFft::GoodSize(123457)};
+	for(int s=0; s<6; s++)
+	{
+		long long n=sizes[s];
+		std::vector<CFft::Complex> data((size_t)n);
+		for(long long i=0; i<n; i++) data[(size_t)i]=CFft::Complex(cos(i*0.1),0);
+
+		double t=BenchBest([&]()
+		{
+			CFft::Forward(&data[0],n);
+			CFft::Inverse(&data[0],n);
+		},0.2);
+		printf("forward+inverse n=%8lld  %9.3f ms  %6.2f ns per n*log2(n)\n",n,t*1e3,t*1e9/(n*log((double)n)/log(2.0)));
+	}
+}
+
+//Transforms cycling through numSizes lengths, with room for maxPlans plans
+static void RunPlanCache(int numSizes, int maxPlans)
+{
+	std::vector<long long> sizes;
+	for(int i=0; (int)sizes.size()<numSizes; i++)
+	{
+		long long n=CFft::GoodSize(2000+i*97);
+		if(std::find(sizes.begin(),sizes.end(),n)==sizes.end()) sizes.push_back(n);
+	}
+
+	std::vector<CFft::Complex> data((size_t)sizes.back()+1);
+	CFft::ClearPlans();
+	CFft::SetMaxPlans(maxPlans);
+
+	double t=BenchBest([&]()
+	{
+		for(size_t i=0; i<sizes.size(); i++) CFft::Forward(&data[0],sizes[i]);
+	},0.2);
+	printf("plan cache: %2i sizes in turn, room for %2i plans  %7.2f us per transform, %i plans cached\n",
+		numSizes,maxPlans,t*1e6/numSizes,CFft::NumPlans());
+
+	CFft::SetMaxPlans(32);
+	CFft::ClearPlans();
+}
+
+int main(int argc, char** argv)
+{
+	int n=(int)BenchArg(argc,argv,1,100000);
+
+	RunConvolution(std::min(n,5000));
+	if(n>5000) RunConvolution(n);
+	RunTransforms();
+
+	RunPlanCache(16,32);
+	RunPlanCache(40,32);
+	RunPlanCache(40,64);
+
+	return 0;
+}
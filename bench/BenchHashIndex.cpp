@@ -0,0 +1,145 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Benchmark of the hash index (HashIndex.h) behind CBidirectionalMap and StdHashMap, against the std::map versions
+//Times are ns per operation over a stream of random words with repeats
+//Arguments: [number of operations, default 1000000] [distinct words to draw from, default 400000]
+
+#include "BenchCommon.h"
+#include "BidirectionalMap.h"
+#include "StdMap.h"
+#include <random>
+#include <vector>
+#include <string.h>
+
+template <class keyType>
+void RunMap(const char* name, const std::vector<keyType>& keys, bool fHashed)
+{
+	int n=(int)keys.size();
+	CBidirectionalMap<keyType> map(-1,false,fHashed);
+	CTimer timer;
+
+	timer.SetTimerZero(0);
+	for(int i=0; i<n; i++) map.AddWord(keys[i]);
+	double tAdd=timer.GetCurTime(0);
+
+	long long check=0;
+	double tGet=BenchBest([&]()
+	{
+		for(int i=0; i<n; i++) check+=map.GetIndex(keys[i]);
+	},0.1);
+
+	int count=map.Count();
+	timer.SetTimerZero(0);
+	for(int i=0; i<count/2; i++) map.RemoveWordFast(map.wordArr[0]);
+	double tRemove=timer.GetCurTime(0);
+
+	printf("CBidirectionalMap %-8s %-9s %7i words  AddWord %6.0f ns  GetIndex %6.0f ns  RemoveWordFast %6.0f ns\n",name,
+		fHashed ? "hash" : "std::map",count,tAdd*1e9/n,tGet*1e9/n,tRemove*1e9/std::max(1,count/2));
+	BenchKeep((double)check);
+}
+
+//Lookup from a character buffer, which needs no temporary BString with the hash index
+static void RunCharLookup(const std::vector<BString>& keys, bool fHashed)
+{
+	int n=(int)keys.size();
+	CBidirectionalMap<BString> map(-1,false,fHashed);
+	for(int i=0; i<n; i++) map.AddWord(keys[i]);
+
+	long long check=0;
+	double t=BenchBest([&]()
+	{
+		for(int i=0; i<n; i++) check+=map.GetIndexOfString(keys[i].c_str(),(int)keys[i].length());
+	},0.1);
+
+	printf("CBidirectionalMap BString  %-9s GetIndexOfString %6.0f ns\n",fHashed ? "hash" : "std::map",t*1e9/n);
+	BenchKeep((double)check);
+}
+
+//A handful of words, like the device name maps
+static void RunSmall(bool fHashed)
+{
+	const char* names[8]={"J","K","N","R","S","T","B","E"};
+	CBidirectionalMap<BString> map(-1,false,fHashed);
+	BString keys[8];
+	for(int i=0; i<8; i++)
+	{
+		keys[i]=names[i];
+		map.AddWord(keys[i]);
+	}
+
+	long long check=0;
+	double t=BenchBest([&]()
+	{
+		for(int i=0; i<1000000; i++) check+=map.GetIndex(keys[(i*5)&7]);
+	},0.1);
+
+	printf("CBidirectionalMap 8 words  %-9s GetIndex %6.1f ns\n",fHashed ? "hash" : "std::map",t*1e9/1000000);
+	BenchKeep((double)check);
+}
+
+template <class mapType>
+void RunCounting(const char* name, const std::vector<BString>& keys)
+{
+	int n=(int)keys.size();
+	mapType map;
+	CTimer timer;
+
+	timer.SetTimerZero(0);
+	for(int i=0; i<n; i++) map[keys[i]]+=1;
+	double tCount=timer.GetCurTime(0);
+
+	long long check=0;
+	double tFind=BenchBest([&]()
+	{
+		for(int i=0; i<n; i++) check+=map.IsPresent(keys[i]);
+	},0.1);
+
+	printf("%-11s word counts: operator[] %6.0f ns  IsPresent %6.0f ns\n",name,tCount*1e9/n,tFind*1e9/n);
+	BenchKeep((double)check);
+}
+
+int main(int argc, char** argv)
+{
+	int n=(int)BenchArg(argc,argv,1,1e6);
+	int numDistinct=(int)BenchArg(argc,argv,2,400000);
+
+	std::mt19937 rng(1);
+	std::vector<BString> words(n);
+	std::vector<int> numbers(n);
+	for(int i=0; i<n; i++)
+	{
+		numbers[i]=(int)(rng()%numDistinct);
+		words[i].Format("word_%i",numbers[i]);
+	}
+	printf("%i operations over %i possible words\n",n,numDistinct);
+
+	for(int h=0; h<2; h++) RunMap("BString",words,h==1);
+	for(int h=0; h<2; h++) RunMap("int",numbers,h==1);
+	for(int h=0; h<2; h++) RunCharLookup(words,h==1);
+	for(int h=0; h<2; h++) RunSmall(h==1);
+
+	RunCounting<StdMap<BString,int>>("StdMap",words);
+	RunCounting<StdHashMap<BString,int>>("StdHashMap",words);
+
+	return 0;
+}
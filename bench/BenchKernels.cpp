@@ -0,0 +1,153 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Benchmark of the vectorized kernels in ArrayKernels.h at every instruction set level the CPU supports
+//Prints ns per element for each kernel, size and level; level "scalar" is the plain loop
+//Then times Sum, KahanSum and PairwiseSum and prints their relative error against a long double reference
+//Sizes run from 16 elements up; with MSVC long double is double, so the double errors there only compare the methods
+//Arguments: [largest number of elements, default 100000000]
+
+#include "BenchCommon.h"
+#include "ArrayKernels.h"
+#include "Array.h"
+#include <algorithm>
+#include <math.h>
+
+//Repeats a kernel so that small sizes run long enough for the timer, returns ns per element
+template <class funcType>
+double NsPerElement(funcType func, long long n)
+{
+	long long reps=std::max(1LL,10000000/n);
+	double t=BenchBest([&]()
+	{
+		for(long long r=0; r<reps; r++) func();
+	},0.1);
+	return t*1e9/((double)reps*n);
+}
+
+//int has only the vectorized Sum, so it runs the first numKernels kernels
+template <class theType>
+void RunKernels(const char* typeName, long long n, int maxLevel, int numKernels)
+{
+	CHArray<theType> a((int)n,true), b((int)n,true);
+	for(long long i=0; i<n; i++)
+	{
+		a[i]=(theType)(1+i%13);
+		b[i]=(theType)(0.5+i%7);
+	}
+
+	const char* names[6]={"Sum","SumOfSquares","DirectProduct","SumOfSquaredDev","MultiplyAdd","Scale"};
+	for(int kernel=0; kernel<numKernels; kernel++)
+	{
+		printf("%-7s %-16s %9lld",typeName,names[kernel],n);
+		for(int level=CArrayKernels::level_scalar; level<=maxLevel; level++)
+		{
+			CArrayKernels::SetLevel(level);
+			double ns=NsPerElement([&]()
+			{
+				switch(kernel)
+				{
+				case 0: BenchKeep(CArrayKernel<theType>::Sum(a.arr,n)); break;
+				case 1: BenchKeep(CArrayKernel<theType>::SumOfSquares(a.arr,n)); break;
+				case 2: BenchKeep(CArrayKernel<theType>::DirectProduct(a.arr,b.arr,n)); break;
+				case 3: BenchKeep(CArrayKernel<theType>::SumOfSquaredDev(a.arr,n,(theType)7)); break;
+				case 4: CArrayKernel<theType>::MultiplyAdd(b.arr,a.arr,n,(theType)1e-9); break;
+				case 5: CArrayKernel<theType>::Scale(b.arr,n,(theType)1); break;
+				}
+			},n);
+			printf(" %9.3f",ns);
+		}
+		printf("\n");
+	}
+	CArrayKernels::SetLevel(-1);
+}
+
+//Times the summation methods on values in [0,1) and compares each with a compensated long double sum
+template <class theType>
+void RunSums(const char* typeName, long long n)
+{
+	CHArray<theType> a((int)n,true);
+	unsigned long long state=12345;
+	for(long long i=0; i<n; i++)
+	{
+		state=state*6364136223846793005ULL+1442695040888963407ULL;
+		a[i]=(theType)((double)(state>>11)/9007199254740992.0);
+	}
+
+	long double reference=0, comp=0, y, t;
+	for(long long i=0; i<n; i++)
+	{
+		y=(long double)a[i]-comp;
+		t=reference+y;
+		comp=(t-reference)-y;
+		reference=t;
+	}
+
+	printf("%-7s %9lld",typeName,n);
+	for(int method=0; method<3; method++)
+	{
+		theType sum=0;
+		double ns=NsPerElement([&]()
+		{
+			switch(method)
+			{
+			case 0: sum=CArrayKernel<theType>::Sum(a.arr,n); break;
+			case 1: sum=CArrayKernel<theType>::KahanSum(a.arr,n); break;
+			case 2: sum=CArrayKernel<theType>::PairwiseSum(a.arr,n); break;
+			}
+			BenchKeep((double)sum);
+		},n);
+		printf(" %9.3f %9.1e",ns,(double)fabsl(((long double)sum-reference)/reference));
+	}
+	printf("\n");
+}
+
+//16, 100, 1000 and so on
+long long NextSize(long long n) {return (n<100) ? 100 : n*10;}
+
+int main(int argc, char** argv)
+{
+	long long maxN=(long long)BenchArg(argc,argv,1,1e8);
+	int maxLevel=CArrayKernels::DetectedLevel();
+
+	printf("ns per element; detected level %s\n",CArrayKernels::LevelName(maxLevel));
+	printf("%-7s %-16s %9s","type","kernel","n");
+	for(int level=CArrayKernels::level_scalar; level<=maxLevel; level++) printf(" %9s",CArrayKernels::LevelName(level));
+	printf("\n");
+
+	for(long long n=16; n<=maxN; n=NextSize(n))
+	{
+		RunKernels<double>("double",n,maxLevel,6);
+		RunKernels<float>("float",n,maxLevel,6);
+		RunKernels<int>("int",n,maxLevel,1);
+	}
+
+	printf("\nSummation at level %s: ns per element and relative error\n",CArrayKernels::LevelName(maxLevel));
+	printf("%-7s %9s %9s %9s %9s %9s %9s %9s\n","type","n","Sum","error","Kahan","error","Pairwise","error");
+	for(long long n=16; n<=maxN; n=NextSize(n))
+	{
+		RunSums<double>("double",n);
+		RunSums<float>("float",n);
+	}
+
+	return 0;
+}
@@ -0,0 +1,110 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Benchmark of CKmeans (Kmeans.h) on gaussian blobs
+//Full-batch clustering (k-means++ and Hamerly-bounded Lloyd iterations) next to the cost of one unbounded assignment pass,
+//mini-batch clustering over the same points, and CMatrix::KmeansClustering on a smaller set
+//Inertia is the sum of squared distances of the points to their centers
+//Arguments: [number of points, default 1000000] [coordinates, default 16] [clusters, default 40] [threads, default 0 - all cores]
+
+#include "BenchCommon.h"
+#include "Kmeans.h"
+#include "Matrix.h"
+#include <random>
+#include <algorithm>
+#include <string.h>
+
+static double Inertia(const CKmeans<float>& kmeans, const CHArray<float>& data, int numCoords, const CHArray<int>& clustering)
+{
+	double sum=0;
+	for(int i=0; i<clustering.Count(); i++)
+	{
+		const float* point=data.arr+(long long)i*numCoords;
+		const float* center=kmeans.Center(clustering[i]);
+		for(int c=0; c<numCoords; c++) sum+=(double)(point[c]-center[c])*(point[c]-center[c]);
+	}
+	return sum;
+}
+
+int main(int argc, char** argv)
+{
+	int numPoints=(int)BenchArg(argc,argv,1,1e6);
+	int numCoords=(int)BenchArg(argc,argv,2,16);
+	int k=(int)BenchArg(argc,argv,3,40);
+	CParallelSort::SetNumThreads((int)BenchArg(argc,argv,4,0));
+	printf("%i points, %i coordinates, %i clusters, %i threads\n",numPoints,numCoords,k,CParallelSort::NumThreads());
+
+	//Points scattered around k random true centers
+	std::mt19937_64 rng(1);
+	std::uniform_real_distribution<float> uniform(-10,10);
+	std::normal_distribution<float> normal(0,1);
+
+	CHArray<float> trueCenters(numCoords*k,true);
+	for(int i=0; i<trueCenters.Count(); i++) trueCenters[i]=uniform(rng);
+
+	CHArray<float> data((int)((long long)numPoints*numCoords),true);
+	for(int i=0; i<numPoints; i++)
+	{
+		int cluster=(int)(rng()%k);
+		for(int c=0; c<numCoords; c++) data[i*numCoords+c]=trueCenters[cluster*numCoords+c]+normal(rng);
+	}
+
+	//Full batch
+	CKmeans<float> kmeans(numCoords,k);
+	CHArray<int> clustering, nearest;
+	CTimer timer;
+	timer.SetTimerZero(0);
+	kmeans.Cluster(data.arr,numPoints,clustering);
+	double tCluster=timer.GetCurTime(0);
+
+	double tAssign=BenchBest([&](){kmeans.Assign(data.arr,numPoints,nearest);},0.2);
+	int numMoved=0;
+	for(int i=0; i<numPoints; i++) if(nearest[i]!=clustering[i]) numMoved++;
+
+	printf("Cluster          %8.3f s, %3i iterations, %7.2f ms per iteration, inertia %.6g, %i points not at the nearest center\n",
+		tCluster,kmeans.NumIterations(),tCluster*1e3/std::max(1,kmeans.NumIterations()),Inertia(kmeans,data,numCoords,clustering),numMoved);
+	printf("unbounded pass   %8.2f ms (all %lld distances, the cost of one plain Lloyd iteration)\n",
+		tAssign*1e3,(long long)numPoints*k);
+
+	//Mini-batch over the same points
+	const int batchSize=1000;
+	CKmeans<float> miniBatch(numCoords,k);
+	timer.SetTimerZero(0);
+	for(int start=0; start+batchSize<=numPoints; start+=batchSize) miniBatch.UpdateMiniBatch(data.arr+(long long)start*numCoords,batchSize);
+	double tMiniBatch=timer.GetCurTime(0);
+	miniBatch.Assign(data.arr,numPoints,nearest);
+
+	printf("mini-batch %4i  %8.3f s, inertia %.6g\n",batchSize,tMiniBatch,Inertia(miniBatch,data,numCoords,nearest));
+
+	//Through CMatrix, one point per column
+	int matrixPoints=std::min(numPoints,100000);
+	CMatrix<float> mat(matrixPoints,numCoords);
+	memcpy(mat.theArray.arr,data.arr,sizeof(float)*matrixPoints*numCoords);
+
+	CHArray<CHArray<int>> clusters;
+	timer.SetTimerZero(0);
+	mat.KmeansClustering(k,clusters);
+	printf("CMatrix::KmeansClustering, %i points %8.3f s, largest cluster %i points\n",matrixPoints,timer.GetCurTime(0),
+		clusters.Count() ? clusters[0].Count() : 0);
+
+	return 0;
+}
@@ -0,0 +1,123 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Benchmark of CMatrix products: MatMultiply in every transpose combination, the self product A.A^T and MatVecMultiply
+//Runs the native CLinearAlgebra kernels and, in builds with MKL, MKL as well
+//GFLOP/s count 2*n^3 operations for every product, also for the self product that does half of that work
+//Arguments: [largest size, default 1024] [threads, default 0 - all cores]
+
+#include "BenchCommon.h"
+#include "Matrix.h"
+#include "LinearAlgebra.h"
+#include <random>
+#include <algorithm>
+
+template <class theType>
+void FillRandom(CMatrix<theType>& mat, std::mt19937_64& rng)
+{
+	std::uniform_real_distribution<double> uniform(-1,1);
+	for(int i=0; i<mat.theArray.Count(); i++) mat.theArray[i]=(theType)uniform(rng);
+}
+
+//Plain triple loop, for reference and for checking the kernels
+template <class theType>
+void NaiveMultiply(const CMatrix<theType>& A, const CMatrix<theType>& B, CMatrix<theType>& C)
+{
+	int n=A.rows;
+	C.ResizeMatrix(n,n);
+	for(int col=0; col<n; col++)
+	{
+		for(int row=0; row<n; row++)
+		{
+			double sum=0;
+			for(int i=0; i<n; i++) sum+=A.ElementAt(i,row)*B.ElementAt(col,i);
+			C.ElementAt(col,row)=(theType)sum;
+		}
+	}
+}
+
+template <class theType>
+void RunType(const char* typeName, int n, const char* backendName, std::mt19937_64& rng)
+{
+	CMatrix<theType> A(n,n), B(n,n), C(n,n);
+	FillRandom(A,rng);
+	FillRandom(B,rng);
+
+	double flops=2.0*n*n*(double)n;
+	const char* combos[4]={"A.B","A^T.B","A.B^T","A^T.B^T"};
+
+	printf("%-6s %-6s n=%5i ",typeName,backendName,n);
+	for(int c=0; c<4; c++)
+	{
+		double t=BenchBest([&](){A.MatMultiply(B,C,(c&1)!=0,(c&2)!=0);},0.2);
+		printf(" %s %6.1f",combos[c],flops/t*1e-9);
+	}
+
+	double tSelf=BenchBest([&](){A.MatMultiply(A,C,false,true);},0.2);
+	printf("  A.A^T %6.1f",flops/tSelf*1e-9);
+
+	CHArray<theType> vec(n,true), result;
+	vec=(theType)1;
+	double tVec=BenchBest([&](){A.MatVecMultiply(vec,result);},0.1);
+	printf("  A.x %5.2f GFLOP/s\n",2.0*n*n/tVec*1e-9);
+
+	//Accuracy against the plain loop at the sizes where it is affordable
+	if(n<=512)
+	{
+		CMatrix<theType> reference;
+		NaiveMultiply(A,B,reference);
+		A.MatMultiply(B,C);
+
+		double maxError=0;
+		for(int i=0; i<C.theArray.Count(); i++) maxError=std::max(maxError,(double)fabs(C.theArray[i]-reference.theArray[i]));
+		if(sizeof(theType)==sizeof(double))
+		{
+			double tNaive=BenchBest([&](){NaiveMultiply(A,B,reference);},0);
+			printf("%-6s %-6s n=%5i  naive loop %6.2f GFLOP/s, max difference from it %.2g\n",typeName,backendName,n,flops/tNaive*1e-9,maxError);
+		}
+		else printf("%-6s %-6s n=%5i  max difference from the naive loop %.2g\n",typeName,backendName,n,maxError);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int maxN=(int)BenchArg(argc,argv,1,1024);
+	CParallelSort::SetNumThreads((int)BenchArg(argc,argv,2,0));
+	printf("GFLOP/s, %i threads, kernel level %s, MKL %s\n",CParallelSort::NumThreads(),
+		CArrayKernels::LevelName(CArrayKernels::Level()),CLinearAlgebra::HasMkl() ? "available" : "not built in");
+
+	std::mt19937_64 rng(1);
+	for(int backend=CLinearAlgebra::backend_mkl; backend<=CLinearAlgebra::backend_native; backend++)
+	{
+		if(backend==CLinearAlgebra::backend_mkl && !CLinearAlgebra::HasMkl()) continue;
+		CLinearAlgebra::SetBackend(backend);
+		const char* backendName=(backend==CLinearAlgebra::backend_mkl) ? "MKL" : "native";
+
+		for(int n=128; n<=maxN; n*=2)
+		{
+			RunType<double>("double",n,backendName,rng);
+			RunType<float>("float",n,backendName,rng);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,119 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Benchmark of CPeakFit: 20 peaks on 2000-point spectra, for every peak shape
+//Reports iterations and time of a single fit and the throughput of FitMany on 1 and on all threads
+//Arguments: [number of spectra for FitMany, default 32]
+
+#include "BenchCommon.h"
+#include "PeakFit.h"
+#include <random>
+#include <math.h>
+#include <algorithm>
+
+int main(int argc, char** argv)
+{
+	int numSpectra=(int)BenchArg(argc,argv,1,32);
+	const int numPeaks=20;
+	const int numPoints=2000;
+	const char* shapeNames[3]={"gaussian","lorentzian","pseudo-Voigt"};
+
+	std::mt19937 rng(1);
+	std::normal_distribution<double> noise(0,1);
+
+	CHArray<double> x(numPoints);
+	for(int i=0; i<numPoints; i++) x.AddPoint(i*0.06);
+
+	printf("%i peaks, %i points, %i spectra for FitMany\n",numPeaks,numPoints,numSpectra);
+
+	for(int shape=0; shape<3; shape++)
+	{
+		CPeakFit fit(shape);
+
+		//Noisy spectra of the same peaks, and perturbed initial guesses
+		CHArray<FitPeak> truth(numPeaks);
+		for(int k=0; k<numPeaks; k++) truth.AddPoint(FitPeak(10+k*5+0.3*noise(rng),1.5+0.2*k/numPeaks,1+k%4,0.3));
+
+		CHArray<double> y;
+		fit.Evaluate(x,truth,0.2,y);
+
+		CHArray<CData> data(numSpectra);
+		CHArray<CHArray<FitPeak>> guesses(numSpectra);
+		CHArray<double> baselines(numSpectra);
+
+		for(int s=0; s<numSpectra; s++)
+		{
+			CData spectrum(numPoints);
+			for(int i=0; i<numPoints; i++) spectrum.AddPoint(x[i],y[i]+0.01*noise(rng));
+			data.AddPoint(spectrum);
+
+			CHArray<FitPeak> guess=truth;
+			for(int k=0; k<numPeaks; k++)
+			{
+				guess[k].pos+=0.3*noise(rng);
+				guess[k].width*=1.2;
+				guess[k].amplitude*=0.8;
+				guess[k].eta=0.5;
+			}
+			guesses.AddPoint(guess);
+			baselines.AddPoint(0);
+		}
+
+		//Single fit
+		CHArray<FitPeak> peaks;
+		double baseline=0;
+		BString status;
+		double single=BenchBest([&]()
+		{
+			peaks=guesses[0];
+			baseline=0;
+			status=fit.Fit(data[0],peaks,baseline);
+		});
+
+		double maxPosError=0;
+		for(int k=0; k<numPeaks; k++) maxPosError=std::max(maxPosError,fabs(peaks[k].pos-truth[k].pos));
+
+		printf("%-12s %-20s %8.2f ms, %2i iterations, chi^2 %.4g, max position error %.3g, %s\n",shapeNames[shape],"Fit",
+			single*1e3,fit.numIterations,fit.chiSquared,maxPosError,status.c_str());
+
+		//Batch on one thread and on all threads
+		for(int pass=0; pass<2; pass++)
+		{
+			int numThreads=(pass==0) ? 1 : 0;
+			CHArray<double> chiSquared;
+			CHArray<bool> converged;
+			int numFailed=0;
+
+			double batch=BenchBest([&]()
+			{
+				CHArray<CHArray<FitPeak>> batchPeaks=guesses;
+				CHArray<double> batchBaselines=baselines;
+				numFailed=fit.FitMany(data,batchPeaks,batchBaselines,chiSquared,converged,numThreads);
+			});
+
+			printf("%-12s %-20s %8.1f ms, %6.1f spectra/s, %i not converged\n",shapeNames[shape],
+				(pass==0) ? "FitMany, 1 thread" : "FitMany, all threads",batch*1e3,numSpectra/batch,numFailed);
+		}
+	}
+
+	return 0;
+}
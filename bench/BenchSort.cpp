@@ -0,0 +1,120 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Benchmark of CHArray sorting (ParallelSort.h) against the standard library
+//For each size from 10^6 up: value sorts, index sorts and in-place permutation, for several key types
+//10^9 doubles need about 20 GB of memory with the copies kept for verification
+//Arguments: [largest number of elements, default 10000000] [threads, default 0 - all cores]
+
+#include "BenchCommon.h"
+#include "Array.h"
+#include "BString.h"
+#include <algorithm>
+#include <random>
+
+//Best of a few runs of sort, each on a fresh copy of source made by setup (not timed)
+template <class setupType, class sortType>
+double TimeSort(setupType setup, sortType sort, long long n)
+{
+	CTimer timer;
+	int runs=(n>=100000000) ? 1 : 3;
+	double best=1e300;
+
+	for(int r=0; r<runs; r++)
+	{
+		setup();
+		timer.SetTimerZero(0);
+		sort();
+		best=std::min(best,timer.GetCurTime(0));
+	}
+	return best;
+}
+
+template <class theType>
+void RunType(const char* typeName, int n, std::mt19937_64& rng)
+{
+	CHArray<theType> source(n,true), work(n,true);
+	std::vector<theType> reference;
+	for(int i=0; i<n; i++) source[i]=(theType)(rng()%2000000000)*(theType)((i&1) ? 1 : -1);
+
+	double tStd=TimeSort([&](){reference.assign(source.arr,source.arr+n);},[&](){std::sort(reference.begin(),reference.end());},n);
+	double tStable=TimeSort([&](){work=source;},[&](){std::stable_sort(work.arr,work.arr+n);},n);
+	double tSort=TimeSort([&](){work=source;},[&](){work.Sort();},n);
+	bool fOk=std::equal(reference.begin(),reference.end(),work.arr);
+
+	printf("%-9s n=%10i  std::sort %9.1f ms  std::stable_sort %9.1f ms  CHArray::Sort %9.1f ms%s\n",
+		typeName,n,tStd*1e3,tStable*1e3,tSort*1e3,fOk ? "" : "  MISMATCH");
+
+	//Indices that sort the values
+	CHArray<int> indices(n,true), perm;
+	double tStdIndices=TimeSort([&](){indices.SetValToPointNum();},[&]()
+	{
+		std::stable_sort(indices.arr,indices.arr+n,[&](int a, int b){return source[a]<source[b];});
+	},n);
+	double tSortPerm=TimeSort([](){},[&](){source.SortPermutation(perm);},n);
+	fOk=std::equal(indices.arr,indices.arr+n,perm.arr);
+
+	//Apply the permutation: gather into a copy vs in place
+	double tGather=TimeSort([](){},[&]()
+	{
+		work.ResizeArray(n,true);
+		for(int i=0; i<n; i++) work[i]=source[perm[i]];
+	},n);
+	double tPermute=TimeSort([&](){work=source;},[&](){work.Permute(perm);},n);
+
+	printf("%-9s n=%10i  stable index sort %9.1f ms  SortPermutation %9.1f ms%s  gather %7.1f ms  Permute %7.1f ms\n",
+		typeName,n,tStdIndices*1e3,tSortPerm*1e3,fOk ? "" : "  MISMATCH",tGather*1e3,tPermute*1e3);
+}
+
+//Non-numeric keys take the parallel comparison sort
+static void RunStrings(int n, std::mt19937_64& rng)
+{
+	CHArray<BString> source(n,true), work(n,true);
+	std::vector<BString> reference;
+	for(int i=0; i<n; i++) source[i].Format("key%llu",(unsigned long long)(rng()%100000000));
+
+	double tStd=TimeSort([&](){reference.assign(source.arr,source.arr+n);},[&](){std::sort(reference.begin(),reference.end());},n);
+	double tSort=TimeSort([&](){work=source;},[&](){work.Sort();},n);
+	bool fOk=std::equal(reference.begin(),reference.end(),work.arr);
+
+	printf("%-9s n=%10i  std::sort %9.1f ms  CHArray::Sort %9.1f ms%s\n",
+		"BString",n,tStd*1e3,tSort*1e3,fOk ? "" : "  MISMATCH");
+}
+
+int main(int argc, char** argv)
+{
+	double maxN=BenchArg(argc,argv,1,1e7);
+	CParallelSort::SetNumThreads((int)BenchArg(argc,argv,2,0));
+	printf("%i threads\n",CParallelSort::NumThreads());
+
+	std::mt19937_64 rng(1);
+	for(double n=1e6; n<=maxN; n*=10)
+	{
+		RunType<double>("double",(int)n,rng);
+		RunType<float>("float",(int)n,rng);
+		RunType<int>("int",(int)n,rng);
+		RunType<long long>("long long",(int)n,rng);
+		if(n<=1e7) RunStrings((int)n,rng);
+	}
+
+	return 0;
+}
@@ -0,0 +1,264 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Benchmark of BString formatting, concatenation and CStringArena, with heap allocation counts
+//Global operator new is replaced by a counting one, so every line reports allocations per operation next to the time
+//Also counts the allocations of saving a saveob to an XML node, the path that writes every device setting,
+//and of a QMS command: QmsSendReceive() over a QmsReplayPort, as ExpDeviceQms::SendReceive() runs it without the Qt signals
+//Needs the saveob, XML and transcript sources on top of the common list, see bench/README.md
+//Arguments: [number of operations, default 160000]
+
+#include "BenchCommon.h"
+#include "BString.h"
+#include "StringArena.h"
+#include "SaveobToXml.h"
+#include "SaveobTermArray.h"
+#include "Qt/Qms/QmsPort.h"
+#include <new>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+//g++ pairs the inlined free() below with the replaced operator new and reports a mismatch that is not there
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__>=11
+	#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static long long numAllocations=0;
+
+void* operator new(size_t size)
+{
+	numAllocations++;
+	void* p=malloc(size ? size : 1);
+	if(p==NULL) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	numAllocations++;
+	void* p=malloc(size ? size : 1);
+	if(p==NULL) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) throw() {free(p);}
+void operator delete[](void* p) throw() {free(p);}
+void operator delete(void* p, size_t) throw() {free(p);}
+void operator delete[](void* p, size_t) throw() {free(p);}
+
+//Times one pass of func over n operations and counts its allocations
+template <class funcType>
+void Run(const char* name, int n, funcType func)
+{
+	long long startAllocations=numAllocations;
+	CTimer timer;
+	timer.SetTimerZero(0);
+	func();
+	double t=timer.GetCurTime(0);
+
+	printf("%-44s %10.1f ns/op %8.3f allocs/op\n",name,t*1e9/n,(double)(numAllocations-startAllocations)/n);
+}
+
+//45 terms and 5 arrays with 900 values, all in one saveob or with the ints in a sub-object
+static void RunXmlSave(int numSaves, bool fNested)
+{
+	SaveobComp root(BString("root")), sub(BString("sub"));
+	SaveobComp& intParent=fNested ? sub : root;
+	std::vector<std::unique_ptr<Saveob>> terms;
+	double doubles[20];
+	int ints[20];
+	BString strings[5];
+	CHArray<double> arrays[4];
+	CHArray<int> intArray;
+	char name[32];
+
+	for(int k=0; k<20; k++)
+	{
+		doubles[k]=k*1.2345e3;
+		ints[k]=k*17;
+		sprintf(name,"d%i",k);
+		terms.emplace_back(new SaveobTerm<double>(name,doubles[k]));
+		root.AddChild(terms.back().get());
+		sprintf(name,"i%i",k);
+		terms.emplace_back(new SaveobTerm<int>(name,ints[k]));
+		intParent.AddChild(terms.back().get());
+	}
+	for(int k=0; k<5; k++)
+	{
+		strings[k].Format("string value number %i with some length",k);
+		sprintf(name,"s%i",k);
+		terms.emplace_back(new SaveobTerm<BString>(name,strings[k]));
+		root.AddChild(terms.back().get());
+	}
+	for(int k=0; k<4; k++)
+	{
+		for(int j=0; j<200; j++) arrays[k].AddAndExtend(j*0.37+k);
+		sprintf(name,"a%i",k);
+		terms.emplace_back(new SaveobTermArray<double>(name,arrays[k]));
+		root.AddChild(terms.back().get());
+	}
+	for(int j=0; j<100; j++) intArray.AddAndExtend(j*3);
+	terms.emplace_back(new SaveobTermArray<int>("ia",intArray));
+	intParent.AddChild(terms.back().get());
+	if(fNested) root.AddChild(&sub);
+
+	pugi::xml_document doc;
+	pugi::xml_node rootNode=doc.append_child("root");
+	SaveobToXml::WriteSaveobDataToNode(root,rootNode);		//The first save creates the nodes
+
+	Run(fNested ? "XML save, saveob with a sub-object" : "XML save, flat saveob",numSaves,[&]()
+	{
+		for(int i=0; i<numSaves; i++) SaveobToXml::WriteSaveobDataToNode(root,rootNode);
+	});
+}
+
+//The SendReceive() loop before the buffers were reused: a new command string, one byte per read, Right() and Left()
+static BString OldSendReceive(QmsPort& port, const BString& command, const BString& termToQms, const BString& termFromQms)
+{
+	port.write(command + termToQms);
+
+	BString response;
+	int termLength = termFromQms.GetLength();
+	while (1)
+	{
+		if (port.available())
+		{
+			while (port.available()) response += port.read();
+
+			if (response.Right(termLength) == termFromQms) break;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	return response.Left(response.GetLength() - termLength);
+}
+
+//A replayed transcript of numCommands commands, each answered with a 30-character response as the Hiden HAL does
+static void RunQmsCommands(int numCommands)
+{
+	BString termToQms("\r"), termFromQms("\r\n"), command("pget mass"), response;
+	CHArray<QmsTranscriptEntry> entries(2*numCommands,false);
+	for(int i=0; i<numCommands; i++)
+	{
+		response.Format("%.6e, %.6e, %i",i*0.01,1.25e-9*(i%97),i%5);
+		response.resize(30,' ');
+		entries << QmsTranscriptEntry(0,true,command) << QmsTranscriptEntry(0,false,response);
+	}
+
+	QmsTranscript transcript(100);
+	for(int k=0; k<100; k++) {transcript.Add(true,command); transcript.Add(false,response);}	//Fills the ring
+	BString sendBuffer, receiveBuffer;
+
+	for(int pass=0; pass<3; pass++)
+	{
+		QmsReplayPort port(entries,termFromQms);
+		const char* names[3]={"QMS command, SendReceive before reuse","QMS command, QmsSendReceive","QMS command, QmsSendReceive + transcript"};
+
+		//A warm-up command, so that the reused buffers are already allocated
+		QmsSendReceive(port,command,termToQms,termFromQms,sendBuffer,receiveBuffer);
+
+		Run(names[pass],numCommands-1,[&]()
+		{
+			for(int i=1; i<numCommands; i++)
+			{
+				if(pass==0) {BenchKeep((double)OldSendReceive(port,command,termToQms,termFromQms).length()); continue;}
+
+				if(pass==2) transcript.Add(true,command);
+				BString result=QmsSendReceive(port,command,termToQms,termFromQms,sendBuffer,receiveBuffer);
+				if(pass==2) transcript.Add(false,result);
+				BenchKeep((double)result.length());
+			}
+		});
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int n=(int)BenchArg(argc,argv,1,160000);
+	printf("%i operations\n",n);
+
+	BString text;
+	Run("AppendFormat(\"%d \") to one string",n,[&]()
+	{
+		text.clear();
+		for(int i=0; i<n; i++) text.AppendFormat("%d ",i);
+	});
+	BenchKeep((double)text.length());
+
+	Run("Format(\"%d\") into a reused 16 MB string",n,[&]()
+	{
+		text.reserve(1<<24);
+		for(int i=0; i<n; i++) text.Format("%d",i);
+	});
+
+	Run("Format(\"%d\") into a new string",n,[&]()
+	{
+		for(int i=0; i<n; i++)
+		{
+			BString number;
+			number.Format("%d",i);
+			BenchKeep((double)number.length());
+		}
+	});
+
+	BString deviceName("Hiden HAL 201"), error("no response from the serial port");
+	Run("\"Device \" + name + \": \" + error",n,[&]()
+	{
+		for(int i=0; i<n; i++)
+		{
+			BString message="Device "+deviceName+": "+error;
+			BenchKeep((double)message.length());
+		}
+	});
+
+	CStringArena& arena=CStringArena::ForThread();
+	arena.Format("warm up");
+	arena.Reset();
+	Run("CStringArena::Format + Rewind",n,[&]()
+	{
+		for(int i=0; i<n; i++)
+		{
+			CStringArenaScope scope(arena);
+			BStringView command=arena.Format("SEM %i, %s",i%7,deviceName.c_str());
+			BenchKeep((double)command.GetLength());
+		}
+	});
+
+	Run("BString::Format of the same command",n,[&]()
+	{
+		for(int i=0; i<n; i++)
+		{
+			BString command;
+			command.Format("SEM %i, %s",i%7,deviceName.c_str());
+			BenchKeep((double)command.length());
+		}
+	});
+
+	RunXmlSave(std::max(1,n/800),false);
+	RunXmlSave(std::max(1,n/800),true);
+
+	RunQmsCommands(std::max(2,n/4));
+
+	return 0;
+}
@@ -0,0 +1,157 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Benchmark of the text Read()/Write() of CData, CHArray and CMatrix (TextCodec.h)
+//Throughput in MB/s of file text, next to a per-value sprintf/fputs and fgetc/atof loop like the one the codec replaced
+//Writes BenchTextCodec.tmp in the current directory and deletes it at the end
+//Arguments: [number of points, default 1000000] [threads for reading, default 0 - all cores]
+
+#include "BenchCommon.h"
+#include "Data.h"
+#include "Matrix.h"
+#include <random>
+#include <vector>
+#include <string.h>
+
+static const char* tempFile="BenchTextCodec.tmp";
+
+static double FileMB()
+{
+	FILE* file=fopen(tempFile,"rb");
+	if(file==NULL) return 0;
+	fseek(file,0,SEEK_END);
+	double size=(double)ftell(file);
+	fclose(file);
+	return size/1e6;
+}
+
+static void PrintLine(const char* name, const char* format, double writeTime, double readTime, bool fOk)
+{
+	double mb=FileMB();
+	printf("%-22s %-6s %8.1f MB  write %7.3f s %7.1f MB/s  read %7.3f s %7.1f MB/s%s\n",name,format,mb,
+		writeTime,mb/writeTime,readTime,mb/readTime,fOk ? "" : "  MISMATCH");
+}
+
+//One value per fputs and one character per fgetc, as CData::Write and Read did before the codec
+static void RunPerValue(const CData& data)
+{
+	double writeTime=BenchBest([&]()
+	{
+		FILE* file=fopen(tempFile,"w");
+		char buffer[64];
+		for(int i=0; i<data.xArr.Count(); i++)
+		{
+			sprintf(buffer,"%.4e",data.xArr[i]); fputs(buffer,file); fputc(' ',file);
+			sprintf(buffer,"%.4e",data.yArr[i]); fputs(buffer,file); fputc('\n',file);
+		}
+		fclose(file);
+	},0);
+
+	std::vector<double> values;
+	double readTime=BenchBest([&]()
+	{
+		values.clear();
+		FILE* file=fopen(tempFile,"r");
+		char buffer[64];
+		int length=0;
+		while(true)
+		{
+			int c=fgetc(file);
+			if(c==EOF || c<=' ')
+			{
+				if(length>0) {buffer[length]=0; values.push_back(atof(buffer)); length=0;}
+				if(c==EOF) break;
+			}
+			else if(length<63) buffer[length++]=(char)c;
+		}
+		fclose(file);
+	},0);
+
+	PrintLine("fputs/fgetc per value","%.4e",writeTime,readTime,(int)values.size()==2*data.xArr.Count());
+}
+
+static void RunData(const CData& data, const char* format)
+{
+	CData readBack;
+	double writeTime=BenchBest([&](){data.Write(tempFile,format);},0);
+	double readTime=BenchBest([&](){readBack.Read(tempFile);},0);
+
+	bool fOk=readBack.xArr.Count()==data.xArr.Count();
+	if(fOk && !strcmp(format,"%r"))
+		for(int i=0; i<data.xArr.Count() && fOk; i++) fOk=(readBack.xArr[i]==data.xArr[i] && readBack.yArr[i]==data.yArr[i]);
+
+	PrintLine("CData",format,writeTime,readTime,fOk);
+}
+
+static void RunArray(const CHArray<double>& arr, const char* format)
+{
+	CHArray<double> readBack;
+	double writeTime=BenchBest([&](){arr.Write(tempFile,format);},0);
+	double readTime=BenchBest([&](){readBack.Read(tempFile);},0);
+
+	bool fOk=readBack.Count()==arr.Count();
+	if(fOk && !strcmp(format,"%r")) fOk=(memcmp(readBack.arr,arr.arr,sizeof(double)*arr.Count())==0);
+
+	PrintLine("CHArray<double>",format,writeTime,readTime,fOk);
+}
+
+static void RunMatrix(CMatrix<double>& mat, const char* format)
+{
+	CMatrix<double> readBack;
+	double writeTime=BenchBest([&](){mat.Write(tempFile,format);},0);
+	double readTime=BenchBest([&](){readBack.Read(tempFile);},0);
+
+	bool fOk=(readBack.cols==mat.cols && readBack.rows==mat.rows);
+	if(fOk && !strcmp(format,"%r")) fOk=(memcmp(readBack.theArray.arr,mat.theArray.arr,sizeof(double)*mat.theArray.Count())==0);
+
+	PrintLine("CMatrix<double> 8 cols",format,writeTime,readTime,fOk);
+}
+
+int main(int argc, char** argv)
+{
+	int n=(int)BenchArg(argc,argv,1,1e6);
+	CParallelSort::SetNumThreads((int)BenchArg(argc,argv,2,0));
+	printf("%i points, %i threads for reading\n",n,CParallelSort::NumThreads());
+
+	std::mt19937_64 rng(1);
+	std::uniform_real_distribution<double> uniform(-1e3,1e3);
+
+	CData data(n);
+	for(int i=0; i<n; i++) data.AddPoint(i*0.01,uniform(rng));
+
+	CHArray<double> arr(n,true);
+	for(int i=0; i<n; i++) arr[i]=uniform(rng);
+
+	CMatrix<double> mat(8,n/8);
+	for(int i=0; i<mat.theArray.Count(); i++) mat.theArray[i]=uniform(rng);
+
+	RunPerValue(data);
+	RunData(data,"%.4e");
+	RunData(data,"%r");
+	RunArray(arr,"%.5e");
+	RunArray(arr,"%r");
+	RunMatrix(mat,"%.5e");
+	RunMatrix(mat,"%r");
+
+	remove(tempFile);
+	return 0;
+}
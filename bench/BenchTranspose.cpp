@@ -0,0 +1,112 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Benchmark of the blocked CMatrix transposes next to plain element-by-element loops
+//GB/s count every element once read and once written
+//Arguments: [size scale, default 1 - scales the number of rows of every shape]
+
+#include "BenchCommon.h"
+#include "Matrix.h"
+#include <string.h>
+#include <algorithm>
+
+template <class theType>
+void Fill(CMatrix<theType>& mat)
+{
+	for(int i=0; i<mat.theArray.Count(); i++) mat.theArray[i]=(theType)(i%1000);
+}
+
+template <class theType>
+void RunCopyTranspose(const char* typeName, int cols, int rows)
+{
+	CMatrix<theType> source(cols,rows), target, plain(rows,cols);
+	Fill(source);
+	double gb=2.0*sizeof(theType)*(double)cols*rows/1e9;
+
+	double tPlain=BenchBest([&]()
+	{
+		for(int c=0; c<cols; c++)
+			for(int r=0; r<rows; r++) plain.ElementAt(r,c)=source.ElementAt(c,r);
+	});
+	double tBlocked=BenchBest([&](){target.CopyTransposeFrom(source);});
+	bool fOk=(memcmp(target.theArray.arr,plain.theArray.arr,sizeof(theType)*plain.theArray.Count())==0);
+
+	printf("CopyTransposeFrom %-6s %7i x %-7i  plain %6.2f GB/s  blocked %6.2f GB/s%s\n",typeName,cols,rows,
+		gb/tPlain,gb/tBlocked,fOk ? "" : "  MISMATCH");
+}
+
+static void RunSquare(int n)
+{
+	CMatrix<double> mat(n,n), copy(n,n);
+	Fill(mat);
+
+	double tPlain=BenchBest([&]()
+	{
+		for(int c=0; c<n; c++)
+			for(int r=c+1; r<n; r++) std::swap(mat.ElementAt(c,r),mat.ElementAt(r,c));
+	});
+	double tInPlace=BenchBest([&](){mat.Transpose();});
+
+	copy.CopyFromMatrix(mat);
+	mat.Transpose();
+	bool fOk=true;
+	for(int c=0; c<n && fOk; c++) for(int r=0; r<n && fOk; r++) fOk=(mat.ElementAt(c,r)==copy.ElementAt(r,c));
+
+	printf("Transpose in place double %5i x %-5i  plain swap %7.1f ms  blocked %7.1f ms%s\n",n,n,tPlain*1e3,tInPlace*1e3,fOk ? "" : "  MISMATCH");
+}
+
+static void RunRowExport(int cols, int rows)
+{
+	CMatrix<double> mat(cols,rows), back;
+	Fill(mat);
+	CHArray<CHArray<double>> result;
+
+	double tPlain=BenchBest([&]()
+	{
+		result.ResizeArray(rows,true);
+		for(int r=0; r<rows; r++)
+		{
+			result[r].ResizeArray(cols,true);
+			for(int c=0; c<cols; c++) result[r][c]=mat.ElementAt(c,r);
+		}
+	});
+	double tExport=BenchBest([&](){mat.ExportRowsToArrayOfArrays(result);});
+	double tImport=BenchBest([&](){back.ImportRowsFromArrayOfArrays(result);});
+	bool fOk=(memcmp(back.theArray.arr,mat.theArray.arr,sizeof(double)*mat.theArray.Count())==0);
+
+	printf("rows of double    %7i x %-7i  plain export %7.1f ms  ExportRows %7.1f ms  ImportRows %7.1f ms%s\n",cols,rows,
+		tPlain*1e3,tExport*1e3,tImport*1e3,fOk ? "" : "  MISMATCH");
+}
+
+int main(int argc, char** argv)
+{
+	double scale=BenchArg(argc,argv,1,1);
+
+	RunCopyTranspose<double>("double",4096,(int)(4096*scale));
+	RunCopyTranspose<float>("float",3000,(int)(5000*scale));
+	RunCopyTranspose<double>("double",8,(int)(1000000*scale));
+	RunCopyTranspose<double>("double",1000000,(int)(8*scale));
+	RunSquare((int)(4096*scale));
+	RunRowExport(1000,(int)(20000*scale));
+
+	return 0;
+}
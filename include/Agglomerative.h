@@ -0,0 +1,257 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Centroid-linkage agglomerative clustering engine used by CMatrix::AgglomerativeClustering
+//
+//Squared distances between clusters are kept in a condensed upper-triangular store (n(n-1)/2 values,
+//filled in parallel) and updated with the Lance-Williams formula for centroids when two clusters merge,
+//so cluster coordinates are never recomputed
+//Every cluster keeps its nearest neighbor among the clusters with larger numbers, and a min-heap of those
+//distances gives the closest pair; entries made stale by merges are refreshed when they reach the top
+//(the generic algorithm of Mullner, fastcluster - centroid linkage is not reducible, so the nearest-neighbor
+//chain does not apply). Typically O(n^2 log n) instead of O(n^3)
+//Points are assigned to clusters with union-find at the end
+
+#pragma once
+#include "Array.h"
+#include "ParallelSort.h"
+#include <atomic>
+#include <math.h>
+
+template <class theType, class intType=int> class CAgglomerative
+{
+public:
+	//data - numPoints columns of numCoords coordinates (column-major)
+	//The closest pair of cluster centers is merged until the entropic number of cluster sizes
+	//is no more than entropicLimit, numPoints >= entropicLimit >= 1
+	//clustering - cluster of every point, clusters are numbered in the order of their first points
+	//sizes - number of points in every cluster
+	static bool Cluster(const theType* data, intType numCoords, intType numPoints, double entropicLimit,
+						CHArray<intType,intType>& clustering, CHArray<intType,intType>& sizes);
+
+private:
+	//Position of pair (i,j), i<j, in the condensed store
+	static int64 PairIndex(int64 i, int64 j, int64 n) {return i*n-i*(i+1)/2+(j-i-1);}
+
+	//Binary min-heap of cluster numbers keyed by keys[], pos[] - place of every cluster in the heap (-1 - absent)
+	static void HeapUp(intType* heap, intType* pos, const theType* keys, intType place);
+	static void HeapDown(intType* heap, intType* pos, const theType* keys, intType place, intType heapSize);
+
+	static intType FindRoot(intType* parent, intType i);
+};
+
+template <class theType, class intType>
+void CAgglomerative<theType,intType>::HeapUp(intType* heap, intType* pos, const theType* keys, intType place)
+{
+	intType cur=heap[place];
+	while(place>0)
+	{
+		intType parentPlace=(place-1)/2;
+		if(!(keys[cur]<keys[heap[parentPlace]])) break;
+		heap[place]=heap[parentPlace];
+		pos[heap[place]]=place;
+		place=parentPlace;
+	}
+	heap[place]=cur;
+	pos[cur]=place;
+}
+
+template <class theType, class intType>
+void CAgglomerative<theType,intType>::HeapDown(intType* heap, intType* pos, const theType* keys, intType place, intType heapSize)
+{
+	intType cur=heap[place];
+	while(true)
+	{
+		intType child=2*place+1;
+		if(child>=heapSize) break;
+		if(child+1<heapSize && keys[heap[child+1]]<keys[heap[child]]) child++;
+		if(!(keys[heap[child]]<keys[cur])) break;
+		heap[place]=heap[child];
+		pos[heap[place]]=place;
+		place=child;
+	}
+	heap[place]=cur;
+	pos[cur]=place;
+}
+
+template <class theType, class intType>
+intType CAgglomerative<theType,intType>::FindRoot(intType* parent, intType i)
+{
+	intType root=i;
+	while(parent[root]!=root) root=parent[root];
+	while(parent[i]!=root) {intType next=parent[i]; parent[i]=root; i=next;}		//Path compression
+	return root;
+}
+
+template <class theType, class intType>
+bool CAgglomerative<theType,intType>::Cluster(const theType* data, intType numCoords, intType numPoints, double entropicLimit,
+												CHArray<intType,intType>& clustering, CHArray<intType,intType>& sizes)
+{
+	if((entropicLimit>numPoints)||(entropicLimit<1)) return false;
+
+	int64 n=numPoints;
+	CHArray<theType,int64> dist(n*(n-1)/2,true);
+
+	//Condensed distances, rows handed out to threads one at a time (they get shorter towards the end)
+	std::atomic<int64> nextRow(0);
+	double work=(double)n*(double)n*(double)numCoords/2;
+	int threads=(work<(1<<21)) ? 1 : CParallelSort::NumThreads();
+	CParallelSort::ParallelFor(threads,[&](int t)
+	{
+		while(true)
+		{
+			int64 i=nextRow++;
+			if(i>=n-1) break;
+			theType* row=dist.arr+PairIndex(i,i+1,n);
+			const theType* a=data+i*numCoords;
+			for(int64 j=i+1; j<n; j++) row[j-i-1]=CArrayKernel<theType>::SquaredDistance(a,data+j*numCoords,numCoords);
+		}
+	});
+
+	CHArray<intType,intType> size(numPoints,true), parent(numPoints,true);
+	CHArray<char,intType> fActive(numPoints,true);
+	size=1;
+	parent.SetValToPointNum();
+	fActive=1;
+
+	//Nearest neighbor of every cluster among the ones after it, and the heap of those distances
+	CHArray<intType,intType> nn(numPoints,true), heap(numPoints,true), pos(numPoints,true);
+	CHArray<theType,intType> nnDist(numPoints,true);
+	pos=-1;
+
+	auto findNeighbor=[&](intType i)
+	{
+		theType best=0;
+		intType bestJ=-1;
+		const theType* row=dist.arr+PairIndex(i,i+1,n)-(i+1);
+		for(intType j=i+1; j<numPoints; j++)
+		{
+			if(!fActive.arr[j]) continue;
+			if(bestJ<0 || row[j]<best) {best=row[j]; bestJ=j;}
+		}
+		nn.arr[i]=bestJ;
+		nnDist.arr[i]=best;
+	};
+
+	intType heapSize=0;
+	for(intType i=0; i<numPoints-1; i++)
+	{
+		findNeighbor(i);
+		heap.arr[heapSize]=i;
+		pos.arr[i]=heapSize++;
+	}
+	for(intType place=heapSize/2-1; place>=0; place--) HeapDown(heap.arr,pos.arr,nnDist.arr,place,heapSize);
+
+	auto removeFromHeap=[&](intType i)
+	{
+		intType place=pos.arr[i];
+		if(place<0) return;
+		pos.arr[i]=-1;
+		heapSize--;
+		if(place==heapSize) return;
+		intType moved=heap.arr[heapSize];
+		heap.arr[place]=moved;
+		pos.arr[moved]=place;
+		HeapDown(heap.arr,pos.arr,nnDist.arr,place,heapSize);
+		HeapUp(heap.arr,pos.arr,nnDist.arr,pos.arr[moved]);
+	};
+
+	//Entropy of cluster sizes from the running sum of size*log(size)
+	double total=(double)numPoints;
+	double sumNLogN=0;
+	double logLimit=log(entropicLimit);
+	intType numClusters=numPoints;
+
+	while(numClusters>1 && heapSize>0 && log(total)-sumNLogN/total>logLimit)
+	{
+		intType a=heap.arr[0];
+		intType b=nn.arr[a];
+
+		//Stale entry - the neighbor has been merged away or its distance has grown
+		if(b<0 || !fActive.arr[b] || dist.arr[PairIndex(a,b,n)]!=nnDist.arr[a])
+		{
+			findNeighbor(a);
+			if(nn.arr[a]<0) removeFromHeap(a);
+			else HeapDown(heap.arr,pos.arr,nnDist.arr,0,heapSize);
+			continue;
+		}
+
+		//Merge a into b: centroid Lance-Williams update of the squared distances to b
+		double na=size.arr[a], nb=size.arr[b], nab=na+nb;
+		double dab=(double)dist.arr[PairIndex(a,b,n)];
+		for(intType k=0; k<numPoints; k++)
+		{
+			if(!fActive.arr[k] || k==a || k==b) continue;
+			theType dka=dist.arr[k<a ? PairIndex(k,a,n) : PairIndex(a,k,n)];
+			theType& dkb=dist.arr[k<b ? PairIndex(k,b,n) : PairIndex(b,k,n)];
+			double newDist=(na*dka+nb*dkb)/nab-na*nb*dab/(nab*nab);
+			dkb=(theType)(newDist>0 ? newDist : 0);
+
+			//Clusters before b may now have b as their nearest neighbor
+			if(k<b && pos.arr[k]>=0 && dkb<nnDist.arr[k])
+			{
+				nn.arr[k]=b;
+				nnDist.arr[k]=dkb;
+				HeapUp(heap.arr,pos.arr,nnDist.arr,pos.arr[k]);
+			}
+		}
+
+		fActive.arr[a]=0;
+		removeFromHeap(a);
+		parent.arr[a]=b;
+
+		sumNLogN+=nab*log(nab)-na*log(na)-nb*log(nb);
+		size.arr[b]=(intType)nab;
+		numClusters--;
+
+		//The distances from b to the clusters after it have all changed
+		if(pos.arr[b]>=0)
+		{
+			findNeighbor(b);
+			if(nn.arr[b]<0) removeFromHeap(b);
+			else
+			{
+				HeapUp(heap.arr,pos.arr,nnDist.arr,pos.arr[b]);
+				HeapDown(heap.arr,pos.arr,nnDist.arr,pos.arr[b],heapSize);
+			}
+		}
+	}
+
+	//Clusters numbered in the order of their first points
+	CHArray<intType,intType> label(numPoints,true);
+	label=-1;
+	clustering.ResizeArray(numPoints,true);
+	sizes.ResizeArray(numClusters,true);
+	intType numLabels=0;
+	for(intType i=0; i<numPoints; i++)
+	{
+		intType root=FindRoot(parent.arr,i);
+		if(label.arr[root]<0)
+		{
+			label.arr[root]=numLabels;
+			sizes.arr[numLabels++]=size.arr[root];
+		}
+		clustering.arr[i]=label.arr[root];
+	}
+
+	return true;
+}
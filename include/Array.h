@@ -27,8 +27,17 @@
 #include <math.h>
 #include <algorithm>
 #include <functional>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <stdlib.h>
+#include <string.h>
 #include <BString.h>
 #include <Savable.h>
+#include <ArrayKernels.h>
+#include <Fft.h>
+#include <ParallelSort.h>
+#include <TextCodec.h>
 
 #pragma warning(disable:4996)		//disable unsafe functions warning
 
@@ -37,6 +46,52 @@ typedef long long int64;
 typedef unsigned long long uint64;
 typedef unsigned char uchar;
 
+template <class exprType> class CArrayExpr;		//Lazy element-wise expressions, see ArrayExpr.h
+
+//Storage of CHArray buffers
+//Trivial types (numbers, POD structs) live in malloc'ed memory: nothing is initialized on allocation,
+//copies are memcpy and growth uses realloc, which can extend the block in place
+//(large blocks are remapped by the C runtime instead of copied where it supports that)
+//Other types use new[]/delete[] and are moved element by element
+//Specialize CHArrayAllocator<yourType> to route a type to a different allocator
+template <class theType, bool fTrivial=std::is_trivial<theType>::value> struct CHArrayAllocator
+{
+	static theType* Allocate(size_t n) {return new theType[n];}
+	static void Free(theType* p) {delete[] p;}
+
+	//Returns a buffer of newSize elements starting with the first numToKeep elements of p, p is released
+	static theType* Reallocate(theType* p, size_t newSize, size_t numToKeep)
+	{
+		theType* newArr=new theType[newSize];
+		for(size_t i=0; i<numToKeep; i++) newArr[i]=std::move(p[i]);
+		delete[] p;
+		return newArr;
+	}
+
+	static void Copy(theType* to, const theType* from, size_t n) {for(size_t i=0; i<n; i++) to[i]=from[i];}
+};
+
+template <class theType> struct CHArrayAllocator<theType,true>
+{
+	//Zero-sized blocks still get a unique pointer, as new[] does
+	static theType* Allocate(size_t n)
+	{
+		theType* p=(theType*)malloc(n ? n*sizeof(theType) : 1);
+		if(p==0) throw std::bad_alloc();		//As new[] would
+		return p;
+	}
+	static void Free(theType* p) {free(p);}
+
+	static theType* Reallocate(theType* p, size_t newSize, size_t)
+	{
+		theType* newArr=(theType*)realloc(p, newSize ? newSize*sizeof(theType) : 1);
+		if(newArr==0) throw std::bad_alloc();		//As new[] would
+		return newArr;
+	}
+
+	static void Copy(theType* to, const theType* from, size_t n) {if(n) memcpy(to,from,n*sizeof(theType));}
+};
+
 template <class theType, class intType=int> class CHArray : public Savable
 {
 	//Add member vars
@@ -53,6 +108,8 @@ public:
 	CHArray(intType theSize=0, bool setMaxNumPoints=false);
 	CHArray(theType start, theType end, intType theNumPoints);		//create vector from start to end with numPoints
 	CHArray(const CHArray<theType,intType>& rhs);					//Copy constructor
+	CHArray(CHArray<theType,intType>&& rhs);						//Move constructor - takes over the buffer of rhs
+	template <class exprType> CHArray(const CArrayExpr<exprType>& expr);	//Evaluates a lazy expression in one pass
 
 	//Constructors don't allocate and delete the array if isVirtual==true
 	//Will use the provided array.
@@ -66,6 +123,7 @@ public:
 public:
 	void CopyFromPointer(const theType* thePointer, intType numToCopy);
 	void SetVirtual(theType* thePointer, intType theSize);	//Makes array virtual
+	void ReleaseVirtual();									//Forgets the virtual buffer - the array becomes an empty owning one
 	//Importing from a different type of array with default cast
 	template<class rhsType, class rhsIntType> void ImportFrom(const CHArray<rhsType, rhsIntType>& rhs);
 
@@ -96,7 +154,17 @@ public:
 
 	void IntegralForm();
 	void InitialIndexArray(CHArray<intType,intType>& result, intType numIndices) const;	//Compose initial index array (result) from indices for sparse mat
-	void Convolve(const CHArray<theType,intType>& rhs, CHArray<theType,intType>& result) const;//O(N^2) convolution - dimensions of (*this) and rhs may be different
+	//Convolution - dimensions of (*this) and rhs may be different, result has N+M-1 points
+	//Convolve() picks the direct O(N*M) loop or the O((N+M)log(N+M)) FFT path by estimated cost
+	void Convolve(const CHArray<theType,intType>& rhs, CHArray<theType,intType>& result) const;
+	void ConvolveDirect(const CHArray<theType,intType>& rhs, CHArray<theType,intType>& result) const;
+	void ConvolveFft(const CHArray<theType,intType>& rhs, CHArray<theType,intType>& result) const;
+	//Cross-correlation for all overlapping shifts, result has N+M-1 points
+	//result[shift+M-1] equals ShiftedDirectProduct(rhs,shift), shift from -(M-1) to N-1
+	void Correlate(const CHArray<theType,intType>& rhs, CHArray<theType,intType>& result) const;
+	//Shift at which rhs best matches (*this), i.e. (*this)[i+lag] ~ rhs[i], with sub-sample precision
+	//Means are removed first; only |lag|<=maxLag is searched when maxLag>=0
+	double FindLag(const CHArray<theType,intType>& rhs, intType maxLag=-1) const;
 	CHArray<theType,intType>& AdjacentAveraging(intType num);
 	CHArray<theType,intType>& BackNormAveraging(const CHArray<theType,intType>& weights);//Backwards normalized averaging - for example for exponential averaging
 	CHArray<theType,intType>& LimitMaxValue(theType limit);
@@ -107,6 +175,8 @@ public:
 	double EntropicNumberOfStates() const;
 
 	theType Sum() const;
+	theType KahanSum() const {return CArrayKernel<theType>::KahanSum(arr,numPoints);}			//Compensated summation
+	theType PairwiseSum() const {return CArrayKernel<theType>::PairwiseSum(arr,numPoints);}	//Error grows as log(N)
 	theType SumOfSquares() const;
 	theType WeightedSum(const CHArray<theType, intType>& weights) const;
 	theType Mean() const;
@@ -144,7 +214,7 @@ public:
 	intType PositionOfMax() const;
 	
 	//Writing to and reading from files
-	bool Write(BString name, BString form="%.5e") const;
+	bool Write(BString name, BString form="%.5e") const;				//One value per line, form "%r" - shortest exact text
 	bool Read(BString name);												//Changes the size of the array as necessary
 	bool WriteBinary(const BString& fileName);
 	bool ReadBinary(const BString& fileName);										//Changes the size of the array as necessary
@@ -190,6 +260,8 @@ public:
 	void Resize(intType newSize, bool fSetMaxNumPoints=false){ResizeArray(newSize,fSetMaxNumPoints);}	//alias
 	void ResizeIfSmaller(intType newSize, bool fSetNumPoints=false);
 	void ResizeArrayKeepPoints(intType newSize);
+	void Reserve(intType minSize) {if(minSize>size) ResizeArrayKeepPoints(minSize);}	//Grows the capacity, keeps the points
+	void ShrinkToFit() {if(size>numPoints) ResizeArrayKeepPoints(numPoints);}			//Releases capacity beyond the points
 	void ResizeToZero() {ResizeArray(0);}
 
 	//Decimates the array with provided step, starting from index 0 (0 is retained)
@@ -245,7 +317,7 @@ public:
 	CHArray<theType,intType>& Concatenate(const CHArray<theType,intType>& rhs);		//Adds rhs to the end of the array, resizing *this
 
 	//Sorting and permutatations
-	void Sort(bool fDescending=false);		//Uses comb sort		
+	void Sort(bool fDescending=false);		//Radix sort for numerical data, parallel comparison sort otherwise
 	void SortPermutation(CHArray<intType,intType>& intArray, bool fDescending=false, bool fStableSort=false) const;
 	//Sorts provided indices according to the values in the array at those indices
 	void SortIndices(CHArray<intType,intType>& indices, bool fDescending=false, bool fStableSort=false) const;
@@ -253,20 +325,14 @@ public:
 	void PartialSort(CHArray<theType,intType>& result, intType numToFind, bool fDescending=false) const;
 	void PartialSortPermutation(CHArray<intType,intType>& perm, intType numToFind, bool fDescending=false) const;
 	void PartialSortIndices(CHArray<intType,intType>& indices, intType numToFind, bool fDescending=false) const;
-	void Permute(const CHArray<intType,intType>& permutation);
+	void Permute(const CHArray<intType,intType>& permutation);	//In place, arr[i] becomes old arr[permutation[i]]
 	void InvertPermutation();
 	void SelectFrom(const CHArray<theType,intType>& source, const CHArray<intType,intType>& indices);	//Selects points from source according to indices
 	
 	//Non-comparison radix sort
-	void RadixSort(bool fDescending=false);	//Stable non-comparison sort for any numerical data, relies on bit order - careful!
+	void RadixSort(bool fDescending=false);	//Stable non-comparison sort for any numerical data, multithreaded for large arrays
 	void RadixSortWithPerm(CHArray<intType,intType>& perm, bool fDescending=false);	//Sorts the array and produces a permutation needed for the sort
 
-private:	//Private auxilliary functions for radix sorting
-	void InternalRadixSort(CHArray<theType,intType>& copyArray, bool fDescending);
-	void InternalRadixSortWithPerm(CHArray<theType,intType>& copyArray,CHArray<intType,intType>& perm,
-										CHArray<intType,intType>& copyPerm, bool fDescending);
-
-public:
 	void Reverse();											//Reverses the order of the elements
 	void SwitchElements(intType index1, intType index2);	//Switches the two elements
 	void TrimRight(intType newNumPoints);
@@ -285,6 +351,8 @@ public:
 	theType& operator[](intType num) const {return arr[num];}
 	
 	CHArray<theType,intType>& operator=(const CHArray<theType,intType>& rhs);
+	CHArray<theType,intType>& operator=(CHArray<theType,intType>&& rhs);		//Copies instead if either array is virtual
+	template <class exprType> CHArray<theType,intType>& operator=(const CArrayExpr<exprType>& expr);
 
 	CHArray<theType,intType>& operator=(theType val);
 	CHArray<theType,intType> operator*(const CHArray<theType,intType>& rhs) 
@@ -324,7 +392,7 @@ public:
 	CHArray<theType,intType>& operator^=(const CHArray<theType,intType>& rhs)
 						{return (AssignmentTwoArrays(rhs,&CHArray<theType,intType>::Power));}
 	CHArray<theType,intType>& operator*=(theType val)
-						{return (AssignmenttheType(val,&CHArray<theType,intType>::Multiply));}
+						{CArrayKernel<theType>::Scale(arr,numPoints,val);return *this;}
 	CHArray<theType,intType>& operator+=(theType val)
 						{return (AssignmenttheType(val,&CHArray<theType,intType>::Add));}
 	CHArray<theType,intType>& operator-=(theType val)
@@ -534,252 +602,108 @@ void CHArray<theType, intType>::SwitchElements(intType index1, intType index2)
 	arr[index2] = temp;
 }
 
-//Helper function for radix sort
 template <class theType,class intType>
-void CHArray<theType,intType>::InternalRadixSort(CHArray<theType,intType>& copyArray,bool fDescending)
+void CHArray<theType,intType>::RadixSort(bool fDescending)
 {
-	//copyArray must have been correctly allocated
-	//An internal function that sorts a positive array with radix sort
-	
-	///////////////////////////////////////////
-	CHArray<intType,short> buckets(256+1,true);		//8-bit buckets
-	char dataSize=sizeof(theType);	//Size of data points in bytes
-
-	//Perform sorting for all bytes starting from the least significant byte
-	for(char i=0;i<dataSize;i++)
-	{
-		buckets=0;
-
-		for(intType j=0;j<numPoints;j++)	//first pass - counting numbers in each bucket
-		{
-			short curBucket=*(((uchar*)(arr+j))+i);
-			if(fDescending) curBucket=(short)255-curBucket;
-			
-			buckets.arr[curBucket+1]++;
-		}
-		buckets.IntegralForm();
+	CParallelSort::SortWithPayload(arr,(intType*)0,numPoints,fDescending);
+}
 
-		for(intType j=0;j<numPoints;j++)	//second pass - sorting according to the current byte
-		{
-			short curBucket=*(((uchar*)(arr+j))+i);
-			if(fDescending) curBucket=(short)255-curBucket;
+template <class theType,class intType>
+void CHArray<theType,intType>::RadixSortWithPerm(CHArray<intType,intType>& perm, bool fDescending)
+{
+	perm.ResizeIfSmaller(numPoints,true);
+	perm.SetValToPointNum();
 
-			copyArray.arr[buckets.arr[curBucket]]=arr[j];
-			buckets.arr[curBucket]++;
-		}
-		
-		CopyFromPointer(copyArray.arr,numPoints);	//Copy without the possibility of array resizing
-	}
+	CParallelSort::SortWithPayload(arr,perm.arr,numPoints,fDescending);
 }
 
-
 template <class theType,class intType>
-void CHArray<theType,intType>::RadixSort(bool fDescending)
+void CHArray<theType,intType>::Convolve(const CHArray<theType,intType>& rhs, CHArray<theType,intType>& result) const
 {
-	if(numPoints<2) return;
-
-	//Find out whether the data type is signed or unsigned
-	bool fSigned=IsDataSigned();
+	if(CFft::DirectConvolutionCost(numPoints,rhs.numPoints) <= CFft::FftConvolutionCost(numPoints,rhs.numPoints))
+		ConvolveDirect(rhs,result);
+	else ConvolveFft(rhs,result);
+}
 
-	//Auxilliary structures
-	CHArray<theType,intType> copyArray(numPoints,true);
-	CHArray<intType,short> buckets(256+1,true);
+//O(N*M) convolution
+template <class theType,class intType>
+void CHArray<theType,intType>::ConvolveDirect(const CHArray<theType,intType>& rhs, CHArray<theType,intType>& result) const
+{
+	if(numPoints==0 || rhs.numPoints==0) {result.ResizeArray(0); return;}
 
-	if(!fSigned)	//Unsigned data - simplest case
+	intType resultNumPoints=numPoints+rhs.numPoints-1;
+	result.ResizeArray(resultNumPoints, true);
+	result=0;
+	
+	for(intType i=0; i<numPoints; i++)
 	{
-		InternalRadixSort(copyArray,fDescending);
-	}
-	else	//signed
-	{
-		//Lose signed zeros
-		for(intType i=0;i<numPoints;i++)
-		{
-			if(arr[i]==(theType)0) arr[i]=+0;
-		}
-
-		//Separate negative and positive parts
-		intType numPositive=0;
-		intType numNegative=0;
-		CHArray<theType,intType> posPart(arr,0,true);	//virtual arrays
-		CHArray<theType,intType> negPart(arr,0,true);
-
-		for(intType i=0;i<numPoints;i++)
-		{
-			if(arr[i]>=0) numPositive++;
-			else numNegative++;
-		}
-
-		if(fDescending)	//positives come before negatives
-		{
-			posPart.SetVirtual(arr,numPositive);
-			negPart.SetVirtual(arr+numPositive,numNegative);
-		}
-		else	//ascending - negatives come before positives
-		{
-			negPart.SetVirtual(arr,numNegative);
-			posPart.SetVirtual(arr+numNegative,numPositive);
-		}
-
-		copyArray.CopyFromPointer(arr,numPoints);
-
-		intType curPos=0;
-		intType curNeg=0;
-		for(intType i=0;i<numPoints;i++)
-		{
-			if(copyArray.arr[i]>=0) posPart[curPos++]=copyArray.arr[i];
-			else negPart[curNeg++]=copyArray.arr[i];
-		}
-
-		negPart.InvertSign();	//Invert negatives
-
-		//Sort
-		posPart.InternalRadixSort(copyArray,fDescending);
-		negPart.InternalRadixSort(copyArray,!fDescending);
-
-		negPart.InvertSign();	//Invert negatives again
+		CArrayKernel<theType>::MultiplyAdd(result.arr+i,rhs.arr,rhs.numPoints,arr[i]);
 	}
 }
 
-
-//Internal auxilliary function used by RadixSortWithPerm
-//copyArray, perm and copyPerm must have been allocated previously
+//FFT convolution, computed in double precision - integer results are rounded
 template <class theType,class intType>
-void CHArray<theType,intType>::InternalRadixSortWithPerm(CHArray<theType,intType>& copyArray,
-										CHArray<intType,intType>& perm, CHArray<intType,intType>& copyPerm, bool fDescending)
+void CHArray<theType,intType>::ConvolveFft(const CHArray<theType,intType>& rhs, CHArray<theType,intType>& result) const
 {
-	char dataSize=sizeof(theType);	//Size of data points in bytes
-	CHArray<intType,short> buckets(256+1,true);
+	if(numPoints==0 || rhs.numPoints==0) {result.ResizeArray(0); return;}
 
-	//Perform sorting for all bytes starting from the least significant byte
-	for(char i=0;i<dataSize;i++)
-	{
-		buckets=0;
+	intType resultNumPoints=numPoints+rhs.numPoints-1;
 
-		for(intType j=0;j<numPoints;j++)	//first pass - counting numbers in each bucket
-		{
-			short curBucket=*(((uchar*)(arr+j))+i);
-			if(fDescending) curBucket=(short)255-curBucket;
+	CHArray<double,int64> a, b, conv(resultNumPoints,true);
+	a.ImportFrom(*this);
+	b.ImportFrom(rhs);
 
-			buckets.arr[curBucket+1]++;
-		}
-		buckets.IntegralForm();
+	CFft::ConvolveReal(a.arr,a.Count(),b.arr,b.Count(),conv.arr);
 
-		for(intType j=0;j<numPoints;j++)	//second pass - sorting according to the current byte
-		{
-			short curBucket=*(((uchar*)(arr+j))+i);
-			if(fDescending) curBucket=(short)255-curBucket;
+	result.ResizeArray(resultNumPoints, true);
+	for(intType i=0; i<resultNumPoints; i++) result.arr[i]=FftResultCast<theType>(conv.arr[i]);
+}
 
-			copyArray.arr[buckets.arr[curBucket]]=arr[j];
-			copyPerm.arr[buckets.arr[curBucket]]=perm.arr[j];
-			buckets.arr[curBucket]++;
-		}
+template <class theType,class intType>
+void CHArray<theType,intType>::Correlate(const CHArray<theType,intType>& rhs, CHArray<theType,intType>& result) const
+{
+	//Correlation is convolution with the reversed rhs
+	CHArray<theType,intType> reversed(rhs.numPoints,true);
+	for(intType i=0; i<rhs.numPoints; i++) reversed.arr[i]=rhs.arr[rhs.numPoints-1-i];
 
-		CopyFromPointer(copyArray.arr,numPoints);		//Copy without the possibility of array resizing
-		perm.CopyFromPointer(copyPerm.arr,numPoints);
-	}
+	Convolve(reversed,result);
 }
 
-
 template <class theType,class intType>
-void CHArray<theType,intType>::RadixSortWithPerm(CHArray<intType,intType>& perm, bool fDescending)
+double CHArray<theType,intType>::FindLag(const CHArray<theType,intType>& rhs, intType maxLag) const
 {
-	perm.ResizeIfSmaller(numPoints,true);
-	perm.SetValToPointNum();
-	if(numPoints<2) return;
+	if(numPoints==0 || rhs.numPoints==0) return 0;
 
-	//Find out whether the data type is signed or unsigned
-	bool fSigned=IsDataSigned();
+	CHArray<double,intType> a, b, corr;
+	a.ImportFrom(*this);
+	b.ImportFrom(rhs);
+	a-=a.Mean();
+	b-=b.Mean();
 
-	//Auxilliary structures
-	CHArray<theType,intType> copyArray(numPoints,true);
-	CHArray<intType,intType> copyPerm(perm);
-	CHArray<intType,short> buckets(256+1,true);
+	a.Correlate(b,corr);
 
-	if(!fSigned)	//Unsigned data - simplest case
+	//corr[i] is the product at shift i-(M-1)
+	intType offset=rhs.numPoints-1;
+	intType from=0, to=corr.Count()-1;
+	if(maxLag>=0)
 	{
-		InternalRadixSortWithPerm(copyArray,perm,copyPerm,fDescending);
+		from=std::max(from,offset-maxLag);
+		to=std::min(to,offset+maxLag);
 	}
-	else	//signed
-	{
-		//Lose signed zeros
-		for(intType i=0;i<numPoints;i++)
-		{
-			if(arr[i]==(theType)0) arr[i]=+0;
-		}
-
-		//Separate negative and positive parts
-		intType numPositive=0;
-		intType numNegative=0;
-		CHArray<theType,intType> posPart(arr,0,true);	//virtual arrays
-		CHArray<theType,intType> negPart(arr,0,true);
-		CHArray<intType,intType> posPartPerm(perm.arr,0,true);
-		CHArray<intType,intType> negPartPerm(perm.arr,0,true);
-
-		for(intType i=0;i<numPoints;i++)
-		{
-			if(arr[i]>=0) numPositive++;
-			else numNegative++;
-		}
-
-		if(fDescending)	//positives come before negatives
-		{
-			posPart.SetVirtual(arr,numPositive);
-			negPart.SetVirtual(arr+numPositive,numNegative);
-			posPartPerm.SetVirtual(perm.arr,numPositive);
-			negPartPerm.SetVirtual(perm.arr+numPositive,numNegative);
-		}
-		else	//ascending - negatives come before positives
-		{
-			negPart.SetVirtual(arr,numNegative);
-			posPart.SetVirtual(arr+numNegative,numPositive);
-			negPartPerm.SetVirtual(perm.arr,numNegative);
-			posPartPerm.SetVirtual(perm.arr+numNegative,numPositive);
-		}
-
-		copyArray.CopyFromPointer(arr,numPoints);
-
-		intType curPos=0;
-		intType curNeg=0;
-		for(intType i=0;i<numPoints;i++)
-		{
-			if(copyArray.arr[i]>=0)
-			{
-				posPart[curPos]=copyArray.arr[i];
-				posPartPerm[curPos]=copyPerm.arr[i];
-				curPos++;
-			}
-			else
-			{
-				negPart[curNeg]=copyArray.arr[i];
-				negPartPerm[curNeg]=copyPerm.arr[i];
-				curNeg++;
-			}
-		}
 
-		negPart.InvertSign();	//Invert negatives
+	intType best=from;
+	for(intType i=from+1; i<=to; i++) if(corr.arr[i]>corr.arr[best]) best=i;
 
-		//Sort
-		posPart.InternalRadixSortWithPerm(copyArray,posPartPerm,copyPerm,fDescending);
-		negPart.InternalRadixSortWithPerm(copyArray,negPartPerm,copyPerm,!fDescending);
-
-		negPart.InvertSign();	//Invert negatives again
-	}
-}
-
-//O(N^2) convolution - dimensions of (*this) and rhs may be different
-template <class theType,class intType>
-void CHArray<theType,intType>::Convolve(const CHArray<theType,intType>& rhs, CHArray<theType,intType>& result) const
-{
-	intType resultNumPoints=numPoints+rhs.numPoints-1;
-	result.ResizeArray(resultNumPoints, true);
-	result=0;
-	
-	for(intType i=0; i<numPoints; i++)
+	//Parabola through the peak and its neighbors
+	double refinement=0;
+	if(best>0 && best<corr.Count()-1)
 	{
-		theType curVal=arr[i];
-
-		for (intType j = 0; j<rhs.numPoints; j++) result.arr[i + j] += curVal * rhs.arr[j];
+		double left=corr.arr[best-1], center=corr.arr[best], right=corr.arr[best+1];
+		double denom=left-2*center+right;
+		if(denom<0) refinement=0.5*(left-right)/denom;
 	}
+
+	return (double)(best-offset)+refinement;
 }
 
 
@@ -892,7 +816,7 @@ void CHArray<theType,intType>::Histogram(theType start, theType end, intType num
 	{
 		if(arr[i]>end || arr[i]<start) continue;	//point out of bounds
 		bin=(intType)( (arr[i]-start) * invStep);
-		result.arr[bin] + =1;						//Adding (resType)1
+		result.arr[bin]+=1;						//Adding (resType)1
 	}
 
 }
@@ -1015,7 +939,7 @@ CHArray<theType,intType>& CHArray<theType,intType>::MultiplyAdd(const CHArray<th
 {
 	if(numPoints!=rhs.numPoints) return *this;
 
-	for (intType i = 0; i<numPoints; i++) arr[i] += rhs.arr[i] * factor;
+	CArrayKernel<theType>::MultiplyAdd(arr,rhs.arr,numPoints,factor);
 
 	return *this;
 }
@@ -1046,7 +970,7 @@ numPoints(0),
 arr(0)
 {
 	size=theSize;
-	arr=new theType[(size_t)size];
+	arr=CHArrayAllocator<theType>::Allocate((size_t)size);
 	if(setMaxNumPoints) SetNumPoints(size);				//if the array is used as s "vector"
 	fVirtual=false;
 }
@@ -1058,7 +982,7 @@ arr(0)
 	numPoints=theNumPoints;
 	size=theNumPoints;
 	fVirtual=false;
-	arr=new theType[size];
+	arr=CHArrayAllocator<theType>::Allocate((size_t)size);
 
 	theType step;
 	if(theNumPoints!=1) step=(end-start)/(theType)(theNumPoints-1);
@@ -1085,9 +1009,9 @@ CHArray<theType,intType>::CHArray(theType* thePointer, intType theSize, bool isV
 	}
 	else
 	{
-		arr=new theType[size];
+		arr=CHArrayAllocator<theType>::Allocate((size_t)size);
 
-		for (intType i = 0; i<numPoints; i++) arr[i] = thePointer[i];
+		CHArrayAllocator<theType>::Copy(arr,thePointer,(size_t)numPoints);
 	}
 }
 
@@ -1096,7 +1020,7 @@ void CHArray<theType,intType>::CopyFromPointer(const theType* thePointer, intTyp
 {
 	ResizeIfSmaller(numToCopy,true);
 
-	for (intType i = 0; i<numToCopy; i++) arr[i] = thePointer[i];
+	CHArrayAllocator<theType>::Copy(arr,thePointer,(size_t)numToCopy);
 }
 
 //Const version - cannot create a virtual array with this one
@@ -1107,9 +1031,9 @@ CHArray<theType,intType>::CHArray(const theType* thePointer, intType theSize)
 	size=theSize;
 	numPoints=size;
 
-	arr=new theType[size];
+	arr=CHArrayAllocator<theType>::Allocate((size_t)size);
 
-	for (intType i = 0; i<numPoints; i++) arr[i] = thePointer[i];
+	CHArrayAllocator<theType>::Copy(arr,thePointer,(size_t)numPoints);
 }
 
 template <class theType,class intType>
@@ -1117,10 +1041,31 @@ CHArray<theType,intType>::CHArray(const CHArray<theType,intType>& rhs)			//Copy
 {	
 	fVirtual=false;
 	size=rhs.GetSize();
-	arr=new theType[size];
+	arr=CHArrayAllocator<theType>::Allocate((size_t)size);
 	
 	numPoints=rhs.numPoints;
-	for (intType i = 0; i<numPoints; i++) arr[i] = rhs.arr[i];
+	CHArrayAllocator<theType>::Copy(arr,rhs.arr,(size_t)numPoints);
+}
+
+template <class theType,class intType>
+CHArray<theType,intType>::CHArray(CHArray<theType,intType>&& rhs)				//Move constructor
+{
+	fVirtual=false;
+	size=rhs.size;
+	numPoints=rhs.numPoints;
+
+	if(rhs.fVirtual)		//The buffer is not owned by rhs - copy it
+	{
+		arr=CHArrayAllocator<theType>::Allocate((size_t)size);
+		CHArrayAllocator<theType>::Copy(arr,rhs.arr,(size_t)numPoints);
+		return;
+	}
+
+	//Take over the buffer and leave rhs empty
+	arr=rhs.arr;
+	rhs.arr=0;
+	rhs.size=0;
+	rhs.numPoints=0;
 }
 
 template <class theType,class intType>
@@ -1152,7 +1097,7 @@ CHArray<theType,intType>::CHArray(const BString& fileName)
 	fVirtual=false;
 	size=1;
 	numPoints=0;
-	arr=new theType[size];
+	arr=CHArrayAllocator<theType>::Allocate((size_t)size);
 
 	Load(fileName);
 }
@@ -1166,7 +1111,7 @@ CHArray<theType,intType>::~CHArray()
 template <class theType,class intType>
 void CHArray<theType,intType>::DeleteArray()
 {
-	if( arr!=0 && !fVirtual) delete[] arr;
+	if( arr!=0 && !fVirtual) CHArrayAllocator<theType>::Free(arr);
 }
 
 template <class theType,class intType>
@@ -1181,6 +1126,17 @@ void CHArray<theType,intType>::SetVirtual(theType* thePointer, intType theSize)
 	arr=thePointer;
 }
 
+template <class theType,class intType>
+void CHArray<theType,intType>::ReleaseVirtual()
+{
+	if(!fVirtual) return;
+
+	fVirtual=false;
+	size=1;
+	numPoints=0;
+	arr=CHArrayAllocator<theType>::Allocate((size_t)size);
+}
+
 //Removes points that are the same as the preceding element - call on sorted arrays
 template <class theType,class intType>
 void CHArray<theType,intType>::RemoveRepetitions()
@@ -1324,18 +1280,14 @@ template <class theType,class intType>
 void CHArray<theType,intType>::SerializeFromBuffer(char*& buffer)
 {
 	//Read number of points and resize array
-	intType newNumPoints=*((intType*)buffer); buffer+=sizeof(intType);
+	//The buffer has no alignment guarantee, so everything is copied bytewise
+	intType newNumPoints;
+	memcpy(&newNumPoints,buffer,sizeof(intType)); buffer+=sizeof(intType);
 	ResizeArray(newNumPoints,true);
 
 	//Read array elements
-	theType* p=(theType*)buffer;
-	for(intType i=0;i<numPoints;i++)
-	{
-		arr[i]=*p;
-		p++;
-	}
-
-	buffer=(char*)p;
+	if(numPoints>0) memcpy(arr,buffer,(size_t)numPoints*sizeof(theType));
+	buffer+=(size_t)numPoints*sizeof(theType);
 }
 
 //Full instantiation to <BString, int>
@@ -1357,17 +1309,11 @@ template <class theType,class intType>
 void CHArray<theType,intType>::SerializeToBuffer(char*& buffer)
 {
 	//Write number of points
-	*((intType*)buffer)=numPoints; buffer+=sizeof(intType);
+	memcpy(buffer,&numPoints,sizeof(intType)); buffer+=sizeof(intType);
 
 	//Write array elements
-	theType* p=(theType*)buffer;
-	for(intType i=0;i<numPoints;i++)
-	{
-		*p=arr[i];
-		p++;
-	}
-
-	buffer=(char*)p;
+	if(numPoints>0) memcpy(buffer,arr,(size_t)numPoints*sizeof(theType));
+	buffer+=(size_t)numPoints*sizeof(theType);
 }
 
 //Full instantiation to <BString, int>
@@ -1625,9 +1571,7 @@ intType CHArray<theType,intType>::FindBinEquispaced(theType val) const
 template <class theType,class intType>
 void CHArray<theType,intType>::Sort(bool fDescending)
 {
-	if(fDescending) std::sort( begin(), end(), std::greater<theType>() );	//std sort descending
-
-	else std::sort( begin(), end() );	//ascending std sort
+	CParallelSort::SortValues(arr,numPoints,fDescending);
 }
 
 template <class theType,class intType>	//intArray is for storing result only
@@ -1643,22 +1587,7 @@ void CHArray<theType,intType>::SortPermutation(CHArray<intType,intType>& perm, b
 template <class theType,class intType>
 void CHArray<theType,intType>::SortIndices(CHArray<intType,intType>& indices, bool fDescending, bool fStableSort) const
 {
-	if(fStableSort)
-	{
-		if(fDescending) std::stable_sort( indices.begin(), indices.end(),
-										[this](const intType& a, const intType& b)->bool{return arr[a] > arr[b];});
-
-		else std::stable_sort( indices.begin(), indices.end(),
-							[this](const intType& a, const intType& b)->bool{return arr[a] < arr[b];});
-	}
-	else
-	{
-		if(fDescending) std::sort( indices.begin(), indices.end(),
-								[this](const intType& a, const intType& b)->bool{return arr[a] > arr[b];});
-
-		else std::sort(	indices.begin(), indices.end(),
-						[this](const intType& a, const intType& b)->bool{return arr[a] < arr[b];});
-	}
+	CParallelSort::SortIndices(arr,indices.begin(),indices.GetNumPoints(),fDescending,fStableSort);
 }
 
 template <class theType,class intType>	//Permutes according to the provided int array
@@ -1666,6 +1595,9 @@ void CHArray<theType,intType>::Permute(const CHArray<intType,intType>& permutati
 {
 	if(permutation.GetNumPoints()!=numPoints) return;
 
+	if(CParallelSort::Permute(arr,permutation.arr,numPoints)) return;
+
+	//Not a one-to-one permutation (repeated indices) - gather through a copy
 	CHArray<theType,intType> interm(*this);
 
 	for(intType i=0;i<numPoints;i++) arr[i]=interm.arr[permutation.arr[i]];
@@ -1743,13 +1675,7 @@ template <class theType,class intType>
 theType CHArray<theType,intType>::Variance() const
 {
 	theType mean=Mean();
-	theType sumSquared=0;
-	theType curVal;
-	for(intType i=0; i<numPoints; i++)
-	{
-		curVal = arr[i]-mean;
-		sumSquared += curVal*curVal;
-	}
+	theType sumSquared=CArrayKernel<theType>::SumOfSquaredDev(arr,numPoints,mean);
 
 	return sumSquared/(theType)numPoints;
 }
@@ -1867,10 +1793,12 @@ void CHArray<theType,intType>::AddAndExtend(const theType& point, intType factor
 template <class theType,class intType>
 void CHArray<theType,intType>::AddFromArray(const CHArray<theType,intType>& source)
 {
-	int newSize = Count() + source.Count();
-	if (newSize > Size()) ResizeArrayKeepPoints(newSize);
+	intType newCount = numPoints + source.numPoints;
+	if (newCount > size) Reserve(std::max(newCount, size*2));		//Geometric growth keeps repeated appends linear
+	if (newCount > size) newCount = size;							//Virtual arrays cannot grow
 
-	for (int i = 0; i < source.Count(); i++) AddPoint(source.arr[i]);
+	CHArrayAllocator<theType>::Copy(arr+numPoints,source.arr,(size_t)(newCount-numPoints));
+	numPoints=newCount;
 }
 
 //Add and extend from string
@@ -1998,8 +1926,13 @@ void CHArray<theType,intType>::ResizeArray(intType newSize, bool fSetMaxNumPoint
 
 	if(size!=newSize)
 	{
-		DeleteArray();
-		arr=new theType[(size_t)newSize];
+		//Points are discarded, so the old contents need not survive a reallocation
+		if(newSize<size && arr!=0) arr=CHArrayAllocator<theType>::Reallocate(arr,(size_t)newSize,0);	//Shrinks in place
+		else
+		{
+			DeleteArray();
+			arr=CHArrayAllocator<theType>::Allocate((size_t)newSize);
+		}
 		size=newSize;
 	}
 
@@ -2016,7 +1949,7 @@ void CHArray<theType,intType>::ResizeIfSmaller(intType newSize, bool fSetNumPoin
 	if(size<newSize)
 	{
 		DeleteArray();
-		arr=new theType[newSize];
+		arr=CHArrayAllocator<theType>::Allocate((size_t)newSize);
 		size=newSize;
 	}
 
@@ -2034,15 +1967,11 @@ void CHArray<theType,intType>::ResizeArrayKeepPoints(intType newSize)
 	if(numPoints<newSize) newPoints=numPoints;
 	else newPoints=newSize;
 
-	theType* newArr=new theType[newSize];
-
-	for (intType i = 0; i<newPoints; i++) newArr[i] = arr[i];
-
-	DeleteArray();
+	if(arr==0) arr=CHArrayAllocator<theType>::Allocate((size_t)newSize);
+	else arr=CHArrayAllocator<theType>::Reallocate(arr,(size_t)newSize,(size_t)newPoints);
 
 	size=newSize;
 	numPoints=newPoints;
-	arr=newArr;
 	
 	return;
 }
@@ -2057,11 +1986,32 @@ CHArray<theType,intType>& CHArray<theType,intType>::operator=(const CHArray<theT
 	if(!fVirtual) numPoints=rhs.numPoints;
 	intType numToCopy=std::min(numPoints,rhs.numPoints);
 	
-	for(intType i=0;i<numToCopy;i++) arr[i]=rhs.arr[i];
+	CHArrayAllocator<theType>::Copy(arr,rhs.arr,(size_t)numToCopy);
 	
 	return *this;
 }
 
+template <class theType,class intType>
+CHArray<theType,intType>& CHArray<theType,intType>::operator=(CHArray<theType,intType>&& rhs)
+{
+	if(this==&rhs) return *this;		//Avoiding self-assignment
+
+	//Virtual arrays do not own their buffers - fall back to copying
+	if(fVirtual || rhs.fVirtual) return (*this)=(const CHArray<theType,intType>&)rhs;
+
+	DeleteArray();
+
+	arr=rhs.arr;
+	size=rhs.size;
+	numPoints=rhs.numPoints;
+
+	rhs.arr=0;
+	rhs.size=0;
+	rhs.numPoints=0;
+
+	return *this;
+}
+
 template <class theType,class intType>
 CHArray<theType,intType>& CHArray<theType,intType>::ExportPart(CHArray<theType,intType>& target, intType from, intType numToCopy) const
 {
@@ -2157,36 +2107,13 @@ bool CHArray<theType,intType>::Read(BString name)
 {
 	CHArray<char,int64> text;
 	if(!text.ReadBinary(name)) return false;
-	int64 textLength=text.GetNumPoints();
-	
-	intType newNum=0;			//Counting the number of lines in the file
-	if(text.arr[0]>32) newNum++;
-	for(int64 i=0;i<(textLength-1);i++)
-	{
-		if((text.arr[i]<=32)&&(text.arr[i+1]>32)) newNum++;
-	}
-
-	ResizeArray(newNum);
-
-	char buffer[1000];
-	int64 numBuffered=0;
-	int64 curPos=0;
 
-	while(curPos<textLength)	
+	CTextCodec::ParseList<theType>(text.arr,text.GetNumPoints(),[this](long long count)->theType*
 	{
-		while(curPos<textLength && text.arr[curPos]<=32) curPos++;	//remove leading blanks				
-		
-		while(curPos<textLength && text.arr[curPos]>32)				//read meaningful characters
-		{
-			buffer[numBuffered++]=text.arr[curPos++];
-		}
-                buffer[numBuffered]=0;
+		ResizeArray((intType)count,true);
+		return arr;
+	});
 
-		if(numBuffered>0) AddPoint((theType)atof(buffer));
-	
-		numBuffered=0;
-	}
-	
 	return true;
 }
 
@@ -2195,44 +2122,29 @@ bool CHArray<theType,intType>::Write(BString name, BString form) const
 {
 	if(numPoints==0) return false;
 
-	//double pass - first count the number of symbols, then write to a char array
-	int64 numSymbols=0;
-	BString buffer;
-	for(intType i=0;i<numPoints;i++)
-	{
-		buffer.Format(form,arr[i]);
-		numSymbols+=buffer.GetLength();
-	}
-	numSymbols+=(numPoints-1);	//for "\n" after every line, except the last one
+	CTextWriter writer;
+	if(!writer.Open(name)) return false;
 
-	CHArray<char,int64> charArr(numSymbols,true);
-	int64 curPos=0;
+	CTextCodec::CNumberFormat format=CTextCodec::ParseFormat(form);
 	for(intType i=0;i<numPoints;i++)
 	{
-		buffer.Format(form,arr[i]);
-		intType curLength=buffer.GetLength();
-
-		for(int j=0;j<curLength;j++)	{charArr.arr[curPos++]=buffer[j];}
-		if(i<(numPoints-1)) charArr.arr[curPos++]='\n';
+		writer.PutNumber(arr[i],format);
+		if(i<(numPoints-1)) writer.Put('\n');
 	}
 
-	return charArr.WriteBinary(name);
+	return writer.Close();
 }
 
 template <class theType,class intType>
 theType CHArray<theType,intType>::Sum() const
 {
-	theType result=0;
-	for (intType i = 0; i<numPoints; i++) result += arr[i];
-	return result;
+	return CArrayKernel<theType>::Sum(arr,numPoints);
 }
 
 template <class theType,class intType>
 theType CHArray<theType,intType>::WeightedSum(const CHArray<theType,intType>& weights) const
 {
-	theType result=0;
-	for (intType i = 0; i<numPoints; i++) result += arr[i] * weights.arr[i];
-	return result;
+	return CArrayKernel<theType>::DirectProduct(arr,weights.arr,numPoints);
 }
 
 template <class theType,class intType>
@@ -2241,7 +2153,7 @@ theType CHArray<theType,intType>::NormalizeSumTo1()
 	theType sum = Sum();
 	if(sum==0) sum=(theType)1;
 
-	(*this) *= 1 / sum;
+	CArrayKernel<theType>::Scale(arr,numPoints,1/sum);
 
 	return sum;
 }
@@ -2252,7 +2164,7 @@ theType CHArray<theType,intType>::NormalizeNorm()
 	theType sqrtSumOfSquares=sqrt(SumOfSquares());
 	if(sqrtSumOfSquares==0) sqrtSumOfSquares=1;
 	
-	(*this) *= 1 / sqrtSumOfSquares;
+	CArrayKernel<theType>::Scale(arr,numPoints,1/sqrtSumOfSquares);
 
 	return sqrtSumOfSquares;
 }
@@ -2260,9 +2172,7 @@ theType CHArray<theType,intType>::NormalizeNorm()
 template <class theType,class intType>
 theType CHArray<theType,intType>::SumOfSquares() const
 {
-	theType result=0;
-	for (intType i = 0; i < numPoints; i++) result += arr[i] * arr[i];
-	return result;
+	return CArrayKernel<theType>::SumOfSquares(arr,numPoints);
 }
 
 template <class theType,class intType>
@@ -2292,7 +2202,7 @@ theType CHArray<theType,intType>::DirectProduct(const CHArray<theType,intType> &
 
 	if(numPoints!=rhs.numPoints) return result;
 
-	for (intType i = 0; i<numPoints; i++) result += arr[i] * rhs.arr[i];
+	result=CArrayKernel<theType>::DirectProduct(arr,rhs.arr,numPoints);
 	
 	if(alpha==1) return result;					//if simple direct product
 
@@ -2408,3 +2318,6 @@ void CHArray<theType,intType>::IntegralForm()
 		arr[i]=sum;
 	}
 }
+
+//Lazy element-wise expressions over CHArray
+#include <ArrayExpr.h>
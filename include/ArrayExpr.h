@@ -0,0 +1,223 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Lazy element-wise expressions over CHArray
+//The eager operators of CHArray (a*b+c) return a new array for every operation
+//Wrapping one operand with Lazy() builds an expression tree instead:
+//
+//		result = Lazy(a)*b + Lazy(c)*2.0;		//one loop, no temporary arrays
+//		CHArray<double> r(Sqrt(Lazy(x)*x + Lazy(y)*y));
+//
+//Every array-scalar or array-array pair needs a Lazy() operand: in Lazy(a)*b + c*2.0 the c*2.0 is an eager
+//CHArray operation that allocates a full temporary before the expression is built
+//The tree is evaluated element by element when it is assigned to a CHArray
+//Array operands are referenced, not copied - they must outlive the expression
+//The count of an expression is the smallest count of the arrays it contains
+//The target may appear in the expression (a = Lazy(a)*b) - every element is read before it is written
+
+#pragma once
+#include <Array.h>
+#include <math.h>
+
+//Base of all expression nodes, exprType is the derived node (CRTP)
+template <class exprType> class CArrayExpr
+{
+public:
+	const exprType& Self() const {return static_cast<const exprType&>(*this);}
+};
+
+//Leaf - references the points of a CHArray
+template <class theType, class intType> class CArrayExprLeaf : public CArrayExpr<CArrayExprLeaf<theType,intType> >
+{
+public:
+	typedef theType valueType;
+	typedef intType indexType;
+
+	CArrayExprLeaf(const CHArray<theType,intType>& theArr):arr(theArr.arr),numPoints(theArr.Count()){};
+
+	theType operator[](intType i) const {return arr[i];}
+	intType Count() const {return numPoints;}
+
+private:
+	const theType* arr;
+	intType numPoints;
+};
+
+//Scalar operand - has no count of its own
+template <class theType, class intType> class CArrayExprScalar : public CArrayExpr<CArrayExprScalar<theType,intType> >
+{
+public:
+	typedef theType valueType;
+	typedef intType indexType;
+
+	CArrayExprScalar(theType theVal):val(theVal){};
+
+	theType operator[](intType) const {return val;}
+	intType Count() const {return -1;}
+
+private:
+	theType val;
+};
+
+//Binary node
+template <class lhsType, class rhsType, class opType> class CArrayExprBinary :
+	public CArrayExpr<CArrayExprBinary<lhsType,rhsType,opType> >
+{
+public:
+	typedef typename lhsType::valueType valueType;
+	typedef typename lhsType::indexType indexType;
+
+	CArrayExprBinary(const lhsType& theLhs, const rhsType& theRhs):lhs(theLhs),rhs(theRhs){};
+
+	valueType operator[](indexType i) const {return opType::Apply(lhs[i],rhs[i]);}
+	indexType Count() const
+	{
+		indexType lCount=lhs.Count(), rCount=rhs.Count();
+		if(lCount<0) return rCount;
+		if(rCount<0) return lCount;
+		return std::min(lCount,rCount);
+	}
+
+private:
+	lhsType lhs;
+	rhsType rhs;
+};
+
+//Unary node
+template <class argType, class opType> class CArrayExprUnary : public CArrayExpr<CArrayExprUnary<argType,opType> >
+{
+public:
+	typedef typename argType::valueType valueType;
+	typedef typename argType::indexType indexType;
+
+	CArrayExprUnary(const argType& theArg):arg(theArg){};
+
+	valueType operator[](indexType i) const {return opType::Apply(arg[i]);}
+	indexType Count() const {return arg.Count();}
+
+private:
+	argType arg;
+};
+
+//Operations - same meaning as the eager operators of CHArray
+struct CArrayExprAdd{template <class T> static T Apply(T a, T b){return a+b;}};
+struct CArrayExprSubtract{template <class T> static T Apply(T a, T b){return a-b;}};
+struct CArrayExprMultiply{template <class T> static T Apply(T a, T b){return a*b;}};
+struct CArrayExprDivide{template <class T> static T Apply(T a, T b){return a/b;}};
+struct CArrayExprRemainder{template <class T> static T Apply(T a, T b){return a%b;}};
+struct CArrayExprPower{template <class T> static T Apply(T a, T b){return (T)pow(a,b);}};
+struct CArrayExprNegate{template <class T> static T Apply(T a){return -a;}};
+struct CArrayExprSqrt{template <class T> static T Apply(T a){return (T)sqrt(a);}};
+struct CArrayExprAbs{template <class T> static T Apply(T a){return (T)fabs(a);}};
+struct CArrayExprExp{template <class T> static T Apply(T a){return (T)exp(a);}};
+struct CArrayExprLog{template <class T> static T Apply(T a){return (T)log(a);}};
+
+//Starts a lazy expression
+template <class theType, class intType>
+CArrayExprLeaf<theType,intType> Lazy(const CHArray<theType,intType>& arr)
+{
+	return CArrayExprLeaf<theType,intType>(arr);
+}
+
+//Operators for all combinations of expression, CHArray and scalar operands
+//At least one operand must be an expression, CHArray op CHArray stays eager
+#define ARRAY_EXPR_BINARY_OPERATOR(op, opType)																\
+template <class lhsType, class rhsType>																		\
+CArrayExprBinary<lhsType,rhsType,opType> operator op(const CArrayExpr<lhsType>& lhs, const CArrayExpr<rhsType>& rhs)	\
+{return CArrayExprBinary<lhsType,rhsType,opType>(lhs.Self(),rhs.Self());}									\
+																											\
+template <class lhsType, class theType, class intType>														\
+CArrayExprBinary<lhsType,CArrayExprLeaf<theType,intType>,opType>											\
+operator op(const CArrayExpr<lhsType>& lhs, const CHArray<theType,intType>& rhs)							\
+{return CArrayExprBinary<lhsType,CArrayExprLeaf<theType,intType>,opType>(lhs.Self(),rhs);}					\
+																											\
+template <class theType, class intType, class rhsType>														\
+CArrayExprBinary<CArrayExprLeaf<theType,intType>,rhsType,opType>											\
+operator op(const CHArray<theType,intType>& lhs, const CArrayExpr<rhsType>& rhs)							\
+{return CArrayExprBinary<CArrayExprLeaf<theType,intType>,rhsType,opType>(lhs,rhs.Self());}					\
+																											\
+template <class lhsType>																					\
+CArrayExprBinary<lhsType,CArrayExprScalar<typename lhsType::valueType,typename lhsType::indexType>,opType>	\
+operator op(const CArrayExpr<lhsType>& lhs, typename lhsType::valueType val)								\
+{return CArrayExprBinary<lhsType,CArrayExprScalar<typename lhsType::valueType,typename lhsType::indexType>,opType>(lhs.Self(),val);}	\
+																											\
+template <class rhsType>																					\
+CArrayExprBinary<CArrayExprScalar<typename rhsType::valueType,typename rhsType::indexType>,rhsType,opType>	\
+operator op(typename rhsType::valueType val, const CArrayExpr<rhsType>& rhs)								\
+{return CArrayExprBinary<CArrayExprScalar<typename rhsType::valueType,typename rhsType::indexType>,rhsType,opType>(val,rhs.Self());}
+
+ARRAY_EXPR_BINARY_OPERATOR(+, CArrayExprAdd)
+ARRAY_EXPR_BINARY_OPERATOR(-, CArrayExprSubtract)
+ARRAY_EXPR_BINARY_OPERATOR(*, CArrayExprMultiply)
+ARRAY_EXPR_BINARY_OPERATOR(/, CArrayExprDivide)
+ARRAY_EXPR_BINARY_OPERATOR(%, CArrayExprRemainder)
+ARRAY_EXPR_BINARY_OPERATOR(^, CArrayExprPower)
+
+#undef ARRAY_EXPR_BINARY_OPERATOR
+
+#define ARRAY_EXPR_UNARY_FUNCTION(name, opType)										\
+template <class argType>															\
+CArrayExprUnary<argType,opType> name(const CArrayExpr<argType>& arg)				\
+{return CArrayExprUnary<argType,opType>(arg.Self());}
+
+ARRAY_EXPR_UNARY_FUNCTION(operator-, CArrayExprNegate)
+ARRAY_EXPR_UNARY_FUNCTION(Sqrt, CArrayExprSqrt)
+ARRAY_EXPR_UNARY_FUNCTION(Abs, CArrayExprAbs)
+ARRAY_EXPR_UNARY_FUNCTION(Exp, CArrayExprExp)
+ARRAY_EXPR_UNARY_FUNCTION(Log, CArrayExprLog)
+
+#undef ARRAY_EXPR_UNARY_FUNCTION
+
+//Evaluation into CHArray
+template <class theType, class intType>
+template <class exprType>
+CHArray<theType,intType>::CHArray(const CArrayExpr<exprType>& expr):
+numPoints(0),
+arr(0)
+{
+	const exprType& e=expr.Self();
+	intType count=(intType)e.Count();
+
+	size=count;
+	fVirtual=false;
+	arr=CHArrayAllocator<theType>::Allocate((size_t)size);
+	numPoints=count;
+
+	for(intType i=0; i<count; i++) arr[i]=(theType)e[i];
+}
+
+//Non-virtual targets are resized to the count of the expression
+//Virtual targets keep their size and get min(numPoints, count) points, as in copy assignment
+template <class theType, class intType>
+template <class exprType>
+CHArray<theType,intType>& CHArray<theType,intType>::operator=(const CArrayExpr<exprType>& expr)
+{
+	const exprType& e=expr.Self();
+	intType count=(intType)e.Count();
+
+	if(fVirtual) count=std::min(count,numPoints);
+	else ResizeIfSmaller(count,true);		//Never reallocates when the target is part of the expression
+
+	for(intType i=0; i<count; i++) arr[i]=(theType)e[i];
+
+	return *this;
+}
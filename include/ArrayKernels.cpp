@@ -0,0 +1,530 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "ArrayKernels.h"
+#include <string.h>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ARRAY_KERNELS_X86
+#endif
+
+#ifdef ARRAY_KERNELS_X86
+
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+//GCC and Clang only emit AVX instructions in functions marked for them
+//MSVC accepts the intrinsics anywhere, and AVX-512 intrinsics since VS2017
+#ifdef __GNUC__
+#define ARRAY_KERNELS_SSE2 __attribute__((target("sse2")))
+#define ARRAY_KERNELS_AVX2 __attribute__((target("avx2,fma")))
+#define ARRAY_KERNELS_AVX512 __attribute__((target("avx512f")))
+#define ARRAY_KERNELS_HAS_AVX512
+#else
+#define ARRAY_KERNELS_SSE2
+#define ARRAY_KERNELS_AVX2
+#define ARRAY_KERNELS_AVX512
+#if _MSC_VER>=1910
+#define ARRAY_KERNELS_HAS_AVX512
+#endif
+#endif
+
+static void CpuId(int regs[4], int leaf)
+{
+#ifdef _MSC_VER
+	__cpuidex(regs,leaf,0);
+#else
+	unsigned int a,b,c,d;
+	__cpuid_count(leaf,0,a,b,c,d);
+	regs[0]=(int)a; regs[1]=(int)b; regs[2]=(int)c; regs[3]=(int)d;
+#endif
+}
+
+//Register state enabled by the OS
+static unsigned long long XGetBv()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned int a,d;
+	__asm__ volatile("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+	return ((unsigned long long)d<<32)|a;
+#endif
+}
+
+static int DetectLevel()
+{
+	int regs[4];
+	CpuId(regs,0);
+	int maxLeaf=regs[0];
+
+	CpuId(regs,1);
+	if(!(regs[3] & (1<<26))) return CArrayKernels::level_scalar;		//SSE2
+
+	bool fOsxsave=(regs[2] & (1<<27))!=0;
+	bool fAvx=(regs[2] & (1<<28))!=0;
+	bool fFma=(regs[2] & (1<<12))!=0;
+	if(!fOsxsave || !fAvx || !fFma || maxLeaf<7) return CArrayKernels::level_sse2;
+
+	unsigned long long xcr0=XGetBv();
+	if((xcr0 & 0x6)!=0x6) return CArrayKernels::level_sse2;			//XMM and YMM state
+
+	CpuId(regs,7);
+	if(!(regs[1] & (1<<5))) return CArrayKernels::level_sse2;			//AVX2
+
+#ifdef ARRAY_KERNELS_HAS_AVX512
+	if((regs[1] & (1<<16)) && (xcr0 & 0xE6)==0xE6) return CArrayKernels::level_avx512;	//AVX-512F, opmask and ZMM state
+#endif
+
+	return CArrayKernels::level_avx2;
+}
+
+#define SSE2_FMADD_PD(a,b,c) _mm_add_pd(_mm_mul_pd(a,b),c)
+#define SSE2_FMADD_PS(a,b,c) _mm_add_ps(_mm_mul_ps(a,b),c)
+#define SSE2_LOADU_EPI32(p) _mm_loadu_si128((const __m128i*)(p))
+#define SSE2_STOREU_EPI32(p,v) _mm_storeu_si128((__m128i*)(p),v)
+#define AVX2_LOADU_EPI32(p) _mm256_loadu_si256((const __m256i*)(p))
+#define AVX2_STOREU_EPI32(p,v) _mm256_storeu_si256((__m256i*)(p),v)
+
+//Sum with four independent vector accumulators, then the tail
+#define ARRAY_KERNELS_SUM(isa, target, theType, vecType, width, load, store, zero, add)	\
+static target theType Sum_##isa(const theType* p, long long n)							\
+{																						\
+	vecType a0=zero, a1=zero, a2=zero, a3=zero;											\
+	long long i=0;																		\
+	for(; i+4*width<=n; i+=4*width)														\
+	{																					\
+		a0=add(a0,load(p+i)); a1=add(a1,load(p+i+width));								\
+		a2=add(a2,load(p+i+2*width)); a3=add(a3,load(p+i+3*width));						\
+	}																					\
+	for(; i+width<=n; i+=width) a0=add(a0,load(p+i));									\
+	theType buf[width];																	\
+	store(buf,add(add(a0,a1),add(a2,a3)));												\
+	theType result=0;																	\
+	for(int k=0; k<width; k++) result+=buf[k];											\
+	for(; i<n; i++) result+=p[i];														\
+	return result;																		\
+}
+
+//The remaining floating point kernels
+#define ARRAY_KERNELS_FLOAT(isa, target, theType, vecType, width, load, store, set1, add, sub, mul, fmadd)	\
+ARRAY_KERNELS_SUM(isa, target, theType, vecType, width, load, store, set1(0), add)			\
+																						\
+static target theType SumOfSquares_##isa(const theType* p, long long n)					\
+{																						\
+	vecType a0=set1(0), a1=a0, a2=a0, a3=a0, v;											\
+	long long i=0;																		\
+	for(; i+4*width<=n; i+=4*width)														\
+	{																					\
+		v=load(p+i); a0=fmadd(v,v,a0); v=load(p+i+width); a1=fmadd(v,v,a1);				\
+		v=load(p+i+2*width); a2=fmadd(v,v,a2); v=load(p+i+3*width); a3=fmadd(v,v,a3);	\
+	}																					\
+	for(; i+width<=n; i+=width){v=load(p+i); a0=fmadd(v,v,a0);}							\
+	theType buf[width];																	\
+	store(buf,add(add(a0,a1),add(a2,a3)));												\
+	theType result=0;																	\
+	for(int k=0; k<width; k++) result+=buf[k];											\
+	for(; i<n; i++) result+=p[i]*p[i];													\
+	return result;																		\
+}																						\
+																						\
+static target theType DirectProduct_##isa(const theType* a, const theType* b, long long n)	\
+{																						\
+	vecType a0=set1(0), a1=a0, a2=a0, a3=a0;											\
+	long long i=0;																		\
+	for(; i+4*width<=n; i+=4*width)														\
+	{																					\
+		a0=fmadd(load(a+i),load(b+i),a0);												\
+		a1=fmadd(load(a+i+width),load(b+i+width),a1);									\
+		a2=fmadd(load(a+i+2*width),load(b+i+2*width),a2);								\
+		a3=fmadd(load(a+i+3*width),load(b+i+3*width),a3);								\
+	}																					\
+	for(; i+width<=n; i+=width) a0=fmadd(load(a+i),load(b+i),a0);						\
+	theType buf[width];																	\
+	store(buf,add(add(a0,a1),add(a2,a3)));												\
+	theType result=0;																	\
+	for(int k=0; k<width; k++) result+=buf[k];											\
+	for(; i<n; i++) result+=a[i]*b[i];													\
+	return result;																		\
+}																						\
+																						\
+static target theType SumOfSquaredDev_##isa(const theType* p, long long n, theType mean)	\
+{																						\
+	vecType m=set1(mean), a0=set1(0), a1=a0, v, w;										\
+	long long i=0;																		\
+	for(; i+2*width<=n; i+=2*width)														\
+	{																					\
+		v=sub(load(p+i),m); a0=fmadd(v,v,a0);											\
+		w=sub(load(p+i+width),m); a1=fmadd(w,w,a1);										\
+	}																					\
+	for(; i+width<=n; i+=width){v=sub(load(p+i),m); a0=fmadd(v,v,a0);}					\
+	theType buf[width];																	\
+	store(buf,add(a0,a1));																\
+	theType result=0, cur;																\
+	for(int k=0; k<width; k++) result+=buf[k];											\
+	for(; i<n; i++){cur=p[i]-mean; result+=cur*cur;}									\
+	return result;																		\
+}																						\
+																						\
+static target theType SquaredDistance_##isa(const theType* a, const theType* b, long long n)	\
+{																						\
+	vecType a0=set1(0), a1=a0, v, w;													\
+	long long i=0;																		\
+	for(; i+2*width<=n; i+=2*width)														\
+	{																					\
+		v=sub(load(a+i),load(b+i)); a0=fmadd(v,v,a0);									\
+		w=sub(load(a+i+width),load(b+i+width)); a1=fmadd(w,w,a1);						\
+	}																					\
+	for(; i+width<=n; i+=width){v=sub(load(a+i),load(b+i)); a0=fmadd(v,v,a0);}			\
+	theType buf[width];																	\
+	store(buf,add(a0,a1));																\
+	theType result=0, cur;																\
+	for(int k=0; k<width; k++) result+=buf[k];											\
+	for(; i<n; i++){cur=a[i]-b[i]; result+=cur*cur;}									\
+	return result;																		\
+}																						\
+																						\
+static target void MultiplyAdd_##isa(theType* y, const theType* x, long long n, theType factor)	\
+{																						\
+	vecType f=set1(factor);																\
+	long long i=0;																		\
+	for(; i+width<=n; i+=width) store(y+i,fmadd(load(x+i),f,load(y+i)));				\
+	for(; i<n; i++) y[i]+=x[i]*factor;													\
+}																						\
+																						\
+static target void Scale_##isa(theType* p, long long n, theType factor)					\
+{																						\
+	vecType f=set1(factor);																\
+	long long i=0;																		\
+	for(; i+width<=n; i+=width) store(p+i,mul(load(p+i),f));							\
+	for(; i<n; i++) p[i]*=factor;														\
+}
+
+ARRAY_KERNELS_FLOAT(sse2_d, ARRAY_KERNELS_SSE2, double, __m128d, 2, _mm_loadu_pd, _mm_storeu_pd, _mm_set1_pd,
+	_mm_add_pd, _mm_sub_pd, _mm_mul_pd, SSE2_FMADD_PD)
+ARRAY_KERNELS_FLOAT(sse2_f, ARRAY_KERNELS_SSE2, float, __m128, 4, _mm_loadu_ps, _mm_storeu_ps, _mm_set1_ps,
+	_mm_add_ps, _mm_sub_ps, _mm_mul_ps, SSE2_FMADD_PS)
+ARRAY_KERNELS_SUM(sse2_i, ARRAY_KERNELS_SSE2, int, __m128i, 4, SSE2_LOADU_EPI32, SSE2_STOREU_EPI32, _mm_setzero_si128(), _mm_add_epi32)
+
+ARRAY_KERNELS_FLOAT(avx2_d, ARRAY_KERNELS_AVX2, double, __m256d, 4, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_set1_pd,
+	_mm256_add_pd, _mm256_sub_pd, _mm256_mul_pd, _mm256_fmadd_pd)
+ARRAY_KERNELS_FLOAT(avx2_f, ARRAY_KERNELS_AVX2, float, __m256, 8, _mm256_loadu_ps, _mm256_storeu_ps, _mm256_set1_ps,
+	_mm256_add_ps, _mm256_sub_ps, _mm256_mul_ps, _mm256_fmadd_ps)
+ARRAY_KERNELS_SUM(avx2_i, ARRAY_KERNELS_AVX2, int, __m256i, 8, AVX2_LOADU_EPI32, AVX2_STOREU_EPI32, _mm256_setzero_si256(), _mm256_add_epi32)
+
+#ifdef ARRAY_KERNELS_HAS_AVX512
+ARRAY_KERNELS_FLOAT(avx512_d, ARRAY_KERNELS_AVX512, double, __m512d, 8, _mm512_loadu_pd, _mm512_storeu_pd, _mm512_set1_pd,
+	_mm512_add_pd, _mm512_sub_pd, _mm512_mul_pd, _mm512_fmadd_pd)
+ARRAY_KERNELS_FLOAT(avx512_f, ARRAY_KERNELS_AVX512, float, __m512, 16, _mm512_loadu_ps, _mm512_storeu_ps, _mm512_set1_ps,
+	_mm512_add_ps, _mm512_sub_ps, _mm512_mul_ps, _mm512_fmadd_ps)
+ARRAY_KERNELS_SUM(avx512_i, ARRAY_KERNELS_AVX512, int, __m512i, 16, _mm512_loadu_si512, _mm512_storeu_si512, _mm512_setzero_si512(), _mm512_add_epi32)
+#endif
+
+
+//Register tile transposes: "a" holds width columns of width elements, written as width columns of "b"
+static ARRAY_KERNELS_SSE2 void TransposeTile_sse2_d(const double* a, long long lda, double* b, long long ldb)
+{
+	__m128d c0=_mm_loadu_pd(a), c1=_mm_loadu_pd(a+lda);
+	_mm_storeu_pd(b,_mm_unpacklo_pd(c0,c1));
+	_mm_storeu_pd(b+ldb,_mm_unpackhi_pd(c0,c1));
+}
+
+static ARRAY_KERNELS_SSE2 void TransposeTile_sse2_f(const float* a, long long lda, float* b, long long ldb)
+{
+	__m128 c0=_mm_loadu_ps(a), c1=_mm_loadu_ps(a+lda), c2=_mm_loadu_ps(a+2*lda), c3=_mm_loadu_ps(a+3*lda);
+	_MM_TRANSPOSE4_PS(c0,c1,c2,c3);
+	_mm_storeu_ps(b,c0); _mm_storeu_ps(b+ldb,c1); _mm_storeu_ps(b+2*ldb,c2); _mm_storeu_ps(b+3*ldb,c3);
+}
+
+static ARRAY_KERNELS_AVX2 void TransposeTile_avx2_d(const double* a, long long lda, double* b, long long ldb)
+{
+	__m256d c0=_mm256_loadu_pd(a), c1=_mm256_loadu_pd(a+lda), c2=_mm256_loadu_pd(a+2*lda), c3=_mm256_loadu_pd(a+3*lda);
+	__m256d t0=_mm256_unpacklo_pd(c0,c1), t1=_mm256_unpackhi_pd(c0,c1);
+	__m256d t2=_mm256_unpacklo_pd(c2,c3), t3=_mm256_unpackhi_pd(c2,c3);
+	_mm256_storeu_pd(b,_mm256_permute2f128_pd(t0,t2,0x20));
+	_mm256_storeu_pd(b+ldb,_mm256_permute2f128_pd(t1,t3,0x20));
+	_mm256_storeu_pd(b+2*ldb,_mm256_permute2f128_pd(t0,t2,0x31));
+	_mm256_storeu_pd(b+3*ldb,_mm256_permute2f128_pd(t1,t3,0x31));
+}
+
+static ARRAY_KERNELS_AVX2 void TransposeTile_avx2_f(const float* a, long long lda, float* b, long long ldb)
+{
+	__m256 c[8], t[8];
+	for(int k=0;k<8;k++) c[k]=_mm256_loadu_ps(a+k*lda);
+	for(int k=0;k<8;k+=2) {t[k]=_mm256_unpacklo_ps(c[k],c[k+1]); t[k+1]=_mm256_unpackhi_ps(c[k],c[k+1]);}
+	for(int k=0;k<8;k+=4)
+	{
+		c[k]=_mm256_shuffle_ps(t[k],t[k+2],0x44); c[k+1]=_mm256_shuffle_ps(t[k],t[k+2],0xEE);
+		c[k+2]=_mm256_shuffle_ps(t[k+1],t[k+3],0x44); c[k+3]=_mm256_shuffle_ps(t[k+1],t[k+3],0xEE);
+	}
+	for(int k=0;k<4;k++)
+	{
+		_mm256_storeu_ps(b+k*ldb,_mm256_permute2f128_ps(c[k],c[k+4],0x20));
+		_mm256_storeu_ps(b+(k+4)*ldb,_mm256_permute2f128_ps(c[k],c[k+4],0x31));
+	}
+}
+
+//Transposes an m x n block that fits in L1: whole tiles in registers, scalar edges
+#define ARRAY_KERNELS_TRANSPOSE_BLOCK(isa, target, theType, width)						\
+static target void TransposeBlock_##isa(const theType* a, long long m, long long n, long long lda,	\
+	theType* b, long long ldb)															\
+{																						\
+	long long i, j, k;																	\
+	for(j=0; j+width<=n; j+=width)														\
+	{																					\
+		for(i=0; i+width<=m; i+=width) TransposeTile_##isa(a+i+j*lda,lda,b+j+i*ldb,ldb);	\
+		for(; i<m; i++) for(k=j; k<j+width; k++) b[k+i*ldb]=a[i+k*lda];				\
+	}																					\
+	for(; j<n; j++) for(i=0; i<m; i++) b[j+i*ldb]=a[i+j*lda];							\
+}
+
+ARRAY_KERNELS_TRANSPOSE_BLOCK(sse2_d, ARRAY_KERNELS_SSE2, double, 2)
+ARRAY_KERNELS_TRANSPOSE_BLOCK(sse2_f, ARRAY_KERNELS_SSE2, float, 4)
+ARRAY_KERNELS_TRANSPOSE_BLOCK(avx2_d, ARRAY_KERNELS_AVX2, double, 4)
+ARRAY_KERNELS_TRANSPOSE_BLOCK(avx2_f, ARRAY_KERNELS_AVX2, float, 8)
+
+#else	//ARRAY_KERNELS_X86
+
+static int DetectLevel() {return CArrayKernels::level_scalar;}
+
+#endif	//ARRAY_KERNELS_X86
+
+int CArrayKernels::forcedLevel=-1;
+
+int CArrayKernels::DetectedLevel()
+{
+	//Detection is idempotent, so a race on first use is harmless
+	static int detected=-1;
+	if(detected<0) detected=DetectLevel();
+	return detected;
+}
+
+int CArrayKernels::Level()
+{
+	int detected=DetectedLevel();
+	if(forcedLevel>=0 && forcedLevel<detected) return forcedLevel;
+	return detected;
+}
+
+void CArrayKernels::SetLevel(int level)
+{
+	forcedLevel=level;
+}
+
+const char* CArrayKernels::LevelName(int level)
+{
+	switch(level)
+	{
+	case level_sse2: return "SSE2";
+	case level_avx2: return "AVX2";
+	case level_avx512: return "AVX-512";
+	default: return "scalar";
+	}
+}
+
+//Dispatches to the kernel for the current level, "scalarCall" is the plain loop
+#ifdef ARRAY_KERNELS_X86
+#ifdef ARRAY_KERNELS_HAS_AVX512
+#define ARRAY_KERNELS_DISPATCH(name, suffix, args, scalarCall)				\
+	switch(Level())															\
+	{																		\
+	case level_avx512: return name##_avx512_##suffix args;					\
+	case level_avx2: return name##_avx2_##suffix args;						\
+	case level_sse2: return name##_sse2_##suffix args;						\
+	default: return scalarCall;												\
+	}
+#else
+#define ARRAY_KERNELS_DISPATCH(name, suffix, args, scalarCall)				\
+	switch(Level())															\
+	{																		\
+	case level_avx2: return name##_avx2_##suffix args;						\
+	case level_sse2: return name##_sse2_##suffix args;						\
+	default: return scalarCall;												\
+	}
+#endif
+#else
+#define ARRAY_KERNELS_DISPATCH(name, suffix, args, scalarCall) return scalarCall;
+#endif
+
+//Plain loops - CArrayKernel<double> and <float> are specialized to call back here
+template <class theType> static theType PlainSum(const theType* p, long long n)
+{theType result=0; for(long long i=0;i<n;i++) result+=p[i]; return result;}
+
+template <class theType> static theType PlainSumOfSquares(const theType* p, long long n)
+{theType result=0; for(long long i=0;i<n;i++) result+=p[i]*p[i]; return result;}
+
+template <class theType> static theType PlainDirectProduct(const theType* a, const theType* b, long long n)
+{theType result=0; for(long long i=0;i<n;i++) result+=a[i]*b[i]; return result;}
+
+template <class theType> static theType PlainSumOfSquaredDev(const theType* p, long long n, theType mean)
+{theType result=0, cur; for(long long i=0;i<n;i++){cur=p[i]-mean; result+=cur*cur;} return result;}
+
+template <class theType> static theType PlainSquaredDistance(const theType* a, const theType* b, long long n)
+{theType result=0, cur; for(long long i=0;i<n;i++){cur=a[i]-b[i]; result+=cur*cur;} return result;}
+
+template <class theType> static void PlainMultiplyAdd(theType* y, const theType* x, long long n, theType factor)
+{for(long long i=0;i<n;i++) y[i]+=x[i]*factor;}
+
+template <class theType> static void PlainScale(theType* p, long long n, theType factor)
+{for(long long i=0;i<n;i++) p[i]*=factor;}
+
+template <class theType> static void PlainTransposeBlock(const theType* a, long long m, long long n, long long lda, theType* b, long long ldb)
+{for(long long j=0;j<n;j++) for(long long i=0;i<m;i++) b[j+i*ldb]=a[i+j*lda];}
+
+//Cache-oblivious transpose: halves the longer side until the block fits in L1, so both the reads
+//and the writes stay within a few cache lines per column at every level of the memory hierarchy
+template <class theType> static void TransposeRecursive(const theType* a, long long m, long long n, long long lda,
+	theType* b, long long ldb, void (*block)(const theType*, long long, long long, long long, theType*, long long))
+{
+	const long long blockSize=32;
+	while(m>blockSize || n>blockSize)
+	{
+		if(m>=n)
+		{
+			long long half=(m/2+7)/8*8;
+			TransposeRecursive(a,half,n,lda,b,ldb,block);
+			a+=half; b+=half*ldb; m-=half;
+		}
+		else
+		{
+			long long half=(n/2+7)/8*8;
+			TransposeRecursive(a,m,half,lda,b,ldb,block);
+			a+=half*lda; b+=half; n-=half;
+		}
+	}
+	block(a,m,n,lda,b,ldb);
+}
+
+//In-place square transpose: mirrored tiles are transposed into two L1 buffers and written back swapped
+template <class theType> static void TransposeSquareBlocked(theType* a, long long n, long long lda,
+	void (*block)(const theType*, long long, long long, long long, theType*, long long))
+{
+	const long long blockSize=32;
+	theType buf1[blockSize*blockSize], buf2[blockSize*blockSize];
+	for(long long i=0;i<n;i+=blockSize)
+	{
+		long long mi=std::min(blockSize,n-i);
+		for(long long j=i;j<n;j+=blockSize)
+		{
+			long long mj=std::min(blockSize,n-j);
+			theType* aij=a+i+j*lda;			//rows i.., columns j..
+			theType* aji=a+j+i*lda;
+			block(aij,mi,mj,lda,buf1,mj);
+			if(j!=i) block(aji,mj,mi,lda,buf2,mi);
+			for(long long k=0;k<mi;k++) memcpy(aji+k*lda,buf1+k*mj,sizeof(theType)*mj);
+			if(j!=i) for(long long k=0;k<mj;k++) memcpy(aij+k*lda,buf2+k*mi,sizeof(theType)*mi);
+		}
+	}
+}
+
+double CArrayKernels::Sum(const double* p, long long n)
+{ARRAY_KERNELS_DISPATCH(Sum, d, (p,n), PlainSum(p,n))}
+
+float CArrayKernels::Sum(const float* p, long long n)
+{ARRAY_KERNELS_DISPATCH(Sum, f, (p,n), PlainSum(p,n))}
+
+int CArrayKernels::Sum(const int* p, long long n)
+{ARRAY_KERNELS_DISPATCH(Sum, i, (p,n), PlainSum(p,n))}
+
+double CArrayKernels::SumOfSquares(const double* p, long long n)
+{ARRAY_KERNELS_DISPATCH(SumOfSquares, d, (p,n), PlainSumOfSquares(p,n))}
+
+float CArrayKernels::SumOfSquares(const float* p, long long n)
+{ARRAY_KERNELS_DISPATCH(SumOfSquares, f, (p,n), PlainSumOfSquares(p,n))}
+
+double CArrayKernels::DirectProduct(const double* a, const double* b, long long n)
+{ARRAY_KERNELS_DISPATCH(DirectProduct, d, (a,b,n), PlainDirectProduct(a,b,n))}
+
+float CArrayKernels::DirectProduct(const float* a, const float* b, long long n)
+{ARRAY_KERNELS_DISPATCH(DirectProduct, f, (a,b,n), PlainDirectProduct(a,b,n))}
+
+double CArrayKernels::SumOfSquaredDev(const double* p, long long n, double mean)
+{ARRAY_KERNELS_DISPATCH(SumOfSquaredDev, d, (p,n,mean), PlainSumOfSquaredDev(p,n,mean))}
+
+float CArrayKernels::SumOfSquaredDev(const float* p, long long n, float mean)
+{ARRAY_KERNELS_DISPATCH(SumOfSquaredDev, f, (p,n,mean), PlainSumOfSquaredDev(p,n,mean))}
+
+double CArrayKernels::SquaredDistance(const double* a, const double* b, long long n)
+{ARRAY_KERNELS_DISPATCH(SquaredDistance, d, (a,b,n), PlainSquaredDistance(a,b,n))}
+
+float CArrayKernels::SquaredDistance(const float* a, const float* b, long long n)
+{ARRAY_KERNELS_DISPATCH(SquaredDistance, f, (a,b,n), PlainSquaredDistance(a,b,n))}
+
+void CArrayKernels::MultiplyAdd(double* y, const double* x, long long n, double factor)
+{ARRAY_KERNELS_DISPATCH(MultiplyAdd, d, (y,x,n,factor), PlainMultiplyAdd(y,x,n,factor))}
+
+void CArrayKernels::MultiplyAdd(float* y, const float* x, long long n, float factor)
+{ARRAY_KERNELS_DISPATCH(MultiplyAdd, f, (y,x,n,factor), PlainMultiplyAdd(y,x,n,factor))}
+
+void CArrayKernels::Scale(double* p, long long n, double factor)
+{ARRAY_KERNELS_DISPATCH(Scale, d, (p,n,factor), PlainScale(p,n,factor))}
+
+void CArrayKernels::Scale(float* p, long long n, float factor)
+{ARRAY_KERNELS_DISPATCH(Scale, f, (p,n,factor), PlainScale(p,n,factor))}
+
+#ifdef ARRAY_KERNELS_X86
+#define ARRAY_KERNELS_TRANSPOSE_BLOCK_FOR_LEVEL(suffix, theType)								\
+	switch(Level())																		\
+	{																					\
+	case level_avx512:																	\
+	case level_avx2: block=TransposeBlock_avx2_##suffix; break;							\
+	case level_sse2: block=TransposeBlock_sse2_##suffix; break;							\
+	default: block=PlainTransposeBlock<theType>;										\
+	}
+#else
+#define ARRAY_KERNELS_TRANSPOSE_BLOCK_FOR_LEVEL(suffix, theType) block=PlainTransposeBlock<theType>;
+#endif
+
+//AVX-512 uses the AVX2 tiles - transposition is bound by memory traffic, not by shuffles
+void CArrayKernels::Transpose(const double* a, long long m, long long n, long long lda, double* b, long long ldb)
+{
+	void (*block)(const double*, long long, long long, long long, double*, long long);
+	ARRAY_KERNELS_TRANSPOSE_BLOCK_FOR_LEVEL(d, double)
+	TransposeRecursive(a,m,n,lda,b,ldb,block);
+}
+
+void CArrayKernels::Transpose(const float* a, long long m, long long n, long long lda, float* b, long long ldb)
+{
+	void (*block)(const float*, long long, long long, long long, float*, long long);
+	ARRAY_KERNELS_TRANSPOSE_BLOCK_FOR_LEVEL(f, float)
+	TransposeRecursive(a,m,n,lda,b,ldb,block);
+}
+
+void CArrayKernels::TransposeSquare(double* a, long long n, long long lda)
+{
+	void (*block)(const double*, long long, long long, long long, double*, long long);
+	ARRAY_KERNELS_TRANSPOSE_BLOCK_FOR_LEVEL(d, double)
+	TransposeSquareBlocked(a,n,lda,block);
+}
+
+void CArrayKernels::TransposeSquare(float* a, long long n, long long lda)
+{
+	void (*block)(const float*, long long, long long, long long, float*, long long);
+	ARRAY_KERNELS_TRANSPOSE_BLOCK_FOR_LEVEL(f, float)
+	TransposeSquareBlocked(a,n,lda,block);
+}
@@ -0,0 +1,177 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Vectorized kernels behind the CHArray reductions and scaled additions
+//The instruction set is picked at run time from the CPU features:
+//AVX-512, AVX2 with FMA, SSE2, or plain loops
+//Kernels exist for double and float, and Sum() for int
+//Other types use the plain loops of CArrayKernel<>
+//Vectorized sums use several partial sums, so the last bits may differ from a sequential loop
+
+#pragma once
+
+class CArrayKernels
+{
+public:
+	enum {level_scalar=0, level_sse2, level_avx2, level_avx512};
+
+	static int Level();							//Level in use - detected, or forced with SetLevel()
+	static int DetectedLevel();					//Best level supported by the CPU and the compiler
+	static void SetLevel(int level);			//Forces a lower level (e.g. level_scalar for comparisons), -1 restores detection
+	static const char* LevelName(int level);
+
+	static double Sum(const double* p, long long n);
+	static float Sum(const float* p, long long n);
+	static int Sum(const int* p, long long n);
+
+	static double SumOfSquares(const double* p, long long n);
+	static float SumOfSquares(const float* p, long long n);
+
+	static double DirectProduct(const double* a, const double* b, long long n);
+	static float DirectProduct(const float* a, const float* b, long long n);
+
+	//Sum of (p[i]-mean)^2
+	static double SumOfSquaredDev(const double* p, long long n, double mean);
+	static float SumOfSquaredDev(const float* p, long long n, float mean);
+
+	//Sum of (a[i]-b[i])^2
+	static double SquaredDistance(const double* a, const double* b, long long n);
+	static float SquaredDistance(const float* a, const float* b, long long n);
+
+	//y[i] += x[i]*factor
+	static void MultiplyAdd(double* y, const double* x, long long n, double factor);
+	static void MultiplyAdd(float* y, const float* x, long long n, float factor);
+
+	//p[i] *= factor
+	static void Scale(double* p, long long n, double factor);
+	static void Scale(float* p, long long n, float factor);
+
+	//b = Transpose(a): "a" is m x n column-major with leading dimension lda, "b" is n x m with leading dimension ldb
+	//Blocked and cache-oblivious, tiles are transposed in registers; a and b must not overlap
+	static void Transpose(const double* a, long long m, long long n, long long lda, double* b, long long ldb);
+	static void Transpose(const float* a, long long m, long long n, long long lda, float* b, long long ldb);
+
+	//In-place transpose of an n x n column-major matrix with leading dimension lda
+	static void TransposeSquare(double* a, long long n, long long lda);
+	static void TransposeSquare(float* a, long long n, long long lda);
+
+private:
+	static int forcedLevel;
+};
+
+//Plain loops for any type, specialized below for the vectorized types
+template <class theType> class CArrayKernel
+{
+public:
+	static theType Sum(const theType* p, long long n)
+	{theType result=0; for(long long i=0;i<n;i++) result+=p[i]; return result;}
+
+	static theType SumOfSquares(const theType* p, long long n)
+	{theType result=0; for(long long i=0;i<n;i++) result+=p[i]*p[i]; return result;}
+
+	static theType DirectProduct(const theType* a, const theType* b, long long n)
+	{theType result=0; for(long long i=0;i<n;i++) result+=a[i]*b[i]; return result;}
+
+	static theType SumOfSquaredDev(const theType* p, long long n, theType mean)
+	{theType result=0, cur; for(long long i=0;i<n;i++){cur=p[i]-mean; result+=cur*cur;} return result;}
+
+	static theType SquaredDistance(const theType* a, const theType* b, long long n)
+	{theType result=0, cur; for(long long i=0;i<n;i++){cur=a[i]-b[i]; result+=cur*cur;} return result;}
+
+	static void MultiplyAdd(theType* y, const theType* x, long long n, theType factor)
+	{for(long long i=0;i<n;i++) y[i]+=x[i]*factor;}
+
+	static void Scale(theType* p, long long n, theType factor)
+	{for(long long i=0;i<n;i++) p[i]*=factor;}
+
+	//Plain transposes in square tiles, so that neither the reads nor the writes stride over the whole matrix
+	static void Transpose(const theType* a, long long m, long long n, long long lda, theType* b, long long ldb)
+	{
+		const long long tile=32;
+		for(long long j0=0;j0<n;j0+=tile)
+			for(long long i0=0;i0<m;i0+=tile)
+				for(long long j=j0;j<n && j<j0+tile;j++)
+					for(long long i=i0;i<m && i<i0+tile;i++) b[j+i*ldb]=a[i+j*lda];
+	}
+
+	static void TransposeSquare(theType* a, long long n, long long lda)
+	{
+		const long long tile=32;
+		theType temp;
+		for(long long j0=0;j0<n;j0+=tile)
+			for(long long i0=j0;i0<n;i0+=tile)
+				for(long long j=j0;j<n && j<j0+tile;j++)
+					for(long long i=(i0==j0 ? j+1 : i0);i<n && i<i0+tile;i++)
+					{temp=a[i+j*lda]; a[i+j*lda]=a[j+i*lda]; a[j+i*lda]=temp;}
+	}
+
+	//Compensated (Kahan) summation - error does not grow with n
+	//Must not be compiled with /fp:fast, which removes the compensation
+	static theType KahanSum(const theType* p, long long n)
+	{
+		theType sum=0, comp=0, y, t;
+		for(long long i=0;i<n;i++)
+		{
+			y=p[i]-comp;
+			t=sum+y;
+			comp=(t-sum)-y;
+			sum=t;
+		}
+		return sum;
+	}
+
+	//Pairwise summation - error grows as log(n), blocks of 256 are summed with Sum()
+	static theType PairwiseSum(const theType* p, long long n)
+	{
+		if(n<=256) return CArrayKernel<theType>::Sum(p,n);
+		long long half=(n/2+255)/256*256;
+		return PairwiseSum(p,half)+PairwiseSum(p+half,n-half);
+	}
+};
+
+#define ARRAY_KERNEL_SPECIALIZATION(theType)																		\
+template<> inline theType CArrayKernel<theType>::Sum(const theType* p, long long n)								\
+{return CArrayKernels::Sum(p,n);}																					\
+template<> inline theType CArrayKernel<theType>::SumOfSquares(const theType* p, long long n)						\
+{return CArrayKernels::SumOfSquares(p,n);}																			\
+template<> inline theType CArrayKernel<theType>::DirectProduct(const theType* a, const theType* b, long long n)	\
+{return CArrayKernels::DirectProduct(a,b,n);}																		\
+template<> inline theType CArrayKernel<theType>::SumOfSquaredDev(const theType* p, long long n, theType mean)		\
+{return CArrayKernels::SumOfSquaredDev(p,n,mean);}																	\
+template<> inline theType CArrayKernel<theType>::SquaredDistance(const theType* a, const theType* b, long long n)	\
+{return CArrayKernels::SquaredDistance(a,b,n);}																	\
+template<> inline void CArrayKernel<theType>::MultiplyAdd(theType* y, const theType* x, long long n, theType factor)	\
+{CArrayKernels::MultiplyAdd(y,x,n,factor);}																		\
+template<> inline void CArrayKernel<theType>::Scale(theType* p, long long n, theType factor)						\
+{CArrayKernels::Scale(p,n,factor);}																				\
+template<> inline void CArrayKernel<theType>::Transpose(const theType* a, long long m, long long n, long long lda,	\
+	theType* b, long long ldb)																						\
+{CArrayKernels::Transpose(a,m,n,lda,b,ldb);}																		\
+template<> inline void CArrayKernel<theType>::TransposeSquare(theType* a, long long n, long long lda)				\
+{CArrayKernels::TransposeSquare(a,n,lda);}
+
+ARRAY_KERNEL_SPECIALIZATION(double)
+ARRAY_KERNEL_SPECIALIZATION(float)
+
+#undef ARRAY_KERNEL_SPECIALIZATION
+
+template<> inline int CArrayKernel<int>::Sum(const int* p, long long n) {return CArrayKernels::Sum(p,n);}
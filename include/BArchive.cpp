@@ -0,0 +1,330 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "BArchive.h"
+#include "BlockCodec.h"
+#include <string.h>
+#include <algorithm>
+
+//Version 2 file layout:
+//header: 8 magic bytes, int version, int flags (reserved)
+//blocks: int rawSize, int storedSize, storedSize bytes (compressed unless storedSize==rawSize)
+//end: a block with rawSize==0
+static const char archiveMagic[8]={'B','A','R','C','H','I','V','E'};
+
+BArchive::BArchive(std::ostream& theOutStream, int theVersion, bool theFCompress):
+isStoring(true),
+version(theVersion),
+fCompress(theFCompress),
+fError(false),
+fClosed(false),
+outStream(&theOutStream),
+inStream(NULL),
+memBuffer(NULL),
+memSize(0),
+memPos(0),
+blockPos(0),
+blockEnd(0)
+{
+	if(version<version2) return;
+
+	version=version2;
+	block.resize((size_t)blockSize);
+	packed.resize((size_t)blockSize);
+
+	int header[2]={version,0};
+	WriteRaw(archiveMagic,sizeof(archiveMagic));
+	WriteRaw((const char*)header,sizeof(header));
+}
+
+BArchive::BArchive(std::istream& theInStream):
+isStoring(false),
+version(version1),
+fCompress(false),
+fError(false),
+fClosed(false),
+outStream(NULL),
+inStream(&theInStream),
+memBuffer(NULL),
+memSize(0),
+memPos(0),
+blockPos(0),
+blockEnd(0)
+{
+	ReadHeader();
+}
+
+BArchive::BArchive(const char* theBuffer, int64 theBufferSize):
+isStoring(false),
+version(version1),
+fCompress(false),
+fError(false),
+fClosed(false),
+outStream(NULL),
+inStream(NULL),
+memBuffer(theBuffer),
+memSize(theBufferSize),
+memPos(0),
+blockPos(0),
+blockEnd(0)
+{
+	ReadHeader();
+}
+
+void BArchive::ReadHeader()
+{
+	char magic[sizeof(archiveMagic)];
+	int64 numRead=0;
+
+	if(memBuffer!=NULL)
+	{
+		numRead=std::min<int64>(memSize,sizeof(magic));
+		memcpy(magic,memBuffer,(size_t)numRead);
+		memPos=numRead;
+	}
+	else
+	{
+		inStream->read(magic,sizeof(magic));
+		numRead=inStream->gcount();
+		if(numRead<(int64)sizeof(magic)) inStream->clear();	//A short version 1 archive, not an error yet
+	}
+
+	if(numRead==sizeof(magic) && memcmp(magic,archiveMagic,sizeof(magic))==0)
+	{
+		int header[2];
+		if(!ReadRaw((char*)header,sizeof(header)) || header[0]!=version2)
+		{
+			std::cerr << "Error: unsupported archive version.";
+			fError=true;
+			return;
+		}
+		version=version2;
+		block.resize((size_t)blockSize);
+		return;
+	}
+
+	//Version 1 - the bytes read belong to the data
+	block.assign(magic,magic+numRead);
+	blockPos=0;
+	blockEnd=numRead;
+}
+
+bool BArchive::Close()
+{
+	if(!isStoring || fClosed) return !fError;
+	fClosed=true;
+
+	if(version>=version2)
+	{
+		if(blockPos>0) WriteBlock(&block[0],blockPos);
+		blockPos=0;
+
+		int endMarker[2]={0,0};
+		WriteRaw((const char*)endMarker,sizeof(endMarker));
+	}
+
+	outStream->flush();
+	if(!(*outStream)) fError=true;
+
+	return !fError;
+}
+
+void BArchive::WriteBytes(const void* data, int64 numBytes)
+{
+	const char* src=(const char*)data;
+	if(numBytes<=0) return;
+
+	if(fClosed)
+	{
+		fError=true;
+		return;
+	}
+
+	if(version<version2)
+	{
+		WriteRaw(src,numBytes);
+		return;
+	}
+
+	while(numBytes>0)
+	{
+		//Whole blocks of a large array are compressed straight from the source
+		if(blockPos==0 && numBytes>=blockSize)
+		{
+			WriteBlock(src,blockSize);
+			src+=blockSize;
+			numBytes-=blockSize;
+			continue;
+		}
+
+		int64 toCopy=std::min(numBytes,blockSize-blockPos);
+		memcpy(&block[(size_t)blockPos],src,(size_t)toCopy);
+		blockPos+=toCopy;
+		src+=toCopy;
+		numBytes-=toCopy;
+
+		if(blockPos==blockSize)
+		{
+			WriteBlock(&block[0],blockSize);
+			blockPos=0;
+		}
+	}
+}
+
+void BArchive::ReadBytes(void* data, int64 numBytes)
+{
+	char* dst=(char*)data;
+	if(numBytes<=0) return;
+
+	while(numBytes>0)
+	{
+		//Bytes left in the current block
+		if(blockPos<blockEnd)
+		{
+			int64 toCopy=std::min(numBytes,blockEnd-blockPos);
+			memcpy(dst,&block[(size_t)blockPos],(size_t)toCopy);
+			blockPos+=toCopy;
+			dst+=toCopy;
+			numBytes-=toCopy;
+			continue;
+		}
+
+		if(fError) break;
+
+		if(version<version2)
+		{
+			if(!ReadRaw(dst,numBytes)) break;
+			return;
+		}
+
+		//Next block - straight into dst if it fits there
+		int64 numRead=0;
+		if(!ReadBlock(dst,numBytes,numRead)) break;
+		dst+=numRead;
+		numBytes-=numRead;
+	}
+
+	if(numBytes>0)
+	{
+		memset(dst,0,(size_t)numBytes);
+		fError=true;
+	}
+}
+
+void BArchive::WriteBlock(const char* data, int64 numBytes)
+{
+	int sizes[2]={(int)numBytes,(int)numBytes};
+	const char* stored=data;
+
+	if(fCompress)
+	{
+		//Only kept if it saves something
+		int packedSize=CBlockCodec::Compress(data,(int)numBytes,&packed[0],(int)numBytes-1);
+		if(packedSize>0)
+		{
+			sizes[1]=packedSize;
+			stored=&packed[0];
+		}
+	}
+
+	WriteRaw((const char*)sizes,sizeof(sizes));
+	WriteRaw(stored,sizes[1]);
+}
+
+bool BArchive::ReadBlock(char* target, int64 targetSize, int64& numRead)
+{
+	int sizes[2];
+	if(!ReadRaw((char*)sizes,sizeof(sizes))) return false;
+
+	int rawSize=sizes[0];
+	int storedSize=sizes[1];
+	if(rawSize<=0 || rawSize>blockSize || storedSize<=0 || storedSize>rawSize)
+	{
+		if(rawSize!=0) std::cerr << "Error: corrupt archive block.";
+		fError=true;
+		return false;
+	}
+
+	const char* stored=ReadRawInPlace(storedSize);
+	if(stored==NULL) return false;
+
+	//Whole block fits into the target - no intermediate copy
+	char* dst=target;
+	if(rawSize>targetSize) dst=&block[0];
+
+	bool fOk=true;
+	if(storedSize==rawSize) memcpy(dst,stored,rawSize);
+	else fOk=CBlockCodec::Decompress(stored,storedSize,dst,rawSize);
+
+	if(!fOk)
+	{
+		std::cerr << "Error: corrupt archive block.";
+		fError=true;
+		return false;
+	}
+
+	if(dst==target) numRead=rawSize;
+	else
+	{
+		blockPos=0;
+		blockEnd=rawSize;
+		numRead=0;
+	}
+
+	return true;
+}
+
+void BArchive::WriteRaw(const char* data, int64 numBytes)
+{
+	outStream->write(data,numBytes);
+	if(!(*outStream)) fError=true;
+}
+
+bool BArchive::ReadRaw(char* data, int64 numBytes)
+{
+	if(memBuffer!=NULL)
+	{
+		if(memSize-memPos<numBytes) {fError=true; return false;}
+		memcpy(data,memBuffer+memPos,(size_t)numBytes);
+		memPos+=numBytes;
+		return true;
+	}
+
+	inStream->read(data,numBytes);
+	if(inStream->gcount()!=numBytes) {fError=true; return false;}
+	return true;
+}
+
+const char* BArchive::ReadRawInPlace(int64 numBytes)
+{
+	if(memBuffer!=NULL)
+	{
+		if(memSize-memPos<numBytes) {fError=true; return NULL;}
+		const char* result=memBuffer+memPos;
+		memPos+=numBytes;
+		return result;
+	}
+
+	if((int64)packed.size()<numBytes) packed.resize((size_t)numBytes);
+	if(!ReadRaw(&packed[0],numBytes)) return NULL;
+	return &packed[0];
+}
@@ -25,6 +25,7 @@
 #include <iostream>
 #include <type_traits>
 #include <cstdio>
+#include <vector>
 
 typedef long long int64;
 
@@ -40,6 +41,14 @@ typedef long long int64;
 
 //Functions IsSaving() and IsLoading() tell which kind of archive it is
 
+//Two formats:
+//version1 - the values are written to the stream as they are, one after another
+//version2 - a header, then the same bytes cut into 256 KB blocks, each compressed with CBlockCodec
+//			 Arrays of classes with a static SerializeArray(BArchive&, T*, int64) are stored through it
+//			 (BString arrays become a table of lengths followed by all characters)
+//Loading archives detect the version themselves
+//A loading archive can also read from a memory buffer, e.g. a memory-mapped file
+
 //Will directly serialize the value of any non-class variables
 //And that includes all pointers - just the pointer value, not what it points to
 
@@ -58,28 +67,33 @@ public:
 	//Default constructor declared, but not defined - no default is allowed
 	BArchive();
 
+	enum {version1=1, version2=2, currentVersion=version2};
+
 	//Accepts either ostream or istream during construction
 	//With ostream, it is a storing archive
-	explicit BArchive(std::ostream& theOutStream):
-	inStream(NULL),
-	outStream(&theOutStream),
-	isStoring(true)
-	{
-	};
+	explicit BArchive(std::ostream& theOutStream, int theVersion=version1, bool theFCompress=true);
 
 	//With istream, it is a loading archive
-	explicit BArchive(std::istream& theInStream):
-	inStream(&theInStream),
-	outStream(NULL),
-	isStoring(false)
-	{
-	};
+	explicit BArchive(std::istream& theInStream);
+
+	//Loading from memory, the buffer must stay valid while the archive is used
+	BArchive(const char* theBuffer, int64 theBufferSize);
 
-	~BArchive(){};
+	~BArchive(){Close();};
 
 public:
 	bool IsStoring() const {return isStoring;};
 	bool IsLoading() const {return !isStoring;};
+	int Version() const {return version;};
+	bool IsOk() const {return !fError;};		//False after a failed write, a read past the end or corrupt data
+
+	//Writes out the last block of a storing archive, returns IsOk()
+	//Called by the destructor; nothing can be stored after that
+	bool Close();
+
+	//Raw bytes
+	void WriteBytes(const void* data, int64 numBytes);
+	void ReadBytes(void* data, int64 numBytes);		//Fills with zeros what could not be read
 
 	//Store or retrieve a value
 	template<class theType>
@@ -144,7 +158,7 @@ private:
 	void DoStoreArray(theType* val, int64 num, std::false_type)
 	{
 		//If it is a non-class type, write it directly
-		(*outStream).write( (const char*)val, sizeof(*val) * num );
+		WriteBytes(val, sizeof(*val) * num);
 	}
 
 	template<class theType>
@@ -158,7 +172,7 @@ private:
 	void DoRetrieveArray(theType* val, int64 num, std::false_type)
 	{
 		//If it is a non-class type, read it directly
-		(*inStream).read( (char*)val, sizeof(*val) * num );
+		ReadBytes(val, sizeof(*val) * num);
 	}
 
 	template<class theType>
@@ -172,7 +186,7 @@ private:
 	void DoStore(theType& val, std::false_type)
 	{
 		//If it is a non-class type, write it directly
-		(*outStream).write( (const char*)(&val), sizeof(val) );
+		WriteBytes(&val, sizeof(val));
 	}
 
 	template<class theType>
@@ -186,7 +200,7 @@ private:
 	void DoRetrieve(theType& val, std::false_type)
 	{
 		//If it is a non-class type, read it directly
-		(*inStream).read( (char*)(&val), sizeof(val) );
+		ReadBytes(&val, sizeof(val));
 	}
 	
 	template<class theType>
@@ -215,6 +229,7 @@ private:
 	struct enable_if<false, T> { };
 
 	HAS_SERIALIZE_FUNC(Serialize, has_serialize);
+	HAS_SERIALIZE_FUNC(SerializeArray, has_serialize_array);
 
 	template<typename T> 
 	typename enable_if<has_serialize<T,void(T::*)(BArchive&)>::value, void>::type
@@ -236,6 +251,9 @@ private:
 	HandleArrayClass(T* t, int64 num)
 	{
 		/* When T has Serialize() */
+		if(version>=version2 && HandleArrayAtOnce(t, num, std::integral_constant<bool,
+									has_serialize_array<T,void(*)(BArchive&,T*,int64)>::value>())) return;
+
 		for(int64 i=0;i<num;i++)
 		{
 			t->Serialize(*this);
@@ -250,12 +268,45 @@ private:
 		/* When T does not have Serialize just complain and do nothing */
 		std::cerr << "Error: attempting to serialize an array of class without a void Serialize(BArchive&) function.";
 	}
+	template<typename T>
+	bool HandleArrayAtOnce(T* t, int64 num, std::true_type)
+	{
+		T::SerializeArray(*this, t, num);	/* When T has a static SerializeArray() */
+		return true;
+	}
+
+	template<typename T>
+	bool HandleArrayAtOnce(T*, int64, std::false_type) {return false;}
 	//End dark magic
 
+private:
+	void ReadHeader();
+	void WriteRaw(const char* data, int64 numBytes);
+	bool ReadRaw(char* data, int64 numBytes);
+	const char* ReadRawInPlace(int64 numBytes);		//Points into the memory buffer, or reads into "packed"
+	void WriteBlock(const char* data, int64 numBytes);
+	bool ReadBlock(char* target, int64 targetSize, int64& numRead);
+
+	static const int64 blockSize=1<<18;
+
 private:
 	bool isStoring;
+	int version;
+	bool fCompress;
+	bool fError;
+	bool fClosed;
 
 	std::ostream* outStream;
 	std::istream* inStream;
+
+	const char* memBuffer;
+	int64 memSize;
+	int64 memPos;
+
+	//Current uncompressed block; when loading, bytes blockPos..blockEnd are not consumed yet
+	std::vector<char> block;
+	int64 blockPos;
+	int64 blockEnd;
+	std::vector<char> packed;		//Compressed data
 };
 
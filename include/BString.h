@@ -29,6 +29,7 @@
 
 Append
 AppendChar
+AppendFormat
 Compare
 Delete
 Find
@@ -77,7 +78,6 @@ operator >=
 
 AllocSysString
 AnsiToOem
-AppendFormat
 Collate
 CollateNoCase
 CompareNoCase
@@ -118,6 +118,10 @@ UnlockBuffer
    is present in CString.
 3) Added convenient functions WriteToFile(fileName) and ReadFromFile(fileName).
 4) Added void Serialize() function so that the string could be saved in BArchive
+5) Added BStringView, a non-owning pointer and length, with View(), LeftView(), RightView(), MidView(),
+   StartsWith() and EndsWith() so that hot paths can compare and slice without copying
+6) Format() and AppendFormat() write into the existing buffer; a string reused for formatting stops allocating
+   once its capacity is large enough
 
 */
 
@@ -129,6 +133,77 @@ UnlockBuffer
 #include <algorithm>
 #include <vector>
 #include <fstream>
+#include <cstring>
+
+//A non-owning view of a range of characters: a pointer and a length, not necessarily zero-terminated
+//Valid only while the characters it points to are alive and unmodified
+class BStringView
+{
+public:
+	BStringView() : ptr(""), len(0) {}
+	BStringView(const char* str) : ptr(str ? str : ""), len(str ? strlen(str) : 0) {}
+	BStringView(const char* str, size_t length) : ptr(str), len(length) {}
+	BStringView(const std::string& str) : ptr(str.data()), len(str.size()) {}
+
+	const char* Data() const { return ptr; }
+	size_t Size() const { return len; }
+	int GetLength() const { return (int)len; }
+	bool IsEmpty() const { return len == 0; }
+	char operator[](int pos) const { return ptr[pos]; }
+
+	//Same clamping rules as BString::Left(), Right() and Mid()
+	BStringView Left(int nCount) const
+	{
+		if (nCount < 0) nCount = 0;
+		return BStringView(ptr, std::min(size_t(nCount), len));
+	}
+
+	BStringView Right(int nCount) const
+	{
+		if (nCount < 0) nCount = 0;
+		size_t count = std::min(size_t(nCount), len);
+		return BStringView(ptr + len - count, count);
+	}
+
+	BStringView Mid(int iFirst, int nCount) const
+	{
+		if (iFirst < 0 || size_t(iFirst) >= len) return BStringView();
+		if (nCount < 0) nCount = 0;
+		return BStringView(ptr + iFirst, std::min(size_t(nCount), len - iFirst));
+	}
+
+	BStringView Mid(int iFirst) const
+	{
+		if (iFirst < 0 || size_t(iFirst) >= len) return BStringView();
+		return BStringView(ptr + iFirst, len - iFirst);
+	}
+
+	//Returns the position, or -1 if not found
+	int Find(char c, int iStart = 0) const
+	{
+		if (iStart < 0 || size_t(iStart) >= len) return -1;
+		const void* res = memchr(ptr + iStart, c, len - iStart);
+		return res ? int((const char*)res - ptr) : -1;
+	}
+
+	int Find(BStringView str, int iStart = 0) const
+	{
+		if (iStart < 0) return -1;
+		for (size_t i = iStart; i + str.len <= len; i++)
+			if (memcmp(ptr + i, str.ptr, str.len) == 0) return int(i);
+		return -1;
+	}
+
+	bool StartsWith(BStringView str) const { return str.len <= len && memcmp(ptr, str.ptr, str.len) == 0; }
+	bool EndsWith(BStringView str) const { return str.len <= len && memcmp(ptr + len - str.len, str.ptr, str.len) == 0; }
+
+	friend bool operator==(BStringView one, BStringView two) { return one.len == two.len && memcmp(one.ptr, two.ptr, one.len) == 0; }
+	friend bool operator!=(BStringView one, BStringView two) { return !(one == two); }
+
+private:
+	const char* ptr;
+	size_t len;
+};
 
 class BString : public std::string
 {
@@ -137,7 +212,15 @@ public:
 	BString() {}
 	BString(const char* str) : std::string(str) {}
 	BString(const std::string& str) : std::string(str) {}
-	//Copy and move contstructors written by the compiler are fine
+	BString(std::string&& str) : std::string(std::move(str)) {}
+	BString(const char* str, int nLength) : std::string(str, size_t(nLength)) {}
+	explicit BString(BStringView str) : std::string(str.Data(), str.Size()) {}		//Explicit - it allocates
+
+	//Spelled out because VS2013 does not generate the move constructor and move assignment
+	BString(const BString& other) : std::string(other) {}
+	BString(BString&& other) : std::string(std::move(other)) {}
+	BString& operator = (const BString& rhs) { std::string::operator=(rhs); return *this; }
+	BString& operator = (BString&& rhs) { std::string::operator=(std::move(rhs)); return *this; }
 
 	//Get const and non-const references to element
 	//CStringT returns by value?
@@ -152,37 +235,21 @@ public:
 	//Assignment operators
 	BString& operator = (const char* rhs) { std::string::operator=(rhs); return *this; }
 	BString& operator = (const std::string& rhs) { std::string::operator=(rhs); return *this; }
-	//BString to BString assignment written by the compiler is fine
-	//Move assignment written by the compiler is fine
+	BString& operator = (BStringView rhs) { assign(rhs.Data(), rhs.Size()); return *this; }		//Reuses the buffer
 
 	//Operator + and += : the ones inherited from std::string return std::string!
 	//New ones need to be defined
-	//We'll spell out all combination of friend operator+ explicitly:
-	friend BString operator+(const BString& one, const BString& two)
-	{
-		BString result = static_cast<const std::string&>(one) + static_cast<const std::string&>(two);
-		return result;
-	}
-	friend BString operator+(const BString& one, const std::string& two)
-	{
-		BString result = static_cast<const std::string&>(one) + two;
-		return result;
-	}
-	friend BString operator+(const BString& one, const char* two)
-	{
-		BString result = static_cast<const std::string&>(one) + two;
-		return result;
-	}
-	friend BString operator+(const std::string& one, const BString& two)
-	{
-		BString result = one + static_cast<const std::string&>(two);
-		return result;
-	}
-	friend BString operator+(const char* one, const BString& two)
-	{
-		BString result = one + static_cast<const std::string&>(two);
-		return result;
-	}
+	//We'll spell out all combination of friend operator+ explicitly
+	//Each one allocates the result once; when the left side is a temporary (a chain a + b + c), it is appended to
+	friend BString operator+(const BString& one, const BString& two) { return Concat(one.data(), one.size(), two.data(), two.size()); }
+	friend BString operator+(const BString& one, const std::string& two) { return Concat(one.data(), one.size(), two.data(), two.size()); }
+	friend BString operator+(const BString& one, const char* two) { return Concat(one.data(), one.size(), two, strlen(two)); }
+	friend BString operator+(const std::string& one, const BString& two) { return Concat(one.data(), one.size(), two.data(), two.size()); }
+	friend BString operator+(const char* one, const BString& two) { return Concat(one, strlen(one), two.data(), two.size()); }
+
+	friend BString operator+(BString&& one, const BString& two) { one.append(two); return std::move(one); }
+	friend BString operator+(BString&& one, const std::string& two) { one.append(two); return std::move(one); }
+	friend BString operator+(BString&& one, const char* two) { one.append(two); return std::move(one); }
 
 
 	//Operator += redefined for char, BString, std::string and const char* to guarrantee BString& being returned
@@ -190,6 +257,7 @@ public:
 	BString& operator+=(const std::string& other){ std::string::operator+=(other); return *this; }
 	BString& operator+=(const char* other){ std::string::operator+=(other); return *this; }
 	BString& operator+=(char c){ std::string::operator+=(c); return *this; }
+	BString& operator+=(BStringView other){ append(other.Data(), other.Size()); return *this; }
 
 	BString& SetAt(int pos, char c) { (*this)[pos] = c; return *this; }
 
@@ -229,6 +297,48 @@ public:
 		}
 	}
 
+	//Extension: arrays of strings in a version 2 BArchive are stored as a table - all lengths, then all characters
+	static void SerializeArray(BArchive& ar, BString* arr, int64 num)
+	{
+		std::vector<int> lengths((size_t)num);
+
+		if (ar.IsLoading())
+		{
+			ar.RetrieveArray(lengths.data(), num);
+
+			int64 totalLength = 0;
+			for (int64 i = 0; i < num; i++) totalLength += std::max(lengths[(size_t)i], 0);
+
+			//A corrupt length table can ask for far more than the archive holds - the characters are read in pieces,
+			//so memory only grows with data that is actually there; running out of data fails the archive
+			std::vector<char> chars(1);
+			int64 numRead = 0;
+			while (numRead < totalLength && ar.IsOk())
+			{
+				int64 piece = std::min(totalLength - numRead, (int64)1 << 20);
+				chars.resize((size_t)(numRead + piece) + 1);
+				ar.RetrieveArray(chars.data() + numRead, piece);
+				numRead += piece;
+			}
+			if (!ar.IsOk()) totalLength = 0;
+
+			const char* cur = chars.data();
+			for (int64 i = 0; i < num; i++)
+			{
+				int curLength = (totalLength == 0) ? 0 : std::max(lengths[(size_t)i], 0);
+				arr[i].SetString(cur, curLength);
+				cur += curLength;
+			}
+		}
+		else
+		{
+			for (int64 i = 0; i < num; i++) lengths[(size_t)i] = arr[i].GetLength();
+			ar.StoreArray(lengths.data(), num);
+
+			for (int64 i = 0; i < num; i++) ar.StoreArray((const char*)arr[i], lengths[(size_t)i]);
+		}
+	}
+
 	//Comparison: < 0 if this string compares as "less" to the provided string
 	// >0 if it compares "greater"
 	// 0 if equal
@@ -274,6 +384,16 @@ public:
 		return substr(iFirst);
 	}
 
+	//Extension: the same portions as views, without copying
+	BStringView View() const { return BStringView(data(), size()); }
+	BStringView LeftView(int nCount) const { return View().Left(nCount); }
+	BStringView RightView(int nCount) const { return View().Right(nCount); }
+	BStringView MidView(int iFirst, int nCount) const { return View().Mid(iFirst, nCount); }
+	BStringView MidView(int iFirst) const { return View().Mid(iFirst); }
+
+	bool StartsWith(BStringView str) const { return View().StartsWith(str); }
+	bool EndsWith(BStringView str) const { return View().EndsWith(str); }
+
 	//String reversal
 	//Returns a reference to itself
 	BString& MakeReverse() { std::reverse(begin(), end()); return *this; }
@@ -529,20 +649,45 @@ public:
 	}
 	
 	//Format function
+	//Formats into the existing buffer, so a string reused for formatting does not allocate once it is large enough
 	BString& Format(const char* format, ...)
 	{
-		//Double pass string formatting: first time to figure out buffer size, second time to write
 		va_list args;
 		va_start(args, format);
+		clear();
+		AppendFormatV(format, args);
+		va_end(args);
 
-		size_t bufSize = FormatBufferSize(format, args);	//First pass - does not consume args
-		char* buffer = new char[bufSize];
+		return *this;
+	}
 
-		vsnprintf(buffer, bufSize, format, args);
+	//Appends formatted text at the end of the string
+	BString& AppendFormat(const char* format, ...)
+	{
+		va_list args;
+		va_start(args, format);
+		AppendFormatV(format, args);
 		va_end(args);
 
-		*this = buffer;
-		delete[] buffer;
+		return *this;
+	}
+
+	BString& AppendFormatV(const char* format, va_list args)
+	{
+		//Short results are formatted on the stack and appended, which reuses the existing capacity;
+		//only longer ones are formatted a second time, straight into the string grown to the exact size
+		char buffer[256];
+		va_list listCopy;
+		va_copy(listCopy, args);
+		int res = vsnprintf(buffer, sizeof(buffer), format, listCopy);
+		va_end(listCopy);
+
+		if (res < 0) return *this;
+		if (size_t(res) < sizeof(buffer)) { append(buffer, size_t(res)); return *this; }
+
+		size_t oldLength = length();
+		resize(oldLength + size_t(res));
+		vsnprintf(&std::string::operator[](oldLength), size_t(res) + 1, format, args);
 
 		return *this;
 	}
@@ -577,21 +722,14 @@ public:
 	}
 
 protected:
-	//Figures out what size is needed for a format buffer
-	//By running vsnprintf with a nullptr
-	size_t FormatBufferSize(const char* format, va_list args) const
+	//Allocates a concatenation once
+	static BString Concat(const char* one, size_t oneLength, const char* two, size_t twoLength)
 	{
-		int res;
-		va_list listCopy;
-		va_copy(listCopy, args);
-
-		//Retval will be the required number of characters not counting the terminating '\0'
-		res = vsnprintf(nullptr, 0, format, listCopy);
-		va_end(listCopy);
-		
-		//Account for the terminating '\0'
-		if (res < 0) res = 0;
-		return size_t(res + 1);
+		BString result;
+		result.reserve(oneLength + twoLength);
+		result.append(one, oneLength);
+		result.append(two, twoLength);
+		return result;
 	}
 
 	//Determine the c-type string size
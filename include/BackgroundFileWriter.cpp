@@ -0,0 +1,146 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "BackgroundFileWriter.h"
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+CBackgroundFileWriter::CBackgroundFileWriter():
+fWriting(false),
+fFailed(false),
+fStop(false),
+numWritten(0),
+numCoalesced(0)
+{
+	writer = std::thread(&CBackgroundFileWriter::WriterThread, this);
+}
+
+CBackgroundFileWriter::~CBackgroundFileWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		fStop = true;
+		writerCondition.notify_one();
+	}
+
+	writer.join();
+}
+
+void CBackgroundFileWriter::Submit(const BString& fileName, BString&& contents)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	BString& slot = pending[fileName];
+	if (!slot.IsEmpty()) numCoalesced++;
+	slot = std::move(contents);
+
+	writerCondition.notify_one();
+}
+
+bool CBackgroundFileWriter::Flush()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	idleCondition.wait(lock, [this]{ return pending.empty() && !fWriting; });
+
+	bool fOk = !fFailed;
+	fFailed = false;
+	return fOk;
+}
+
+int CBackgroundFileWriter::NumWritten() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return numWritten;
+}
+
+int CBackgroundFileWriter::NumCoalesced() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return numCoalesced;
+}
+
+void CBackgroundFileWriter::WriterThread()
+{
+	while (1)
+	{
+		BString fileName, contents;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			writerCondition.wait(lock, [this]{ return fStop || !pending.empty(); });
+
+			//Pending files are written before stopping
+			if (pending.empty()) return;
+
+			//Take one file and write it without holding the lock, so that Submit() never waits for the disk
+			auto iter = pending.begin();
+			fileName = iter->first;
+			contents.swap(iter->second);
+			pending.erase(iter);
+			fWriting = true;
+		}
+
+		bool fOk = WriteAtomic(fileName, contents.c_str(), contents.size());
+
+		std::lock_guard<std::mutex> lock(mutex);
+		fWriting = false;
+		if (fOk) numWritten++;
+		else fFailed = true;
+		if (pending.empty()) idleCondition.notify_all();
+	}
+}
+
+bool CBackgroundFileWriter::WriteAtomic(const BString& fileName, const char* data, size_t size)
+{
+	BString tempName = fileName + ".tmp";
+
+	FILE* fp = fopen(tempName, "wb");
+	if (!fp) return false;
+
+	bool fOk = (fwrite(data, 1, size, fp) == size);
+	fOk = (fflush(fp) == 0) && fOk;
+
+	//The data must be on disk before the rename makes it the file
+#ifdef _WIN32
+	fOk = (_commit(_fileno(fp)) == 0) && fOk;
+#else
+	fOk = (fsync(fileno(fp)) == 0) && fOk;
+#endif
+	fOk = (fclose(fp) == 0) && fOk;
+
+	if (!fOk)
+	{
+		remove(tempName);
+		return false;
+	}
+
+#ifdef _WIN32
+	return MoveFileExA(tempName, fileName, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return rename(tempName, fileName) == 0;
+#endif
+}
@@ -0,0 +1,66 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#pragma once
+#include "BString.h"
+#include <map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+//Writes whole files on a separate thread, replacing them atomically
+//Submit() hands over the new contents and returns at once. If the same file is submitted again before the
+//writer gets to it, only the newest contents are written. Every write goes to "<fileName>.tmp" first, which
+//is flushed to disk and then renamed over the file: a crash leaves either the old file or the new one.
+class CBackgroundFileWriter
+{
+public:
+	CBackgroundFileWriter();
+	~CBackgroundFileWriter();		//Writes everything still pending
+
+	void Submit(const BString& fileName, BString&& contents);		//Takes the contents; thread-safe
+	bool Flush();				//Waits until everything submitted so far is written; false if any write failed since the last Flush()
+
+	int NumWritten() const;		//Files written
+	int NumCoalesced() const;	//Submissions dropped because newer contents for the same file arrived first
+
+	//The same temporary file and rename, on the calling thread
+	static bool WriteAtomic(const BString& fileName, const char* data, size_t size);
+
+private:
+	CBackgroundFileWriter(const CBackgroundFileWriter&);
+	CBackgroundFileWriter& operator=(const CBackgroundFileWriter&);
+
+	void WriterThread();
+
+private:
+	mutable std::mutex mutex;
+	std::condition_variable writerCondition;	//Something to write, or stop
+	std::condition_variable idleCondition;		//Nothing pending and nothing being written
+	std::map<BString, BString> pending;			//File name to newest contents
+	bool fWriting;
+	bool fFailed;
+	bool fStop;
+	int numWritten;
+	int numCoalesced;
+	std::thread writer;
+};
@@ -1,16 +1,19 @@
 #pragma once
 #include "Array.h"
 #include "CAIStrings.h"
+#include "HashIndex.h"
 #include <map>
 
 //Hash-to-int bidirectional map
 //Cannot have more than 2^32 elements, so uses only CHArray<theType,int>
+//Words are found through std::map by default, or through an open-addressing hash index (fHashed, SetHashed())
+//The hash index needs CHashOf<theType>, the tree needs operator<
 
 template <class theType> class CBidirectionalMap : public Savable
 {
 public:
-	CBidirectionalMap(int theMaxPoints=-1, bool fFrequencies=false);
-	CBidirectionalMap(CHArray<theType>& rhsArray, bool fFrequencies=false);	//Will call AddFromArray()
+	CBidirectionalMap(int theMaxPoints=-1, bool fFrequencies=false, bool fHashedIndex=false);
+	CBidirectionalMap(CHArray<theType>& rhsArray, bool fFrequencies=false, bool fHashedIndex=false);	//Will call AddFromArray()
 	CBidirectionalMap(const BString& fileName, bool fArray=false, bool fFrequencies=false);	//Will call Load() if fArray==false
 																						//or LoadFromArray() if true
 	void CreateFromArray(CHArray<theType>& rhsArray);
@@ -49,10 +52,18 @@ public:
 	void RemoveWords(CBidirectionalMap<theType>& removeList, bool present=true);		//Removes words by re-composing the map
     void RemoveWord(const theType& word);		//Removes a single word - O(N) because of word array shifting and decrementing in the map
 	void RemoveWordByIndex(int index);			//Removes a single word - O(N) because of word array shifting and decrementing in the map
+	//Removes a single word, the last word takes over its index - O(1) with the hash index, indices stay contiguous
+	void RemoveWordFast(const theType& word);
+	void RemoveWordByIndexFast(int index);
     int GetFrequency(const theType& word);
     int GetIndex(const theType& word) const;
+	//String lookup without a temporary BString - for CBidirectionalMap<BString>
+	//Named apart from GetIndex/IsPresent, so that GetIndex(0) on a map of numbers is not ambiguous
+	int GetIndexOfString(const char* str, int length) const;
+	int GetIndexOfString(const char* str) const {return GetIndexOfString(str,(int)strlen(str));}
+	bool IsStringPresent(const char* str) const {return GetIndexOfString(str)>=0;}
 	void GetIndexForArrayOfWords(CHArray<theType>& words, CHArray<int>& result); //calls GetIndex() on every element of words and saves in result
-    bool IsPresent(const theType& word);
+    bool IsPresent(const theType& word) const;
 
 	void LoadFromArray(const BString& fileName, bool fFrequencies);	//Creates map from saved CHArray
 	void Serialize(BArchive& ar);
@@ -63,11 +74,19 @@ public:
 	void ResizeKeepPoints(int newSize);
 	void SortByFrequencies();
 
+	void SetHashed(bool fHashedIndex);		//Switches the lookup structure, rebuilding it from wordArr
+	bool IsHashed() const {return fHashed;}
+
+private:
+	unsigned int Fingerprint(const theType& word) const {return CHashIndex::Fingerprint(CHashOf<theType>::Hash(word));}
+
 public:
 	bool fFreq;						//if frequencies are counted for words being added
+	bool fHashed;					//if words are found through hashIndex instead of map
 	CHArray<int> freqArr;			//array of frequencies
 	CHArray<theType> wordArr;		//array of words - word stands for key values (theType) added to map
 	std::map<theType,int> map;			//mapping between words and numbers (indexes in array)
+	CHashIndex hashIndex;				//the same mapping when fHashed - only fingerprints and indexes, keys stay in wordArr
 };
 
 template<>
@@ -86,15 +105,17 @@ void CBidirectionalMap<BString>::AddBStringsFromCAIS(CAIStrings<char,intType>& s
 }
 
 template <class theType>
-CBidirectionalMap<theType>::CBidirectionalMap(int theMaxPoints, bool fFrequencies):
-fFreq(fFrequencies)
+CBidirectionalMap<theType>::CBidirectionalMap(int theMaxPoints, bool fFrequencies, bool fHashedIndex):
+fFreq(fFrequencies),
+fHashed(fHashedIndex)
 {
 	if (theMaxPoints > 0) Resize(theMaxPoints);
 }
 
 template <class theType>
-CBidirectionalMap<theType>::CBidirectionalMap(CHArray<theType>& rhsArray, bool fFrequencies):
-fFreq(fFrequencies)
+CBidirectionalMap<theType>::CBidirectionalMap(CHArray<theType>& rhsArray, bool fFrequencies, bool fHashedIndex):
+fFreq(fFrequencies),
+fHashed(fHashedIndex)
 {
 	CreateFromArray(rhsArray);
 }
@@ -115,6 +136,7 @@ void CBidirectionalMap<theType>::Resize(int newSize)
 	if(fFreq) freqArr.ResizeArray(newSize);
 
 	Clear();
+	if(fHashed) hashIndex.Reserve(newSize);
 }
 
 template <class theType>
@@ -136,7 +158,8 @@ void CBidirectionalMap<theType>::ResizeKeepPoints(int newSize)
 }
 
 template <class theType>
-CBidirectionalMap<theType>::CBidirectionalMap(const BString& fileName, bool fArray, bool fFrequencies)
+CBidirectionalMap<theType>::CBidirectionalMap(const BString& fileName, bool fArray, bool fFrequencies):
+fHashed(false)
 {
 	if(fArray) LoadFromArray(fileName,fFrequencies);
 	else Load(fileName);
@@ -199,13 +222,64 @@ void CBidirectionalMap<theType>::RemoveWordByIndex(int index)
 	//Slow operation - because the array needs to be shifted with each deletion
 	//And all indices above the given index decremented
 
-	map.erase(wordArr[index]);
+	if(fHashed) hashIndex.Erase(Fingerprint(wordArr[index]),index);
+	else map.erase(wordArr[index]);
 	wordArr.RemovePointAt(index);
 	if(fFreq) freqArr.RemovePointAt(index);
 	
 	for(int i=index; i < Count(); i++)
 	{
-		map[wordArr[i]]=i;
+		if(fHashed) hashIndex.Reindex(Fingerprint(wordArr[i]),i+1,i);
+		else map[wordArr[i]]=i;
+	}
+}
+
+template <class theType>
+void CBidirectionalMap<theType>::RemoveWordFast(const theType& word)
+{
+	int index=GetIndex(word);
+	if(index!=-1) RemoveWordByIndexFast(index);
+}
+
+template <class theType>
+void CBidirectionalMap<theType>::RemoveWordByIndexFast(int index)
+{
+	//The last word moves into the freed index, so only one other entry changes
+	int last=Count()-1;
+	if(fHashed)
+	{
+		hashIndex.Erase(Fingerprint(wordArr[index]),index);
+		if(index!=last) hashIndex.Reindex(Fingerprint(wordArr[last]),last,index);
+	}
+	else
+	{
+		map.erase(wordArr[index]);
+		if(index!=last) map[wordArr[last]]=index;
+	}
+
+	if(index!=last)
+	{
+		wordArr[index]=std::move(wordArr[last]);
+		if(fFreq) freqArr[index]=freqArr[last];
+	}
+	wordArr.RemoveLastPoint();
+	if(fFreq) freqArr.RemoveLastPoint();
+}
+
+template <class theType>
+void CBidirectionalMap<theType>::SetHashed(bool fHashedIndex)
+{
+	if(fHashed==fHashedIndex) return;
+
+	fHashed=fHashedIndex;
+	map.clear();
+	hashIndex.Clear();
+
+	if(fHashed) hashIndex.Reserve(Count());
+	for(int i=0; i < Count(); i++)
+	{
+		if(fHashed) hashIndex.Insert(Fingerprint(wordArr[i]),i);
+		else map[wordArr[i]]=i;
 	}
 }
 
@@ -237,6 +311,7 @@ void CBidirectionalMap<theType>::Clear()
 	freqArr.Clear();
 	wordArr.Clear();
 	map.clear();
+	hashIndex.Clear();
 }
 
 template <class theType>
@@ -305,7 +380,15 @@ bool CBidirectionalMap<theType>::AddWord(const theType& newWord, int numTimes)
 template <class theType>
 int CBidirectionalMap<theType>::AddWordGetIndex(const theType& newWord, int numTimes)		//returns index
 {
-	int index = GetIndex(newWord);
+	unsigned int fingerprint = 0;
+	int index;
+	if(fHashed)
+	{
+		fingerprint = Fingerprint(newWord);
+		index = hashIndex.Find(fingerprint,[&](int cur){return CHashOf<theType>::Equal(wordArr.arr[cur],newWord);});
+	}
+	else index = GetIndex(newWord);
+
 	if(index != -1)	//word already there
 	{
 		if(fFreq) freqArr[index]+=numTimes;
@@ -313,7 +396,8 @@ int CBidirectionalMap<theType>::AddWordGetIndex(const theType& newWord, int numT
 	}
 	else			//word not found
 	{
-		map[newWord] = Count();
+		if(fHashed) hashIndex.Insert(fingerprint,Count());
+		else map[newWord] = Count();
 		wordArr.AddAndExtend(newWord);
 		if(fFreq) freqArr.AddAndExtend(numTimes);
 		return(Count()-1);
@@ -346,6 +430,8 @@ void CBidirectionalMap<theType>::GetIndexForArrayOfWords(CHArray<theType>& words
 template <class theType>
 int CBidirectionalMap<theType>::GetIndex(const theType& word) const
 {
+	if(fHashed) return hashIndex.Find(Fingerprint(word),[&](int cur){return CHashOf<theType>::Equal(wordArr.arr[cur],word);});
+
 	auto it = map.find(word);
 	if(it!=map.end())	//word is found
 	{
@@ -355,8 +441,17 @@ int CBidirectionalMap<theType>::GetIndex(const theType& word) const
 }
 
 template <class theType>
-bool CBidirectionalMap<theType>::IsPresent(const theType& word)
+bool CBidirectionalMap<theType>::IsPresent(const theType& word) const
 {
 	if(GetIndex(word) >= 0) return true;	//word is found
 	else return false;
 }
+
+template <class theType>
+int CBidirectionalMap<theType>::GetIndexOfString(const char* str, int length) const
+{
+	if(!fHashed) return GetIndex(theType(std::string(str,length)));		//std::map needs the key type
+
+	unsigned int fingerprint = CHashIndex::Fingerprint(CHashOf<theType>::Hash(str,(size_t)length));
+	return hashIndex.Find(fingerprint,[&](int cur){return CHashOf<theType>::Equal(wordArr.arr[cur],str,(size_t)length);});
+}
@@ -0,0 +1,178 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "BlockCodec.h"
+#include <string.h>
+#include <vector>
+
+static const int minMatch=4;
+static const int maxOffset=65535;
+static const int hashLog=14;
+static const int tailLiterals=5;		//The last bytes are always literals, so matches never run to the very end
+
+static unsigned int Read32(const char* p)
+{
+	unsigned int val;
+	memcpy(&val,p,4);
+	return val;
+}
+
+static int Hash(unsigned int val)
+{
+	return (int)((val*2654435761U)>>(32-hashLog));
+}
+
+//Writes a length that did not fit into a token nibble
+static bool PutLength(char*& op, char* oend, int length)
+{
+	while(length>=255)
+	{
+		if(op>=oend) return false;
+		*op++=(char)255;
+		length-=255;
+	}
+	if(op>=oend) return false;
+	*op++=(char)length;
+	return true;
+}
+
+static bool GetLength(const unsigned char*& ip, const unsigned char* iend, int& length)
+{
+	while(true)
+	{
+		if(ip>=iend) return false;
+		int cur=*ip++;
+		length+=cur;
+		if(cur!=255) return true;
+	}
+}
+
+//One sequence - literals, and a match unless matchLength is 0
+static bool PutSequence(char*& op, char* oend, const char* literals, int numLiterals, int offset, int matchLength)
+{
+	if(op>=oend) return false;
+	char* token=op++;
+
+	int litCode=numLiterals<15 ? numLiterals : 15;
+	int matchCode=0;
+	if(numLiterals>=15 && !PutLength(op,oend,numLiterals-15)) return false;
+
+	if(oend-op<numLiterals) return false;
+	memcpy(op,literals,numLiterals);
+	op+=numLiterals;
+
+	if(matchLength>0)
+	{
+		if(oend-op<2) return false;
+		*op++=(char)(offset & 0xFF);
+		*op++=(char)(offset>>8);
+
+		int extra=matchLength-minMatch;
+		matchCode=extra<15 ? extra : 15;
+		if(extra>=15 && !PutLength(op,oend,extra-15)) return false;
+	}
+
+	*token=(char)((litCode<<4) | matchCode);
+	return true;
+}
+
+int CBlockCodec::Compress(const char* src, int srcSize, char* dst, int dstCapacity)
+{
+	std::vector<int> table(1<<hashLog,-1);
+
+	char* op=dst;
+	char* oend=dst+dstCapacity;
+	int anchor=0;
+	int pos=0;
+	int matchLimit=srcSize-tailLiterals;
+	int searchLimit=matchLimit-minMatch;
+	int misses=0;
+
+	while(pos<searchLimit)
+	{
+		unsigned int cur=Read32(src+pos);
+		int h=Hash(cur);
+		int ref=table[h];
+		table[h]=pos;
+
+		if(ref<0 || pos-ref>maxOffset || Read32(src+ref)!=cur)
+		{
+			pos+=1+(misses++>>6);	//Skip faster through data that does not compress
+			continue;
+		}
+		misses=0;
+
+		//Extend the match backwards over pending literals, then forwards
+		while(pos>anchor && ref>0 && src[pos-1]==src[ref-1]) {pos--; ref--;}
+
+		int length=minMatch;
+		while(pos+length<matchLimit && src[ref+length]==src[pos+length]) length++;
+
+		if(!PutSequence(op,oend,src+anchor,pos-anchor,pos-ref,length)) return 0;
+
+		pos+=length;
+		anchor=pos;
+		if(pos-2>=0 && pos-2<searchLimit) table[Hash(Read32(src+pos-2))]=pos-2;
+	}
+
+	if(!PutSequence(op,oend,src+anchor,srcSize-anchor,0,0)) return 0;
+	return (int)(op-dst);
+}
+
+bool CBlockCodec::Decompress(const char* src, int srcSize, char* dst, int dstSize)
+{
+	const unsigned char* ip=(const unsigned char*)src;
+	const unsigned char* iend=ip+srcSize;
+	char* op=dst;
+	char* oend=dst+dstSize;
+
+	while(ip<iend)
+	{
+		int token=*ip++;
+
+		int numLiterals=token>>4;
+		if(numLiterals==15 && !GetLength(ip,iend,numLiterals)) return false;
+		if(iend-ip<numLiterals || oend-op<numLiterals) return false;
+		memcpy(op,ip,numLiterals);
+		ip+=numLiterals;
+		op+=numLiterals;
+
+		if(ip==iend) break;		//Last sequence
+
+		if(iend-ip<2) return false;
+		int offset=ip[0] | (ip[1]<<8);
+		ip+=2;
+
+		int length=token & 15;
+		if(length==15 && !GetLength(ip,iend,length)) return false;
+		length+=minMatch;
+
+		if(offset==0 || offset>op-dst || oend-op<length) return false;
+
+		const char* match=op-offset;
+		if(offset>=length) memcpy(op,match,length);
+		else for(int i=0;i<length;i++) op[i]=match[i];	//Overlapping - repeats the last offset bytes
+		op+=length;
+	}
+
+	return op==oend;
+}
@@ -0,0 +1,39 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//A small in-tree LZ77 block compressor in the spirit of LZ4, used by BArchive
+//Favors speed over ratio: greedy matching through a hash table, 64 KB window
+//Block format: sequences of [token][extra literal length][literals][2-byte offset][extra match length],
+//token = literal length (high 4 bits) and match length - 4 (low 4 bits), 15 means "more bytes follow"
+//The last sequence only has literals
+
+#pragma once
+
+class CBlockCodec
+{
+public:
+	//Compresses src into dst, returns the compressed size or 0 if it would take more than dstCapacity bytes
+	static int Compress(const char* src, int srcSize, char* dst, int dstCapacity);
+
+	//Decompresses exactly dstSize bytes, false on corrupt input
+	static bool Decompress(const char* src, int srcSize, char* dst, int dstSize);
+};
@@ -4,6 +4,25 @@
 #include "Array.h"
 #include "Savable.h"
 #include "Common.h"
+#include "MappedFile.h"
+#include "ParallelSort.h"
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+#include <type_traits>
+
+//Header of the memory-mapped form of a CAIS: the initial index array and the data follow, each 64-byte aligned
+struct CAISMappedHeader
+{
+	char magic[8];			//"CAISMAP1"
+	int typeSize;			//sizeof(theType)
+	int intTypeSize;		//sizeof(intType)
+	int64 numElements;
+	int64 storageSize;
+	int64 iiaOffset;		//From the start of the file
+	int64 dataOffset;
+	char reserved[16];
+};
 
 template <class theType, class intType=int> class CAIStrings : public Savable
 {
@@ -20,6 +39,15 @@ public:
 		storageArr(rhs.storageArr),
 		initIndexArr(rhs.initIndexArr){};
 
+	CAIStrings(CAIStrings<theType,intType>&& rhs):			//Move constructor - takes over the arrays of rhs
+		storageArr(std::move(rhs.storageArr)),
+		initIndexArr(std::move(rhs.initIndexArr)){};
+
+	CAIStrings<theType,intType>& operator=(const CAIStrings<theType,intType>& rhs)
+	{if(this!=&rhs){DropVirtual(); storageArr=rhs.storageArr; initIndexArr=rhs.initIndexArr;} return *this;};
+	CAIStrings<theType,intType>& operator=(CAIStrings<theType,intType>&& rhs)
+	{if(this!=&rhs){DropVirtual(); storageArr=std::move(rhs.storageArr); initIndexArr=std::move(rhs.initIndexArr);} return *this;};
+
 	~CAIStrings(void);
 
 public:
@@ -32,6 +60,7 @@ public:
 	//Sorts primaryIndices and secondaryIndices
 	//And builds a CAIS index of secondaryIndices for each primaryIndex
 	//Saves the frequency information of secondary indices for each primaryIndex in freqCAIS
+	//Primary indices outside [0,numPrimaryIndices) are dropped
 	template <class argIntType> void BuildIndex(CAIStrings<theType,intType>& freqCAIS,
 												argIntType numPrimaryIndices,
 												CHArray<theType,argIntType>& primaryIndices,
@@ -53,6 +82,8 @@ public:
 	template <class argIntType> void GetVirtualElement(intType index, CHArray<theType,argIntType>& result);
 	template <class argIntType> void GetElementAt(intType index, CHArray<theType,argIntType>& result);
 	theType* GetPointerToElement(intType elementNum) const {return storageArr.arr+initIndexArr[elementNum];};
+	//Batch lookup: the elements listed in "indices" are copied into result, in that order
+	template <class argIntType> void GatherElements(const CHArray<argIntType,argIntType>& indices, CAIStrings<theType,intType>& result) const;
 
 	//Getting and adding char strings
 	void AddCharString(const BString& string, bool fAddZero = true);		//adds a char string with a terminating zero or without
@@ -81,10 +112,26 @@ public:
 	void Clear();
 
 	void SetDataAndIia(const CHArray<intType,intType>& iia, const CHArray<theType,intType>& dataArr);
+	//No copy - the CAIS reads the memory provided, which must outlive it or the next SetData call
+	void SetVirtualDataAndIia(intType* iia, intType numElements, theType* dataArr, intType dataSize);
+
+	//Memory-mapped form, native byte order: header, initial index array, data
+	//LoadMapped() points the arrays into the mapped file, so large tables load without reading or parsing
+	//Mapped pages are copy-on-write; the CAIS copies itself out of the mapping before any change of size
+	bool SaveMapped(const BString& fileName) const;
+	bool LoadMapped(const BString& fileName);
+	bool IsMapped() const {return mappedFile!=0;};
 
 	theType& operator()(intType elementNum, intType pointNum) const {return storageArr[initIndexArr[elementNum]+pointNum];};
 
 	CCommon common;
+
+private:
+	void DropVirtual();				//Forgets mapped or virtual arrays, leaving empty owned ones
+	void MakeOwned();				//Copies mapped or virtual arrays into owned ones before they are modified
+	void TakeDataAndIia(CHArray<intType,intType>& iia, CHArray<theType,intType>& dataArr);	//Moves the arrays in
+
+	std::unique_ptr<CMappedFile> mappedFile;
 };
 
 //The number of empty elements in the array
@@ -112,48 +159,135 @@ void CAIStrings<theType,intType>::BuildIndex(CAIStrings<theType,intType>& freqCA
 											CHArray<theType,argIntType>& primaryIndices,
 											CHArray<theType,argIntType>& secondaryIndices)
 {
-	//Clear all
-	(*this).Clear();
-	freqCAIS.Clear();
-
-	//Resize as needed
-	(*this).ResizeIfSmaller((intType)primaryIndices.Count(),(intType)numPrimaryIndices);
-	freqCAIS.ResizeIfSmaller((intType)primaryIndices.Count(),(intType)numPrimaryIndices);
-
-	//Sort first by secondary indices, then with stable sort by primary indices
-	CHArray<argIntType,argIntType> perm;
-	secondaryIndices.SortPermutation(perm,false,false);		//Regular sort
-	secondaryIndices.Permute(perm);
-	primaryIndices.Permute(perm);
-
-	primaryIndices.SortPermutation(perm,false,true);	//Stable sort
-	secondaryIndices.Permute(perm);
-	primaryIndices.Permute(perm);
-
-	//Build the initial index array on primaryIndices
-	CHArray<argIntType,argIntType> iia;
-	primaryIndices.InitialIndexArray(iia,numPrimaryIndices);
-
-	//Find longest string
-	argIntType longest=0;
-	for(argIntType i=0;i<numPrimaryIndices;i++)
+	//Counting sort by primary index instead of two full sorts: every thread counts the primary indices of its chunk,
+	//the counts become per-thread offsets, and the secondary indices are scattered into their buckets in parallel
+	argIntType n=primaryIndices.Count();
+	int threads=(n<CParallelSort::minParallelSize) ? 1 : CParallelSort::NumThreads();
+	while(threads>1 && (int64)threads*numPrimaryIndices>(int64)n) threads--;		//Keeps the counters small next to the data
+
+	CHArray<argIntType,argIntType> offsets((argIntType)(threads*numPrimaryIndices),true);
+	offsets=0;
+	CParallelSort::ParallelFor(threads,[&](int t)
 	{
-		if((iia[i+1]-iia[i])>longest) longest=iia[i+1]-iia[i];
+		argIntType* counts=offsets.arr+(int64)t*numPrimaryIndices;
+		argIntType end=(argIntType)((int64)n*(t+1)/threads);
+		for(argIntType i=(argIntType)((int64)n*t/threads);i<end;i++)
+		{
+			int64 primary=(int64)primaryIndices.arr[i];
+			if(primary>=0 && primary<(int64)numPrimaryIndices) counts[primary]++;
+		}
+	});
+
+	CHArray<argIntType,argIntType> iia(numPrimaryIndices+1,true);
+	argIntType total=0;
+	for(argIntType p=0;p<numPrimaryIndices;p++)
+	{
+		iia.arr[p]=total;
+		for(int t=0;t<threads;t++)
+		{
+			argIntType& cur=offsets.arr[(int64)t*numPrimaryIndices+p];
+			argIntType count=cur;
+			cur=total;
+			total+=count;
+		}
 	}
+	iia.arr[numPrimaryIndices]=total;
 
-	//Extract runs from each string of secIndices corresponding to each primaryIndex
-	//And add them to (*this) and freqCAIS
-	CHArray<theType,argIntType> curSecString;
-	CHArray<theType,argIntType> runVals(longest);
-	CHArray<argIntType,argIntType> runLengths(longest);
-	for(argIntType i=0;i<numPrimaryIndices;i++)
+	CHArray<theType,argIntType> sortedSecondary(total,true);
+	CParallelSort::ParallelFor(threads,[&](int t)
+	{
+		argIntType* next=offsets.arr+(int64)t*numPrimaryIndices;
+		argIntType end=(argIntType)((int64)n*(t+1)/threads);
+		for(argIntType i=(argIntType)((int64)n*t/threads);i<end;i++)
+		{
+			int64 primary=(int64)primaryIndices.arr[i];
+			if(primary>=0 && primary<(int64)numPrimaryIndices) sortedSecondary.arr[next[primary]++]=secondaryIndices.arr[i];
+		}
+	});
+
+	//Buckets are sorted and reduced to runs independently; every thread takes an equal share of the points
+	int bucketThreads=(total<CParallelSort::minParallelSize) ? 1 : CParallelSort::NumThreads();
+	auto firstBucket=[&](int t) -> argIntType
 	{
-		curSecString.SetVirtual(secondaryIndices.arr+iia[i],iia[i+1]-iia[i]);
-		curSecString.CountRuns(runVals,runLengths);
+		if(t>=bucketThreads) return numPrimaryIndices;
+		argIntType target=(argIntType)((int64)total*t/bucketThreads);
+		return (argIntType)(std::lower_bound(iia.arr,iia.arr+numPrimaryIndices,target)-iia.arr);
+	};
 
-		(*this).AddElement(runVals);
-		freqCAIS.ImportElement(runLengths);		//We have to call Import because argIntType does not necessarily match theType
+	CHArray<intType,intType> runIia((intType)numPrimaryIndices+1,true);
+	CParallelSort::ParallelFor(bucketThreads,[&](int t)
+	{
+		argIntType end=firstBucket(t+1);
+		for(argIntType p=firstBucket(t);p<end;p++)
+		{
+			theType* bucket=sortedSecondary.arr+iia.arr[p];
+			argIntType length=iia.arr[p+1]-iia.arr[p];
+			CParallelSort::SortValues(bucket,length,false);
+
+			intType numRuns=0;
+			for(argIntType i=0;i<length;i++) if(i==0 || bucket[i]!=bucket[i-1]) numRuns++;
+			runIia.arr[p+1]=numRuns;
+		}
+	});
+
+	runIia.arr[0]=0;
+	for(argIntType p=0;p<numPrimaryIndices;p++) runIia.arr[p+1]+=runIia.arr[p];
+
+	intType totalRuns=runIia.arr[numPrimaryIndices];
+	CHArray<theType,intType> runVals(totalRuns,true), runLengths(totalRuns,true);
+	CParallelSort::ParallelFor(bucketThreads,[&](int t)
+	{
+		argIntType end=firstBucket(t+1);
+		for(argIntType p=firstBucket(t);p<end;p++)
+		{
+			const theType* bucket=sortedSecondary.arr+iia.arr[p];
+			argIntType length=iia.arr[p+1]-iia.arr[p];
+			intType curRun=runIia.arr[p]-1;
+			for(argIntType i=0;i<length;i++)
+			{
+				if(i==0 || bucket[i]!=bucket[i-1]) {curRun++; runVals.arr[curRun]=bucket[i]; runLengths.arr[curRun]=0;}
+				runLengths.arr[curRun]++;
+			}
+		}
+	});
+
+	CHArray<intType,intType> freqIia(runIia);
+	freqCAIS.TakeDataAndIia(freqIia,runLengths);
+	TakeDataAndIia(runIia,runVals);
+
+	//Leave the inputs sorted by primary, then by secondary index
+	primaryIndices.ResizeIfSmaller(total,true);
+	for(argIntType p=0;p<numPrimaryIndices;p++)
+	{
+		for(argIntType i=iia.arr[p];i<iia.arr[p+1];i++) primaryIndices.arr[i]=(theType)p;
 	}
+	secondaryIndices=sortedSecondary;
+}
+
+//Batch lookup: the lengths go into the initial index array first, then the elements are copied in parallel
+template <class theType, class intType>
+template <class argIntType>
+void CAIStrings<theType,intType>::GatherElements(const CHArray<argIntType,argIntType>& indices, CAIStrings<theType,intType>& result) const
+{
+	argIntType numIndices=indices.Count();
+	CHArray<intType,intType> iia((intType)numIndices+1,true);
+	iia.arr[0]=0;
+	for(argIntType i=0;i<numIndices;i++) iia.arr[i+1]=iia.arr[i]+NumPointsInElement((intType)indices.arr[i]);
+
+	intType total=iia.arr[numIndices];
+	CHArray<theType,intType> data(total,true);
+	int threads=(total<CParallelSort::minParallelSize) ? 1 : CParallelSort::NumThreads();
+	CParallelSort::ParallelFor(threads,[&](int t)
+	{
+		argIntType end=(argIntType)((int64)numIndices*(t+1)/threads);
+		for(argIntType i=(argIntType)((int64)numIndices*t/threads);i<end;i++)
+		{
+			CHArrayAllocator<theType>::Copy(data.arr+iia.arr[i],GetPointerToElement((intType)indices.arr[i]),
+				(size_t)(iia.arr[i+1]-iia.arr[i]));
+		}
+	});
+
+	result.TakeDataAndIia(iia,data);
 }
 
 template <class theType, class intType>
@@ -192,13 +326,106 @@ storageArr(dataArr)
 template <class theType, class intType>
 void CAIStrings<theType,intType>::SetDataAndIia(const CHArray<intType,intType>& iia, const CHArray<theType,intType>& dataArr)
 {
+	DropVirtual();
 	initIndexArr=iia;
 	storageArr=dataArr;
 }
 
+template <class theType, class intType>
+void CAIStrings<theType,intType>::SetVirtualDataAndIia(intType* iia, intType numElements, theType* dataArr, intType dataSize)
+{
+	DropVirtual();
+	initIndexArr.SetVirtual(iia,numElements+1);
+	storageArr.SetVirtual(dataArr,dataSize);
+}
+
+template <class theType, class intType>
+void CAIStrings<theType,intType>::TakeDataAndIia(CHArray<intType,intType>& iia, CHArray<theType,intType>& dataArr)
+{
+	DropVirtual();
+	initIndexArr=std::move(iia);
+	storageArr=std::move(dataArr);
+}
+
+template <class theType, class intType>
+void CAIStrings<theType,intType>::DropVirtual()
+{
+	storageArr.ReleaseVirtual();
+	initIndexArr.ReleaseVirtual();
+	mappedFile.reset();
+}
+
+template <class theType, class intType>
+void CAIStrings<theType,intType>::MakeOwned()
+{
+	if(!storageArr.IsVirtual() && !initIndexArr.IsVirtual()) return;
+
+	CHArray<theType,intType> storageCopy(storageArr);		//Copying a virtual array allocates
+	CHArray<intType,intType> iiaCopy(initIndexArr);
+	TakeDataAndIia(iiaCopy,storageCopy);
+}
+
+template <class theType, class intType>
+bool CAIStrings<theType,intType>::SaveMapped(const BString& fileName) const
+{
+	static_assert(std::is_trivial<theType>::value, "Only trivial types can be mapped");
+
+	const int64 alignment=64;
+	CAISMappedHeader header;
+	memset(&header,0,sizeof(header));
+	memcpy(header.magic,"CAISMAP1",8);
+	header.typeSize=(int)sizeof(theType);
+	header.intTypeSize=(int)sizeof(intType);
+	header.numElements=Count();
+	header.storageSize=StorageUsed();
+	header.iiaOffset=(int64)sizeof(header);
+	header.dataOffset=(header.iiaOffset+(header.numElements+1)*(int64)sizeof(intType)+alignment-1)/alignment*alignment;
+
+	FILE* file=fopen((const char*)fileName,"wb");
+	if(file==0) return false;
+
+	char padding[alignment];
+	memset(padding,0,sizeof(padding));
+	int64 iiaEnd=header.iiaOffset+(header.numElements+1)*(int64)sizeof(intType);
+	bool fOk=fwrite(&header,sizeof(header),1,file)==1;
+	fOk=fOk && fwrite(initIndexArr.arr,sizeof(intType),(size_t)(header.numElements+1),file)==(size_t)(header.numElements+1);
+	fOk=fOk && fwrite(padding,1,(size_t)(header.dataOffset-iiaEnd),file)==(size_t)(header.dataOffset-iiaEnd);
+	if(header.storageSize>0) fOk=fOk && fwrite(storageArr.arr,sizeof(theType),(size_t)header.storageSize,file)==(size_t)header.storageSize;
+	if(fclose(file)!=0) fOk=false;
+
+	return fOk;
+}
+
+//Only the header and the two ends of the initial index array are checked, the file is not read through
+template <class theType, class intType>
+bool CAIStrings<theType,intType>::LoadMapped(const BString& fileName)
+{
+	static_assert(std::is_trivial<theType>::value, "Only trivial types can be mapped");
+
+	std::unique_ptr<CMappedFile> file(new CMappedFile);
+	if(!file->Open(fileName) || file->Size()<(int64)sizeof(CAISMappedHeader)) return false;
+
+	const CAISMappedHeader* header=(const CAISMappedHeader*)file->Data();
+	if(memcmp(header->magic,"CAISMAP1",8)!=0) return false;
+	if(header->typeSize!=(int)sizeof(theType) || header->intTypeSize!=(int)sizeof(intType)) return false;
+	if(header->numElements<0 || header->storageSize<0) return false;
+	if((int64)(intType)header->numElements!=header->numElements || (int64)(intType)header->storageSize!=header->storageSize) return false;
+	if(header->iiaOffset<(int64)sizeof(CAISMappedHeader) || header->dataOffset<header->iiaOffset) return false;
+	if(header->iiaOffset+(header->numElements+1)*(int64)sizeof(intType)>file->Size()) return false;
+	if(header->dataOffset+header->storageSize*(int64)sizeof(theType)>file->Size()) return false;
+
+	intType* iia=(intType*)(file->Data()+header->iiaOffset);
+	if(iia[0]!=0 || iia[header->numElements]!=(intType)header->storageSize) return false;
+
+	SetVirtualDataAndIia(iia,(intType)header->numElements,(theType*)(file->Data()+header->dataOffset),(intType)header->storageSize);
+	mappedFile=std::move(file);
+	return true;
+}
+
 template <class theType, class intType>
 void CAIStrings<theType,intType>::Clear()
 {
+	DropVirtual();
 	initIndexArr.EraseArray();
 	storageArr.EraseArray();
 
@@ -234,6 +461,7 @@ void CAIStrings<theType,intType>::GetElementLengths(CHArray<intType,intType>& le
 template <class theType, class intType>
 void CAIStrings<theType,intType>::ResizeIfSmaller(intType storageSize,intType maxElements)
 {
+	MakeOwned();
 	if(storageSize>=storageArr.GetSize()) storageArr.ResizeArrayKeepPoints(storageSize);
 	if(maxElements>=(initIndexArr.GetSize()-1)) initIndexArr.ResizeArrayKeepPoints(maxElements+1);
 }
@@ -241,6 +469,7 @@ void CAIStrings<theType,intType>::ResizeIfSmaller(intType storageSize,intType ma
 template <class theType, class intType>
 void CAIStrings<theType,intType>::ResizeToZero()
 {
+	DropVirtual();
 	storageArr.ResizeArray(0);
 	initIndexArr.ResizeArray(1);
 
@@ -266,11 +495,10 @@ void CAIStrings<theType,intType>::GetCharStringAt(intType index, BString& result
 template <class theType, class intType>
 void CAIStrings<theType,intType>::AddElement(const theType* pointer, intType numToCopy)
 {
-	//Store the element
-	for(intType i=0;i<numToCopy;i++)
-	{
-		storageArr.AddAndExtend(pointer[i]);
-	}
+	//Store the element with one copy, the storage grows geometrically
+	MakeOwned();
+	CHArray<theType,intType> element((theType*)pointer,numToCopy,true);
+	storageArr.AddFromArray(element);
 	initIndexArr.AddAndExtend(storageArr.GetNumPoints());
 }
 
@@ -279,15 +507,7 @@ template <class theType, class intType>
 template <class argIntType>
 void CAIStrings<theType,intType>::AddElement(const CHArray<theType,argIntType>& element)
 {
-	argIntType numToCopy=element.GetNumPoints();
-
-	//Store the element
-	for(argIntType i=0;i<numToCopy;i++)
-	{
-		storageArr.AddAndExtend(element.arr[i]);
-	}
-
-	initIndexArr.AddAndExtend(storageArr.GetNumPoints());
+	AddElement(element.arr,(intType)element.GetNumPoints());
 }
 
 //ImportElement accepts CHArrays with different type and intType
@@ -298,9 +518,12 @@ void CAIStrings<theType,intType>::ImportElement(const CHArray<argType,argIntType
 	argIntType numToCopy=element.GetNumPoints();
 
 	//Store the element
+	MakeOwned();
+	intType needed=storageArr.GetNumPoints()+(intType)numToCopy;
+	if(needed>storageArr.GetSize()) storageArr.Reserve(std::max(needed,storageArr.GetSize()*2));
 	for(argIntType i=0;i<numToCopy;i++)
 	{
-		storageArr.AddAndExtend((theType)element.arr[i]);
+		storageArr.AddPoint((theType)element.arr[i]);
 	}
 
 	initIndexArr.AddAndExtend(storageArr.GetNumPoints());
@@ -311,6 +534,7 @@ template <class theType, class intType>
 template <class argType, class argIntType>
 void CAIStrings<theType,intType>::ImportFrom(const CAIStrings<argType,argIntType>& rhs)
 {
+	DropVirtual();
 	storageArr.ImportFrom(rhs.storageArr);
 	initIndexArr.ImportFrom(rhs.initIndexArr);
 }
@@ -361,6 +585,7 @@ void CAIStrings<theType,intType>::GetElementAt(intType index, CHArray<theType,ar
 template <class theType, class intType>
 void CAIStrings<theType,intType>::Serialize(BArchive& archive)
 {
+	if(archive.IsLoading()) DropVirtual();
 	storageArr.Serialize(archive);
 	initIndexArr.Serialize(archive);
 }
@@ -0,0 +1,92 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "ChunkedArray.h"
+#include <map>
+#include <mutex>
+
+//Free buffers by size, returned to the heap at exit
+struct CChunkPoolBuffers : public std::multimap<size_t, void*>
+{
+	~CChunkPoolBuffers() {for(auto& cur : *this) free(cur.second);}
+};
+
+static CChunkPoolBuffers freeChunks;
+static size_t pooledBytes=0;
+static size_t maxPooledBytes=(size_t)64*1024*1024;
+static std::mutex poolMutex;
+
+void* CChunkPool::Get(size_t bytes)
+{
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+		auto found=freeChunks.find(bytes);
+		if(found!=freeChunks.end())
+		{
+			void* p=found->second;
+			freeChunks.erase(found);
+			pooledBytes-=bytes;
+			return p;
+		}
+	}
+
+	void* p=malloc(bytes);
+	if(!p) throw std::bad_alloc();
+	return p;
+}
+
+void CChunkPool::Release(void* p, size_t bytes)
+{
+	if(!p) return;
+
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+		if(pooledBytes+bytes<=maxPooledBytes)
+		{
+			freeChunks.insert(std::make_pair(bytes,p));
+			pooledBytes+=bytes;
+			return;
+		}
+	}
+
+	free(p);
+}
+
+void CChunkPool::SetMaxPooledBytes(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(poolMutex);
+	maxPooledBytes=bytes;
+
+	while(pooledBytes>maxPooledBytes && !freeChunks.empty())
+	{
+		auto last=freeChunks.begin();
+		pooledBytes-=last->first;
+		free(last->second);
+		freeChunks.erase(last);
+	}
+}
+
+size_t CChunkPool::PooledBytes()
+{
+	std::lock_guard<std::mutex> lock(poolMutex);
+	return pooledBytes;
+}
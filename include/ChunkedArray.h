@@ -0,0 +1,541 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Segmented append-only series for unbounded live data
+//Points are stored in fixed-size chunks, so appending never moves existing points:
+//addresses stay valid, growth needs no transient copy, and Add() is O(1)
+//Random access is one shift and one mask; iterators are random-access and work with <algorithm>
+//Chunk k can be seen as a virtual CHArray with GetChunk() to run CHArray algorithms on it
+//Full chunks can be spilled to a file and are read back transparently when accessed;
+//with SetSpillFile() this happens on its own, so only the most recent points stay in memory
+//Const access may run on several threads at once, the spill file is read under a lock; non-const calls need the array to themselves
+//Only trivial element types (numbers, POD structs) are supported
+
+#pragma once
+#include "Array.h"
+#include "Data.h"
+#include <stdio.h>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <type_traits>
+
+//Process-wide pool of chunk buffers, so clearing and refilling a series does not go back to the heap
+class CChunkPool
+{
+public:
+	static void* Get(size_t bytes);
+	static void Release(void* p, size_t bytes);
+	static void SetMaxPooledBytes(size_t bytes);		//Free buffers above this total are returned to the heap
+	static size_t PooledBytes();
+};
+
+template <class theType> class CChunkedArray
+{
+	static_assert(std::is_trivial<theType>::value, "CChunkedArray stores trivial types only");
+
+public:
+	explicit CChunkedArray(int log2ChunkSize=14);
+	CChunkedArray(const CChunkedArray<theType>& rhs);
+	CChunkedArray(CChunkedArray<theType>&& rhs);
+	~CChunkedArray();
+
+	CChunkedArray<theType>& operator=(const CChunkedArray<theType>& rhs);
+	CChunkedArray<theType>& operator=(CChunkedArray<theType>&& rhs);
+
+public:
+	int64 Count() const {return numPoints;}
+	bool IsEmpty() const {return numPoints==0;}
+	int64 ChunkSize() const {return (int64)1<<shift;}
+	int64 NumChunks() const {return chunks.Count();}
+
+	void Add(const theType& point);
+	void AddPoint(const theType& point) {Add(point);}				//Same names as CHArray
+	void AddAndExtend(const theType& point) {Add(point);}
+	CChunkedArray<theType>& operator<<(const theType& point) {Add(point); return *this;}
+	template <class intType> void AddFromArray(const CHArray<theType,intType>& source);
+
+	void Clear();									//Releases all chunks and closes the spill file
+
+	//Non-const access loads spilled chunks back into memory; const access reads them from the file and keeps them there
+	theType& operator[](int64 index) {return ChunkPointer(index>>shift)[index&mask];}
+	theType operator[](int64 index) const;
+	theType& Last() {return (*this)[numPoints-1];}
+	theType Last() const {return (*this)[numPoints-1];}
+
+	//Virtual array over chunk number chunkNum, with the points stored in it
+	void GetChunk(int64 chunkNum, CHArray<theType,int64>& view);
+
+	//false if the points do not fit in intType (result is then left as it was) or could not all be read back
+	template <class intType> bool ExportTo(CHArray<theType,intType>& result) const {return ExportPart(result,0,numPoints);}
+	template <class intType> bool ExportPart(CHArray<theType,intType>& result, int64 from, int64 numToCopy) const;
+
+	theType Sum() const;		//Points that could not be read back count as 0, see IsOk()
+	theType Mean() const {return IsEmpty() ? 0 : Sum()/(theType)numPoints;}
+
+public:
+	//Spilling: full chunks older than the last keepInMemory points are written to fileName and released
+	//Spilled chunks are reloaded by non-const access and stay in memory until the next Spill()
+	//Non-const access hands out writable references, so Spill() writes reloaded chunks back in place before releasing them
+	//Passes that only read old points should use const access, which reads the file without reloading
+	bool Spill(const BString& fileName, int64 keepInMemory);
+	int64 NumChunksInMemory() const;
+
+	//Spills on its own every time a new chunk is started and more than maxInMemory points are stored
+	//The setting survives Clear(), the file is created on the first spill and deleted by Clear(); maxInMemory=0 turns it off
+	//Copies keep all their points in memory and do not spill
+	void SetSpillFile(const BString& fileName, int64 maxInMemory) {autoSpillFileName=fileName; autoSpillPoints=maxInMemory;}
+	//false once a spill or a read of spilled points has failed: automatic spilling stops (the points stay in memory),
+	//and points that could not be read are returned as 0 - also through operator[], iterators and GetChunk()
+	bool IsOk() const {return !fSpillFailed;}
+	//Applies the SetSpillFile() limit right away, e.g. after a pass over old points has reloaded them
+	bool TrimMemory() {return autoSpillPoints>0 && numPoints>autoSpillPoints ? Spill(autoSpillFileName,autoSpillPoints) : true;}
+
+public:
+	class iterator
+	{
+	public:
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef theType value_type;
+		typedef int64 difference_type;
+		typedef theType* pointer;
+		typedef theType& reference;
+
+		iterator(CChunkedArray<theType>* theArr=0, int64 theIndex=0):arr(theArr),index(theIndex){}
+
+		theType& operator*() const {return (*arr)[index];}
+		theType* operator->() const {return &(*arr)[index];}
+		theType& operator[](int64 n) const {return (*arr)[index+n];}
+
+		iterator& operator++() {index++; return *this;}
+		iterator& operator--() {index--; return *this;}
+		iterator operator++(int) {iterator old(*this); index++; return old;}
+		iterator operator--(int) {iterator old(*this); index--; return old;}
+		iterator& operator+=(int64 n) {index+=n; return *this;}
+		iterator& operator-=(int64 n) {index-=n; return *this;}
+		iterator operator+(int64 n) const {return iterator(arr,index+n);}
+		iterator operator-(int64 n) const {return iterator(arr,index-n);}
+		int64 operator-(const iterator& rhs) const {return index-rhs.index;}
+
+		bool operator==(const iterator& rhs) const {return index==rhs.index;}
+		bool operator!=(const iterator& rhs) const {return index!=rhs.index;}
+		bool operator<(const iterator& rhs) const {return index<rhs.index;}
+		bool operator>(const iterator& rhs) const {return index>rhs.index;}
+		bool operator<=(const iterator& rhs) const {return index<=rhs.index;}
+		bool operator>=(const iterator& rhs) const {return index>=rhs.index;}
+
+	private:
+		CChunkedArray<theType>* arr;
+		int64 index;
+	};
+
+	iterator begin() {return iterator(this,0);}
+	iterator end() {return iterator(this,numPoints);}
+
+private:
+	theType* ChunkPointer(int64 chunkNum)
+	{
+		theType* p=chunks.arr[chunkNum];
+		return p ? p : LoadChunk(chunkNum);
+	}
+	theType* LoadChunk(int64 chunkNum);		//A chunk that cannot be read is loaded as zeros and fails IsOk()
+	bool ReadPart(int64 chunkNum, int64 pos, int64 num, theType* dest) const;	//Copies points from memory or the spill file
+	void AddChunk();
+	void CopyFrom(const CChunkedArray<theType>& rhs);
+	void Steal(CChunkedArray<theType>& rhs);
+	void CloseSpillFile();
+
+private:
+	int shift;
+	int64 mask;
+	int64 numPoints;
+	CHArray<theType*,int64> chunks;		//0 for chunks that are spilled and not loaded
+	CHArray<int64,int64> spillOffsets;		//-1 for chunks that were never spilled
+	FILE* spillFile;
+	BString spillFileName;
+	mutable std::mutex fileLock;			//Guards the position of spillFile, const reads seek and read under it
+
+	BString autoSpillFileName;
+	int64 autoSpillPoints;
+	mutable bool fSpillFailed;		//Sticky, set by const reads as well
+};
+
+//Keeps running min and max of the added points, as CHArrayMinMax does
+template <class theType> class CChunkedArrayMinMax : public CChunkedArray<theType>
+{
+public:
+	explicit CChunkedArrayMinMax(int log2ChunkSize=14):CChunkedArray<theType>(log2ChunkSize),min(0),max(0){}
+
+public:
+	void AddPointMinMax(theType point)
+	{
+		if (this->IsEmpty()) min = max = point;
+		else
+		{
+			if (point < min) min = point;
+			if (point > max) max = point;
+		}
+
+		this->Add(point);
+	}
+
+	theType CurMin() const { return min; }
+	theType CurMax() const { return max; }
+
+private:
+	theType min;
+	theType max;
+};
+
+//x-y series recorded point by point, exported to CData for analysis
+class CChunkedData
+{
+public:
+	explicit CChunkedData(int log2ChunkSize=14):xArr(log2ChunkSize),yArr(log2ChunkSize){}
+
+public:
+	CChunkedArray<double> xArr;
+	CChunkedArray<double> yArr;
+
+public:
+	void AddPoint(double x, double y) {xArr.Add(x); yArr.Add(y);}
+	int64 Count() const {return xArr.Count();}
+	bool IsEmpty() const {return xArr.IsEmpty();}
+	void Clear() {xArr.Clear(); yArr.Clear();}
+
+	//fileBase+".x" and fileBase+".y", see CChunkedArray::SetSpillFile()
+	void SetSpillFile(const BString& fileBase, int64 maxInMemory)
+	{
+		xArr.SetSpillFile(fileBase+".x",maxInMemory);
+		yArr.SetSpillFile(fileBase+".y",maxInMemory);
+	}
+
+	bool ExportTo(CData& result) const {return xArr.ExportTo(result.xArr) && yArr.ExportTo(result.yArr);}
+	bool IsOk() const {return xArr.IsOk() && yArr.IsOk();}
+};
+
+template <class theType>
+CChunkedArray<theType>::CChunkedArray(int log2ChunkSize):
+shift(log2ChunkSize),
+mask(((int64)1<<log2ChunkSize)-1),
+numPoints(0),
+spillFile(0),
+autoSpillPoints(0),
+fSpillFailed(false)
+{
+}
+
+template <class theType>
+CChunkedArray<theType>::CChunkedArray(const CChunkedArray<theType>& rhs):
+shift(rhs.shift),
+mask(rhs.mask),
+numPoints(0),
+spillFile(0),
+autoSpillPoints(0),
+fSpillFailed(false)
+{
+	CopyFrom(rhs);
+}
+
+template <class theType>
+CChunkedArray<theType>::CChunkedArray(CChunkedArray<theType>&& rhs):
+shift(rhs.shift),
+mask(rhs.mask),
+numPoints(0),
+spillFile(0),
+autoSpillPoints(0),
+fSpillFailed(false)
+{
+	Steal(rhs);
+}
+
+template <class theType>
+CChunkedArray<theType>::~CChunkedArray()
+{
+	Clear();
+}
+
+template <class theType>
+CChunkedArray<theType>& CChunkedArray<theType>::operator=(const CChunkedArray<theType>& rhs)
+{
+	if(this==&rhs) return *this;
+
+	Clear();
+	shift=rhs.shift;
+	mask=rhs.mask;
+	CopyFrom(rhs);
+
+	return *this;
+}
+
+template <class theType>
+CChunkedArray<theType>& CChunkedArray<theType>::operator=(CChunkedArray<theType>&& rhs)
+{
+	if(this==&rhs) return *this;
+
+	Clear();
+	shift=rhs.shift;
+	mask=rhs.mask;
+	Steal(rhs);
+
+	return *this;
+}
+
+//The copy keeps everything in memory, it does not share the spill file
+template <class theType>
+void CChunkedArray<theType>::CopyFrom(const CChunkedArray<theType>& rhs)
+{
+	size_t chunkBytes=(size_t)rhs.ChunkSize()*sizeof(theType);
+
+	for(int64 k=0; k<rhs.NumChunks(); k++)
+	{
+		theType* p=(theType*)CChunkPool::Get(chunkBytes);
+		if(!rhs.ReadPart(k,0,std::min(rhs.ChunkSize(),rhs.numPoints-(k<<shift)),p)) fSpillFailed=true;
+		chunks.AddAndExtend(p);
+		spillOffsets.AddAndExtend(-1);
+	}
+
+	numPoints=rhs.numPoints;
+}
+
+template <class theType>
+void CChunkedArray<theType>::Steal(CChunkedArray<theType>& rhs)
+{
+	chunks=std::move(rhs.chunks);
+	spillOffsets=std::move(rhs.spillOffsets);
+	numPoints=rhs.numPoints;
+	spillFile=rhs.spillFile;
+	spillFileName=rhs.spillFileName;
+	autoSpillFileName=rhs.autoSpillFileName;
+	autoSpillPoints=rhs.autoSpillPoints;
+	fSpillFailed=rhs.fSpillFailed;
+
+	rhs.numPoints=0;
+	rhs.spillFile=0;
+	rhs.spillFileName="";
+	rhs.fSpillFailed=false;
+}
+
+template <class theType>
+void CChunkedArray<theType>::Clear()
+{
+	size_t chunkBytes=(size_t)ChunkSize()*sizeof(theType);
+	for(int64 k=0; k<chunks.Count(); k++) if(chunks.arr[k]) CChunkPool::Release(chunks.arr[k],chunkBytes);
+
+	chunks.EraseArray();
+	spillOffsets.EraseArray();
+	numPoints=0;
+	fSpillFailed=false;
+
+	CloseSpillFile();
+}
+
+template <class theType>
+void CChunkedArray<theType>::CloseSpillFile()
+{
+	std::lock_guard<std::mutex> guard(fileLock);
+
+	if(spillFile) fclose(spillFile);
+	spillFile=0;
+
+	if(!spillFileName.IsEmpty()) remove(spillFileName.c_str());
+	spillFileName="";
+}
+
+template <class theType>
+void CChunkedArray<theType>::AddChunk()
+{
+	if(autoSpillPoints>0 && numPoints>autoSpillPoints && !fSpillFailed)
+	{
+		if(!Spill(autoSpillFileName,autoSpillPoints)) fSpillFailed=true;
+	}
+
+	chunks.AddAndExtend((theType*)CChunkPool::Get((size_t)ChunkSize()*sizeof(theType)));
+	spillOffsets.AddAndExtend(-1);
+}
+
+template <class theType>
+void CChunkedArray<theType>::Add(const theType& point)
+{
+	int64 pos=numPoints&mask;
+	if(pos==0 && (numPoints>>shift)==chunks.Count()) AddChunk();		//All chunks are full
+
+	chunks.arr[numPoints>>shift][pos]=point;		//The last chunk is never spilled
+	numPoints++;
+}
+
+template <class theType>
+template <class intType>
+void CChunkedArray<theType>::AddFromArray(const CHArray<theType,intType>& source)
+{
+	int64 count=(int64)source.Count();
+	int64 from=0;
+	while(from<count)
+	{
+		if((numPoints&mask)==0 && (numPoints>>shift)==chunks.Count()) AddChunk();
+
+		int64 pos=numPoints&mask;
+		int64 numToCopy=std::min(count-from,ChunkSize()-pos);
+		memcpy(chunks.arr[numPoints>>shift]+pos,source.arr+from,(size_t)numToCopy*sizeof(theType));
+
+		from+=numToCopy;
+		numPoints+=numToCopy;
+	}
+}
+
+template <class theType>
+theType CChunkedArray<theType>::operator[](int64 index) const
+{
+	theType result;
+	ReadPart(index>>shift,index&mask,1,&result);
+	return result;
+}
+
+template <class theType>
+void CChunkedArray<theType>::GetChunk(int64 chunkNum, CHArray<theType,int64>& view)
+{
+	int64 numInChunk=std::min(ChunkSize(),numPoints-(chunkNum<<shift));
+	view.SetVirtual(ChunkPointer(chunkNum),numInChunk);
+}
+
+template <class theType>
+template <class intType>
+bool CChunkedArray<theType>::ExportPart(CHArray<theType,intType>& result, int64 from, int64 numToCopy) const
+{
+	if(from<0) from=0;
+	if(numToCopy>numPoints-from) numToCopy=numPoints-from;
+	if(numToCopy<0) numToCopy=0;
+	if((uint64)numToCopy>(uint64)std::numeric_limits<intType>::max()) return false;
+
+	result.ResizeIfSmaller((intType)numToCopy,true);
+
+	bool fRead=true;
+	int64 done=0;
+	while(done<numToCopy)
+	{
+		int64 index=from+done;
+		int64 pos=index&mask;
+		int64 num=std::min(numToCopy-done,ChunkSize()-pos);
+		if(!ReadPart(index>>shift,pos,num,result.arr+done)) fRead=false;
+		done+=num;
+	}
+
+	return fRead;
+}
+
+template <class theType>
+theType CChunkedArray<theType>::Sum() const
+{
+	theType result=0;
+	CHArray<theType,int64> spilled;		//Read buffer for chunks that are not in memory
+	for(int64 k=0; k<NumChunks(); k++)
+	{
+		int64 numInChunk=std::min(ChunkSize(),numPoints-(k<<shift));
+		const theType* p=chunks.arr[k];
+		if(!p)
+		{
+			spilled.ResizeIfSmaller(ChunkSize(),true);
+			ReadPart(k,0,numInChunk,spilled.arr);		//Zeros and fSpillFailed if the file is short
+			p=spilled.arr;
+		}
+		result+=CArrayKernel<theType>::Sum(p,numInChunk);
+	}
+	return result;
+}
+
+template <class theType>
+bool CChunkedArray<theType>::Spill(const BString& fileName, int64 keepInMemory)
+{
+	std::lock_guard<std::mutex> guard(fileLock);
+
+	if(spillFile && spillFileName!=fileName) return false;		//One spill file per series
+
+	if(!spillFile)
+	{
+		spillFile=fopen(fileName.c_str(),"w+b");
+		if(!spillFile) return false;
+		spillFileName=fileName;
+	}
+
+	size_t chunkSize=(size_t)ChunkSize();
+	int64 lastToSpill=((numPoints-keepInMemory)>>shift)-1;		//Only full chunks
+
+	for(int64 k=0; k<=lastToSpill && k<NumChunks(); k++)
+	{
+		if(!chunks.arr[k]) continue;
+
+		//New chunks go to the end of the file, reloaded ones may have been changed and are rewritten in place
+		//A chunk that fails to write stays in memory, so a partly rewritten place in the file is never read
+		bool fNew=spillOffsets.arr[k]<0;
+		if(fseek_large(spillFile,fNew ? 0 : spillOffsets.arr[k],fNew ? SEEK_END : SEEK_SET)!=0) return false;
+		int64 offset=ftell_large(spillFile);
+		if(offset<0 || fwrite(chunks.arr[k],sizeof(theType),chunkSize,spillFile)!=chunkSize) return false;
+		spillOffsets.arr[k]=offset;
+
+		CChunkPool::Release(chunks.arr[k],chunkSize*sizeof(theType));
+		chunks.arr[k]=0;
+	}
+
+	fflush(spillFile);
+	return true;
+}
+
+template <class theType>
+bool CChunkedArray<theType>::ReadPart(int64 chunkNum, int64 pos, int64 num, theType* dest) const
+{
+	if(chunks.arr[chunkNum]) {memcpy(dest,chunks.arr[chunkNum]+pos,(size_t)num*sizeof(theType)); return true;}
+
+	std::lock_guard<std::mutex> guard(fileLock);
+	if(fseek_large(spillFile,spillOffsets.arr[chunkNum]+pos*(int64)sizeof(theType),SEEK_SET)!=0 ||
+		fread(dest,sizeof(theType),(size_t)num,spillFile)!=(size_t)num)
+	{
+		memset(dest,0,(size_t)num*sizeof(theType));
+		fSpillFailed=true;
+		return false;
+	}
+	return true;
+}
+
+template <class theType>
+theType* CChunkedArray<theType>::LoadChunk(int64 chunkNum)
+{
+	size_t chunkSize=(size_t)ChunkSize();
+	theType* p=(theType*)CChunkPool::Get(chunkSize*sizeof(theType));
+
+	std::lock_guard<std::mutex> guard(fileLock);
+	if(fseek_large(spillFile,spillOffsets.arr[chunkNum],SEEK_SET)!=0 || fread(p,sizeof(theType),chunkSize,spillFile)!=chunkSize)
+	{
+		memset(p,0,chunkSize*sizeof(theType));
+		fSpillFailed=true;
+	}
+
+	chunks.arr[chunkNum]=p;
+	return p;
+}
+
+template <class theType>
+int64 CChunkedArray<theType>::NumChunksInMemory() const
+{
+	int64 result=0;
+	for(int64 k=0; k<NumChunks(); k++) if(chunks.arr[k]) result++;
+	return result;
+}
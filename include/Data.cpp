@@ -95,6 +95,16 @@ CData& CData::operator=(const CData& rhs)
 	return *this;
 }
 
+CData& CData::operator=(CData&& rhs)
+{
+	if(&rhs==this) return *this;
+
+	xArr=std::move(rhs.xArr);
+	yArr=std::move(rhs.yArr);
+
+	return *this;
+}
+
 CData& CData::Concatenate(const CData& rhs)   //Parent CData must have enough space
 {
 	xArr.Concatenate(rhs.xArr);
@@ -149,63 +159,49 @@ double CData::InterpolatePoint(double x)
 			(yArr.arr[pos] - yArr.arr[pos - 1]) / (xArr.arr[pos] - xArr.arr[pos - 1]);
 }
 
-void CData::Write(BString name) const
+bool CData::Write(BString name, BString form) const
 {
-	if(!fDataPresent()) return;
+	if(!fDataPresent()) return false;
+
+	CTextWriter writer;
+	if(!writer.Open(name,true)) return false;
 
-	FILE* f=fopen(name,"w");
+	CTextCodec::CNumberFormat format=CTextCodec::ParseFormat(form);
 	for(int c1=0;c1<GetNumPoints();c1++)
 	{
-		char buffer[20];
-
-		sprintf(buffer,"%.4e",xArr[c1]);         //x
-		fputs(buffer,f);
-		fputc(' ',f);
-
-		sprintf(buffer,"%.4e",yArr[c1]);
-		fputs(buffer,f);
-		fputc('\n',f);
+		writer.PutNumber(xArr[c1],format);
+		writer.Put(' ');
+		writer.PutNumber(yArr[c1],format);
+		writer.Put('\n');
 	}
-	fclose(f);
+
+	return writer.Close();
 }
 
-void CData::Read(BString name)
+bool CData::Read(BString name)
 {
-	char buffer[40];
-	bool x=true;
-	bool eofReached=false;
-
 	EraseData();
 
-	FILE* f;
-	if((f=fopen(name,"r"))==NULL) return;
-	while(1)			
+	CHArray<char,int64> text;
+	if(!text.ReadBinary(name)) return false;
+
+	//x y pairs, in any arrangement of blanks
+	CHArray<double> values;
+	CTextCodec::ParseList<double>(text.begin(),text.GetNumPoints(),[&values](long long count)->double*
 	{
-		int c2=0;						//in buffer
-		while(1)
-		{
-			int i=fgetc(f);
-			if(i==EOF) {eofReached=true; break;}
-			if(i<=32)
-			{
-				if(c2>0) break;
-				else continue;
-			}
-			else
-			{
-				buffer[c2]=(char)i;
-				c2++;
-			}
-		}
-		buffer[c2]='\0';
-		if(c2>0)
-		{
-		if(x==false) {yArr << atof(buffer); x=true;}
-		else {xArr << atof(buffer); x=false;}
-		}
-		if(eofReached) break;
+		values.ResizeArray((int)count,true);
+		return values.begin();
+	});
+
+	int numPairs=values.GetNumPoints()/2;
+	ResizeData(numPairs);
+	for(int i=0;i<numPairs;i++)
+	{
+		xArr.AddPoint(values[2*i]);
+		yArr.AddPoint(values[2*i+1]);
 	}
-	fclose(f);
+
+	return true;
 }
 
 void CData::RemoveLastPoint()
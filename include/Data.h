@@ -28,6 +28,8 @@ class CData
 {
 public:
 	CData(int theSize=100);
+	CData(const CData& rhs):xArr(rhs.xArr),yArr(rhs.yArr){};
+	CData(CData&& rhs):xArr(std::move(rhs.xArr)),yArr(std::move(rhs.yArr)){};	//Takes over the arrays of rhs
 	virtual ~CData(){};
 
 public:
@@ -76,8 +78,8 @@ public:
 	int FindNearestX(double x) const;
 	void RemoveAllPointsAfter(double x);
 	void RemoveLastPoint();
-	void Read(BString name);
-	void Write(BString name) const;
+	bool Read(BString name);
+	bool Write(BString name, BString form="%.4e") const;		//"x y" lines, form "%r" - shortest exact text
 	double InterpolatePoint(double x);
 	void ResizeData(int theSize);
 	void Resize(int theSize) { ResizeData(theSize); }
@@ -98,4 +100,5 @@ public:
 	CData& Concatenate(const CData& rhs);   //Parent CData should have enough space
 	CData& ExportPart(CData& rhs, int from, int to);
 	CData& operator=(const CData& rhs);
+	CData& operator=(CData&& rhs);
 };
\ No newline at end of file
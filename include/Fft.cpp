@@ -0,0 +1,356 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "Fft.h"
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+
+typedef CFft::Complex Complex;
+
+//Factorization and twiddles for one transform size
+struct CFftPlan
+{
+	long long n;
+	std::vector<long long> factors;		//pairs (radix, remaining length)
+	std::vector<Complex> twiddles;		//exp(-2*pi*i*k/n)
+	//Per stage, the twiddles used by the butterflies in the order they are used
+	//stageTwiddles[s][(q-1)*m+k] = twiddles[q*k*fstride] for radix p, q=1..p-1, k<m
+	std::vector<std::vector<Complex> > stageTwiddles;
+};
+
+//Cached plans by size, with the time of their last use for the least-recently-used eviction
+struct CFftCachedPlan
+{
+	std::shared_ptr<const CFftPlan> plan;
+	unsigned long long lastUse;
+};
+
+static std::map<long long, CFftCachedPlan> fftPlans;
+static unsigned long long fftPlanClock=0;
+static int maxFftPlans=32;
+static std::mutex fftPlansMutex;
+
+//Makes room for one more plan; plans still in use by other threads live on through their shared_ptr
+static void EvictPlans(int maxPlans)
+{
+	while((int)fftPlans.size()>=maxPlans && !fftPlans.empty())
+	{
+		auto oldest=fftPlans.begin();
+		for(auto cur=fftPlans.begin(); cur!=fftPlans.end(); ++cur) if(cur->second.lastUse<oldest->second.lastUse) oldest=cur;
+		fftPlans.erase(oldest);
+	}
+}
+
+static std::shared_ptr<const CFftPlan> GetPlan(long long n)
+{
+	std::lock_guard<std::mutex> lock(fftPlansMutex);
+
+	auto found=fftPlans.find(n);
+	if(found!=fftPlans.end())
+	{
+		found->second.lastUse=++fftPlanClock;
+		return found->second.plan;
+	}
+
+	std::shared_ptr<CFftPlan> plan(new CFftPlan);
+	plan->n=n;
+
+	plan->twiddles.resize((size_t)n);
+	const double pi=3.14159265358979323846;
+	for(long long k=0; k<n; k++)
+	{
+		double phase=-2*pi*(double)k/(double)n;
+		plan->twiddles[(size_t)k]=Complex(cos(phase),sin(phase));
+	}
+
+	//Radix 4 first, then 2, then odd factors
+	long long remaining=n, p=4;
+	long long sqrtN=(long long)floor(sqrt((double)n));
+	do
+	{
+		while(remaining%p)
+		{
+			if(p==4) p=2;
+			else if(p==2) p=3;
+			else p+=2;
+			if(p>sqrtN) p=remaining;
+		}
+		remaining/=p;
+		plan->factors.push_back(p);
+		plan->factors.push_back(remaining);
+	}
+	while(remaining>1);
+
+	long long fstride=1;
+	for(size_t f=0; f<plan->factors.size(); f+=2)
+	{
+		long long p=plan->factors[f], m=plan->factors[f+1];
+		std::vector<Complex> stage((size_t)((p-1)*m));
+		for(long long q=1; q<p; q++)
+			for(long long k=0; k<m; k++) stage[(size_t)((q-1)*m+k)]=plan->twiddles[(size_t)((q*k*fstride)%n)];
+		plan->stageTwiddles.push_back(stage);
+		fstride*=p;
+	}
+
+	EvictPlans(maxFftPlans);
+	CFftCachedPlan& cached=fftPlans[n];
+	cached.plan=plan;
+	cached.lastUse=++fftPlanClock;
+	return plan;
+}
+
+void CFft::ClearPlans()
+{
+	std::lock_guard<std::mutex> lock(fftPlansMutex);
+	fftPlans.clear();
+}
+
+int CFft::NumPlans()
+{
+	std::lock_guard<std::mutex> lock(fftPlansMutex);
+	return (int)fftPlans.size();
+}
+
+void CFft::SetMaxPlans(int maxPlans)
+{
+	std::lock_guard<std::mutex> lock(fftPlansMutex);
+	maxFftPlans=(maxPlans<1) ? 1 : maxPlans;
+	EvictPlans(maxFftPlans+1);		//Trims to the new limit
+}
+
+long long CFft::GoodSize(long long minSize)
+{
+	if(minSize<=2) return 2;
+
+	long long best=-1;
+	for(long long p2=2; ; p2*=2)			//Even sizes only
+	{
+		for(long long p3=p2; ; p3*=3)
+		{
+			long long p5=p3;
+			while(p5<minSize) p5*=5;
+			if(best<0 || p5<best) best=p5;
+			if(p3>=minSize) break;
+		}
+		if(p2>=minSize) break;
+	}
+
+	return best;
+}
+
+//Plain complex product - std::complex operator* checks for NaN and infinity on every call
+static inline Complex Mul(const Complex& a, const Complex& b)
+{
+	return Complex(a.real()*b.real()-a.imag()*b.imag(), a.real()*b.imag()+a.imag()*b.real());
+}
+
+static void Butterfly2(Complex* out, const Complex* tw, long long m)
+{
+	Complex* out2=out+m;
+	for(long long k=0; k<m; k++)
+	{
+		Complex t=Mul(out2[k],tw[k]);
+		out2[k]=out[k]-t;
+		out[k]+=t;
+	}
+}
+
+static void Butterfly4(Complex* out, const Complex* tw, long long m)
+{
+	for(long long k=0; k<m; k++)
+	{
+		Complex s0=Mul(out[k+m],tw[k]);
+		Complex s1=Mul(out[k+2*m],tw[m+k]);
+		Complex s2=Mul(out[k+3*m],tw[2*m+k]);
+
+		Complex s5=out[k]-s1;
+		out[k]+=s1;
+		Complex s3=s0+s2;
+		Complex s4=s0-s2;
+
+		out[k+2*m]=out[k]-s3;
+		out[k]+=s3;
+		out[k+m]=Complex(s5.real()+s4.imag(), s5.imag()-s4.real());		//s5 - i*s4
+		out[k+3*m]=Complex(s5.real()-s4.imag(), s5.imag()+s4.real());	//s5 + i*s4
+	}
+}
+
+static void Butterfly3(Complex* out, const Complex* tw, long long m)
+{
+	const double sin3=-0.86602540378443864676;		//imaginary part of exp(-2*pi*i/3)
+
+	for(long long k=0; k<m; k++)
+	{
+		Complex s1=Mul(out[k+m],tw[k]);
+		Complex s2=Mul(out[k+2*m],tw[m+k]);
+		Complex sum=s1+s2;
+		Complex diff=(s1-s2)*sin3;
+
+		Complex mid=out[k]-sum*0.5;
+		out[k]+=sum;
+		out[k+m]=Complex(mid.real()-diff.imag(), mid.imag()+diff.real());
+		out[k+2*m]=Complex(mid.real()+diff.imag(), mid.imag()-diff.real());
+	}
+}
+
+static void Butterfly5(Complex* out, const Complex* tw, long long m, const CFftPlan& plan)
+{
+	Complex ya=plan.twiddles[(size_t)(plan.n/5)];		//exp(-2*pi*i/5)
+	Complex yb=plan.twiddles[(size_t)(2*plan.n/5)];		//exp(-4*pi*i/5)
+
+	for(long long u=0; u<m; u++)
+	{
+		Complex s0=out[u];
+		Complex s1=Mul(out[u+m],tw[u]);
+		Complex s2=Mul(out[u+2*m],tw[m+u]);
+		Complex s3=Mul(out[u+3*m],tw[2*m+u]);
+		Complex s4=Mul(out[u+4*m],tw[3*m+u]);
+
+		Complex s7=s1+s4, s10=s1-s4, s8=s2+s3, s9=s2-s3;
+
+		out[u]=s0+s7+s8;
+
+		Complex s5(s0.real()+s7.real()*ya.real()+s8.real()*yb.real(), s0.imag()+s7.imag()*ya.real()+s8.imag()*yb.real());
+		Complex s6(s10.imag()*ya.imag()+s9.imag()*yb.imag(), -s10.real()*ya.imag()-s9.real()*yb.imag());
+		out[u+m]=s5-s6;
+		out[u+4*m]=s5+s6;
+
+		Complex s11(s0.real()+s7.real()*yb.real()+s8.real()*ya.real(), s0.imag()+s7.imag()*yb.real()+s8.imag()*ya.real());
+		Complex s12(-s10.imag()*yb.imag()+s9.imag()*ya.imag(), s10.real()*yb.imag()-s9.real()*ya.imag());
+		out[u+2*m]=s11+s12;
+		out[u+3*m]=s11-s12;
+	}
+}
+
+//Any radix, O(p^2) per group
+static void ButterflyGeneric(Complex* out, long long fstride, const CFftPlan& plan, long long m, long long p)
+{
+	const Complex* tw=plan.twiddles.data();
+	long long n=plan.n;
+	std::vector<Complex> scratch((size_t)p);
+
+	for(long long u=0; u<m; u++)
+	{
+		for(long long q=0; q<p; q++) scratch[(size_t)q]=out[u+q*m];
+
+		for(long long q1=0; q1<p; q1++)
+		{
+			long long k=u+q1*m;
+			long long twIndex=0;
+			Complex sum=scratch[0];
+			for(long long q=1; q<p; q++)
+			{
+				twIndex+=fstride*k;
+				twIndex%=n;
+				sum+=Mul(scratch[(size_t)q],tw[twIndex]);
+			}
+			out[k]=sum;
+		}
+	}
+}
+
+//Recursive decimation in time, out of place from "in" to "out"
+static void Work(Complex* out, const Complex* in, long long fstride, int stage, const CFftPlan& plan)
+{
+	long long p=plan.factors[2*stage];
+	long long m=plan.factors[2*stage+1];
+
+	if(m==1)
+	{
+		for(long long q=0; q<p; q++) out[q]=in[q*fstride];
+	}
+	else
+	{
+		for(long long q=0; q<p; q++) Work(out+q*m, in+q*fstride, fstride*p, stage+1, plan);
+	}
+
+	const Complex* tw=plan.stageTwiddles[stage].data();
+	switch(p)
+	{
+	case 2: Butterfly2(out,tw,m); break;
+	case 3: Butterfly3(out,tw,m); break;
+	case 4: Butterfly4(out,tw,m); break;
+	case 5: Butterfly5(out,tw,m,plan); break;
+	default: ButterflyGeneric(out,fstride,plan,m,p); break;
+	}
+}
+
+void CFft::Forward(Complex* data, long long n)
+{
+	if(n<=1) return;
+
+	std::shared_ptr<const CFftPlan> plan=GetPlan(n);
+	std::vector<Complex> input(data,data+n);
+
+	Work(data,input.data(),1,0,*plan);
+}
+
+void CFft::Inverse(Complex* data, long long n)
+{
+	if(n<=1) return;
+
+	//ifft(x) = conj(fft(conj(x)))/n
+	for(long long i=0; i<n; i++) data[i]=std::conj(data[i]);
+	Forward(data,n);
+
+	double norm=1.0/(double)n;
+	for(long long i=0; i<n; i++) data[i]=std::conj(data[i])*norm;
+}
+
+//Relative to one multiply-add of the (vectorized) direct loop
+//Measured crossover: M~400 for N=5000 and M~1000 for N=1e5
+double CFft::FftConvolutionCost(long long na, long long nb)
+{
+	double len=(double)GoodSize(na+nb-1);
+	return 40*len*log(len)/log(2.0);
+}
+
+void CFft::ConvolveReal(const double* a, long long na, const double* b, long long nb, double* result)
+{
+	if(na<=0 || nb<=0) return;
+
+	long long len=GoodSize(na+nb-1);
+
+	//a goes into the real part, b into the imaginary part
+	std::vector<Complex> z((size_t)len,Complex(0,0));
+	for(long long i=0; i<na; i++) z[(size_t)i]=Complex(a[i],0);
+	for(long long i=0; i<nb; i++) z[(size_t)i]=Complex(z[(size_t)i].real(),b[i]);
+
+	Forward(z.data(),len);
+
+	//Separate the two spectra using the symmetry of real input and multiply them
+	std::vector<Complex> product((size_t)len);
+	for(long long k=0; k<len; k++)
+	{
+		Complex zk=z[(size_t)k];
+		Complex zn=std::conj(z[(size_t)((len-k)%len)]);
+		Complex spectrumA=(zk+zn)*0.5;
+		Complex spectrumB=(zk-zn)*Complex(0,-0.5);
+		product[(size_t)k]=Mul(spectrumA,spectrumB);
+	}
+
+	Inverse(product.data(),len);
+
+	for(long long i=0; i<na+nb-1; i++) result[i]=product[(size_t)i].real();
+}
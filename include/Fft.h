@@ -0,0 +1,64 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Mixed-radix FFT (radix 4, 2, 3, 5 and generic odd factors) with cached plans
+//Plans hold the factorization and the twiddle table and are shared between threads; a few recent sizes are cached
+//Sizes with only factors 2, 3 and 5 are fastest - use GoodSize() when the length can be padded
+
+#pragma once
+#include <complex>
+#include <math.h>
+
+class CFft
+{
+public:
+	typedef std::complex<double> Complex;
+
+	//Smallest even 2^a*3^b*5^c that is not less than minSize
+	static long long GoodSize(long long minSize);
+
+	//In-place transforms, Inverse() includes the 1/n normalization
+	static void Forward(Complex* data, long long n);
+	static void Inverse(Complex* data, long long n);
+
+	//Linear convolution of two real sequences, result must have room for na+nb-1 points
+	//Both sequences are packed into one complex transform
+	static void ConvolveReal(const double* a, long long na, const double* b, long long nb, double* result);
+
+	//Cost estimates in arbitrary but comparable units, used to choose between direct and FFT convolution
+	static double DirectConvolutionCost(long long na, long long nb) {return (double)na*(double)nb;}
+	static double FftConvolutionCost(long long na, long long nb);
+
+	//At most maxPlans plans are cached, the least recently used one is dropped to make room for a new size
+	static void ClearPlans();		//Frees all cached plans
+	static int NumPlans();
+	static void SetMaxPlans(int maxPlans);		//At least 1, 32 by default
+};
+
+//Converts the double result of a transform back to the element type, integer types are rounded
+template <class theType> inline theType FftResultCast(double val) {return (theType)val;}
+template <> inline int FftResultCast<int>(double val) {return (int)floor(val+0.5);}
+template <> inline long long FftResultCast<long long>(double val) {return (long long)floor(val+0.5);}
+template <> inline short FftResultCast<short>(double val) {return (short)floor(val+0.5);}
+template <> inline char FftResultCast<char>(double val) {return (char)floor(val+0.5);}
+template <> inline unsigned int FftResultCast<unsigned int>(double val) {return (unsigned int)floor(val+0.5);}
+template <> inline unsigned char FftResultCast<unsigned char>(double val) {return (unsigned char)floor(val+0.5);}
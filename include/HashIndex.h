@@ -0,0 +1,218 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Open-addressing hash index used by CBidirectionalMap and StdHashMap
+//The table stores only a 32-bit fingerprint of the key and an index into the owner's dense key array,
+//so a probe touches 8 bytes per slot and keys are compared only when fingerprints match
+//Robin Hood insertion keeps probe sequences short; removal shifts the following slots back (no tombstones)
+
+#pragma once
+#include "BString.h"
+#include <vector>
+#include <functional>
+#include <string.h>
+
+//MurmurHash64A by Austin Appleby (public domain)
+inline unsigned long long HashBytes(const void* data, size_t length)
+{
+	const unsigned long long m=0xc6a4a7935bd1e995ULL;
+	const int r=47;
+	unsigned long long h=0x8445d61a4e774912ULL^(length*m);
+
+	const unsigned char* p=(const unsigned char*)data;
+	const unsigned char* end=p+(length/8)*8;
+	for(; p!=end; p+=8)
+	{
+		unsigned long long k;
+		memcpy(&k,p,8);
+		k*=m; k^=k>>r; k*=m;
+		h^=k; h*=m;
+	}
+
+	//Tail bytes, same mixing as the fall-through switch of the reference MurmurHash64A
+	size_t tail=length&7;
+	if(tail)
+	{
+		for(size_t i=tail; i-->0;) h^=(unsigned long long)p[i]<<(8*i);
+		h*=m;
+	}
+
+	h^=h>>r; h*=m; h^=h>>r;
+	return h;
+}
+
+//Hashing and comparison of keys - specialize CHashOf<yourType> for key types without std::hash
+template <class theType> struct CHashOf
+{
+	static unsigned long long Hash(const theType& key) {return (unsigned long long)std::hash<theType>()(key);}
+	static bool Equal(const theType& a, const theType& b) {return a==b;}
+};
+
+//Strings can also be looked up by a char pointer and a length, without a temporary BString
+template <> struct CHashOf<BString>
+{
+	static unsigned long long Hash(const BString& key) {return HashBytes(key.c_str(),key.length());}
+	static unsigned long long Hash(const char* str, size_t length) {return HashBytes(str,length);}
+	static bool Equal(const BString& a, const BString& b) {return a==b;}
+	static bool Equal(const BString& a, const char* str, size_t length)
+	{return a.length()==length && memcmp(a.c_str(),str,length)==0;}
+};
+
+class CHashIndex
+{
+public:
+	CHashIndex(): mask(0), count(0) {}
+
+	//Mixes the hash, so that identity hashes of integers spread over the table too
+	static unsigned int Fingerprint(unsigned long long hash) {return (unsigned int)((hash*0x9E3779B97F4A7C15ULL)>>32);}
+
+	int Count() const {return count;}
+	void Clear();							//Keeps the capacity
+	void Reserve(int numKeys);
+
+	//Index stored under this fingerprint for which isKey(index) is true, -1 if none
+	template <class equalType> int Find(unsigned int fingerprint, equalType isKey) const;
+	void Insert(unsigned int fingerprint, int index);						//The key must not be present yet
+	void Erase(unsigned int fingerprint, int index);
+	void Reindex(unsigned int fingerprint, int oldIndex, int newIndex);		//The key moved in the owner's array
+
+private:
+	struct Slot
+	{
+		unsigned int fingerprint;
+		int index;				//-1 for an empty slot
+	};
+
+	unsigned int Distance(unsigned int pos) const {return (pos-slots[pos].fingerprint)&mask;}	//From the ideal slot
+	int FindSlot(unsigned int fingerprint, int index) const;
+	void Rehash(size_t newCapacity);
+
+	std::vector<Slot> slots;		//Power of two, at most 4/5 full
+	unsigned int mask;
+	int count;
+};
+
+inline void CHashIndex::Clear()
+{
+	for(auto& cur : slots) cur.index=-1;
+	count=0;
+}
+
+inline void CHashIndex::Reserve(int numKeys)
+{
+	size_t capacity=16;
+	while(capacity*4<(size_t)numKeys*5) capacity*=2;
+	if(capacity>slots.size()) Rehash(capacity);
+}
+
+inline void CHashIndex::Rehash(size_t newCapacity)
+{
+	std::vector<Slot> oldSlots;
+	oldSlots.swap(slots);
+
+	Slot empty={0,-1};
+	slots.assign(newCapacity,empty);
+	mask=(unsigned int)(newCapacity-1);
+	count=0;
+
+	for(auto& cur : oldSlots) if(cur.index>=0) Insert(cur.fingerprint,cur.index);
+}
+
+template <class equalType>
+int CHashIndex::Find(unsigned int fingerprint, equalType isKey) const
+{
+	if(count==0) return -1;
+
+	unsigned int pos=fingerprint&mask;
+	for(unsigned int dist=0;;dist++)
+	{
+		const Slot& cur=slots[pos];
+		if(cur.index<0 || Distance(pos)<dist) return -1;		//A present key would have displaced this slot
+		if(cur.fingerprint==fingerprint && isKey(cur.index)) return cur.index;
+		pos=(pos+1)&mask;
+	}
+}
+
+inline void CHashIndex::Insert(unsigned int fingerprint, int index)
+{
+	if((size_t)(count+1)*5>slots.size()*4) Rehash(slots.empty() ? 16 : slots.size()*2);
+
+	//Robin Hood: the entry farther from its ideal slot keeps the slot, the other one moves on
+	Slot cur={fingerprint,index};
+	unsigned int pos=fingerprint&mask;
+	for(unsigned int dist=0;;dist++)
+	{
+		Slot& slot=slots[pos];
+		if(slot.index<0)
+		{
+			slot=cur;
+			count++;
+			return;
+		}
+
+		unsigned int slotDist=Distance(pos);
+		if(slotDist<dist)
+		{
+			std::swap(slot,cur);
+			dist=slotDist;
+		}
+		pos=(pos+1)&mask;
+	}
+}
+
+inline int CHashIndex::FindSlot(unsigned int fingerprint, int index) const
+{
+	if(count==0) return -1;
+
+	unsigned int pos=fingerprint&mask;
+	for(unsigned int dist=0;;dist++)
+	{
+		const Slot& cur=slots[pos];
+		if(cur.index<0 || Distance(pos)<dist) return -1;
+		if(cur.index==index) return (int)pos;
+		pos=(pos+1)&mask;
+	}
+}
+
+inline void CHashIndex::Erase(unsigned int fingerprint, int index)
+{
+	int found=FindSlot(fingerprint,index);
+	if(found<0) return;
+
+	//Shift the following displaced slots one step back, so no tombstone is needed
+	unsigned int pos=(unsigned int)found;
+	unsigned int next=(pos+1)&mask;
+	while(slots[next].index>=0 && Distance(next)>0)
+	{
+		slots[pos]=slots[next];
+		pos=next;
+		next=(next+1)&mask;
+	}
+	slots[pos].index=-1;
+	count--;
+}
+
+inline void CHashIndex::Reindex(unsigned int fingerprint, int oldIndex, int newIndex)
+{
+	int found=FindSlot(fingerprint,oldIndex);
+	if(found>=0) slots[found].index=newIndex;
+}
@@ -0,0 +1,329 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//K-means engine used by CMatrix::KmeansClustering
+//
+//Cluster() - full-batch k-means: k-means++ seeding, then Lloyd iterations with Hamerly's bounds
+//(an upper bound on the distance to the own center and a lower bound on the distance to any other one),
+//so most points skip the distance computations once the centers settle down
+//Assignment runs on CParallelSort threads, each thread keeps the changes of the center sums for the points it moved
+//
+//UpdateMiniBatch() - mini-batch k-means (Sculley) for data that arrives in portions, e.g. spectra as they
+//are acquired: every batch moves the centers towards its points with per-center learning rates 1/count
+//
+//Points and centers are stored in columns (column-major, numCoords values per point)
+
+#pragma once
+#include "Array.h"
+#include "ParallelSort.h"
+#include <math.h>
+#include <random>
+#include <vector>
+
+template <class theType, class intType=int> class CKmeans
+{
+public:
+	CKmeans(intType theNumCoords, intType theK, unsigned long long seed=1):
+		numCoords(theNumCoords),k(theK),centers(theNumCoords*theK,true),counts(theK,true),rng(seed),fSeeded(false)
+		{centers=0; counts=0;};
+
+	//Clusters numPoints points from scratch; clustering receives the center number of every point
+	//False if there are fewer points than clusters
+	bool Cluster(const theType* data, intType numPoints, CHArray<intType,intType>& clustering, int maxIterations=300);
+
+	//Moves the centers towards a batch of points; the first batch seeds the centers and needs at least k points
+	bool UpdateMiniBatch(const theType* batch, intType batchSize);
+
+	//Nearest center of every point
+	void Assign(const theType* data, intType numPoints, CHArray<intType,intType>& clustering) const;
+
+	const theType* Center(intType num) const {return centers.arr+num*numCoords;};
+	const CHArray<theType,intType>& Centers() const {return centers;};	//numCoords x k, column-major
+	int64 Count(intType num) const {return counts.arr[num];};			//Points in the cluster (all batches so far)
+	int NumIterations() const {return numIterations;};					//Lloyd iterations in the last Cluster()
+
+private:
+	//k-means++: every next center is drawn with probability proportional to the squared distance to the nearest one
+	void SeedCenters(const theType* data, intType numPoints);
+
+	//Nearest and second nearest center
+	void FindNearest(const theType* point, intType& nearest, double& nearestDist, double& secondDist) const;
+
+	static int NumThreads(double work) {return (work<(1<<21)) ? 1 : CParallelSort::NumThreads();};
+
+	intType numCoords;
+	intType k;
+	CHArray<theType,intType> centers;
+	CHArray<int64,intType> counts;
+	std::mt19937_64 rng;
+	bool fSeeded;
+	int numIterations;
+};
+
+template <class theType, class intType>
+void CKmeans<theType,intType>::FindNearest(const theType* point, intType& nearest, double& nearestDist, double& secondDist) const
+{
+	nearest=0;
+	nearestDist=secondDist=HUGE_VAL;
+	for(intType j=0; j<k; j++)
+	{
+		double dist=(double)CArrayKernel<theType>::SquaredDistance(point,centers.arr+j*numCoords,numCoords);
+		if(dist<nearestDist) {secondDist=nearestDist; nearestDist=dist; nearest=j;}
+		else if(dist<secondDist) secondDist=dist;
+	}
+	nearestDist=sqrt(nearestDist);
+	secondDist=sqrt(secondDist);
+}
+
+template <class theType, class intType>
+void CKmeans<theType,intType>::SeedCenters(const theType* data, intType numPoints)
+{
+	std::vector<double> minDist((size_t)numPoints);
+	int threads=NumThreads((double)numPoints*numCoords);
+	std::vector<double> threadSums((size_t)threads);
+
+	//Squared distances to the nearest chosen center, updated after every new center
+	auto update=[&](intType center, bool fFirst)
+	{
+		const theType* c=centers.arr+center*numCoords;
+		CParallelSort::ParallelFor(threads,[&](int t)
+		{
+			intType from=(intType)((int64)numPoints*t/threads), to=(intType)((int64)numPoints*(t+1)/threads);
+			double sum=0;
+			for(intType i=from; i<to; i++)
+			{
+				double dist=(double)CArrayKernel<theType>::SquaredDistance(data+(int64)i*numCoords,c,numCoords);
+				if(fFirst || dist<minDist[(size_t)i]) minDist[(size_t)i]=dist;
+				sum+=minDist[(size_t)i];
+			}
+			threadSums[(size_t)t]=sum;
+		});
+	};
+
+	intType first=(intType)(rng()%(unsigned long long)numPoints);
+	memcpy(centers.arr,data+(int64)first*numCoords,sizeof(theType)*numCoords);
+	update(0,true);
+
+	for(intType j=1; j<k; j++)
+	{
+		double total=0;
+		for(int t=0; t<threads; t++) total+=threadSums[(size_t)t];
+
+		//Point with cumulative weight just above the random target, found thread block first
+		intType chosen=numPoints-1;
+		if(total>0)
+		{
+			double target=std::uniform_real_distribution<double>(0,total)(rng);
+			int t=0;
+			while(t<threads-1 && target>=threadSums[(size_t)t]) target-=threadSums[(size_t)t++];
+			intType from=(intType)((int64)numPoints*t/threads), to=(intType)((int64)numPoints*(t+1)/threads);
+			for(intType i=from; i<to; i++)
+			{
+				target-=minDist[(size_t)i];
+				if(target<0) {chosen=i; break;}
+			}
+			if(target>=0) chosen=to-1;
+		}
+		else chosen=(intType)(rng()%(unsigned long long)numPoints);		//All points coincide with the centers
+
+		memcpy(centers.arr+j*numCoords,data+(int64)chosen*numCoords,sizeof(theType)*numCoords);
+		update(j,false);
+	}
+
+	fSeeded=true;
+}
+
+template <class theType, class intType>
+bool CKmeans<theType,intType>::Cluster(const theType* data, intType numPoints, CHArray<intType,intType>& clustering, int maxIterations)
+{
+	numIterations=0;
+	if(k<1 || numPoints<k) return false;
+
+	SeedCenters(data,numPoints);
+	clustering.ResizeArray(numPoints,true);
+
+	//Hamerly's bounds: upper - distance to the own center, lower - to the second closest one
+	std::vector<double> upper((size_t)numPoints), lower((size_t)numPoints);
+	std::vector<double> sums((size_t)k*numCoords,0), halfGap((size_t)k), moved((size_t)k);
+	counts=0;
+
+	int threads=NumThreads((double)numPoints*numCoords*k);
+	intType* assigned=clustering.arr;
+
+	//Initial assignment, all distances
+	CParallelSort::ParallelFor(threads,[&](int t)
+	{
+		intType from=(intType)((int64)numPoints*t/threads), to=(intType)((int64)numPoints*(t+1)/threads);
+		for(intType i=from; i<to; i++)
+			FindNearest(data+(int64)i*numCoords,assigned[i],upper[(size_t)i],lower[(size_t)i]);
+	});
+	for(intType i=0; i<numPoints; i++)
+	{
+		const theType* point=data+(int64)i*numCoords;
+		double* sum=&sums[(size_t)assigned[i]*numCoords];
+		for(intType d=0; d<numCoords; d++) sum[d]+=point[d];
+		counts.arr[assigned[i]]++;
+	}
+
+	//Changes of the sums and counts from the points that one thread moved
+	std::vector<std::vector<double> > sumChanges((size_t)threads);
+	std::vector<std::vector<int64> > countChanges((size_t)threads);
+	std::vector<intType> numChanged((size_t)threads);
+
+	bool fConverged=false;
+	while(numIterations<maxIterations)
+	{
+		numIterations++;
+
+		//New centers (empty clusters keep theirs) and how far they moved
+		double maxMove=0, secondMove=0;
+		intType maxMoved=0;
+		for(intType j=0; j<k; j++)
+		{
+			theType* c=centers.arr+j*numCoords;
+			double move=0;
+			if(counts.arr[j]>0)
+			{
+				double scale=1.0/(double)counts.arr[j];
+				const double* sum=&sums[(size_t)j*numCoords];
+				for(intType d=0; d<numCoords; d++)
+				{
+					theType newVal=(theType)(sum[d]*scale);
+					double diff=(double)newVal-(double)c[d];
+					move+=diff*diff;
+					c[d]=newVal;
+				}
+			}
+			moved[(size_t)j]=move=sqrt(move);
+			if(move>maxMove) {secondMove=maxMove; maxMove=move; maxMoved=j;}
+			else if(move>secondMove) secondMove=move;
+		}
+
+		if(fConverged) break;
+
+		//Half the distance to the closest other center - points closer than that to their own stay put
+		for(intType j=0; j<k; j++)
+		{
+			double closest=HUGE_VAL;
+			for(intType other=0; other<k; other++)
+			{
+				if(other==j) continue;
+				double dist=(double)CArrayKernel<theType>::SquaredDistance(centers.arr+j*numCoords,centers.arr+other*numCoords,numCoords);
+				if(dist<closest) closest=dist;
+			}
+			halfGap[(size_t)j]=0.5*sqrt(closest);
+		}
+
+		CParallelSort::ParallelFor(threads,[&](int t)
+		{
+			std::vector<double>& sumChange=sumChanges[(size_t)t];
+			std::vector<int64>& countChange=countChanges[(size_t)t];
+			sumChange.assign((size_t)k*numCoords,0);
+			countChange.assign((size_t)k,0);
+			numChanged[(size_t)t]=0;
+
+			intType from=(intType)((int64)numPoints*t/threads), to=(intType)((int64)numPoints*(t+1)/threads);
+			for(intType i=from; i<to; i++)
+			{
+				intType own=assigned[i];
+				double& up=upper[(size_t)i];
+				double& low=lower[(size_t)i];
+
+				//Bounds follow the centers
+				up+=moved[(size_t)own];
+				low-=(own==maxMoved) ? secondMove : maxMove;
+
+				double bound=std::max(halfGap[(size_t)own],low);
+				if(up<=bound) continue;
+
+				const theType* point=data+(int64)i*numCoords;
+				up=sqrt((double)CArrayKernel<theType>::SquaredDistance(point,centers.arr+own*numCoords,numCoords));
+				if(up<=bound) continue;
+
+				intType nearest;
+				FindNearest(point,nearest,up,low);
+				if(nearest==own) continue;
+
+				assigned[i]=nearest;
+				numChanged[(size_t)t]++;
+				countChange[(size_t)own]--;
+				countChange[(size_t)nearest]++;
+				double* sumFrom=&sumChange[(size_t)own*numCoords];
+				double* sumTo=&sumChange[(size_t)nearest*numCoords];
+				for(intType d=0; d<numCoords; d++) {sumFrom[d]-=point[d]; sumTo[d]+=point[d];}
+			}
+		});
+
+		intType totalChanged=0;
+		for(int t=0; t<threads; t++)
+		{
+			totalChanged+=numChanged[(size_t)t];
+			if(!numChanged[(size_t)t]) continue;
+			for(size_t i=0; i<sums.size(); i++) sums[i]+=sumChanges[(size_t)t][i];
+			for(intType j=0; j<k; j++) counts.arr[j]+=countChanges[(size_t)t][(size_t)j];
+		}
+
+		//One more pass over the centers brings them in line with the final assignment
+		if(!totalChanged) fConverged=true;
+	}
+
+	return true;
+}
+
+template <class theType, class intType>
+void CKmeans<theType,intType>::Assign(const theType* data, intType numPoints, CHArray<intType,intType>& clustering) const
+{
+	clustering.ResizeArray(numPoints,true);
+	int threads=NumThreads((double)numPoints*numCoords*k);
+	CParallelSort::ParallelFor(threads,[&](int t)
+	{
+		intType from=(intType)((int64)numPoints*t/threads), to=(intType)((int64)numPoints*(t+1)/threads);
+		double nearestDist, secondDist;
+		for(intType i=from; i<to; i++) FindNearest(data+(int64)i*numCoords,clustering.arr[i],nearestDist,secondDist);
+	});
+}
+
+template <class theType, class intType>
+bool CKmeans<theType,intType>::UpdateMiniBatch(const theType* batch, intType batchSize)
+{
+	if(!fSeeded)
+	{
+		if(k<1 || batchSize<k) return false;
+		SeedCenters(batch,batchSize);
+		counts=0;
+	}
+
+	CHArray<intType,intType> nearest;
+	Assign(batch,batchSize,nearest);
+
+	//Gradient step per point, the learning rate of a center decreases as it gathers points
+	for(intType i=0; i<batchSize; i++)
+	{
+		intType j=nearest.arr[i];
+		theType rate=(theType)(1.0/(double)(++counts.arr[j]));
+		theType* c=centers.arr+j*numCoords;
+		const theType* point=batch+(int64)i*numCoords;
+		for(intType d=0; d<numCoords; d++) c[d]+=rate*(point[d]-c[d]);
+	}
+
+	return true;
+}
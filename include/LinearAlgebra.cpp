@@ -0,0 +1,833 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "LinearAlgebra.h"
+#include "ArrayKernels.h"
+#include "ParallelSort.h"
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define LINALG_X86
+#include <immintrin.h>
+#endif
+
+//Same rules as in ArrayKernels.cpp: GCC needs target attributes, MSVC has AVX-512 intrinsics since VS2017
+#ifdef __GNUC__
+#define LINALG_AVX2 __attribute__((target("avx2,fma")))
+#define LINALG_AVX512 __attribute__((target("avx512f")))
+#define LINALG_HAS_AVX512
+#else
+#define LINALG_AVX2
+#define LINALG_AVX512
+#if defined(_MSC_VER) && _MSC_VER>=1910
+#define LINALG_HAS_AVX512
+#endif
+#endif
+
+#ifdef LABGENIE_NO_MKL
+static int linAlgBackend=CLinearAlgebra::backend_native;
+#else
+static int linAlgBackend=CLinearAlgebra::backend_mkl;
+#endif
+
+bool CLinearAlgebra::HasMkl()
+{
+#ifdef LABGENIE_NO_MKL
+	return false;
+#else
+	return true;
+#endif
+}
+
+int CLinearAlgebra::Backend() {return linAlgBackend;}
+
+void CLinearAlgebra::SetBackend(int backend)
+{
+	if(backend==backend_mkl && !HasMkl()) return;
+	linAlgBackend=backend;
+}
+
+//////////////////////////////////////////////////////////////////
+//Micro-kernels: c[mr x nr] += alpha * a-panel . b-panel
+//Panels are packed: kc steps of mr values of A, kc steps of nr values of B
+//m, n - the part of the tile that is inside C
+
+template <class theType>
+struct CGemmKernel
+{
+	typedef void (*funcType)(long long kc, const theType* a, const theType* b, theType* c, long long ldc,
+								theType alpha, long long m, long long n);
+	int mr;
+	int nr;
+	funcType func;
+};
+
+//Adds alpha*acc (column-major mr x nr) to the m x n corner of c
+template <class theType>
+static void AddTile(const theType* acc, int mr, theType* c, long long ldc, theType alpha, long long m, long long n)
+{
+	for(long long j=0; j<n; j++)
+		for(long long i=0; i<m; i++) c[i+j*ldc]+=alpha*acc[i+j*mr];
+}
+
+template <class theType, int mr, int nr>
+static void KernelPlain(long long kc, const theType* a, const theType* b, theType* c, long long ldc,
+							theType alpha, long long m, long long n)
+{
+	theType acc[mr*nr]={0};
+	for(long long p=0; p<kc; p++)
+	{
+		for(int j=0; j<nr; j++)
+		{
+			theType bj=b[j];
+			for(int i=0; i<mr; i++) acc[i+j*mr]+=a[i]*bj;
+		}
+		a+=mr;
+		b+=nr;
+	}
+	AddTile(acc,mr,c,ldc,alpha,m,n);
+}
+
+#ifdef LINALG_X86
+
+//8 x 6 doubles: 12 accumulators of 4
+LINALG_AVX2 static void KernelAvx2(long long kc, const double* a, const double* b, double* c, long long ldc,
+									double alpha, long long m, long long n)
+{
+	__m256d acc[6][2];
+	for(int j=0; j<6; j++) acc[j][0]=acc[j][1]=_mm256_setzero_pd();
+
+	for(long long p=0; p<kc; p++)
+	{
+		__m256d a0=_mm256_loadu_pd(a);
+		__m256d a1=_mm256_loadu_pd(a+4);
+		for(int j=0; j<6; j++)
+		{
+			__m256d bj=_mm256_broadcast_sd(b+j);
+			acc[j][0]=_mm256_fmadd_pd(a0,bj,acc[j][0]);
+			acc[j][1]=_mm256_fmadd_pd(a1,bj,acc[j][1]);
+		}
+		a+=8;
+		b+=6;
+	}
+
+	__m256d alphaVec=_mm256_set1_pd(alpha);
+	if(m==8 && n==6)
+	{
+		for(int j=0; j<6; j++)
+		{
+			double* cj=c+j*ldc;
+			_mm256_storeu_pd(cj,_mm256_fmadd_pd(alphaVec,acc[j][0],_mm256_loadu_pd(cj)));
+			_mm256_storeu_pd(cj+4,_mm256_fmadd_pd(alphaVec,acc[j][1],_mm256_loadu_pd(cj+4)));
+		}
+		return;
+	}
+
+	double tile[8*6];
+	for(int j=0; j<6; j++)
+	{
+		_mm256_storeu_pd(tile+j*8,acc[j][0]);
+		_mm256_storeu_pd(tile+j*8+4,acc[j][1]);
+	}
+	AddTile(tile,8,c,ldc,alpha,m,n);
+}
+
+//16 x 6 floats
+LINALG_AVX2 static void KernelAvx2(long long kc, const float* a, const float* b, float* c, long long ldc,
+									float alpha, long long m, long long n)
+{
+	__m256 acc[6][2];
+	for(int j=0; j<6; j++) acc[j][0]=acc[j][1]=_mm256_setzero_ps();
+
+	for(long long p=0; p<kc; p++)
+	{
+		__m256 a0=_mm256_loadu_ps(a);
+		__m256 a1=_mm256_loadu_ps(a+8);
+		for(int j=0; j<6; j++)
+		{
+			__m256 bj=_mm256_broadcast_ss(b+j);
+			acc[j][0]=_mm256_fmadd_ps(a0,bj,acc[j][0]);
+			acc[j][1]=_mm256_fmadd_ps(a1,bj,acc[j][1]);
+		}
+		a+=16;
+		b+=6;
+	}
+
+	__m256 alphaVec=_mm256_set1_ps(alpha);
+	if(m==16 && n==6)
+	{
+		for(int j=0; j<6; j++)
+		{
+			float* cj=c+j*ldc;
+			_mm256_storeu_ps(cj,_mm256_fmadd_ps(alphaVec,acc[j][0],_mm256_loadu_ps(cj)));
+			_mm256_storeu_ps(cj+8,_mm256_fmadd_ps(alphaVec,acc[j][1],_mm256_loadu_ps(cj+8)));
+		}
+		return;
+	}
+
+	float tile[16*6];
+	for(int j=0; j<6; j++)
+	{
+		_mm256_storeu_ps(tile+j*16,acc[j][0]);
+		_mm256_storeu_ps(tile+j*16+8,acc[j][1]);
+	}
+	AddTile(tile,16,c,ldc,alpha,m,n);
+}
+
+#ifdef LINALG_HAS_AVX512
+
+//16 x 12 doubles: 24 accumulators of 8
+LINALG_AVX512 static void KernelAvx512(long long kc, const double* a, const double* b, double* c, long long ldc,
+										double alpha, long long m, long long n)
+{
+	__m512d acc[12][2];
+	for(int j=0; j<12; j++) acc[j][0]=acc[j][1]=_mm512_setzero_pd();
+
+	for(long long p=0; p<kc; p++)
+	{
+		__m512d a0=_mm512_loadu_pd(a);
+		__m512d a1=_mm512_loadu_pd(a+8);
+		for(int j=0; j<12; j++)
+		{
+			__m512d bj=_mm512_set1_pd(b[j]);
+			acc[j][0]=_mm512_fmadd_pd(a0,bj,acc[j][0]);
+			acc[j][1]=_mm512_fmadd_pd(a1,bj,acc[j][1]);
+		}
+		a+=16;
+		b+=12;
+	}
+
+	__m512d alphaVec=_mm512_set1_pd(alpha);
+	if(m==16 && n==12)
+	{
+		for(int j=0; j<12; j++)
+		{
+			double* cj=c+j*ldc;
+			_mm512_storeu_pd(cj,_mm512_fmadd_pd(alphaVec,acc[j][0],_mm512_loadu_pd(cj)));
+			_mm512_storeu_pd(cj+8,_mm512_fmadd_pd(alphaVec,acc[j][1],_mm512_loadu_pd(cj+8)));
+		}
+		return;
+	}
+
+	double tile[16*12];
+	for(int j=0; j<12; j++)
+	{
+		_mm512_storeu_pd(tile+j*16,acc[j][0]);
+		_mm512_storeu_pd(tile+j*16+8,acc[j][1]);
+	}
+	AddTile(tile,16,c,ldc,alpha,m,n);
+}
+
+//32 x 12 floats
+LINALG_AVX512 static void KernelAvx512(long long kc, const float* a, const float* b, float* c, long long ldc,
+										float alpha, long long m, long long n)
+{
+	__m512 acc[12][2];
+	for(int j=0; j<12; j++) acc[j][0]=acc[j][1]=_mm512_setzero_ps();
+
+	for(long long p=0; p<kc; p++)
+	{
+		__m512 a0=_mm512_loadu_ps(a);
+		__m512 a1=_mm512_loadu_ps(a+16);
+		for(int j=0; j<12; j++)
+		{
+			__m512 bj=_mm512_set1_ps(b[j]);
+			acc[j][0]=_mm512_fmadd_ps(a0,bj,acc[j][0]);
+			acc[j][1]=_mm512_fmadd_ps(a1,bj,acc[j][1]);
+		}
+		a+=32;
+		b+=12;
+	}
+
+	__m512 alphaVec=_mm512_set1_ps(alpha);
+	if(m==32 && n==12)
+	{
+		for(int j=0; j<12; j++)
+		{
+			float* cj=c+j*ldc;
+			_mm512_storeu_ps(cj,_mm512_fmadd_ps(alphaVec,acc[j][0],_mm512_loadu_ps(cj)));
+			_mm512_storeu_ps(cj+16,_mm512_fmadd_ps(alphaVec,acc[j][1],_mm512_loadu_ps(cj+16)));
+		}
+		return;
+	}
+
+	float tile[32*12];
+	for(int j=0; j<12; j++)
+	{
+		_mm512_storeu_ps(tile+j*32,acc[j][0]);
+		_mm512_storeu_ps(tile+j*32+16,acc[j][1]);
+	}
+	AddTile(tile,32,c,ldc,alpha,m,n);
+}
+
+#endif	//LINALG_HAS_AVX512
+#endif	//LINALG_X86
+
+template <class theType>
+static CGemmKernel<theType> PickKernel()
+{
+	//Panel heights are in units of 4 doubles (8 floats) per vector
+	const int scale=(int)(sizeof(double)/sizeof(theType));
+	CGemmKernel<theType> kernel;
+	int level=CArrayKernels::Level();
+
+#ifdef LINALG_X86
+#ifdef LINALG_HAS_AVX512
+	if(level>=CArrayKernels::level_avx512)
+	{
+		kernel.mr=16*scale;
+		kernel.nr=12;
+		kernel.func=&KernelAvx512;
+		return kernel;
+	}
+#endif
+	if(level>=CArrayKernels::level_avx2)
+	{
+		kernel.mr=8*scale;
+		kernel.nr=6;
+		kernel.func=&KernelAvx2;
+		return kernel;
+	}
+#endif
+
+	(void)level;
+	if(scale==1) {kernel.mr=4; kernel.nr=4; kernel.func=&KernelPlain<theType,4,4>;}
+	else {kernel.mr=8; kernel.nr=4; kernel.func=&KernelPlain<theType,8,4>;}
+	return kernel;
+}
+
+//////////////////////////////////////////////////////////////////
+//Blocked product on one thread
+
+//Cache blocking: a kc x nc panel of B stays in L3, an mc x kc block of A in L2
+static const long long blockK=256;
+static const long long blockM=192;
+static const long long blockN=3072;
+
+//Below this many multiply-adds everything runs on the calling thread
+static const long long minParallelWork=1<<21;
+
+//Element (i,p) of op(A)
+template <class theType>
+static inline theType OpElement(const theType* A, long long lda, bool fTrans, long long i, long long p)
+{
+	return fTrans ? A[p+i*lda] : A[i+p*lda];
+}
+
+//mc x kc block of op(A) into panels of mr rows, zero-padded
+template <class theType>
+static void PackA(const theType* A, long long lda, bool fTrans, long long mc, long long kc, int mr, theType* dst)
+{
+	for(long long i=0; i<mc; i+=mr)
+	{
+		long long rows=std::min<long long>(mr,mc-i);
+		for(long long p=0; p<kc; p++)
+		{
+			if(!fTrans && rows==mr) memcpy(dst,A+i+p*lda,mr*sizeof(theType));
+			else
+			{
+				long long ii=0;
+				for(; ii<rows; ii++) dst[ii]=OpElement(A,lda,fTrans,i+ii,p);
+				for(; ii<mr; ii++) dst[ii]=0;
+			}
+			dst+=mr;
+		}
+	}
+}
+
+//kc x nc block of op(B) into panels of nr columns, zero-padded
+template <class theType>
+static void PackB(const theType* B, long long ldb, bool fTrans, long long kc, long long nc, int nr, theType* dst)
+{
+	for(long long j=0; j<nc; j+=nr)
+	{
+		long long numCols=std::min<long long>(nr,nc-j);
+		for(long long p=0; p<kc; p++)
+		{
+			long long jj=0;
+			//op(B)(p,j) is B[j+p*ldb] when transposed, B[p+j*ldb] otherwise
+			for(; jj<numCols; jj++) dst[jj]=fTrans ? B[(j+jj)+p*ldb] : B[p+(j+jj)*ldb];
+			for(; jj<nr; jj++) dst[jj]=0;
+			dst+=nr;
+		}
+	}
+}
+
+template <class theType>
+static void ScaleMatrix(long long m, long long n, theType beta, theType* C, long long ldc)
+{
+	if(beta==(theType)1) return;
+	for(long long j=0; j<n; j++)
+	{
+		theType* cj=C+j*ldc;
+		if(beta==(theType)0) memset(cj,0,(size_t)m*sizeof(theType));	//BLAS convention - C is not read at all
+		else for(long long i=0; i<m; i++) cj[i]*=beta;
+	}
+}
+
+//C += alpha*op(A).op(B), one thread
+template <class theType>
+static void GemmSerial(bool fTransA, bool fTransB, long long m, long long n, long long k,
+						theType alpha, const theType* A, long long lda, const theType* B, long long ldb,
+						theType* C, long long ldc)
+{
+	if(m<=0 || n<=0 || k<=0 || alpha==(theType)0) return;
+
+	CGemmKernel<theType> kernel=PickKernel<theType>();
+	long long mr=kernel.mr, nr=kernel.nr;
+
+	long long mcMax=std::min(m,blockM);
+	long long ncMax=std::min(n,blockN);
+	long long kcMax=std::min(k,blockK);
+	std::vector<theType> packedA((size_t)(((mcMax+mr-1)/mr)*mr*kcMax));
+	std::vector<theType> packedB((size_t)(((ncMax+nr-1)/nr)*nr*kcMax));
+
+	for(long long jc=0; jc<n; jc+=blockN)
+	{
+		long long nc=std::min(blockN,n-jc);
+		for(long long pc=0; pc<k; pc+=blockK)
+		{
+			long long kc=std::min(blockK,k-pc);
+			const theType* curB=fTransB ? B+jc+pc*ldb : B+pc+jc*ldb;
+			PackB(curB,ldb,fTransB,kc,nc,(int)nr,&packedB[0]);
+
+			for(long long ic=0; ic<m; ic+=blockM)
+			{
+				long long mc=std::min(blockM,m-ic);
+				const theType* curA=fTransA ? A+pc+ic*lda : A+ic+pc*lda;
+				PackA(curA,lda,fTransA,mc,kc,(int)mr,&packedA[0]);
+
+				for(long long jr=0; jr<nc; jr+=nr)
+				{
+					const theType* panelB=&packedB[(size_t)(jr*kc)];
+					for(long long ir=0; ir<mc; ir+=mr)
+					{
+						kernel.func(kc,&packedA[(size_t)(ir*kc)],panelB,C+(ic+ir)+(jc+jr)*ldc,ldc,alpha,
+									std::min(mr,mc-ir),std::min(nr,nc-jr));
+					}
+				}
+			}
+		}
+	}
+}
+
+//Splits C into row or column stripes, one per thread
+template <class theType>
+static void GemmParallel(bool fTransA, bool fTransB, long long m, long long n, long long k,
+							theType alpha, const theType* A, long long lda, const theType* B, long long ldb,
+							theType beta, theType* C, long long ldc)
+{
+	if(m<=0 || n<=0) return;
+
+	double work=(double)m*(double)n*(double)std::max(k,1LL);
+	int threads=(work<minParallelWork) ? 1 : CParallelSort::NumThreads();
+
+	CGemmKernel<theType> kernel=PickKernel<theType>();
+	bool fSplitCols=(n>=m);
+	long long length=fSplitCols ? n : m;
+	long long unit=fSplitCols ? kernel.nr : kernel.mr;
+	long long numUnits=(length+unit-1)/unit;
+	if(threads>numUnits) threads=(int)numUnits;
+
+	CParallelSort::ParallelFor(threads,[&](int t)
+	{
+		long long from=std::min(length,numUnits*t/threads*unit);
+		long long to=std::min(length,numUnits*(t+1)/threads*unit);
+		if(from>=to) return;
+
+		if(fSplitCols)
+		{
+			theType* curC=C+from*ldc;
+			ScaleMatrix(m,to-from,beta,curC,ldc);
+			GemmSerial(fTransA,fTransB,m,to-from,k,alpha,A,lda,fTransB ? B+from : B+from*ldb,ldb,curC,ldc);
+		}
+		else
+		{
+			theType* curC=C+from;
+			ScaleMatrix(to-from,n,beta,curC,ldc);
+			GemmSerial(fTransA,fTransB,to-from,n,k,alpha,fTransA ? A+from*lda : A+from,lda,B,ldb,curC,ldc);
+		}
+	});
+}
+
+void CLinearAlgebra::Gemm(bool fTransA, bool fTransB, long long m, long long n, long long k,
+					double alpha, const double* A, long long lda, const double* B, long long ldb,
+					double beta, double* C, long long ldc)
+{GemmParallel(fTransA,fTransB,m,n,k,alpha,A,lda,B,ldb,beta,C,ldc);}
+
+void CLinearAlgebra::Gemm(bool fTransA, bool fTransB, long long m, long long n, long long k,
+					float alpha, const float* A, long long lda, const float* B, long long ldb,
+					float beta, float* C, long long ldc)
+{GemmParallel(fTransA,fTransB,m,n,k,alpha,A,lda,B,ldb,beta,C,ldc);}
+
+//////////////////////////////////////////////////////////////////
+//Syrk: tiles of the lower triangle are shared out between threads, then mirrored
+
+template <class theType>
+static void SyrkParallel(bool fTrans, long long n, long long k, theType alpha, const theType* A, long long lda,
+							theType beta, theType* C, long long ldc)
+{
+	if(n<=0) return;
+
+	const long long tile=256;
+	long long numTiles=(n+tile-1)/tile;
+	long long numPairs=numTiles*(numTiles+1)/2;
+
+	double work=(double)n*(double)n*(double)std::max(k,1LL)/2;
+	int threads=(work<minParallelWork) ? 1 : CParallelSort::NumThreads();
+	if(threads>numPairs) threads=(int)numPairs;
+
+	std::atomic<long long> nextPair(0);
+	CParallelSort::ParallelFor(threads,[&](int)
+	{
+		while(true)
+		{
+			long long pair=nextPair++;
+			if(pair>=numPairs) break;
+
+			//Pair number -> (row tile >= column tile)
+			long long ti=0;
+			while((ti+1)*(ti+2)/2<=pair) ti++;
+			long long tj=pair-ti*(ti+1)/2;
+
+			long long i0=ti*tile, j0=tj*tile;
+			long long rowsInTile=std::min(tile,n-i0), colsInTile=std::min(tile,n-j0);
+			theType* curC=C+i0+j0*ldc;
+
+			ScaleMatrix(rowsInTile,colsInTile,beta,curC,ldc);
+
+			//Rows i0.. of op(A) times the transpose of rows j0.. of op(A)
+			const theType* rowsA=fTrans ? A+i0*lda : A+i0;
+			const theType* rowsB=fTrans ? A+j0*lda : A+j0;
+			GemmSerial(fTrans,!fTrans,rowsInTile,colsInTile,k,alpha,rowsA,lda,rowsB,lda,curC,ldc);
+		}
+	});
+
+	for(long long j=1; j<n; j++)
+		for(long long i=0; i<j; i++) C[i+j*ldc]=C[j+i*ldc];
+}
+
+void CLinearAlgebra::Syrk(bool fTrans, long long n, long long k, double alpha, const double* A, long long lda,
+				double beta, double* C, long long ldc)
+{SyrkParallel(fTrans,n,k,alpha,A,lda,beta,C,ldc);}
+
+void CLinearAlgebra::Syrk(bool fTrans, long long n, long long k, float alpha, const float* A, long long lda,
+				float beta, float* C, long long ldc)
+{SyrkParallel(fTrans,n,k,alpha,A,lda,beta,C,ldc);}
+
+//////////////////////////////////////////////////////////////////
+//Gemv
+
+template <class theType>
+static void GemvParallel(bool fTrans, long long m, long long n, theType alpha, const theType* A, long long lda,
+							const theType* x, theType beta, theType* y)
+{
+	long long yLength=fTrans ? n : m;
+	if(yLength<=0) return;
+
+	double work=(double)m*(double)n;
+	int threads=(work<minParallelWork) ? 1 : CParallelSort::NumThreads();
+	if(threads>yLength) threads=(int)yLength;
+
+	CParallelSort::ParallelFor(threads,[&](int t)
+	{
+		long long from=yLength*t/threads, to=yLength*(t+1)/threads;
+		ScaleMatrix(to-from,1,beta,y+from,to-from);
+
+		if(fTrans)		//Dot products with the columns
+		{
+			for(long long j=from; j<to; j++) y[j]+=alpha*CArrayKernel<theType>::DirectProduct(A+j*lda,x,m);
+		}
+		else			//Sum of scaled column stripes
+		{
+			for(long long j=0; j<n; j++)
+				CArrayKernel<theType>::MultiplyAdd(y+from,A+from+j*lda,to-from,alpha*x[j]);
+		}
+	});
+}
+
+void CLinearAlgebra::Gemv(bool fTrans, long long m, long long n, double alpha, const double* A, long long lda,
+				const double* x, double beta, double* y)
+{GemvParallel(fTrans,m,n,alpha,A,lda,x,beta,y);}
+
+void CLinearAlgebra::Gemv(bool fTrans, long long m, long long n, float alpha, const float* A, long long lda,
+				const float* x, float beta, float* y)
+{GemvParallel(fTrans,m,n,alpha,A,lda,x,beta,y);}
+
+//////////////////////////////////////////////////////////////////
+//Cyclic Jacobi eigensolver, always in double precision
+
+static bool JacobiEigen(long long n, std::vector<double>& a, std::vector<double>& vecs, std::vector<double>& values)
+{
+	vecs.assign((size_t)(n*n),0);
+	for(long long i=0; i<n; i++) vecs[(size_t)(i+i*n)]=1;
+
+	bool fConverged=false;
+	for(int sweep=0; sweep<100 && !fConverged; sweep++)
+	{
+		double offNorm=0, diagNorm=0;
+		for(long long j=0; j<n; j++)
+			for(long long i=0; i<n; i++)
+			{
+				double val=a[(size_t)(i+j*n)];
+				if(i==j) diagNorm+=val*val;
+				else offNorm+=val*val;
+			}
+
+		if(offNorm<=1e-30*diagNorm || offNorm==0) {fConverged=true; break;}
+
+		for(long long p=0; p<n-1; p++)
+			for(long long q=p+1; q<n; q++)
+			{
+				double apq=a[(size_t)(p+q*n)];
+				if(apq==0) continue;
+
+				double app=a[(size_t)(p+p*n)], aqq=a[(size_t)(q+q*n)];
+				double theta=(aqq-app)/(2*apq);
+				double t=(theta>=0 ? 1 : -1)/(fabs(theta)+sqrt(theta*theta+1));
+				double c=1/sqrt(t*t+1), s=t*c;
+
+				//Columns p and q
+				double* colP=&a[(size_t)(p*n)];
+				double* colQ=&a[(size_t)(q*n)];
+				for(long long r=0; r<n; r++)
+				{
+					double arp=colP[r], arq=colQ[r];
+					colP[r]=c*arp-s*arq;
+					colQ[r]=s*arp+c*arq;
+				}
+
+				//Rows p and q
+				for(long long r=0; r<n; r++)
+				{
+					double apr=a[(size_t)(p+r*n)], aqr=a[(size_t)(q+r*n)];
+					a[(size_t)(p+r*n)]=c*apr-s*aqr;
+					a[(size_t)(q+r*n)]=s*apr+c*aqr;
+				}
+
+				double* vecP=&vecs[(size_t)(p*n)];
+				double* vecQ=&vecs[(size_t)(q*n)];
+				for(long long r=0; r<n; r++)
+				{
+					double vrp=vecP[r], vrq=vecQ[r];
+					vecP[r]=c*vrp-s*vrq;
+					vecQ[r]=s*vrp+c*vrq;
+				}
+			}
+	}
+
+	values.resize((size_t)n);
+	for(long long i=0; i<n; i++) values[(size_t)i]=a[(size_t)(i+i*n)];
+	return fConverged;
+}
+
+template <class theType>
+static bool SymmetricEigenImpl(long long n, theType* A, long long lda, theType* values)
+{
+	if(n<=0) return true;
+
+	//Symmetrize from the upper triangle, as LAPACK with "U" would
+	std::vector<double> a((size_t)(n*n));
+	for(long long j=0; j<n; j++)
+		for(long long i=0; i<n; i++) a[(size_t)(i+j*n)]=(double)(i<=j ? A[i+j*lda] : A[j+i*lda]);
+
+	std::vector<double> vecs, vals;
+	bool fResult=JacobiEigen(n,a,vecs,vals);
+
+	//Lowest to largest
+	std::vector<long long> order((size_t)n);
+	for(long long i=0; i<n; i++) order[(size_t)i]=i;
+	std::sort(order.begin(),order.end(),[&vals](long long x, long long y){return vals[(size_t)x]<vals[(size_t)y];});
+
+	for(long long j=0; j<n; j++)
+	{
+		long long src=order[(size_t)j];
+		values[j]=(theType)vals[(size_t)src];
+		for(long long i=0; i<n; i++) A[i+j*lda]=(theType)vecs[(size_t)(i+src*n)];
+	}
+
+	return fResult;
+}
+
+bool CLinearAlgebra::SymmetricEigen(long long n, double* A, long long lda, double* values)
+{return SymmetricEigenImpl(n,A,lda,values);}
+
+bool CLinearAlgebra::SymmetricEigen(long long n, float* A, long long lda, float* values)
+{return SymmetricEigenImpl(n,A,lda,values);}
+
+//////////////////////////////////////////////////////////////////
+//Householder QR
+
+template <class theType>
+static void QRImpl(long long m, long long n, theType* A, long long lda, theType* R, long long ldr, bool fFormQ)
+{
+	if(n<=0) return;
+
+	std::vector<theType> tau((size_t)n,0);
+	for(long long j=0; j<n && j<m; j++)
+	{
+		//Reflector that zeroes A[j+1..m-1, j], stored as v=(1, A[j+1..m-1, j])
+		theType* col=A+j+j*lda;
+		long long len=m-j;
+		double tail=(len>1) ? (double)CArrayKernel<theType>::DirectProduct(col+1,col+1,len-1) : 0;
+		double head=(double)col[0];
+		if(tail==0) {tau[(size_t)j]=0; continue;}
+
+		double norm=sqrt(head*head+tail);
+		double beta=(head>0) ? -norm : norm;
+		double scale=1/(head-beta);
+		for(long long i=1; i<len; i++) col[i]=(theType)(col[i]*scale);
+		col[0]=(theType)beta;
+		tau[(size_t)j]=(theType)((beta-head)/beta);
+
+		//The remaining columns: a <- a - tau*v*(v.a)
+		for(long long k=j+1; k<n; k++)
+		{
+			theType* colK=A+j+k*lda;
+			theType s=colK[0]+((len>1) ? CArrayKernel<theType>::DirectProduct(col+1,colK+1,len-1) : 0);
+			s*=tau[(size_t)j];
+			colK[0]-=s;
+			if(len>1) CArrayKernel<theType>::MultiplyAdd(colK+1,col+1,len-1,-s);
+		}
+	}
+
+	if(R)
+	{
+		for(long long j=0; j<n; j++)
+			for(long long i=0; i<n; i++) R[i+j*ldr]=(i<=j && i<m) ? A[i+j*lda] : 0;
+	}
+
+	if(!fFormQ) return;
+
+	//Thin Q: the reflectors applied to the first n columns of the identity, last to first
+	for(long long j=std::min(n,m)-1; j>=0; j--)
+	{
+		theType* col=A+j+j*lda;
+		long long len=m-j;
+		theType t=tau[(size_t)j];
+
+		for(long long k=j+1; k<n; k++)
+		{
+			theType* colK=A+j+k*lda;
+			theType s=t*((len>1) ? CArrayKernel<theType>::DirectProduct(col+1,colK+1,len-1) : 0);
+			colK[0]=-s;
+			if(len>1) CArrayKernel<theType>::MultiplyAdd(colK+1,col+1,len-1,-s);
+		}
+
+		//Column j itself: e_j - tau*v
+		col[0]=1-t;
+		for(long long i=1; i<len; i++) col[i]*=-t;
+		for(long long i=0; i<j; i++) A[i+j*lda]=0;
+	}
+}
+
+void CLinearAlgebra::QR(long long m, long long n, double* A, long long lda, double* R, long long ldr, bool fFormQ)
+{QRImpl(m,n,A,lda,R,ldr,fFormQ);}
+
+void CLinearAlgebra::QR(long long m, long long n, float* A, long long lda, float* R, long long ldr, bool fFormQ)
+{QRImpl(m,n,A,lda,R,ldr,fFormQ);}
+
+//////////////////////////////////////////////////////////////////
+//One-sided Jacobi SVD (Hestenes), in double precision
+
+template <class theType>
+static bool JacobiSVDImpl(long long m, long long n, theType* A, long long lda, theType* values, theType* V, long long ldv)
+{
+	if(n<=0) return true;
+
+	std::vector<double> a((size_t)(m*n)), v((size_t)(n*n),0);
+	for(long long j=0; j<n; j++)
+	{
+		for(long long i=0; i<m; i++) a[(size_t)(i+j*m)]=(double)A[i+j*lda];
+		v[(size_t)(j+j*n)]=1;
+	}
+
+	//Rotates pairs of columns until all of them are orthogonal
+	bool fConverged=false;
+	for(int sweep=0; sweep<100 && !fConverged; sweep++)
+	{
+		fConverged=true;
+		for(long long p=0; p<n-1; p++)
+			for(long long q=p+1; q<n; q++)
+			{
+				double* colP=&a[(size_t)(p*m)];
+				double* colQ=&a[(size_t)(q*m)];
+				double alpha=CArrayKernel<double>::DirectProduct(colP,colP,m);
+				double beta=CArrayKernel<double>::DirectProduct(colQ,colQ,m);
+				double gamma=CArrayKernel<double>::DirectProduct(colP,colQ,m);
+				if(gamma==0 || fabs(gamma)<=1e-15*sqrt(alpha*beta)) continue;
+
+				fConverged=false;
+				double zeta=(beta-alpha)/(2*gamma);
+				double t=(zeta>=0 ? 1 : -1)/(fabs(zeta)+sqrt(zeta*zeta+1));
+				double c=1/sqrt(t*t+1), s=t*c;
+
+				for(long long r=0; r<m; r++)
+				{
+					double arp=colP[r], arq=colQ[r];
+					colP[r]=c*arp-s*arq;
+					colQ[r]=s*arp+c*arq;
+				}
+
+				double* vecP=&v[(size_t)(p*n)];
+				double* vecQ=&v[(size_t)(q*n)];
+				for(long long r=0; r<n; r++)
+				{
+					double vrp=vecP[r], vrq=vecQ[r];
+					vecP[r]=c*vrp-s*vrq;
+					vecQ[r]=s*vrp+c*vrq;
+				}
+			}
+	}
+
+	//Column norms are the singular values, lowest to largest
+	std::vector<double> norms((size_t)n);
+	std::vector<long long> order((size_t)n);
+	for(long long j=0; j<n; j++)
+	{
+		norms[(size_t)j]=sqrt(CArrayKernel<double>::DirectProduct(&a[(size_t)(j*m)],&a[(size_t)(j*m)],m));
+		order[(size_t)j]=j;
+	}
+	std::sort(order.begin(),order.end(),[&norms](long long x, long long y){return norms[(size_t)x]<norms[(size_t)y];});
+
+	for(long long j=0; j<n; j++)
+	{
+		long long src=order[(size_t)j];
+		double norm=norms[(size_t)src];
+		double scale=(norm>0) ? 1/norm : 0;
+		values[j]=(theType)norm;
+		for(long long i=0; i<m; i++) A[i+j*lda]=(theType)(a[(size_t)(i+src*m)]*scale);
+		if(V) for(long long i=0; i<n; i++) V[i+j*ldv]=(theType)v[(size_t)(i+src*n)];
+	}
+
+	return fConverged;
+}
+
+bool CLinearAlgebra::JacobiSVD(long long m, long long n, double* A, long long lda, double* values, double* V, long long ldv)
+{return JacobiSVDImpl(m,n,A,lda,values,V,ldv);}
+
+bool CLinearAlgebra::JacobiSVD(long long m, long long n, float* A, long long lda, float* values, float* V, long long ldv)
+{return JacobiSVDImpl(m,n,A,lda,values,V,ldv);}
@@ -0,0 +1,81 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Dense linear algebra that does not need MKL
+//Gemm/Syrk: cache-blocked, multithreaded matrix products with SIMD micro-kernels (AVX-512, AVX2+FMA, plain loops),
+//picked at run time through CArrayKernels::Level()
+//Gemv: matrix-vector product on top of the CArrayKernels reductions
+//SymmetricEigen: Jacobi eigensolver, stands in for LAPACK in builds without MKL
+//QR, JacobiSVD: Householder QR and one-sided Jacobi SVD for the small factorizations of randomized SVD
+//All matrices are column-major with a leading dimension, as in BLAS
+
+//CMatrix uses these when the native backend is selected - always when built with LABGENIE_NO_MKL defined,
+//and in MKL builds after SetBackend(backend_native)
+
+#pragma once
+
+class CLinearAlgebra
+{
+public:
+	enum {backend_mkl=0, backend_native};
+
+	static bool HasMkl();					//Built with MKL
+	static int Backend();
+	static void SetBackend(int backend);	//backend_mkl is ignored without MKL
+
+	//C <- alpha*op(A).op(B) + beta*C, op(A) is m x k, op(B) is k x n
+	static void Gemm(bool fTransA, bool fTransB, long long m, long long n, long long k,
+					double alpha, const double* A, long long lda, const double* B, long long ldb,
+					double beta, double* C, long long ldc);
+	static void Gemm(bool fTransA, bool fTransB, long long m, long long n, long long k,
+					float alpha, const float* A, long long lda, const float* B, long long ldb,
+					float beta, float* C, long long ldc);
+
+	//C <- alpha*op(A).op(A)^T + beta*C, op(A) is n x k (fTrans - A is stored k x n)
+	//Computes the lower triangle and mirrors it, so all of C is written; beta*C uses the lower triangle of C only
+	static void Syrk(bool fTrans, long long n, long long k, double alpha, const double* A, long long lda,
+					double beta, double* C, long long ldc);
+	static void Syrk(bool fTrans, long long n, long long k, float alpha, const float* A, long long lda,
+					float beta, float* C, long long ldc);
+
+	//y <- alpha*op(A).x + beta*y, A is m x n
+	static void Gemv(bool fTrans, long long m, long long n, double alpha, const double* A, long long lda,
+					const double* x, double beta, double* y);
+	static void Gemv(bool fTrans, long long m, long long n, float alpha, const float* A, long long lda,
+					const float* x, float beta, float* y);
+
+	//Eigensystem of a symmetric n x n matrix: A is overwritten with eigenvectors in columns,
+	//eigenvalues go lowest to largest. False if the iterations did not converge
+	static bool SymmetricEigen(long long n, double* A, long long lda, double* values);
+	static bool SymmetricEigen(long long n, float* A, long long lda, float* values);
+
+	//Householder QR of an m x n matrix, m >= n: R (n x n, upper triangular) goes to R if it is not null,
+	//A is overwritten with the thin Q (m x n, orthonormal columns) if fFormQ, otherwise with the reflectors
+	static void QR(long long m, long long n, double* A, long long lda, double* R, long long ldr, bool fFormQ=true);
+	static void QR(long long m, long long n, float* A, long long lda, float* R, long long ldr, bool fFormQ=true);
+
+	//Thin SVD of an m x n matrix, m >= n, by one-sided Jacobi rotations; meant for small matrices
+	//A is overwritten with the left singular vectors, right vectors go to V (n x n) if it is not null,
+	//singular values go lowest to largest. False if the rotations did not converge
+	static bool JacobiSVD(long long m, long long n, double* A, long long lda, double* values, double* V=0, long long ldv=0);
+	static bool JacobiSVD(long long m, long long n, float* A, long long lda, float* values, float* V=0, long long ldv=0);
+};
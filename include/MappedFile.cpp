@@ -0,0 +1,113 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+CMappedFile::CMappedFile():
+data(0),
+size(0)
+{
+#ifdef _WIN32
+	fileHandle=INVALID_HANDLE_VALUE;
+	mappingHandle=0;
+#endif
+}
+
+CMappedFile::~CMappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool CMappedFile::Open(const BString& fileName)
+{
+	Close();
+
+	fileHandle=CreateFileA((const char*)fileName,GENERIC_READ,FILE_SHARE_READ,0,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,0);
+	if(fileHandle==INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(fileHandle,&fileSize) || fileSize.QuadPart==0) {Close(); return false;}
+
+	mappingHandle=CreateFileMappingA(fileHandle,0,PAGE_WRITECOPY,0,0,0);
+	if(mappingHandle==0) {Close(); return false;}
+
+	data=(char*)MapViewOfFile(mappingHandle,FILE_MAP_COPY,0,0,0);
+	if(data==0) {Close(); return false;}
+
+	size=fileSize.QuadPart;
+	return true;
+}
+
+void CMappedFile::Close()
+{
+	if(data!=0) UnmapViewOfFile(data);
+	if(mappingHandle!=0) CloseHandle(mappingHandle);
+	if(fileHandle!=INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+
+	data=0;
+	size=0;
+	mappingHandle=0;
+	fileHandle=INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool CMappedFile::Open(const BString& fileName)
+{
+	Close();
+
+	int fd=open((const char*)fileName,O_RDONLY);
+	if(fd<0) return false;
+
+	struct stat fileStat;
+	if(fstat(fd,&fileStat)!=0 || fileStat.st_size==0) {close(fd); return false;}
+
+	//The mapping keeps its own reference to the file
+	void* view=mmap(0,(size_t)fileStat.st_size,PROT_READ|PROT_WRITE,MAP_PRIVATE,fd,0);
+	close(fd);
+	if(view==MAP_FAILED) return false;
+
+	data=(char*)view;
+	size=(long long)fileStat.st_size;
+	return true;
+}
+
+void CMappedFile::Close()
+{
+	if(data!=0) munmap(data,(size_t)size);
+
+	data=0;
+	size=0;
+}
+
+#endif
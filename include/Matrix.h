@@ -1,13 +1,20 @@
 #pragma once
 
+//Build with LABGENIE_NO_MKL defined to drop MKL: products and symmetric eigensystems then use CLinearAlgebra,
+//the other LAPACK-based functions (full SVD, non-symmetric eigensystems) report that they need MKL
+#ifndef LABGENIE_NO_MKL
 #include "mkl.h"
+#endif
 
 #include "Array.h"
+#include "LinearAlgebra.h"
+#include "Agglomerative.h"
+#include "Kmeans.h"
+#include "TaskPool.h"
 #include "Timer.h"
 #include "ArrArr.h"
 #include "CAIStrings.h"
 #include "Savable.h"
-#include <list>
 
 #define MKL_INT int
 #undef max
@@ -18,6 +25,7 @@ public:
 	CMatrix(intType theCols=0, intType theRows=0);
 	explicit CMatrix(const BString& fileName);						//Will call Load() 
 	explicit CMatrix(const CMatrix<theType,intType>& theMat);		//Will copy everything from another matrix
+	CMatrix(CMatrix<theType,intType>&& theMat);						//Takes over the storage of another matrix
 
 	//Will create a virtual matrix in an existing one that only includes a certain number of columns
 	CMatrix(const CMatrix<theType,intType>& otherMat, intType startCol, intType numColsToInclude);
@@ -90,7 +98,7 @@ public:
 	void CopyTransposeFrom(CMatrix<theType,intType>& rhs);			//Copies with transposition from matrix, resizes if needed
 	
 //Transposition
-	void Transpose();
+	void Transpose();											//In place without a copy for square matrices
 
 //Modifying structure
 	void PermuteColumns(const CHArray<intType,intType>& perm);
@@ -110,7 +118,7 @@ public:
 	bool ReadStrings(const BString& fileName);
 	bool WriteStrings(const BString& fileName, bool fOnlyAddedRows = false);
 	bool Read(const BString& fileName);
-	bool Write(const BString& fileName, BString format="%.5e");
+	bool Write(const BString& fileName, BString format="%.5e");		//Tab-separated rows, format "%r" - shortest exact text
 		
 //Interpolation	
 	theType Interpolate(double colIndex, double rowIndex) const;	//Bilinear interpolation
@@ -167,6 +175,7 @@ public:
 
 //Operators
 	CMatrix<theType,intType>& operator=(const CMatrix<theType,intType>& rhs);
+	CMatrix<theType,intType>& operator=(CMatrix<theType,intType>&& rhs);
 	CMatrix<theType,intType>& operator=(theType val){theArray=val;return *this;};
 	CMatrix<theType,intType>& operator+=(CMatrix<theType,intType>& rhs){theArray+=rhs.theArray;return *this;};
 	CMatrix<theType,intType>& operator-=(CMatrix<theType,intType>& rhs){theArray-=rhs.theArray;return *this;};
@@ -232,7 +241,13 @@ public:
 	//values and vectors are written least to largest in vals and vecs
 	bool PartialSVD(intType numVecs, CHArray<theType,intType>& vals, CMatrix<theType,intType>& colVecs, CMatrix<theType,intType>& rowVecs) const;
 
-	//K-means clustering - Lloyd's algorithm
+	//Randomized partial SVD (CRandomizedSVD) - same results as PartialSVD, but the Gram matrix is never formed:
+	//O((rows+cols)*numVecs) memory instead of O(min(rows,cols)^2), and the condition number is not squared
+	//For matrices that do not fit in memory use CRandomizedSVD with a chunk source directly
+	bool RandomizedSVD(intType numVecs, CHArray<theType,intType>& vals, CMatrix<theType,intType>& colVecs, CMatrix<theType,intType>& rowVecs,
+						int numPowerIterations=2, intType oversampling=10) const;
+
+	//K-means clustering - Lloyd's algorithm with k-means++ seeding and Hamerly's bounds (CKmeans)
 	//The coordinates of points should be in columns, there are N columns (N points) grouped into K clusters
 	//Result will contain K arrays, each contaning int point numbers that will go into that cluster.
 	//Arrays are sorted so that clusters with larger numbers of points come first
@@ -249,15 +264,15 @@ public:
 	//Until the size of the clusters is no more than maxNumInCluster
 	//The coordinates of points should be in matrix columns
 	//The columns are interchanged to group cluster members together
-	//The columns are interchanged to group cluster members together
 	//Result contains the clusters of original column indices
 	//The order in result and in the permuted (*this) matrix are the same
+	//The two halves of every split are independent and are processed as tasks on CParallelSort threads (CTaskPool)
 	void PDDPclustering(intType maxNumInCluster, CAIStrings<intType,intType>& result);
 
 private:
 	//Helper function for PDDP clustering
-	//Creates a copy of the matrix
-	//Finds the projection of each column on the primary eigenvector
+	//Finds the principal direction of the columns by power iterations, without copying the matrix
+	//Finds the projection of each column on the principal direction
 	//Sorts the columns according to the projection
 	//Finds optimal division point
 	//And returns the division point and corresponding reduction in squared devs in divPoint and reduction
@@ -452,6 +467,9 @@ bool CMatrix<theType,intType>::SetToIdentityMatrix()
 template <class theType, class intType>
 BString CMatrix<theType,intType>::EigenNonsym(CHArray<float,intType>& eValsRe, CHArray<float,intType>& eValsIm, CMatrix<float,intType>& eVecs) const
 {
+#ifdef LABGENIE_NO_MKL
+	return "EigenNonsym: needs MKL.";
+#else
 	if(cols!=rows) return "EigenNonsym: matrix must be square.";
 
 	eValsRe.ResizeArray(cols,true);
@@ -523,11 +541,15 @@ BString CMatrix<theType,intType>::EigenNonsym(CHArray<float,intType>& eValsRe, C
 	}
 	
 	return "EigenNonsym: normal termination.";
+#endif
 }
 
 template <class theType, class intType>
 BString CMatrix<theType,intType>::EigenNonsym(CHArray<double,intType>& eValsRe, CHArray<double,intType>& eValsIm, CMatrix<double,intType>& eVecs) const
 {
+#ifdef LABGENIE_NO_MKL
+	return "EigenNonsym: needs MKL.";
+#else
 	if(cols!=rows) return "EigenNonsym: matrix must be square.";
 
 	eValsRe.ResizeArray(cols,true);
@@ -599,6 +621,7 @@ BString CMatrix<theType,intType>::EigenNonsym(CHArray<double,intType>& eValsRe,
 	}
 	
 	return "EigenNonsym: normal termination.";
+#endif
 }
 
 template <class theType, class intType>
@@ -803,9 +826,20 @@ void CMatrix<theType,intType>::ExportRowsToArrayOfArrays(CHArray<CHArray<theType
 	if(result.GetSize()<rows) result.ResizeArray(rows);
 	result.SetNumPoints(rows);
 
-	for(intType counter1=0;counter1<rows;counter1++)
+	//Bands of rows are transposed through a buffer, so the matrix is read in contiguous pieces of columns
+	const intType bandSize=32;
+	CHArray<theType,intType> band(bandSize*cols);
+	for(intType startRow=0;startRow<rows;startRow+=bandSize)
 	{
-		GetRow(counter1, result[counter1]);
+		intType numRows=std::min(bandSize,rows-startRow);
+		CArrayKernel<theType>::Transpose(theArray.arr+startRow,numRows,cols,rows,band.arr,cols);
+		for(intType counter1=0;counter1<numRows;counter1++)
+		{
+			CHArray<theType,intType>& row=result[startRow+counter1];
+			if(row.GetSize()<cols) row.ResizeArray(cols);
+			row.SetNumPoints(cols);
+			memcpy(row.arr,band.arr+counter1*cols,sizeof(theType)*cols);
+		}
 	}
 }
 
@@ -814,9 +848,19 @@ void CMatrix<theType,intType>::ImportRowsFromArrayOfArrays(CHArray<CHArray<theTy
 {
 	ResizeMatrix(source[0].GetNumPoints(), source.GetNumPoints());
 
-	for(intType counter1=0;counter1<rows;counter1++)
+	//Same banding as ExportRowsToArrayOfArrays, rows of the wrong length are skipped like in SetRow
+	const intType bandSize=32;
+	CHArray<theType,intType> band(bandSize*cols);
+	for(intType startRow=0;startRow<rows;startRow+=bandSize)
 	{
-		SetRow(counter1,source[counter1]);
+		intType numRows=std::min(bandSize,rows-startRow);
+		for(intType counter1=0;counter1<numRows;counter1++)
+		{
+			const CHArray<theType,intType>& row=source[startRow+counter1];
+			if(row.GetNumPoints()==cols) memcpy(band.arr+counter1*cols,row.arr,sizeof(theType)*cols);
+			else for(intType counter2=0;counter2<cols;counter2++) band.arr[counter1*cols+counter2]=theArray.arr[counter2*rows+startRow+counter1];
+		}
+		CArrayKernel<theType>::Transpose(band.arr,cols,numRows,cols,theArray.arr+startRow,rows);
 	}
 }
 
@@ -844,96 +888,60 @@ void CMatrix<theType,intType>::PDDPclustering(intType maxNumInCluster, CAIString
 	perm.ResizeIfSmaller(cols,true);
 	perm.SetValToPointNum();
 
-	//Cluster description
+	//Column range of a cluster, [start, start+count)
 	struct cluster
 	{
-		cluster(intType theStart, intType theEnd, intType theDiv, intType theRed, bool isFin):
-				start(theStart),end(theEnd),div(theDiv),red(theRed),fin(isFin){};
-
-		intType Count() const {return end-start;};
-
-		intType start;	//position where the cluster starts
-		intType end;	//and ends, [...)
-		intType div;	//optimal division position for the cluster - it's an offset from start, not absolute numbering!
-		theType red;	//reduction in total sq devs achieved after optimal division
-		bool fin;		//Whether the cluster is "finished" - has no more points than required
+		cluster(intType theStart=0, intType theCount=0):start(theStart),count(theCount){};
+		intType start;
+		intType count;
 	};
-	std::list<cluster> clusterList;
 
-	int numFinished=0;			//Number of columns already assigned to clusters with < than maxNumInCluster elements
+	//Every split only touches its own columns, so the halves are divided independently
+	//Clusters with no more than maxNumInCluster points are finished
+	std::vector<cluster> finished;
+	std::mutex finishedLock;
 
-	//Specify the top cluster and add it to list
-	cluster topCluster(0,cols,0,0,false);
-	(*this).PDDPhelper(topCluster.div,topCluster.red,perm);
-	if(cols<=maxNumInCluster) {topCluster.fin=true;numFinished=cols;}
-
-	clusterList.push_back(topCluster);
-	
-	//While there are clusters to divide, select the one with largest reduction
-	//Divide it and run PDDPhelper on each of the two new clusters
-	while(numFinished < cols)
+	CTaskPool<cluster> pool(cols*rows<(1<<16) ? 1 : CParallelSort::NumThreads());
+	pool.Run(cluster(0,cols),[&](const cluster& cur, int threadNum)
 	{
-		theType curRed=-1;					//this initial choice is always changed in cluster selection
-		auto curPick=clusterList.end();		//this initial choice is always changed in cluster selection
-
-		//pick the cluster to divide - the cluster with the largest reduction
-		for(auto it=clusterList.begin();it!=clusterList.end();it++)
+		if(cur.count<=maxNumInCluster || cur.count<2)
 		{
-			cluster& curCluster=*it;
-			if(!curCluster.fin && curCluster.red > curRed)
-			{
-				curPick=it;
-				curRed=curCluster.red;
-			}
+			std::lock_guard<std::mutex> guard(finishedLock);
+			finished.push_back(cur);
+			return;
 		}
 
-		//Current picked cluster
-		cluster& picked=*curPick;
-				
-		cluster newCluster(picked.start + picked.div,picked.end,0,0,false);	//new cluster to be inserted after the picked one
-		picked.end = picked.start + picked.div;			//removing the elements from the picked cluster that were moved to the new cluster
-		
-		//If the sizes have been reached, mark as finished and increment numFinished
-		if(newCluster.Count() <= maxNumInCluster)
-		{
-			newCluster.fin=true;
-			numFinished += newCluster.Count();
-		}
-		if(picked.Count() <= maxNumInCluster)
-		{
-			picked.fin=true;
-			numFinished += picked.Count();
-		}
-
-		//Compute the division point and the sq dev reduction on the two new clusters
+		//Compute the division point on the virtual columns of the cluster
 		//And permute them according to projection on the principal direction
-		{
-			CMatrix<theType,intType> virtMatrix(*this,picked.start,picked.Count());
-			CHArray<intType,intType> virtArray(perm.arr + picked.start,picked.Count(),true);
-			virtMatrix.PDDPhelper(picked.div,picked.red,virtArray);
-		}
-
-		{
-			CMatrix<theType,intType> virtMatrix(*this,newCluster.start,newCluster.Count());
-			CHArray<intType,intType> virtArray(perm.arr + newCluster.start,newCluster.Count(),true);
-			virtMatrix.PDDPhelper(newCluster.div,newCluster.red,virtArray);
-		}
-
-		//Insert the new cluster after the picked cluster
-		curPick++;
-		clusterList.insert(curPick,newCluster);
-	}
-
-	//Compose the result CAIS from perm and the cluster list
-	CHArray<intType,intType> iia((intType)clusterList.size()+1);
+		CMatrix<theType,intType> virtMatrix(*this,cur.start,cur.count);
+		CHArray<intType,intType> virtArray(perm.arr+cur.start,cur.count,true);
+		intType div;
+		theType reduction;
+#ifndef LABGENIE_NO_MKL
+		//MKL runs its own threads, the pool's threads already use every core
+		int mklThreads=(pool.NumThreads()>1) ? mkl_set_num_threads_local(1) : -1;
+#endif
+		virtMatrix.PDDPhelper(div,reduction,virtArray);
+#ifndef LABGENIE_NO_MKL
+		if(mklThreads>=0) mkl_set_num_threads_local(mklThreads);
+#endif
+
+		pool.Push(threadNum,cluster(cur.start+div,cur.count-div));
+		pool.Push(threadNum,cluster(cur.start,div));
+	});
+
+	//Compose the result CAIS from perm and the finished clusters, in the order of the columns
+	std::sort(finished.begin(),finished.end(),[](const cluster& a, const cluster& b){return a.start<b.start;});
+	CHArray<intType,intType> iia((intType)finished.size()+1);
 	iia.AddPoint(0);
-	for(auto it=clusterList.begin();it!=clusterList.end();it++) iia.AddPoint((*it).end);
+	for(size_t i=0;i<finished.size();i++) iia.AddPoint(finished[i].start+finished[i].count);
 	result.SetDataAndIia(iia,perm);
 }
 
 //Helper function for PDDP clustering
-//Creates a copy of the matrix
-//Finds the projection of each column on the primary eigenvector
+//Finds the principal direction of the columns with a few power iterations on the centered columns,
+//X_c.Transpose(X_c).v = X.(Transpose(X).v - (mean.v)) - mean*Sum(...) - the matrix is not copied or centered
+//Finds the projection of each column on the principal direction
 //Sorts the columns according to the projection
 //Finds optimal division point
 //And returns the division point and corresponding reduction in squared devs in divPoint and reduction
@@ -943,32 +951,63 @@ void CMatrix<theType,intType>::PDDPclustering(intType maxNumInCluster, CAIString
 template <class theType, class intType>
 void CMatrix<theType,intType>::PDDPhelper(intType& divPoint, theType& reduction, CHArray<intType,intType>& arrayToPermute)
 {
-	//Create a copy of curMat so that we can subtract the average from it
-	CMatrix<theType,intType> copy(*this);
-
 	//Compute the average on the columns
-	CHArray<theType,intType> average(copy.rows,true);
+	CHArray<theType,intType> average(rows,true);
 	average=0;
-	for(intType i=0;i<copy.cols;i++) average+=copy[i];
+	for(intType i=0;i<cols;i++) average+=colArrays[i];
 	average /= (theType) cols;
 
-	//Subtract the average from each column
-	for(int i=0;i<copy.cols;i++) copy[i]-=average;
+	//Subspace iterations with a small block of directions converge as (lambda(blockSize+1)/lambda(1))^iterations
+	//Plain power iterations stall when the two largest variances are close
+	intType blockSize=std::min(std::min(rows,cols),(intType)8);
+	CMatrix<theType,intType> dirs(blockSize,rows), projs, newDirs;
+	CHArray<theType,intType> gram(blockSize*blockSize,true), ritzVals(blockSize,true), dir(rows,true), oldDir(rows,true);
+
+	//Start from the column farthest from the average - usually close to the principal direction -
+	//and fixed pseudo-random directions
+	intType farthest=0;
+	theType farthestDist=-1;
+	for(intType i=0;i<cols;i++)
+	{
+		theType dist=CArrayKernel<theType>::SquaredDistance(colArrays[i].arr,average.arr,rows);
+		if(dist>farthestDist) {farthestDist=dist; farthest=i;}
+	}
+	for(intType j=0;j<rows;j++) dirs.ElementAt(0,j)=colArrays[farthest].arr[j]-average.arr[j];
+	unsigned int hash=12345;
+	for(intType i=1;i<blockSize;i++)
+		for(intType j=0;j<rows;j++) {hash=hash*1664525u+1013904223u; dirs.ElementAt(i,j)=(theType)((double)(hash>>8)/8388608.0-1.0);}
+	CLinearAlgebra::QR(rows,blockSize,dirs.theArray.arr,rows,(theType*)0,0);
+
+	oldDir=0;
+	const int maxIterations=100;
+	for(int iter=0; iter<maxIterations; iter++)
+	{
+		//Projections of the centered columns on the directions
+		MatMultiply(dirs,projs,true,false);
+		for(intType i=0;i<blockSize;i++) projs[i]-=average.DirectProduct(dirs[i]);
+
+		//Rayleigh-Ritz: the best principal direction within the block
+		projs.MatMultiply(projs,newDirs,true,false);
+		memcpy(gram.arr,newDirs.theArray.arr,sizeof(theType)*blockSize*blockSize);
+		CLinearAlgebra::SymmetricEigen(blockSize,gram.arr,blockSize,ritzVals.arr);
+		dir=0;
+		for(intType i=0;i<blockSize;i++) dir.MultiplyAdd(dirs[i],gram.arr[(blockSize-1)*blockSize+i]);
 
-	//Assumes that curMat has relatively few rows (but possibly many columns)
-	//example is projections of words on eigenvectors in columns
-	CMatrix<theType,intType> temp;
-	copy.MatMultiply(copy,temp,false,true);		//mat product of curMat with itself to find the largest eigenvector
-	CMatrix<theType,intType> tempEvecs;
-	CHArray<theType,intType> tempEvals;
+		theType change=(theType)1-fabs(dir.DirectProduct(oldDir));
+		if(change<(theType)1e-7 || blockSize==rows) break;
+		oldDir=dir;
 
-	//Find one largest eigenvector of temp
-	temp.EigenRRR(1,tempEvals,tempEvecs);
-	CHArray<theType,intType>& primEvec=tempEvecs[0];
+		//Next block: centered columns weighted with their projections, orthonormalized
+		MatMultiply(projs,newDirs,false,false);
+		for(intType i=0;i<blockSize;i++) newDirs[i].MultiplyAdd(average,-projs[i].Sum());
+		CLinearAlgebra::QR(rows,blockSize,newDirs.theArray.arr,rows,(theType*)0,0);
+		dirs=newDirs;
+	}
 
-	//Compute projections of each column onto the primary eigenvector
-	CHArray<theType,intType> proj;
-	copy.MatVecMultiply(primEvec,proj,true);
+	//Compute projections of each column onto the principal direction
+	CHArray<theType,intType> proj(cols,true);
+	MatVecMultiply(dir,proj,true);
+	proj-=average.DirectProduct(dir);
 
 	//Permutation to sort the columns according to the projection
 	CHArray<intType,intType> perm;
@@ -986,106 +1025,11 @@ void CMatrix<theType,intType>::PDDPhelper(intType& divPoint, theType& reduction,
 template <class theType, class intType>
 bool CMatrix<theType,intType>::AgglomerativeClustering(theType entropicLimit, CHArray<CHArray<intType,intType>,intType>& result)
 {
-	if((entropicLimit>cols)||(entropicLimit<1)) return false;
-
-	intType curNumClusters=cols;		//Number of groups will decrease as clusters are merged
-	intType numCoords=rows;
-
-	CHArray<intType,intType> clustering(cols,true);				//Array assigning points to a given cluster
-	clustering.SetValToPointNum();					//Clusters will need to be renumbered 0 to max at the end
-
-	CHArray<intType,intType> numPointsInClusters(cols,true);	//Points are deleted from this array as the number of clusters decreases
-	numPointsInClusters=1;							//When merging, one cluster takes the points of both
-
-	CHArray<CHArray<theType,intType>,intType> clusters(cols);		//Average coordinates of clusters
-	ExportColsToArrayOfArrays(clusters);
-
-	CMatrix<theType,intType> distances(cols,cols);						//Pairwise distances between clusters
-	for(intType counter1=0;counter1<(cols-1);counter1++)			//Initialize distance matrix
-	{
-		for(intType counter2=counter1+1;counter2<cols;counter2++)
-		{
-			distances.ElementAt(counter1,counter2)=clusters[counter1].EuclideanDistance(clusters[counter2]);
-		}
-	}
-
-	CHArray<intType,intType> remainingClusters(cols,true);		//Registration of remaining clusters to position number in "clusters"
-	remainingClusters.SetValToPointNum();			//Points are deleted as clusters are merged
-
-	//do while entropic limit is not reached
-	while(numPointsInClusters.EntropicNumberOfStates()>entropicLimit)
-	{
-		//Find minimum pairwise distance between remaining clusters
-		theType minDist=distances.ElementAt(remainingClusters[0],remainingClusters[1]);
-		intType minCounter1=0;
-		intType minCounter2=1;
-
-		theType dist;
-		for(intType counter1=0;counter1<(curNumClusters-1);counter1++)
-		{
-			intType index1=remainingClusters[counter1];
-			for(intType counter2=counter1+1;counter2<curNumClusters;counter2++)
-			{
-				intType index2=remainingClusters[counter2];
-
-				dist=distances.ElementAt(index1,index2);
-
-				if(dist<minDist)
-				{
-					minDist=dist;
-					minCounter1=counter1;
-					minCounter2=counter2;
-				}
-			}
-		}
-
-		//At this point, the minimum distance is found
-		//Now merge the second min dist cluster into the first one
-		intType index1=remainingClusters[minCounter1];
-		intType index2=remainingClusters[minCounter2];
-
-		intType numPointsIn1=numPointsInClusters[minCounter1];
-		intType numPointsIn2=numPointsInClusters[minCounter2];
-
-		clusters[index1]*=(theType)numPointsIn1;
-		clusters[index2]*=(theType)numPointsIn2;
-
-		clusters[index1]+=clusters[index2];
-		clusters[index1]*=((theType)1.0/(theType)(numPointsIn1+numPointsIn2));
-
-		numPointsInClusters[minCounter1]+=numPointsIn2;
+	CHArray<intType,intType> clustering;			//Cluster of every point
+	CHArray<intType,intType> numPointsInClusters;	//Number of points in every cluster
+	if(!CAgglomerative<theType,intType>::Cluster(theArray.arr,rows,cols,(double)entropicLimit,clustering,numPointsInClusters)) return false;
 
-		//Now remove references to the second cluster
-		remainingClusters.DeletePointAt(minCounter2);
-		numPointsInClusters.DeletePointAt(minCounter2);
-
-		for(intType counter1=0;counter1<cols;counter1++)
-		{
-			if(clustering[counter1]==index2) clustering[counter1]=index1;
-		}
-
-		curNumClusters--;
-
-		//And update the distance table - index1 is the cluster that has kept its number
-		for(intType counter1=0;counter1<curNumClusters;counter1++)
-		{
-			dist=clusters[index1].EuclideanDistance(clusters[remainingClusters[counter1]]);
-			distances.ElementAt(index1,remainingClusters[counter1])=dist;
-			distances.ElementAt(remainingClusters[counter1],index1)=dist;
-		}
-	}
-
-	//Renumber the clusters in "clustering" to indices in "remainingClusters"
-	CHArray<intType,intType> renumbering(cols,true);
-	for(intType counter1=0;counter1<curNumClusters;counter1++)
-	{
-		renumbering[remainingClusters[counter1]]=counter1;
-	}
-
-	for(intType counter1=0;counter1<cols;counter1++)
-	{
-		clustering[counter1]=renumbering[clustering[counter1]];
-	}
+	intType curNumClusters=numPointsInClusters.GetNumPoints();
 
 	//Convert data in "clustering" into array of arrays
 	result.ResizeArray(curNumClusters, true);
@@ -1114,81 +1058,16 @@ template <class theType, class intType>
 bool CMatrix<theType,intType>::KmeansClustering(intType k, CHArray<CHArray<intType,intType>,intType>& result)
 {
 	intType numPoints=cols;
-	intType numCoords=rows;
 
 	if((k>numPoints)||(k<1)) return false;
 
-	CHArray<intType,intType> clustering(numPoints,true);		//Indicates which cluster the point belongs to
-
-	//Simple initialization of clustering array
-	clustering=0;
-	for(intType counter1=0;counter1<k;counter1++)
-	{
-		clustering[counter1]=counter1;
-	}
-
-	//Arrays for the coordinates of the mean of each group
-	CHArray<CHArray<theType,intType>,intType> meanGroupCoord(k);
-	for(intType counter1=0;counter1<k;counter1++)
-	{
-		meanGroupCoord[counter1].ResizeArray(numCoords, true);
-	}
+	CHArray<intType,intType> clustering;		//Indicates which cluster the point belongs to
+	CKmeans<theType,intType> kmeans(rows,k);
+	if(!kmeans.Cluster(theArray.arr,numPoints,clustering)) return false;
 
 	//Number of points in each group
-	CHArray<intType,intType> numPointsInGroup(k, true);
-
-	//Distances between the mean and the point
-	CHArray<theType,intType> distances(k,true);
-
-	//Auxilliary array for extracting a column from the matrix - could be replaced by CHArray<CHArray<theType>>
-	CHArray<theType,intType> aux(numCoords,true);
-
-	//Old clustering - for the termination condition
-	CHArray<intType,intType> oldClustering(clustering);
-
-	//Iterate
-	while(1)
-	{
-		//Compute the mean of each group
-		numPointsInGroup=0;
-		for(intType counter1=0;counter1<k;counter1++)
-		{
-			meanGroupCoord[counter1]=0;
-		}
-
-		for(intType counter1=0;counter1<numPoints;counter1++)
-		{
-			intType curGroup=clustering[counter1];
-			numPointsInGroup[curGroup]+=1;
-
-			GetColumn(counter1, aux);
-			meanGroupCoord[curGroup]+=aux;
-		}
-
-		for(intType counter1=0;counter1<k;counter1++)
-		{
-			meanGroupCoord[counter1]*=((theType)1./(theType)numPointsInGroup[counter1]);
-		}
-
-		//reassign points to groups
-		for(intType counter1=0;counter1<numPoints;counter1++)
-		{
-			GetColumn(counter1, aux);
-
-			//Compute distances to centers of all groups
-			for(intType counter2=0;counter2<k;counter2++)
-			{
-				distances[counter2]=meanGroupCoord[counter2].EuclideanDistance(aux);
-			}
-
-			clustering[counter1]=distances.FindPositionOfMin();
-		}
-
-		//Terminate if no change from last time
-		if(clustering==oldClustering) break;
-
-		oldClustering=clustering;
-	}
+	CHArray<intType,intType> numPointsInGroup(k,true);
+	for(intType counter1=0;counter1<k;counter1++) numPointsInGroup[counter1]=(intType)kmeans.Count(counter1);
 
 	//Now reformat the data in "clustering" into k int arrays
 	result.ResizeArray(k, true);
@@ -1216,41 +1095,21 @@ bool CMatrix<theType,intType>::KmeansClustering(intType k, CHArray<CHArray<intTy
 template <class theType, class intType>
 bool CMatrix<theType,intType>::Write(const BString& fileName, BString format)
 {
-	CHArray<char,int64> charArr;
-	if(cols==0 || rows==0) {return charArr.WriteBinary(fileName);}
-
-	//double pass - first count the number of symbols, then write to a char array
-	int64 numSymbols=0;
-	BString buffer;
-	for(intType i=0;i<rows;i++)
-	{
-		for(intType j=0;j<cols;j++)
-		{
-			buffer.Format(format,ElementAt(j,i));
-			numSymbols+=buffer.GetLength();
-		}
-	}
-	numSymbols+=(rows-1);			//for "\n" after every line, except the last one
-	numSymbols+=rows*(cols-1);		//for "\t" after every element, except the last one in each row
+	CTextWriter writer;
+	if(!writer.Open(fileName)) return false;
 
-	charArr.Resize(numSymbols,true);
-	int64 curPos=0;
+	CTextCodec::CNumberFormat numberFormat=CTextCodec::ParseFormat(format);
 	for(intType i=0;i<rows;i++)
 	{
 		for(intType j=0;j<cols;j++)
 		{
-			buffer.Format(format,ElementAt(j,i));
-			int64 curLength=buffer.GetLength();
-			for(int k=0;k<curLength;k++)
-			{
-				charArr[curPos++]=buffer[k];
-			}
-			if(j<(cols-1)) charArr[curPos++]='\t';
+			writer.PutNumber(ElementAt(j,i),numberFormat);
+			if(j<(cols-1)) writer.Put('\t');
 		}
-		if(i<(rows-1)) charArr[curPos++]='\n';
+		if(i<(rows-1)) writer.Put('\n');
 	}
 
-	return charArr.WriteBinary(fileName);
+	return writer.Close();
 }
 
 template <class theType, class intType>
@@ -1258,108 +1117,15 @@ bool CMatrix<theType,intType>::Read(const BString& fileName)
 {
 	CHArray<char,int64> text;
 	if(!text.ReadBinary(fileName)) return false;
-	int64 textLength=text.GetNumPoints();
-	if(textLength==0) {ResizeMatrix(0,0);return true;}
 
-	///////Remove all CRs
-	int64 newLength=0;
-	for(int64 i=0;i<textLength;i++)
-	{
-		if(text.arr[i]!=13)
-		{
-			if(i!=newLength) text.arr[newLength]=text.arr[i];
-			newLength++;
-		}
-	}
-	text.SetNumPoints(newLength);
-	textLength=newLength;
-	if(textLength==0) {ResizeMatrix(0,0);return true;}
-
-	//Remove terminating LF - there should be no LF at the end
-	if(text[textLength-1]==10)
-	{
-		textLength--;
-		text.SetNumPoints(textLength);
-		if(textLength==0) {ResizeMatrix(0,0);return true;}
-	}
-
-	//Count the number of lines in the file
-	intType numLines=1;
-	for(int64 i=0;i<textLength;i++)
-	{
-		if(text.arr[i]==10) numLines++;
-	}
-
-	//Count the number of elements in the first row
-	intType newNumCols=1;
-	for(int64 i=1;i<textLength && text.arr[i]!=10;i++)
-	{
-		if(text.arr[i-1]<=32 && text.arr[i]>32) newNumCols++;
-	}
-
-	ResizeMatrix(newNumCols,numLines);
-
-	//Maximum length of the line
-	intType maxLength=0;
-	intType curMaxLength=0;
-	for(int64 i=0;i<=textLength;i++)
-	{
-		if(i<textLength && text.arr[i]!=10)	curMaxLength++;
-		else
+	CTextCodec::ParseTable<theType>(text.begin(),text.GetNumPoints(),
+		[this](long long newCols, long long newRows)
 		{
-			if(curMaxLength>maxLength) {maxLength=curMaxLength;}
-			curMaxLength=0;
-		}
-	}
-	if(curMaxLength>maxLength) maxLength=curMaxLength;
+			ResizeMatrix((intType)newCols,(intType)newRows);
+			theArray=(theType)0;						//Short rows are padded with zeros
+		},
+		[this](long long col, long long row, theType val) {ElementAt((intType)col,(intType)row)=val;});
 
-	//Strings for current line and current element
-	char* curLine=new char[maxLength+1];
-	char* curElement=new char[maxLength+1];
-	
-	int64 numBufferedInLine=0;
-	int64 numBufferedInElement=0;
-	int64 curPosInText=0;
-	int64 curPosInLine=0;
-
-	intType curCol=0;
-	intType curRow=0;
-
-	while(curPosInText<textLength)
-	{
-		while(curPosInText<textLength && text.arr[curPosInText]!=10)		//copy current line to curLine
-		{
-			curLine[curPosInLine++]=text.arr[curPosInText++];
-		}
-		curPosInText++;
-		numBufferedInLine=curPosInLine;
-		curPosInLine=0;
-	
-		while(curPosInLine<numBufferedInLine)	
-		{
-			while(curPosInLine<numBufferedInLine && curLine[curPosInLine]<=32) curPosInLine++;	//remove leading blanks				
-			
-			while(curPosInLine<numBufferedInLine && curLine[curPosInLine]>32)				//read meaningful characters
-			{
-				curElement[numBufferedInElement++]=curLine[curPosInLine++];
-			}
-			curPosInLine++;
-			curElement[numBufferedInElement]=NULL;
-
-			if(numBufferedInElement>0) {ElementAt(curCol,curRow)=(theType)atof(curElement);}
-	
-			numBufferedInElement=0;
-			curCol++;
-		}
-		curRow++;
-		curCol=0;
-
-		numBufferedInLine=0;
-		curPosInLine=0;
-	}
-	
-	delete[] curLine;
-	delete[] curElement;
 	return true;
 }
 
@@ -1485,14 +1251,7 @@ void CMatrix<theType,intType>::CopyTransposeFrom(CMatrix<theType, intType>& rhs)
 template <class theType, class intType>
 void CMatrix<theType,intType>::HelperCopyTransposeFrom(CHArray<theType,intType>& arr, intType targetCols, intType targetRows)
 {
-	intType curPoint=0;
-	for(intType rowCounter=0;rowCounter<targetRows;rowCounter++)
-	{
-		for(intType colCounter=0;colCounter<targetCols;colCounter++)
-		{
-			theArray.arr[curPoint++]=arr.arr[colCounter*targetRows+rowCounter];
-		}
-	}
+	CArrayKernel<theType>::Transpose(arr.arr,targetRows,targetCols,targetRows,theArray.arr,targetCols);
 }
 
 template <class theType, class intType>
@@ -1520,6 +1279,9 @@ void CMatrix<theType,intType>::CopyFromMatrix(const CMatrix<theType,intType>& rh
 template <class theType, class intType>		//double
 BString CMatrix<theType,intType>::FullSVD(CHArray<double,intType>& values, CMatrix<double,intType>& leftVecs, CMatrix<double,intType>& rightVecs)
 {
+#ifdef LABGENIE_NO_MKL
+	return "FullSVD: needs MKL.";
+#else
 	intType numVals=std::min(rows,cols);				//number of singular values and vectors
 
 	if(values.GetSize()<numVals) values.ResizeArray(numVals);
@@ -1553,11 +1315,15 @@ BString CMatrix<theType,intType>::FullSVD(CHArray<double,intType>& values, CMatr
 	if(info==0) return "DGESVD: ok.\n";
 	if(info<0) return "DGESVD: illegal argument value.\n";
 	/*if(info>0)*/ return "DGESVD: incomplete convergence.\n";
+#endif
 }
 
 template <class theType, class intType>		//float
 BString CMatrix<theType,intType>::FullSVD(CHArray<float,intType>& values, CMatrix<float,intType>& leftVecs, CMatrix<float,intType>& rightVecs)
 {
+#ifdef LABGENIE_NO_MKL
+	return "FullSVD: needs MKL.";
+#else
 	intType numVals=std::min(rows,cols);				//number of singular values and vectors
 
 	if(values.GetSize()<numVals) values.ResizeArray(numVals);
@@ -1591,11 +1357,15 @@ BString CMatrix<theType,intType>::FullSVD(CHArray<float,intType>& values, CMatri
 	if(info==0) return "SGESVD: ok.\n";
 	if(info<0) return "SGESVD: illegal argument value.\n";
 	/*if(info>0)*/ return "SGESVD: incomplete convergence.\n";
+#endif
 }
 
 template <class theType, class intType>		//float
 BString CMatrix<theType,intType>::SVD(char leftRight, CHArray<float,intType>& values)
 {
+#ifdef LABGENIE_NO_MKL
+	return "SVD: needs MKL.";
+#else
 	intType numVals=std::min(rows,cols);				//number of singular values
 	
 	if(values.GetSize()<numVals) values.ResizeArray(numVals);
@@ -1630,11 +1400,15 @@ BString CMatrix<theType,intType>::SVD(char leftRight, CHArray<float,intType>& va
 	if(info==0) return "SGESVD: ok.\n";
 	if(info<0) return "SGESVD: illegal argument value.\n";
 	/*if(info>0)*/ return "SGESVD: incomplete convergence.\n";
+#endif
 }
 
 template <class theType, class intType>		//double
 BString CMatrix<theType,intType>::SVD(char leftRight, CHArray<double,intType>& values)
 {
+#ifdef LABGENIE_NO_MKL
+	return "SVD: needs MKL.";
+#else
 	intType numVals=std::min(rows,cols);				//number of singular values
 
 	if(values.GetSize()<numVals) values.ResizeArray(numVals);
@@ -1668,6 +1442,7 @@ BString CMatrix<theType,intType>::SVD(char leftRight, CHArray<double,intType>& v
 	if(info==0) return "DGESVD: ok.\n";
 	if(info<0) return "DGESVD: illegal argument value.\n";
 	/*if(info>0)*/ return "DGESVD: incomplete convergence.\n";
+#endif
 }
 
 template <class theType, class intType>		//float
@@ -1681,6 +1456,20 @@ bool CMatrix<theType,intType>::EigenRRR(intType n, CHArray<float,intType>& value
 
 	if((vectors.cols!=n)||(vectors.rows)!=rows) vectors.ResizeMatrix(n,rows);
 
+#ifdef LABGENIE_NO_MKL
+	//Full eigensystem, then the n lowest or largest
+	CHArray<float,intType> allValues(rows,true);
+	bool fResult=CLinearAlgebra::SymmetricEigen(rows,theArray.arr,rows,allValues.arr);
+
+	intType first=fLargest ? rows-n : 0;
+	for(intType i=0;i<n;i++)
+	{
+		values.arr[i]=allValues.arr[first+i];
+		memcpy(vectors.theArray.arr+i*rows,theArray.arr+(first+i)*rows,rows*sizeof(theType));
+	}
+
+	return fResult;
+#else
 	float vl;		//Unused
 	float vu;		//Unused
 
@@ -1724,6 +1513,7 @@ bool CMatrix<theType,intType>::EigenRRR(intType n, CHArray<float,intType>& value
 
 	if(!info) return true;
 	else return false;
+#endif
 }
 
 template <class theType, class intType>	//double
@@ -1737,6 +1527,20 @@ bool CMatrix<theType,intType>::EigenRRR(intType n, CHArray<double,intType>& valu
 
 	if((vectors.cols!=n)||(vectors.rows)!=rows) vectors.ResizeMatrix(n,rows);
 
+#ifdef LABGENIE_NO_MKL
+	//Full eigensystem, then the n lowest or largest
+	CHArray<double,intType> allValues(rows,true);
+	bool fResult=CLinearAlgebra::SymmetricEigen(rows,theArray.arr,rows,allValues.arr);
+
+	intType first=fLargest ? rows-n : 0;
+	for(intType i=0;i<n;i++)
+	{
+		values.arr[i]=allValues.arr[first+i];
+		memcpy(vectors.theArray.arr+i*rows,theArray.arr+(first+i)*rows,rows*sizeof(theType));
+	}
+
+	return fResult;
+#else
 	double vl;		//Unused
 	double vu;		//Unused
 	
@@ -1780,6 +1584,7 @@ bool CMatrix<theType,intType>::EigenRRR(intType n, CHArray<double,intType>& valu
 
 	if(!info) return true;
 	else return false;
+#endif
 }
 
 //Finds column (fCol=true) or row (fCol=false) singular vectors
@@ -1825,6 +1630,10 @@ BString CMatrix<theType,intType>::EigenDAC(CHArray<double,intType>& evalues)
 	if(evalues.GetSize()<cols) evalues.ResizeArray(cols);
 	evalues.SetNumPoints(cols);
 
+#ifdef LABGENIE_NO_MKL
+	if(CLinearAlgebra::SymmetricEigen(cols,theArray.arr,cols,evalues.arr)) return "Jacobi: OK.\n";
+	else return "Jacobi: unusual termination.\n";
+#else
 	intType lwork=-1;
 	intType liwork=-1;
 	double* work=new double[5];
@@ -1846,6 +1655,7 @@ BString CMatrix<theType,intType>::EigenDAC(CHArray<double,intType>& evalues)
 	delete[] iwork;
 	if(!info) return "Dsyevd: OK.\n";
 	else return "Dsyevd: unusual termination.\n";
+#endif
 }
 
 template <class theType, class intType>
@@ -1856,6 +1666,10 @@ BString CMatrix<theType,intType>::EigenDAC(CHArray<float,intType>& evalues)		//f
 	if(evalues.GetSize()<cols) evalues.ResizeArray(cols);
 	evalues.SetNumPoints(cols);
 
+#ifdef LABGENIE_NO_MKL
+	if(CLinearAlgebra::SymmetricEigen(cols,theArray.arr,cols,evalues.arr)) return "Jacobi: OK.\n";
+	else return "Jacobi: unusual termination.\n";
+#else
 	intType lwork=-1;
 	intType liwork=-1;
 	float* work=new float[5];
@@ -1877,6 +1691,7 @@ BString CMatrix<theType,intType>::EigenDAC(CHArray<float,intType>& evalues)		//f
 	delete[] iwork;
 	if(!info) return "Ssyevd: OK.\n";
 	else return "Ssyevd: unusual termination.\n";
+#endif
 }
 
 //Permute columns according to the provided permutation
@@ -1885,19 +1700,58 @@ void CMatrix<theType,intType>::PermuteColumns(const CHArray<intType,intType>& pe
 {
 	if(perm.Count()!=cols) return;
 
-	CMatrix<theType,intType> tempMat(*this);
+	//Cycles only close if perm hits every column exactly once
+	CHArray<char,intType> fDone(cols,true);
+	fDone=0;
+	bool fBijection=true;
 	for(intType i=0;i<cols;i++)
 	{
-		(*this)[i]=tempMat[perm[i]];
+		if(perm[i]<0 || perm[i]>=cols) return;
+		if(fDone[perm[i]]) fBijection=false;
+		fDone[perm[i]]=1;
+	}
+
+	//Repeated columns: gather from a copy, as before
+	if(!fBijection)
+	{
+		CMatrix<theType,intType> tempMat(*this);
+		for(intType i=0;i<cols;i++) (*this)[i]=tempMat[perm[i]];
+		return;
+	}
+
+	//In place, cycle by cycle, with one column of extra memory
+	CHArray<theType,intType> temp(rows,true);
+	fDone=0;
+	size_t colBytes=sizeof(theType)*rows;
+	for(intType start=0;start<cols;start++)
+	{
+		if(fDone[start] || perm[start]==start) continue;
+
+		memcpy(temp.arr,colArrays[start].arr,colBytes);
+		intType cur=start;
+		while(perm[cur]!=start)
+		{
+			memcpy(colArrays[cur].arr,colArrays[perm[cur]].arr,colBytes);
+			fDone[cur]=1;
+			cur=perm[cur];
+		}
+		memcpy(colArrays[cur].arr,temp.arr,colBytes);
+		fDone[cur]=1;
 	}
 }
 
 template <class theType, class intType>
 void CMatrix<theType,intType>::Transpose()
 {
+	if(rows==cols)
+	{
+		CArrayKernel<theType>::TransposeSquare(theArray.arr,rows,rows);
+		return;
+	}
+
 	CHArray<theType,intType> copy(theArray);
 	HelperCopyTransposeFrom(copy,cols,rows);
-	if(rows!=cols) ResizeMatrix(rows,cols);
+	ResizeMatrix(rows,cols);
 }
 
 template <class theType, class intType>
@@ -1929,14 +1783,21 @@ CHArray<theType,intType>& CMatrix<theType,intType>::MatVecMultiply(CHArray<doubl
 {
 	const CMatrix<theType,intType>& A=*this;
 
-	char transA;
+	if(fTransposeA)	result.ResizeIfSmaller(cols,true);
+	else			result.ResizeIfSmaller(rows,true);
 
-	if(fTransposeA)	{transA='T';result.ResizeIfSmaller(cols,true);}
-	else			{transA='N';result.ResizeIfSmaller(rows,true);}
+#ifndef LABGENIE_NO_MKL
+	if(CLinearAlgebra::Backend()==CLinearAlgebra::backend_mkl)
+	{
+		char transA=fTransposeA ? 'T' : 'N';
+		intType incVec=1;		//Spacing in vec array
+		intType incResult=1;	//Spacing in result array
+		dgemv(&transA,&A.rows,&A.cols,&alpha,A.theArray.arr,&A.rows/*lda*/,vec.arr,&incVec,&beta,result.arr,&incResult);
+		return result;
+	}
+#endif
 
-	intType incVec=1;		//Spacing in vec array
-	intType incResult=1;	//Spacing in result array
-	dgemv(&transA,&A.rows,&A.cols,&alpha,A.theArray.arr,&A.rows/*lda*/,vec.arr,&incVec,&beta,result.arr,&incResult);
+	CLinearAlgebra::Gemv(fTransposeA,A.rows,A.cols,alpha,A.theArray.arr,A.rows,vec.arr,beta,result.arr);
 
 	return result;
 }
@@ -1947,14 +1808,21 @@ CHArray<theType,intType>& CMatrix<theType,intType>::MatVecMultiply(CHArray<float
 {
 	const CMatrix<theType,intType>& A=*this;
 
-	char transA;
+	if(fTransposeA)	result.ResizeIfSmaller(cols,true);
+	else			result.ResizeIfSmaller(rows,true);
 
-	if(fTransposeA)	{transA='T';result.ResizeIfSmaller(cols,true);}
-	else			{transA='N';result.ResizeIfSmaller(rows,true);}
+#ifndef LABGENIE_NO_MKL
+	if(CLinearAlgebra::Backend()==CLinearAlgebra::backend_mkl)
+	{
+		char transA=fTransposeA ? 'T' : 'N';
+		intType incVec=1;		//Spacing in vec array
+		intType incResult=1;	//Spacing in result array
+		sgemv(&transA,&A.rows,&A.cols,&alpha,A.theArray.arr,&A.rows/*lda*/,vec.arr,&incVec,&beta,result.arr,&incResult);
+		return result;
+	}
+#endif
 
-	intType incVec=1;		//Spacing in vec array
-	intType incResult=1;	//Spacing in result array
-	sgemv(&transA,&A.rows,&A.cols,&alpha,A.theArray.arr,&A.rows/*lda*/,vec.arr,&incVec,&beta,result.arr,&incResult);
+	CLinearAlgebra::Gemv(fTransposeA,A.rows,A.cols,alpha,A.theArray.arr,A.rows,vec.arr,beta,result.arr);
 
 	return result;
 }
@@ -1967,21 +1835,33 @@ CMatrix<theType,intType>& CMatrix<theType,intType>::MatMultiply(const CMatrix<do
 	
 	intType a_cols, a_rows, b_cols, b_rows;					 //Number of rows and cols, mathematically
 
-	char transA;
-	char transB;
+	if(fTransposeA){a_cols=A.rows;a_rows=A.cols;}
+	else {a_cols=A.cols;a_rows=A.rows;}
 
-	if(fTransposeA){a_cols=A.rows;a_rows=A.cols;transA='T';}
-	else {a_cols=A.cols;a_rows=A.rows;transA='N';}
-
-	if(fTransposeB){b_cols=B.rows;b_rows=B.cols;transB='T';}
-	else {b_cols=B.cols;b_rows=B.rows;transB='N';}
+	if(fTransposeB){b_cols=B.rows;b_rows=B.cols;}
+	else {b_cols=B.cols;b_rows=B.rows;}
 
 	if(a_cols!=b_rows) return C;						//Dimensional mismatch
 
 	if((C.rows!=a_rows)||(C.cols!=b_cols)) C.ResizeMatrix(b_cols,a_rows);
 
-	dgemm(&transA, &transB, &a_rows, &b_cols, &a_cols, &alpha,
-		A.theArray.arr, &A.rows/*lda*/, B.theArray.arr, &B.rows/*ldb*/, &beta, C.theArray.arr, &C.rows/*ldc*/);
+#ifndef LABGENIE_NO_MKL
+	if(CLinearAlgebra::Backend()==CLinearAlgebra::backend_mkl)
+	{
+		char transA=fTransposeA ? 'T' : 'N';
+		char transB=fTransposeB ? 'T' : 'N';
+		dgemm(&transA, &transB, &a_rows, &b_cols, &a_cols, &alpha,
+			A.theArray.arr, &A.rows/*lda*/, B.theArray.arr, &B.rows/*ldb*/, &beta, C.theArray.arr, &C.rows/*ldc*/);
+		return C;
+	}
+#endif
+
+	//A.Transpose(A) and Transpose(A).A only need half of the work (C is not read, so it need not be symmetric)
+	if((const void*)&B==(const void*)&A && fTransposeA!=fTransposeB && beta==0)
+		CLinearAlgebra::Syrk(fTransposeA,a_rows,a_cols,alpha,A.theArray.arr,A.rows,beta,C.theArray.arr,C.rows);
+	else
+		CLinearAlgebra::Gemm(fTransposeA,fTransposeB,a_rows,b_cols,a_cols,alpha,
+			A.theArray.arr,A.rows,B.theArray.arr,B.rows,beta,C.theArray.arr,C.rows);
 
 	return C;
 }
@@ -1994,21 +1874,33 @@ CMatrix<theType,intType>& CMatrix<theType,intType>::MatMultiply(const CMatrix<fl
 	
 	intType a_cols, a_rows, b_cols, b_rows;					 //Number of rows and cols, mathematically
 
-	char transA;
-	char transB;
+	if(fTransposeA){a_cols=A.rows;a_rows=A.cols;}
+	else {a_cols=A.cols;a_rows=A.rows;}
 
-	if(fTransposeA){a_cols=A.rows;a_rows=A.cols;transA='T';}
-	else {a_cols=A.cols;a_rows=A.rows;transA='N';}
-
-	if(fTransposeB){b_cols=B.rows;b_rows=B.cols;transB='T';}
-	else {b_cols=B.cols;b_rows=B.rows;transB='N';}
+	if(fTransposeB){b_cols=B.rows;b_rows=B.cols;}
+	else {b_cols=B.cols;b_rows=B.rows;}
 
 	if(a_cols!=b_rows) return C;						//Dimensional mismatch
 
 	if((C.rows!=a_rows)||(C.cols!=b_cols)) C.ResizeMatrix(b_cols,a_rows);
 
-	sgemm(&transA, &transB, &a_rows, &b_cols, &a_cols, &alpha,
-		A.theArray.arr, &A.rows/*lda*/, B.theArray.arr, &B.rows/*ldb*/, &beta, C.theArray.arr, &C.rows/*ldc*/);
+#ifndef LABGENIE_NO_MKL
+	if(CLinearAlgebra::Backend()==CLinearAlgebra::backend_mkl)
+	{
+		char transA=fTransposeA ? 'T' : 'N';
+		char transB=fTransposeB ? 'T' : 'N';
+		sgemm(&transA, &transB, &a_rows, &b_cols, &a_cols, &alpha,
+			A.theArray.arr, &A.rows/*lda*/, B.theArray.arr, &B.rows/*ldb*/, &beta, C.theArray.arr, &C.rows/*ldc*/);
+		return C;
+	}
+#endif
+
+	//A.Transpose(A) and Transpose(A).A only need half of the work (C is not read, so it need not be symmetric)
+	if((const void*)&B==(const void*)&A && fTransposeA!=fTransposeB && beta==0)
+		CLinearAlgebra::Syrk(fTransposeA,a_rows,a_cols,alpha,A.theArray.arr,A.rows,beta,C.theArray.arr,C.rows);
+	else
+		CLinearAlgebra::Gemm(fTransposeA,fTransposeB,a_rows,b_cols,a_cols,alpha,
+			A.theArray.arr,A.rows,B.theArray.arr,B.rows,beta,C.theArray.arr,C.rows);
 
 	return C;
 }
@@ -2041,6 +1933,46 @@ numRowsAdded(theMat.numRowsAdded)
 	SetColArrays();
 }
 
+//A virtual matrix does not own its storage and is copied instead
+template <class theType, class intType>
+CMatrix<theType,intType>::CMatrix(CMatrix<theType,intType>&& theMat):
+cols(theMat.cols),
+rows(theMat.rows),
+numRowsAdded(theMat.numRowsAdded),
+theArray(std::move(theMat.theArray))
+{
+	SetColArrays();
+
+	if(theMat.theArray.IsVirtual()) return;
+
+	theMat.cols=0;
+	theMat.rows=0;
+	theMat.numRowsAdded=0;
+	theMat.SetColArrays();
+}
+
+template <class theType, class intType>
+CMatrix<theType,intType>& CMatrix<theType,intType>::operator=(CMatrix<theType,intType>&& rhs)
+{
+	if(&rhs==this) return *this;
+
+	//Virtual matrices keep copy semantics
+	if(theArray.IsVirtual() || rhs.theArray.IsVirtual()) return (*this)=(const CMatrix<theType,intType>&)rhs;
+
+	cols=rhs.cols;
+	rows=rhs.rows;
+	numRowsAdded=rhs.numRowsAdded;
+	theArray=std::move(rhs.theArray);
+	SetColArrays();
+
+	rhs.cols=0;
+	rhs.rows=0;
+	rhs.numRowsAdded=0;
+	rhs.SetColArrays();
+
+	return *this;
+}
+
 template <class theType, class intType>
 void CMatrix<theType,intType>::GetRow(intType rowNum, CHArray<theType,intType>& result) const
 {
@@ -2048,10 +1980,12 @@ void CMatrix<theType,intType>::GetRow(intType rowNum, CHArray<theType,intType>&
 
 	if(result.GetSize()<cols) result.ResizeArray(cols);
 
+	//A single row is strided by nature - use ExportRowsToArrayOfArrays or CopyTransposeFrom for many rows
 	result.SetNumPoints(cols);
-	for(intType counter1=0;counter1<cols;counter1++)
+	const theType* source=theArray.arr+rowNum;
+	for(intType counter1=0;counter1<cols;counter1++,source+=rows)
 	{
-		result.arr[counter1]=theArray.arr[counter1*rows+rowNum];
+		result.arr[counter1]=*source;
 	}
 
 	return;
@@ -2079,9 +2013,10 @@ void CMatrix<theType,intType>::SetRow(intType rowNum, const CHArray<theType,intT
 	if(rowNum>(rows-1)) return;
 	if(source.GetNumPoints()!=cols) return;
 
-	for(intType counter1=0;counter1<cols;counter1++)
+	theType* target=theArray.arr+rowNum;
+	for(intType counter1=0;counter1<cols;counter1++,target+=rows)
 	{
-		theArray.arr[counter1*rows+rowNum]=source.arr[counter1];
+		*target=source.arr[counter1];
 	}
 
 	return;
@@ -2285,3 +2220,6 @@ bool CMatrix<theType,intType>::WriteStrings(const BString& fileName, bool fOnlyA
 
 	return charArr.WriteBinary(fileName);
 }
+
+//Randomized truncated SVD, streaming over column chunks
+#include "RandomizedSVD.h"
@@ -0,0 +1,374 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Parallel sorting kernels behind the CHArray sorts
+//RadixSort: parallel LSD radix sort for numeric keys (integers of any sign, float, double),
+//optionally carrying a payload (e.g. indices) along - stable, no comparisons at all
+//Sort: parallel comparison sort - chunks are sorted on separate threads and merged pairwise
+//Permute: in-place cycle-following permutation, one bit of extra memory per element
+//SortValues/SortIndices pick radix sort for numeric types and the comparison sort for everything else
+
+#pragma once
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <type_traits>
+#include <functional>
+#include <string.h>
+
+//VS2013 has no thread_local; a thread-local POD is supported by both compilers
+#ifdef _MSC_VER
+#define PARALLEL_SORT_THREAD __declspec(thread)
+#else
+#define PARALLEL_SORT_THREAD __thread
+#endif
+
+class CParallelSort
+{
+public:
+	static int NumThreads()
+	{
+		if(SerialDepth()>0) return 1;
+		if(ThreadSetting()>0) return ThreadSetting();
+		int hw=(int)std::thread::hardware_concurrency();
+		return hw>0 ? hw : 1;
+	}
+	static void SetNumThreads(int theNumThreads) {ThreadSetting()=theNumThreads;}	//0 - use all cores
+
+	//While one is alive, NumThreads() is 1 on the calling thread, so nested sorts and products stay on it
+	//The workers of a CTaskPool hold one: all cores are already busy with tasks
+	class CSerialScope
+	{
+	public:
+		explicit CSerialScope(bool theSerial=true):fSerial(theSerial) {if(fSerial) SerialDepth()++;}
+		~CSerialScope() {if(fSerial) SerialDepth()--;}
+
+	private:
+		bool fSerial;
+	};
+
+	//Below this size everything runs on the calling thread
+	static const long long minParallelSize=1<<16;
+	//Below this size std::sort beats the radix passes
+	static const long long minRadixSize=1<<10;
+
+	//Types RadixSort can handle
+	template <class theType> struct IsRadixSortable : std::integral_constant<bool,
+		std::is_integral<theType>::value || (std::is_floating_point<theType>::value && sizeof(theType)<=8)> {};
+
+	//Sorts values in place, ascending or descending
+	template <class theType>
+	static void SortValues(theType* p, long long n, bool fDescending)
+	{SortValues(p,n,fDescending,IsRadixSortable<theType>());}
+
+	//Sorts indices by values[indices[i]]; radix sort is always stable, fStable matters for other types only
+	template <class theType, class intType>
+	static void SortIndices(const theType* values, intType* indices, long long n, bool fDescending, bool fStable)
+	{SortIndices(values,indices,n,fDescending,fStable,IsRadixSortable<theType>());}
+
+	//Stable sort that moves payload[i] along with keys[i]
+	template <class theType, class payloadType>
+	static void SortWithPayload(theType* keys, payloadType* payload, long long n, bool fDescending)
+	{SortWithPayload(keys,payload,n,fDescending,IsRadixSortable<theType>());}
+
+	//Sorts keys[0..n) in place; payload (may be 0) is permuted along with the keys
+	template <class keyType, class payloadType>
+	static void RadixSort(keyType* keys, payloadType* payload, long long n, bool fDescending);
+
+	template <class keyType>
+	static void RadixSort(keyType* keys, long long n, bool fDescending) {RadixSort(keys,(int*)0,n,fDescending);}
+
+	//Comparison sort; fStable keeps the order of equal elements
+	template <class theType, class compType>
+	static void Sort(theType* p, long long n, compType comp, bool fStable);
+
+	//p[i] = old p[perm[i]]; returns false and leaves p untouched if perm is not a permutation of 0..n-1
+	template <class theType, class intType>
+	static bool Permute(theType* p, const intType* perm, long long n);
+
+	//Runs func(threadNum) for threadNum=0..threads-1, thread 0 on the calling thread
+	template <class funcType>
+	static void ParallelFor(int threads, funcType func)
+	{
+		std::vector<std::thread> workers;
+		for(int t=1; t<threads; t++) workers.push_back(std::thread(func,t));
+		func(0);
+		for(auto& cur : workers) cur.join();
+	}
+
+private:
+	template <class theType>
+	static void SortValues(theType* p, long long n, bool fDescending, std::true_type)
+	{
+		if(n>=minRadixSize) RadixSort(p,n,fDescending);
+		else if(fDescending) std::sort(p,p+n,std::greater<theType>());
+		else std::sort(p,p+n);
+	}
+
+	template <class theType>
+	static void SortValues(theType* p, long long n, bool fDescending, std::false_type)
+	{
+		if(fDescending) Sort(p,n,std::greater<theType>(),false);
+		else Sort(p,n,std::less<theType>(),false);
+	}
+
+	//The radix sort is always stable, so the stability flag does not matter here
+	template <class theType, class intType>
+	static void SortIndices(const theType* values, intType* indices, long long n, bool fDescending, bool /*fStable*/, std::true_type)
+	{
+		std::vector<theType> keys((size_t)n);
+		for(long long i=0; i<n; i++) keys[(size_t)i]=values[indices[i]];
+		RadixSort(keys.data(),indices,n,fDescending);
+	}
+
+	template <class theType, class intType>
+	static void SortIndices(const theType* values, intType* indices, long long n, bool fDescending, bool fStable, std::false_type)
+	{
+		if(fDescending) Sort(indices,n,[values](const intType& a, const intType& b)->bool{return values[a] > values[b];},fStable);
+		else Sort(indices,n,[values](const intType& a, const intType& b)->bool{return values[a] < values[b];},fStable);
+	}
+
+	template <class theType, class payloadType>
+	static void SortWithPayload(theType* keys, payloadType* payload, long long n, bool fDescending, std::true_type)
+	{RadixSort(keys,payload,n,fDescending);}
+
+	template <class theType, class payloadType>
+	static void SortWithPayload(theType* keys, payloadType* payload, long long n, bool fDescending, std::false_type)
+	{
+		std::vector<long long> order((size_t)n);
+		for(long long i=0; i<n; i++) order[(size_t)i]=i;
+		SortIndices(keys,order.data(),n,fDescending,true,std::false_type());
+		Permute(keys,order.data(),n);
+		if(payload) Permute(payload,order.data(),n);
+	}
+
+	//Constant-initialized, so safe without thread-safe statics
+	static int& ThreadSetting() {static int numThreads=0; return numThreads;}
+	static int& SerialDepth() {static PARALLEL_SORT_THREAD int depth=0; return depth;}
+
+	template <int size> struct UnsignedOfSize {};
+	template <class keyType> struct RadixKey;
+};
+
+template <> struct CParallelSort::UnsignedOfSize<1> {typedef unsigned char type;};
+template <> struct CParallelSort::UnsignedOfSize<2> {typedef unsigned short type;};
+template <> struct CParallelSort::UnsignedOfSize<4> {typedef unsigned int type;};
+template <> struct CParallelSort::UnsignedOfSize<8> {typedef unsigned long long type;};
+
+//Maps a key to an unsigned integer with the same ordering
+template <class keyType> struct CParallelSort::RadixKey
+{
+	typedef typename UnsignedOfSize<sizeof(keyType)>::type bitsType;
+	static const bitsType signBit=(bitsType)((bitsType)1<<(8*sizeof(keyType)-1));
+
+	static bitsType Encode(keyType key)
+	{
+		if(std::is_floating_point<keyType>::value && key==0) key=0;	//Lose signed zeros
+
+		bitsType bits;
+		memcpy(&bits,&key,sizeof(key));
+
+		if(std::is_floating_point<keyType>::value) return (bits & signBit) ? (bitsType)~bits : (bitsType)(bits | signBit);
+		if(std::is_signed<keyType>::value) return (bitsType)(bits ^ signBit);
+		return bits;
+	}
+
+	static keyType Decode(bitsType bits)
+	{
+		if(std::is_floating_point<keyType>::value) bits=(bits & signBit) ? (bitsType)(bits & ~signBit) : (bitsType)~bits;
+		else if(std::is_signed<keyType>::value) bits=(bitsType)(bits ^ signBit);
+
+		keyType key;
+		memcpy(&key,&bits,sizeof(key));
+		return key;
+	}
+};
+
+template <class keyType, class payloadType>
+void CParallelSort::RadixSort(keyType* keys, payloadType* payload, long long n, bool fDescending)
+{
+	static_assert(std::is_arithmetic<keyType>::value, "RadixSort needs numeric keys");
+	typedef typename RadixKey<keyType>::bitsType bitsType;
+
+	if(n<2) return;
+
+	int threads=(n<minParallelSize) ? 1 : NumThreads();
+	long long slice=(n+threads-1)/threads;
+
+	//Descending order is ascending order of the inverted bits, which keeps the sort stable
+	std::vector<bitsType> bits((size_t)n), bitsCopy((size_t)n);
+	std::vector<payloadType> payloadCopy(payload ? (size_t)n : 0);
+	ParallelFor(threads,[&](int t)
+	{
+		long long from=t*slice, to=std::min(n,from+slice);
+		for(long long i=from; i<to; i++)
+		{
+			bitsType cur=RadixKey<keyType>::Encode(keys[i]);
+			bits[(size_t)i]=fDescending ? (bitsType)~cur : cur;
+		}
+	});
+
+	bitsType* src=bits.data();
+	bitsType* dst=bitsCopy.data();
+	payloadType* srcPayload=payload;
+	payloadType* dstPayload=payloadCopy.data();
+
+	std::vector<long long> counts((size_t)threads*256);
+
+	for(int byte=0; byte<(int)sizeof(bitsType); byte++)
+	{
+		int bitShift=8*byte;
+
+		//Per-thread histograms of the current byte
+		ParallelFor(threads,[&](int t)
+		{
+			long long* hist=counts.data()+t*256;
+			std::fill(hist,hist+256,0LL);
+			long long from=t*slice, to=std::min(n,from+slice);
+			for(long long i=from; i<to; i++) hist[(src[i]>>bitShift) & 0xFF]++;
+		});
+
+		//A byte that is the same in all keys does not change the order
+		bool fSkip=false;
+		for(int c=0; c<256; c++)
+		{
+			long long total=0;
+			for(int t=0; t<threads; t++) total+=counts[(size_t)(t*256+c)];
+			if(total==n) fSkip=true;
+			if(total!=0) break;
+		}
+		if(fSkip) continue;
+
+		//Exclusive prefix over (bucket, thread), so each thread writes its own stable range of every bucket
+		long long running=0;
+		for(int c=0; c<256; c++)
+			for(int t=0; t<threads; t++)
+			{
+				long long cur=counts[(size_t)(t*256+c)];
+				counts[(size_t)(t*256+c)]=running;
+				running+=cur;
+			}
+
+		ParallelFor(threads,[&](int t)
+		{
+			long long* offsets=counts.data()+t*256;
+			long long from=t*slice, to=std::min(n,from+slice);
+			for(long long i=from; i<to; i++)
+			{
+				long long pos=offsets[(src[i]>>bitShift) & 0xFF]++;
+				dst[pos]=src[i];
+				if(srcPayload) dstPayload[pos]=srcPayload[i];
+			}
+		});
+
+		std::swap(src,dst);
+		if(srcPayload) std::swap(srcPayload,dstPayload);
+	}
+
+	ParallelFor(threads,[&](int t)
+	{
+		long long from=t*slice, to=std::min(n,from+slice);
+		for(long long i=from; i<to; i++)
+		{
+			bitsType cur=fDescending ? (bitsType)~src[i] : src[i];
+			keys[i]=RadixKey<keyType>::Decode(cur);
+		}
+		if(srcPayload && srcPayload!=payload) for(long long i=from; i<to; i++) payload[i]=srcPayload[i];
+	});
+}
+
+template <class theType, class compType>
+void CParallelSort::Sort(theType* p, long long n, compType comp, bool fStable)
+{
+	int threads=(n<minParallelSize) ? 1 : NumThreads();
+
+	if(threads==1)
+	{
+		if(fStable) std::stable_sort(p,p+n,comp);
+		else std::sort(p,p+n,comp);
+		return;
+	}
+
+	//Sort the chunks
+	std::vector<long long> bounds(threads+1);
+	for(int t=0; t<=threads; t++) bounds[t]=n*t/threads;
+
+	ParallelFor(threads,[&](int t)
+	{
+		if(fStable) std::stable_sort(p+bounds[t],p+bounds[t+1],comp);
+		else std::sort(p+bounds[t],p+bounds[t+1],comp);
+	});
+
+	//Merge neighbors pairwise until one run is left, the left run wins ties so the merge is stable
+	std::vector<theType> buffer(p,p+n);
+	theType* src=p;
+	theType* dst=buffer.data();
+
+	for(int width=1; width<threads; width*=2)
+	{
+		int numMerges=(threads+2*width-1)/(2*width);
+		ParallelFor(numMerges,[&](int m)
+		{
+			int left=2*m*width;
+			int mid=std::min(left+width,threads);
+			int right=std::min(left+2*width,threads);
+			std::merge(src+bounds[left],src+bounds[mid],src+bounds[mid],src+bounds[right],dst+bounds[left],comp);
+		});
+		std::swap(src,dst);
+	}
+
+	if(src!=p) std::copy(src,src+n,p);
+}
+
+template <class theType, class intType>
+bool CParallelSort::Permute(theType* p, const intType* perm, long long n)
+{
+	std::vector<bool> done((size_t)n,false);
+
+	//Check that perm hits every index exactly once, otherwise the cycles below would not close
+	for(long long i=0; i<n; i++)
+	{
+		long long target=(long long)perm[i];
+		if(target<0 || target>=n || done[(size_t)target]) return false;
+		done[(size_t)target]=true;
+	}
+	done.assign((size_t)n,false);
+
+	for(long long start=0; start<n; start++)
+	{
+		if(done[(size_t)start]) continue;
+
+		//Pull values along the cycle that starts here
+		theType first=std::move(p[start]);
+		long long cur=start;
+		while(true)
+		{
+			done[(size_t)cur]=true;
+			long long next=(long long)perm[cur];
+			if(next==start) {p[cur]=std::move(first); break;}
+			p[cur]=std::move(p[next]);
+			cur=next;
+		}
+	}
+
+	return true;
+}
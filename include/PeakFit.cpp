@@ -0,0 +1,295 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "PeakFit.h"
+#include <math.h>
+#include <thread>
+#include <atomic>
+#include <vector>
+
+CPeakFit::CPeakFit(int theShape)
+{
+	shape = theShape;
+	fFitBaseline = true;
+	maxIterations = 200;
+	tolerance = 1e-8;
+
+	chiSquared = 0;
+	numIterations = 0;
+	fConverged = false;
+}
+
+BString CPeakFit::Fit(const CData& data, CHArray<FitPeak>& peaks, double& baseline)
+{
+	chiSquared = 0;
+	numIterations = 0;
+	fConverged = false;
+
+	CHArray<double> param;
+	PeaksToParams(peaks, baseline, param);
+
+	int numParams = param.Count();
+	int numPoints = data.Count();
+	if (numParams == 0) return "Fit: no peaks.";
+	if (numPoints <= numParams) return "Fit: not enough points.";
+
+	CHArray<double> model, residual, trialParam, trialModel, trialResidual;
+	CHArray<double> gradient(numParams), step(numParams);
+	CMatrix<double> jacobian(numParams, numPoints);
+	CMatrix<double> normal(numParams, numParams);
+
+	Model(data.xArr, param, model, &jacobian);
+	double chi = ChiSquared(data.yArr, model, residual);
+	double lambda = 1e-3;
+	bool fStalled = false;		//No step reduces chi squared, even a tiny gradient-descent one
+
+	for (numIterations = 0; numIterations < maxIterations; numIterations++)
+	{
+		//Normal equations: (J^T.J + lambda*diag(J^T.J)).step = J^T.r
+		jacobian.MatMultiply(jacobian, normal, true, false);
+		jacobian.MatVecMultiply(residual, gradient, true);
+		for (int i = 0; i < numParams; i++)
+		{
+			if (normal(i, i) == 0) normal(i, i) = 1e-12;
+			normal(i, i) *= 1 + lambda;
+		}
+
+		normal.SolveSPDLinearSystem(gradient, step);
+
+		trialParam = param;
+		for (int i = 0; i < numParams; i++) trialParam[i] += step[i];
+
+		double trialChi = chi;
+		if (ParamsValid(trialParam))
+		{
+			Model(data.xArr, trialParam, trialModel, 0);
+			trialChi = ChiSquared(data.yArr, trialModel, trialResidual);
+		}
+
+		if (trialChi < chi)
+		{
+			//Accepted step: move towards Gauss-Newton
+			double decrease = (chi - trialChi) / chi;
+
+			param = trialParam;
+			chi = trialChi;
+			residual = trialResidual;
+			lambda /= 10;
+
+			if (decrease < tolerance) { fConverged = true; break; }
+
+			Model(data.xArr, param, model, &jacobian);
+		}
+		else
+		{
+			//Rejected step: move towards gradient descent
+			//The normal matrix is rebuilt from the unchanged jacobian on the next iteration
+			lambda *= 10;
+			if (lambda > 1e12) { fStalled = true; break; }
+		}
+	}
+
+	ParamsToPeaks(param, peaks, baseline);
+	chiSquared = chi;
+
+	if (fConverged) return "Fit: OK.";
+	else if (fStalled) return "Fit: did not converge, no step reduces chi squared.";
+	else return "Fit: maximum number of iterations reached.";
+}
+
+int CPeakFit::FitMany(const CHArray<CData>& data, CHArray<CHArray<FitPeak>>& peaks, CHArray<double>& baselines,
+	CHArray<double>& finalChiSquared, CHArray<bool>& converged, int numThreads) const
+{
+	int numSpectra = data.Count();
+	if (peaks.Count() != numSpectra || baselines.Count() != numSpectra) return numSpectra;
+
+	finalChiSquared.ResizeIfSmaller(numSpectra, true);
+	converged.ResizeIfSmaller(numSpectra, true);
+	if (numSpectra == 0) return 0;
+
+	if (numThreads <= 0) numThreads = std::thread::hardware_concurrency();
+	if (numThreads <= 0) numThreads = 1;
+	if (numThreads > numSpectra) numThreads = numSpectra;
+
+	//Every thread takes the next unfitted spectrum until none are left
+	std::atomic<int> next(0);
+	std::atomic<int> numFailed(0);
+	auto worker = [&]()
+	{
+		CPeakFit fitter(*this);
+		for (int i = next++; i < numSpectra; i = next++)
+		{
+			fitter.Fit(data[i], peaks[i], baselines[i]);
+			finalChiSquared[i] = fitter.chiSquared;
+			converged[i] = fitter.fConverged;
+			if (!fitter.fConverged) numFailed++;
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < numThreads; i++) threads.push_back(std::thread(worker));
+	worker();
+
+	for (auto& cur : threads) cur.join();
+	return numFailed;
+}
+
+void CPeakFit::Evaluate(const CHArray<double>& x, const CHArray<FitPeak>& peaks, double baseline, CHArray<double>& result) const
+{
+	CHArray<double> param;
+	PeaksToParams(peaks, baseline, param);
+	Model(x, param, result, 0);
+}
+
+//Parameter layout: pos, width, amplitude (and eta for pseudo-Voigt) for every peak, then the baseline if it is fitted
+void CPeakFit::PeaksToParams(const CHArray<FitPeak>& peaks, double baseline, CHArray<double>& param) const
+{
+	int numParams = peaks.Count() * ParamsPerPeak() + (fFitBaseline ? 1 : 0);
+	param.ResizeIfSmaller(numParams);
+
+	for (auto& peak : peaks)
+	{
+		param << peak.pos << peak.width << peak.amplitude;
+		if (shape == peakShape_voigt) param << peak.eta;
+	}
+
+	if (fFitBaseline) param << baseline;
+}
+
+void CPeakFit::ParamsToPeaks(const CHArray<double>& param, CHArray<FitPeak>& peaks, double& baseline) const
+{
+	int perPeak = ParamsPerPeak();
+
+	for (int i = 0; i < peaks.Count(); i++)
+	{
+		const double* cur = param.arr + i * perPeak;
+		peaks[i].pos = cur[0];
+		peaks[i].width = cur[1];
+		peaks[i].amplitude = cur[2];
+		if (shape == peakShape_voigt) peaks[i].eta = cur[3];
+	}
+
+	if (fFitBaseline) baseline = param.Last();
+}
+
+//Widths should stay positive and the lorentzian fraction within 0..1
+bool CPeakFit::ParamsValid(const CHArray<double>& param) const
+{
+	int perPeak = ParamsPerPeak();
+	int numPeaks = (param.Count() - (fFitBaseline ? 1 : 0)) / perPeak;
+
+	for (int i = 0; i < numPeaks; i++)
+	{
+		const double* cur = param.arr + i * perPeak;
+		if (!(cur[1] > 0)) return false;
+		if (shape == peakShape_voigt && (cur[3] < 0 || cur[3] > 1)) return false;
+	}
+
+	return true;
+}
+
+void CPeakFit::Model(const CHArray<double>& x, const CHArray<double>& param, CHArray<double>& model, CMatrix<double>* jacobian) const
+{
+	const double ln2 = 0.693147180559945309;
+
+	int numPoints = x.Count();
+	int perPeak = ParamsPerPeak();
+	int numPeaks = (param.Count() - (fFitBaseline ? 1 : 0)) / perPeak;
+
+	model.ResizeIfSmaller(numPoints, true);
+	model = fFitBaseline ? param.Last() : 0;
+
+	const double* xp = x.arr;
+	double* mp = model.arr;
+
+	for (int peak = 0; peak < numPeaks; peak++)
+	{
+		const double* cur = param.arr + peak * perPeak;
+		double pos = cur[0];
+		double invWidth = 1 / cur[1];
+		double amplitude = cur[2];
+		double eta = (shape == peakShape_voigt) ? cur[3] : 0;
+
+		//Jacobian columns of this peak, or 0 if only the model is needed
+		double* dPos = 0;
+		double* dWidth = 0;
+		double* dAmp = 0;
+		double* dEta = 0;
+		if (jacobian)
+		{
+			dPos = (*jacobian)[peak * perPeak].arr;
+			dWidth = (*jacobian)[peak * perPeak + 1].arr;
+			dAmp = (*jacobian)[peak * perPeak + 2].arr;
+			if (shape == peakShape_voigt) dEta = (*jacobian)[peak * perPeak + 3].arr;
+		}
+
+		for (int i = 0; i < numPoints; i++)
+		{
+			double u = (xp[i] - pos) * invWidth;		//Distance from the peak in widths
+
+			//Gaussian and lorentzian with unit height and their derivatives with respect to u
+			double gauss = 0, gaussDu = 0, lor = 0, lorDu = 0;
+			if (shape != peakShape_lorentzian)
+			{
+				gauss = exp(-4 * ln2 * u * u);
+				gaussDu = -8 * ln2 * u * gauss;
+			}
+			if (shape != peakShape_gaussian)
+			{
+				lor = 1 / (1 + 4 * u * u);
+				lorDu = -8 * u * lor * lor;
+			}
+
+			double shapeVal = (1 - eta) * gauss + eta * lor;
+			double shapeDu = (1 - eta) * gaussDu + eta * lorDu;
+			if (shape == peakShape_lorentzian) { shapeVal = lor; shapeDu = lorDu; }
+
+			mp[i] += amplitude * shapeVal;
+
+			if (jacobian)
+			{
+				//du/dpos = -1/width, du/dwidth = -u/width
+				dPos[i] = -amplitude * shapeDu * invWidth;
+				dWidth[i] = -amplitude * shapeDu * u * invWidth;
+				dAmp[i] = shapeVal;
+				if (dEta) dEta[i] = amplitude * (lor - gauss);
+			}
+		}
+	}
+
+	if (jacobian && fFitBaseline) (*jacobian)[param.Count() - 1] = 1;
+}
+
+double CPeakFit::ChiSquared(const CHArray<double>& y, const CHArray<double>& model, CHArray<double>& residual) const
+{
+	int numPoints = model.Count();
+	residual.ResizeIfSmaller(numPoints, true);
+
+	double result = 0;
+	for (int i = 0; i < numPoints; i++)
+	{
+		residual[i] = y[i] - model[i];
+		result += residual[i] * residual[i];
+	}
+
+	return result;
+}
@@ -0,0 +1,93 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "Data.h"
+#include "Matrix.h"
+
+#define peakShape_gaussian 0
+#define peakShape_lorentzian 1
+#define peakShape_voigt 2			//Pseudo-Voigt: mix of a gaussian and a lorentzian with the same width
+
+//Parameters of a single peak
+//The shapes are the same as in CData::Gaussian and CData::Lorentzian with fNormalizeArea=false
+struct FitPeak
+{
+	FitPeak(){}
+
+	FitPeak(double thePos, double theWidth, double theAmplitude, double theEta = 0.5) :
+	pos(thePos), width(theWidth), amplitude(theAmplitude), eta(theEta) {}
+
+	double pos;
+	double width;			//FWHM
+	double amplitude;		//Peak height
+	double eta;				//Lorentzian fraction of pseudo-Voigt peaks, 0 to 1; not used by the other shapes
+};
+
+//Levenberg-Marquardt least-squares fit of a sum of peaks and a constant baseline to CData
+//The model and the jacobian are computed one peak at a time over the contiguous columns of the jacobian
+//Normal equations are solved with CMatrix::SolveSPDLinearSystem
+class CPeakFit
+{
+public:
+	CPeakFit(int theShape = peakShape_gaussian);
+	~CPeakFit(){}
+
+public:
+	//Fits the peaks to data starting from the initial guess in peaks and baseline
+	//The fitted values are written back into peaks and baseline
+	BString Fit(const CData& data, CHArray<FitPeak>& peaks, double& baseline);
+
+	//Fits many spectra in parallel, each from its own initial guess
+	//peaks and baselines should have the same number of elements as data
+	//finalChiSquared receives the final sum of squared residuals for every spectrum, converged - whether its fit converged
+	//Returns the number of fits that did not converge
+	//numThreads = 0 uses all hardware threads
+	int FitMany(const CHArray<CData>& data, CHArray<CHArray<FitPeak>>& peaks, CHArray<double>& baselines,
+		CHArray<double>& finalChiSquared, CHArray<bool>& converged, int numThreads = 0) const;
+
+	//Model curve at the points x
+	void Evaluate(const CHArray<double>& x, const CHArray<FitPeak>& peaks, double baseline, CHArray<double>& result) const;
+
+private:
+	int ParamsPerPeak() const { return shape == peakShape_voigt ? 4 : 3; }
+	void PeaksToParams(const CHArray<FitPeak>& peaks, double baseline, CHArray<double>& param) const;
+	void ParamsToPeaks(const CHArray<double>& param, CHArray<FitPeak>& peaks, double& baseline) const;
+	bool ParamsValid(const CHArray<double>& param) const;
+
+	//Computes the model and, if jacobian is not 0, its derivatives with respect to all parameters
+	//The jacobian has one column per parameter and one row per point
+	void Model(const CHArray<double>& x, const CHArray<double>& param, CHArray<double>& model, CMatrix<double>* jacobian) const;
+	double ChiSquared(const CHArray<double>& y, const CHArray<double>& model, CHArray<double>& residual) const;
+
+public:
+	int shape;
+	bool fFitBaseline;
+	int maxIterations;
+	double tolerance;			//Stops when the relative decrease in chi squared of an accepted step is below tolerance
+
+	//Results of the last call to Fit
+	double chiSquared;
+	int numIterations;
+	bool fConverged;
+};
@@ -24,6 +24,8 @@
 
 #include <QWidget>
 #include <QtCharts>
+#include <QDir>
+#include <QCoreApplication>
 
 #include "CwLineGroup.h"
 #include "CwEditGroup.h"
@@ -132,6 +134,12 @@ public:
 		int index = lines.Count() - 1;
 		CwLineGroup& cur = lines[index];
 
+		//Very long logs keep only their latest points in memory
+		BString spillFile;
+		spillFile.Format("%s/labgenie_%lld_%p_line%i", QDir::tempPath().toStdString().c_str(),
+			(long long)QCoreApplication::applicationPid(), (void*)this, index);
+		cur.SetSpillFile(spillFile, maxLinePointsInMemory);
+
 		CreateSeries(index);
 		return index;
 	}
@@ -150,8 +158,8 @@ public:
 		CData result;
 		if (lineNum < 0 || lineNum >= LineCount()) return result;
 
-		result.xArr = Line(lineNum).xArray;
-		result.yArr = Line(lineNum).yArray;
+		Line(lineNum).xArray.ExportTo(result.xArr);
+		Line(lineNum).yArray.ExportTo(result.yArr);
 		return result;
 	}
 
@@ -203,6 +211,8 @@ private:
 	CHArray<CwLineGroup> lines;
 	CHArray<QRgb> stdColors;
 
+	static const int64 maxLinePointsInMemory = (int64)1 << 22;		//Per axis, 32 MB of doubles
+
 private:
 	//Limit array - avoid reallocating each time
 	CHArray<double> limArray;
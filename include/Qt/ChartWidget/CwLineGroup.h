@@ -23,7 +23,7 @@
 #pragma once
 
 #include <QtCharts>
-#include "ArrayMinMax.h"
+#include "ChunkedArray.h"
 #include "Data.h"
 
 class CwLineGroup
@@ -65,7 +65,7 @@ public:
 		Redraw();
 	}
 	
-	int Count() const { return xArray.Count(); }
+	int Count() const { return (int)xArray.Count(); }
 	bool IsEmpty() const { return Count() == 0; }
 
 	void Clear()
@@ -94,7 +94,17 @@ public:
 		skipInterval = 2 * Count() / maxChartPoints + 1;
 		skipCounter = 1;
 
-		for (int i = 0; i < Count(); i += skipInterval) series->append(xArray[i], yArray[i]);
+		//Const access reads spilled points from the files without loading their chunks back
+		const CChunkedArrayMinMax<double>& xs = xArray;
+		const CChunkedArrayMinMax<double>& ys = yArray;
+		for (int i = 0; i < Count(); i += skipInterval) series->append(xs[i], ys[i]);
+	}
+
+	//Points beyond maxInMemory per axis go to fileBase+".x"/".y", the files are deleted when the line is cleared
+	void SetSpillFile(const BString& fileBase, int64 maxInMemory)
+	{
+		xArray.SetSpillFile(fileBase + ".x", maxInMemory);
+		yArray.SetSpillFile(fileBase + ".y", maxInMemory);
 	}
 
 	void SetVisible(bool fVisible) { series->setVisible(fVisible); }
@@ -124,8 +134,9 @@ public:
 
 public:
 	QLineSeries* series;
-	CHArrayMinMax<double> xArray;
-	CHArrayMinMax<double> yArray;
+	//Chunked storage - long live logs grow without reallocating and copying the whole line
+	CChunkedArrayMinMax<double> xArray;
+	CChunkedArrayMinMax<double> yArray;
 
 private:
 	//Maximum number of points to be plotted on screen
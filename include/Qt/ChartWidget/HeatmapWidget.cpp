@@ -0,0 +1,126 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "HeatmapWidget.h"
+#include <QPainter>
+#include <math.h>
+
+HeatmapWidget::HeatmapWidget(QWidget* parent) :
+QWidget(parent),
+palette(256)
+{
+	firstRow = 0;
+	lo = 0;
+	hi = 1;
+	fLogScale = false;
+
+	//Black - blue - red - yellow - white palette, interpolated between the anchor colors
+	int anchors[5][3] = { { 0, 0, 0 }, { 0, 0, 200 }, { 220, 0, 0 }, { 255, 220, 0 }, { 255, 255, 255 } };
+	for (int i = 0; i < 256; i++)
+	{
+		double pos = i * 4 / 255.0;
+		int k = (i == 255) ? 3 : int(pos);
+		double frac = pos - k;
+
+		int rgb[3];
+		for (int c = 0; c < 3; c++) rgb[c] = int(anchors[k][c] + frac * (anchors[k + 1][c] - anchors[k][c]) + 0.5);
+
+		palette << qRgb(rgb[0], rgb[1], rgb[2]);
+	}
+
+	ResizeMap(1, 1);
+}
+
+void HeatmapWidget::ResizeMap(int numCols, int numRows)
+{
+	if (numCols < 1) numCols = 1;
+	if (numRows < 1) numRows = 1;
+
+	image = QImage(numCols, numRows, QImage::Format_RGB32);
+	image.fill(palette[0]);
+	firstRow = 0;
+}
+
+void HeatmapWidget::SetRange(double theLo, double theHi, bool fLog)
+{
+	fLogScale = fLog;
+
+	if (fLogScale)
+	{
+		//Only positive values can be shown on the log scale
+		if (theHi <= 0) theHi = 1;
+		if (theLo <= 0 || theLo >= theHi) theLo = theHi * 1e-3;
+	}
+
+	if (theLo >= theHi) theHi = theLo + 1;
+
+	lo = theLo;
+	hi = theHi;
+}
+
+QRgb HeatmapWidget::ColorOf(double val) const
+{
+	double frac;
+
+	if (fLogScale)
+	{
+		if (val <= 0) return palette[0];
+		frac = log(val / lo) / log(hi / lo);
+	}
+	else frac = (val - lo) / (hi - lo);
+
+	int index = int(frac * 255 + 0.5);
+	if (index < 0) index = 0;
+	if (index > 255) index = 255;
+
+	return palette[index];
+}
+
+void HeatmapWidget::SetRow(int row, const float* vals)
+{
+	if (row < 0 || row >= image.height()) return;
+
+	QRgb* line = (QRgb*)image.scanLine(row);
+	for (int i = 0; i < image.width(); i++) line[i] = ColorOf(vals[i]);
+}
+
+void HeatmapWidget::paintEvent(QPaintEvent* event)
+{
+	QPainter painter(this);
+
+	QRect area = rect();
+	int numRows = image.height();
+
+	//Image rows firstRow...numRows-1 go to the top, rows 0...firstRow-1 to the bottom
+	int splitY = area.top() + int((double)area.height() * (numRows - firstRow) / numRows + 0.5);
+
+	painter.drawImage(QRect(area.left(), area.top(), area.width(), splitY - area.top()),
+		image, QRect(0, firstRow, image.width(), numRows - firstRow));
+
+	if (firstRow > 0)
+	{
+		painter.drawImage(QRect(area.left(), splitY, area.width(), area.bottom() + 1 - splitY),
+			image, QRect(0, 0, image.width(), firstRow));
+	}
+
+	QWidget::paintEvent(event);
+}
@@ -0,0 +1,60 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <QWidget>
+#include <QImage>
+
+#include "Array.h"
+
+//Displays a ring of rows as a heatmap, one image row per row of data
+//Rows are colorized once, when they are set, so the cost of a new row does not depend on the number of rows
+//The rows are drawn from the oldest (firstRow) at the top to the newest at the bottom
+class HeatmapWidget : public QWidget
+{
+public:
+	HeatmapWidget(QWidget* parent = 0);
+	~HeatmapWidget(){}
+
+public:
+	void ResizeMap(int numCols, int numRows);		//Clears the map
+	void SetRange(double theLo, double theHi, bool fLog);	//Applies to rows set after the call
+	void SetRow(int row, const float* vals);		//vals should contain numCols values
+	void SetFirstRow(int row) { firstRow = row; }
+
+	double Lo() const { return lo; }
+	double Hi() const { return hi; }
+
+protected:
+	void paintEvent(QPaintEvent* event);
+
+private:
+	QRgb ColorOf(double val) const;
+
+private:
+	QImage image;
+	CHArray<QRgb> palette;
+	int firstRow;
+	double lo, hi;
+	bool fLogScale;
+};
@@ -62,6 +62,11 @@ saveFileName("save.xml")
 	if (!SimplestXml::ReadNodeFromFile(saveFileName, saveDoc)) SimplestXml::RemoveAllChildren(saveDoc);
 	xml_node mainSaveNode = saveDoc.child("save");
 	if (!mainSaveNode) mainSaveNode = saveDoc.append_child("save");
+
+	//Autosave: devices update their nodes in place, and the file is only rewritten when something changed
+	autosaveTimer.setInterval(autosaveInterval);
+	QObject::connect(&autosaveTimer, &QTimer::timeout, this, &ExpDevManagerWidget::OnAutosave);
+	autosaveTimer.start();
 	
 	//Read the configuration file
 	if (!QFileInfo::exists(configFileName.c_str()))
@@ -328,8 +333,26 @@ void ExpDevManagerWidget::OnClose()
 	//Call OnClose() on all devices
 	for (auto& cur : deviceMap) cur.second->OnClose();
 
-	//Save the XML save file
-	SimplestXml::WriteNodeToFile(saveFileName, saveDoc, true, true);
+	//Save the XML save file and wait for it to be on disk
+	autosaveTimer.stop();
+	SubmitSaveFile();
+	if (!saveWriter.Flush()) ShowManagerError("Could not write the save file " + saveFileName + ".");
+}
+
+void ExpDevManagerWidget::OnAutosave()
+{
+	//Device data as it is, without pulling in values being edited in the widgets
+	bool fChanged = false;
+	for (auto& cur : deviceMap) fChanged = cur.second->WriteSaveDataToNode(false) || fChanged;
+
+	if (fChanged) SubmitSaveFile();
+}
+
+void ExpDevManagerWidget::SubmitSaveFile()
+{
+	BString contents;
+	SimplestXml::XmlToString(saveDoc, contents, true, true);
+	saveWriter.Submit(saveFileName, std::move(contents));
 }
 
 void ExpDevManagerWidget::CreateDeviceFromNode(xml_node& node, xml_node& mainSaveNode)
@@ -23,7 +23,9 @@
 #pragma once
 
 #include <QTabWidget>
+#include <QTimer>
 #include "BString.h"
+#include "BackgroundFileWriter.h"
 #include "StdMap.h"
 #include "Qt/ExpDevice.h"
 #include "Qt/ExpDevManagerWidget/DevInfoWidget.h"
@@ -39,6 +41,7 @@ public:
 public slots:
 	void OnClose();									//Called by the main window before closing
 	void OnDeviceError(BString str) { ShowDeviceError(str); }
+	void OnAutosave();								//Writes the save file if any device's save data changed
 
 private:
 	void CreateDeviceFromNode(xml_node& node, xml_node& mainSaveNode);
@@ -50,6 +53,7 @@ private:
 
 private:
 	void InitializeDevices();
+	void SubmitSaveFile();					//Serializes saveDoc and hands it to saveWriter
 	void RecursiveInitialize(const BString& devName, StdMap<BString>& initMap, StdMap<BString>& failedMap);
 
 private:
@@ -59,6 +63,9 @@ private:
 	BString configFileName;
 	xml_document saveDoc;				//XML document where the devices save their data; write and read
 	BString saveFileName;
+	CBackgroundFileWriter saveWriter;	//Writes saveFileName off the GUI thread, replacing it atomically
+	QTimer autosaveTimer;
+	static const int autosaveInterval = 60000;		//ms
 
 private:
 	DevInfoWidget* infoWidget;						//Tab with device information populated by the devManager
@@ -28,16 +28,17 @@ void ExpDevice::OnClose()
 	WriteSaveDataToNode();
 }
 
-void ExpDevice::WriteSaveDataToNode()
+bool ExpDevice::WriteSaveDataToNode(bool fFromWidget)
 {
-	//Clear the node
-	SimplestXml::RemoveAllChildren(saveNode);
-
 	//copy data from the widget, if a widget exists
-	UpdateDevice();
+	if (fFromWidget) UpdateDevice();
 
 	//Save device data to the node
-	SaveobToXml::WriteSaveobDataToNode(saveData, saveNode);
+	//Nodes are updated in place rather than cleared and rebuilt, so that unchanged data leaves the document unchanged
+	bool fChanged = SaveobToXml::WriteSaveobDataToNode(saveData, saveNode);
+	for (auto& schema : saveSchemas) fChanged = schema.write(schema.ob, saveNode) || fChanged;
+
+	return fChanged;
 }
 
 
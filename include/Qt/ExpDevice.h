@@ -24,8 +24,10 @@
 
 #include "SaveobComp.h"
 #include "SaveobToXml.h"
+#include "SaveobSchema.h"
 #include "BString.h"
 #include <QObject>
+#include <vector>
 #include "StdMap.h"
 #include "QtUtils.h"
 
@@ -106,9 +108,12 @@ public:
 	{
 		SaveobToXml::ReadSaveobDataFromNode(devData, devNode);
 		SaveobToXml::ReadSaveobDataFromNode(saveData, saveNode);
+		for (auto& schema : saveSchemas) schema.read(schema.ob, saveNode);
 	}
 
-	void WriteSaveDataToNode();			//Save all savable data to saveNode
+	//Save all savable data to saveNode, in place; returns true if saveNode changed
+	//fFromWidget - first copy the widget's values to the device, as on closing; autosave leaves the device alone
+	bool WriteSaveDataToNode(bool fFromWidget = true);
 
 	void EmitError(const BString& error)
 	{
@@ -127,6 +132,17 @@ protected:
 	//Saved data saveob
 	SaveobComp saveData;
 
+	//Saved data with a compile-time schema (see SaveobSchema.h), stored in the save node next to saveData
+	//ob must outlive the device; its fields must not clash with the names in saveData
+	template<class T> void AddSaveSchema(T& ob)
+	{
+		SaveSchema schema;
+		schema.ob = &ob;
+		schema.read = &ReadSchema<T>;
+		schema.write = &WriteSchema<T>;
+		saveSchemas.push_back(schema);
+	}
+
 protected:
 	//Not in saveob
 	bool fSerialDevice;		//Whether it's a device connected by a serial port
@@ -141,6 +157,18 @@ private:
 	bool fShowBox;
 	BString boxText;
 	
+	//Structs registered by AddSaveSchema(): one indirect call per struct, the fields themselves are inlined
+	struct SaveSchema
+	{
+		void* ob;
+		void (*read)(void* ob, xml_node& node);
+		bool (*write)(void* ob, xml_node& node);
+	};
+	std::vector<SaveSchema> saveSchemas;
+
+	template<class T> static void ReadSchema(void* ob, xml_node& node) { SaveobSchema::ReadFromNode(*(T*)ob, node); }
+	template<class T> static bool WriteSchema(void* ob, xml_node& node) { return SaveobSchema::WriteToNode(*(T*)ob, node); }
+
 	//Pointer to the widget
 	ExpWidget* widget;
 
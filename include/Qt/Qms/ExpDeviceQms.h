@@ -27,10 +27,31 @@
 #include <mutex>
 #include <memory>
 #include <thread>
+#include <QDateTime>
 #include "QmsDataPoint.h"
+#include "QmsSpectrumAccumulator.h"
 #include "ExpDeviceQmsDefines.h"
 #include "Timer.h"
 #include "serial/serial.h"
+#include "QmsPort.h"
+#include "QmsTranscript.h"
+
+//A real serial port
+class QmsSerialPort : public QmsPort
+{
+public:
+	QmsSerialPort(serial::Serial* theSerial) : serialPort(theSerial) {}
+
+	virtual bool isOpen() { return serialPort->isOpen(); }
+	virtual void close() { serialPort->close(); }
+	virtual void flush() { serialPort->flush(); }
+	virtual size_t available() { return serialPort->available(); }
+	virtual std::string read(size_t size = 1) { return serialPort->read(size); }
+	virtual size_t write(const std::string& data) { return serialPort->write(data); }
+
+private:
+	std::unique_ptr<serial::Serial> serialPort;
+};
 
 //Base class for all QMS devices
 class ExpDeviceQms : public ExpDevice
@@ -72,6 +93,10 @@ public:
 
 		portString = "COM1";
 
+		historyLength = 500;
+		historyFolder = "";
+		transcriptFolder = "";
+
 		//Handle saveob saving and loading
 		saveData.AddChildAndOwn("opMode", opMode);
 		saveData.AddChildAndOwn("detectorType", detectorType);
@@ -92,9 +117,13 @@ public:
 		saveData.AddChildAndOwn("hidenDwell", hidenDwell);
 		saveData.AddChildAndOwn("hidenSettleTime", hidenSettleTime);
 
-		saveData.AddChildAndOwn("massTable", massTable);
+		saveData.AddChildAndOwn("massTable", massTable, SaveobArrayCodec::encodingList);	//"1 2 18 28 44", still easy to edit by hand
 
 		saveData.AddChildAndOwn("portString", portString);
+
+		saveData.AddChildAndOwn("historyLength", historyLength);
+		saveData.AddChildAndOwn("historyFolder", historyFolder);
+		saveData.AddChildAndOwn("transcriptFolder", transcriptFolder);
 		
 	}
 	virtual ~ExpDeviceQms(){}
@@ -112,6 +141,7 @@ signals:
 	void SignalSpecEnd();										//Spectrum ends
 	void SignalMIDstart();										//A new MID scan is starting in a signal-time dataset
 	void SignalMIDend();										//A MID dataset has ended
+	void SignalNewSpectrumStats(QmsSpectrumStats stats);		//Accumulated statistics after every spectrum in the accumulation mode
 
 public:
 	virtual void Start() = 0;									//Starts scanning
@@ -130,6 +160,7 @@ public:
 	bool IsStopAtEndRequested() const { return scanState == scanState_stopAtEnd; }
 	bool IsPowerOn() const { return powerState == powerState_on; }
 	bool IsConnected() const { return connState == connState_on; }
+	bool IsAccumulating() const { return opMode == opMode_spectrum && specMode == specMode_accumulate; }
 
 public:
 	//In saveob
@@ -143,7 +174,7 @@ public:
 	double specStart;
 	double specEnd;
 	double specStep;
-	int specMode;		//0 - single scan, 1 - keep scanning
+	int specMode;		//0 - single scan, 1 - keep scanning, 2 - keep scanning and accumulate
 	
 	//Hiden-specific stuff
 	bool fHidenAutoranging;	//Whether autoranging is used on hiden QMS
@@ -157,6 +188,10 @@ public:
 	
 	BString portString;		//Port name, for example (and most likely) COM1
 
+	int historyLength;		//Number of spectra in the waterfall history
+	BString historyFolder;	//If not empty, every spectrum of a continuous scan is also written to a file in this folder
+	BString transcriptFolder;	//If not empty, the serial communication is logged to a file in this folder
+
 //Current state
 protected:
 	void SetScanState(int val) { scanState = val; emit SignalNewScanState(val); }
@@ -168,6 +203,7 @@ protected:
 	std::atomic<int> powerState;		//0 - off, 1 - on
 	std::atomic<int> connState;			//Serial connection state, 0 - disconnected, 1 - connected
 	CTimer timer;
+	QmsSpectrumAccumulator accumulator;		//Running statistics of the spectra in the accumulation mode
 
 //Port operation - for serial-connected QMSes
 public:
@@ -175,10 +211,15 @@ public:
 	CHArray<BString> portDescList;		//The descriptions provided for the ports in portList
 
 protected:
-	std::unique_ptr<serial::Serial> port;	//Serial port object used for all communication with the mass spec
+	std::unique_ptr<QmsPort> port;			//Serial port (or transcript replay) used for all communication with the mass spec
 	BString termToQms;						//Terminating characters on messages to QMS
 	BString termFromQms;					//Terminating characters on messages from QMS
 	std::recursive_mutex portMutex;		//The mutex guarding the port
+	QmsTranscript transcript;			//All commands and responses
+	BString sendBuffer;					//Command plus terminator, reused by SendReceive() under portMutex
+	BString receiveBuffer;				//Response accumulated by SendReceive(), reused under portMutex
+
+	bool StartTranscriptLog();			//Starts logging the transcript if transcriptFolder is set
 
 public:
 	virtual bool Connect(){ return true; }				//Returns true if connection is successful, false otherwise
@@ -187,6 +228,8 @@ public:
 	void EnumeratePorts();
 	void Disconnect();
 	void SetQmsPort(const BString& portName){portString = portName;}
+	bool ConnectReplay(const BString& fileName);		//"Connects" to a recorded transcript instead of the serial port
+	const QmsTranscript& Transcript() const { return transcript; }
 
 	BString SendReceive(const BString& sendString);
 	template<class T> BString SendReceive(const BString& formatString, const T& val);
@@ -217,38 +260,47 @@ inline void ExpDeviceQms::Disconnect()
 	std::lock_guard<std::recursive_mutex> lock(portMutex);
 	if (port && port->isOpen()) port->close();
 	port.reset();
+	transcript.StopLog();
 
 	SetConnState(connState_off);
 }
 
-inline BString ExpDeviceQms::SendReceive(const BString& sendString)
+inline bool ExpDeviceQms::ConnectReplay(const BString& fileName)
 {
+	CHArray<QmsTranscriptEntry> entries;
+	if (!QmsTranscript::ReadLog(fileName, entries)) return false;
+
+	Disconnect();
+
 	std::lock_guard<std::recursive_mutex> lock(portMutex);
+	port.reset(new QmsReplayPort(entries, termFromQms));
 
-	if (!port || !port->isOpen()) return "";
+	SetConnState(connState_on);
+	return true;
+}
 
-	emit SignalNewCom(sendString);
+inline bool ExpDeviceQms::StartTranscriptLog()
+{
+	if (transcriptFolder == "") return false;
 
-	//Write
-	port->write(sendString + termToQms);
+	BString fileName = transcriptFolder + "/qms_" +
+		QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss").toStdString() + ".qtr";
 
-	//Read response
-	BString response;
-	int termLength = termFromQms.GetLength();
-	while (1)
-	{
-		if (port->available())
-		{
-			while (port->available()) response += port->read();
+	return transcript.StartLog(fileName);
+}
 
-			if (response.Right(termLength) == termFromQms) break;	//break on terminating sequence
-		}
+inline BString ExpDeviceQms::SendReceive(const BString& sendString)
+{
+	std::lock_guard<std::recursive_mutex> lock(portMutex);
 
-		std::this_thread::sleep_for(std::chrono::milliseconds(1));
-	}
+	if (!port || !port->isOpen()) return "";
+
+	transcript.Add(true, sendString);
+	emit SignalNewCom(sendString);
 
-	BString result = response.Left(response.GetLength() - termLength);
+	BString result = QmsSendReceive(*port, sendString, termToQms, termFromQms, sendBuffer, receiveBuffer);
 
+	transcript.Add(false, result);
 	emit SignalNewCom(result);
 
 	return result;
@@ -38,6 +38,7 @@
 
 #define specMode_single		0
 #define specMode_continuous	1
+#define specMode_accumulate	2		//Continuous scanning, spectra are averaged on the device side
 
 #define detector_SEM		0
 #define detector_faraday	1
\ No newline at end of file
@@ -29,7 +29,7 @@ bool ExpDeviceQmsHidenHAL::Connect()
 	Disconnect();
 
 	//Create new serial connection to the mass spec
-	port.reset(
+	port.reset(new QmsSerialPort(
 		new serial::Serial(
 			portString,
 			115200,
@@ -39,7 +39,7 @@ bool ExpDeviceQmsHidenHAL::Connect()
 			serial::stopbits_one,
 			serial::flowcontrol_none
 							)
-				);
+				));
 
 	//Flush the port
 	port->flush();
@@ -52,6 +52,9 @@ bool ExpDeviceQmsHidenHAL::Connect()
 	ShutOffPower();				//If for any reason the power is on, shut it off
 	
 	SetConnState(connState_on);
+
+	//Log the session from here on, so that it can be replayed after the same Connect()
+	StartTranscriptLog();
 	return true;
 }
 
@@ -114,7 +117,11 @@ void ExpDeviceQmsHidenHAL::AcquisitionThread()
 	emit SignalDatasetStart();		//A single spectrum, multiple spectrum or signal-time dataset is starting
 	timer.SetTimerZero(0);
 
-	if (opMode == opMode_spectrum) SetSpecParams();
+	if (opMode == opMode_spectrum)
+	{
+		SetSpecParams();
+		if (IsAccumulating()) accumulator.SetGrid(specStart, specEnd, specStep);
+	}
 	else if (opMode == opMode_sigTime) SetSigTimeParams();
 
 	SendReceive("pset terse 1");
@@ -144,6 +151,7 @@ void ExpDeviceQmsHidenHAL::AcquisitionThread()
 				{
 					fInsideBrackets = false;
 					ProcessDataString(dataString);
+					if (IsAccumulating()) EmitSpectrumStats();
 					if (opMode == opMode_spectrum) emit SignalSpecEnd();			//Emit spec start signal if in spectrum mode
 					else if (opMode == opMode_sigTime) emit SignalMIDend();
 				}
@@ -274,7 +282,19 @@ void ExpDeviceQmsHidenHAL::ProcessDataString(BString& str)
 		newData << point;
 	}
 
-	if (newData.Count() > 0) emit SignalNewData(newData);
+	//In the accumulation mode, only the statistics are sent at the end of every spectrum
+	if (IsAccumulating()) accumulator.AddPoints(newData);
+	else if (newData.Count() > 0) emit SignalNewData(newData);
 
 	str = "";
-}
\ No newline at end of file
+}
+
+//Completes the current spectrum in the accumulator and sends the statistics to the widget
+void ExpDeviceQmsHidenHAL::EmitSpectrumStats()
+{
+	accumulator.EndSpectrum();
+
+	QmsSpectrumStats stats;
+	accumulator.GetStats(stats);
+	emit SignalNewSpectrumStats(stats);
+}
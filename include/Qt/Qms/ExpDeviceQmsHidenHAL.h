@@ -65,6 +65,7 @@ private:
 	void SetSpecParams();			//The function that sets the parameters specific to mass spectrum acquisition
 	void SetSigTimeParams();		//Set parameters for signal vs. time acquisition
 	void ProcessDataString(BString& str);
+	void EmitSpectrumStats();		//Sends the accumulated statistics at the end of a spectrum
 	void ShutOffDataAndAbort();		//Shuts off data and sets the state to Abort: independent of current state
 	void ShutOffPower() { SendReceive("lset mode 0"); }		//Tries to shut off power independent of state
 };
\ No newline at end of file
@@ -0,0 +1,136 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "QmsTranscript.h"
+#include <string>
+#include <thread>
+#include <chrono>
+
+//Byte stream used by the QMS devices to talk to the mass spec
+//The functions follow serial::Serial, so that a recorded transcript can be replayed in place of the serial port
+class QmsPort
+{
+public:
+	virtual ~QmsPort(){}
+
+	virtual bool isOpen() = 0;
+	virtual void close() = 0;
+	virtual void flush() = 0;
+	virtual size_t available() = 0;
+	virtual std::string read(size_t size = 1) = 0;
+	virtual size_t write(const std::string& data) = 0;
+};
+
+//Writes the command with termToQms and reads until termFromQms arrives, returns the response without the terminator
+//The buffers belong to the caller and keep their memory from one command to the next
+//Qt-free, so that bench/BenchStrings.cpp can drive it through a QmsReplayPort
+inline BString QmsSendReceive(QmsPort& port, const BString& command, const BString& termToQms, const BString& termFromQms,
+	BString& sendBuffer, BString& receiveBuffer)
+{
+	//Write
+	sendBuffer = command;
+	sendBuffer += termToQms;
+	port.write(sendBuffer);
+
+	//Read response
+	receiveBuffer.clear();
+	int termLength = termFromQms.GetLength();
+	while (1)
+	{
+		if (port.available())
+		{
+			//Everything that has arrived in one read rather than one byte per read
+			while (size_t numAvailable = port.available()) receiveBuffer += port.read(numAvailable);
+
+			if (receiveBuffer.EndsWith(termFromQms)) break;	//break on terminating sequence
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	return BString(receiveBuffer.LeftView(receiveBuffer.GetLength() - termLength));
+}
+
+//Replays a recorded transcript: every write returns the responses recorded after the next recorded command
+//Timing is not reproduced, so a replayed acquisition runs as fast as the parser allows
+//Commands that differ from the recorded ones are counted, the recorded responses are returned regardless
+class QmsReplayPort : public QmsPort
+{
+public:
+	QmsReplayPort(const CHArray<QmsTranscriptEntry>& theEntries, const BString& theTermFromQms) :
+	entries(theEntries), termFromQms(theTermFromQms)
+	{
+		pos = 0;
+		numMismatches = 0;
+		fOpen = true;
+	}
+
+	virtual bool isOpen() { return fOpen; }
+	virtual void close() { fOpen = false; }
+	virtual void flush() { buffer.clear(); }
+	virtual size_t available() { return buffer.size(); }
+
+	virtual std::string read(size_t size = 1)
+	{
+		std::string result = buffer.substr(0, size);
+		buffer.erase(0, result.size());
+		return result;
+	}
+
+	virtual size_t write(const std::string& data)
+	{
+		//Skip to the next recorded command
+		while (pos < entries.Count() && !entries[pos].fSent) pos++;
+
+		if (pos < entries.Count())
+		{
+			if (data.compare(0, entries[pos].text.size(), entries[pos].text) != 0) numMismatches++;
+			pos++;
+		}
+
+		//Queue all responses up to the next command; an empty response once the transcript is exhausted
+		bool fResponded = false;
+		for (; pos < entries.Count() && !entries[pos].fSent; pos++)
+		{
+			buffer += entries[pos].text;
+			buffer += termFromQms;
+			fResponded = true;
+		}
+
+		if (!fResponded) buffer += termFromQms;
+
+		return data.size();
+	}
+
+	int NumMismatches() const { return numMismatches; }
+	bool IsFinished() const { return pos >= entries.Count(); }
+
+private:
+	CHArray<QmsTranscriptEntry> entries;
+	BString termFromQms;
+	std::string buffer;		//Bytes waiting to be read
+	int pos;				//Next entry in the transcript
+	int numMismatches;
+	bool fOpen;
+};
@@ -0,0 +1,119 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "QmsSpectrumAccumulator.h"
+#include <math.h>
+
+QmsSpectrumAccumulator::QmsSpectrumAccumulator()
+{
+	start = 0;
+	step = 1;
+	numSpectra = 0;
+}
+
+void QmsSpectrumAccumulator::SetGrid(double theStart, double theEnd, double theStep)
+{
+	start = theStart;
+	step = (theStep > 0) ? theStep : 1;
+
+	int numBins = int(floor((theEnd - theStart) / step + 0.5)) + 1;
+	if (numBins < 1) numBins = 1;
+
+	counts.ResizeIfSmaller(numBins, true);
+	mean.ResizeIfSmaller(numBins, true);
+	m2.ResizeIfSmaller(numBins, true);
+	minVal.ResizeIfSmaller(numBins, true);
+	maxVal.ResizeIfSmaller(numBins, true);
+	lastVal.ResizeIfSmaller(numBins, true);
+	lastValSpectrum.ResizeIfSmaller(numBins, true);
+
+	Reset();
+}
+
+void QmsSpectrumAccumulator::Reset()
+{
+	numSpectra = 0;
+
+	counts = 0;
+	mean = 0;
+	m2 = 0;
+	minVal = 0;
+	maxVal = 0;
+	lastVal = 0;
+	lastValSpectrum = -1;
+}
+
+void QmsSpectrumAccumulator::AddPoint(double mass, double signal)
+{
+	int bin = int(floor((mass - start) / step + 0.5));
+	if (bin < 0 || bin >= NumBins()) return;
+
+	lastVal[bin] = signal;
+	lastValSpectrum[bin] = numSpectra;		//The spectrum in progress
+
+	int n = ++counts[bin];
+	if (n == 1)
+	{
+		minVal[bin] = signal;
+		maxVal[bin] = signal;
+	}
+	else
+	{
+		if (signal < minVal[bin]) minVal[bin] = signal;
+		if (signal > maxVal[bin]) maxVal[bin] = signal;
+	}
+
+	double delta = signal - mean[bin];
+	mean[bin] += delta / n;
+	m2[bin] += delta * (signal - mean[bin]);
+}
+
+void QmsSpectrumAccumulator::AddPoints(const CHArray<QmsDataPoint>& points)
+{
+	for (auto& point : points) AddPoint(point.mass, point.signal);
+}
+
+void QmsSpectrumAccumulator::GetStats(QmsSpectrumStats& stats) const
+{
+	int numBins = NumBins();
+
+	stats.numSpectra = numSpectra;
+	stats.mass.ResizeIfSmaller(numBins);
+	stats.mean.ResizeIfSmaller(numBins);
+	stats.stdDev.ResizeIfSmaller(numBins);
+	stats.minVal.ResizeIfSmaller(numBins);
+	stats.maxVal.ResizeIfSmaller(numBins);
+	stats.lastVal.ResizeIfSmaller(numBins);
+
+	for (int i = 0; i < numBins; i++)
+	{
+		int n = counts[i];
+		if (n == 0) continue;
+
+		stats.mass << start + i * step;
+		stats.mean << mean[i];
+		stats.stdDev << ((n > 1) ? sqrt(m2[i] / (n - 1)) : 0);
+		stats.minVal << minVal[i];
+		stats.maxVal << maxVal[i];
+		stats.lastVal << ((lastValSpectrum[i] == numSpectra - 1) ? lastVal[i] : 0);
+	}
+}
@@ -0,0 +1,75 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "Array.h"
+#include "QmsDataPoint.h"
+
+//Statistics of the accumulated spectra, one element per mass bin that received data
+struct QmsSpectrumStats
+{
+	QmsSpectrumStats(){ numSpectra = 0; }
+
+	int numSpectra;				//Number of completed spectra
+	CHArray<double> mass;		//Center of the mass bin
+	CHArray<double> mean;
+	CHArray<double> stdDev;
+	CHArray<double> minVal;
+	CHArray<double> maxVal;
+	CHArray<double> lastVal;	//The value from the latest spectrum, 0 where it had no point
+};
+
+//Accumulates continuously scanned spectra on a fixed mass grid
+//Running mean, variance (Welford), min and max are kept per bin, so memory does not grow with the number of spectra
+class QmsSpectrumAccumulator
+{
+public:
+	QmsSpectrumAccumulator();
+	~QmsSpectrumAccumulator(){}
+
+public:
+	void SetGrid(double theStart, double theEnd, double theStep);	//Sets the mass grid and clears all data
+	void Reset();													//Clears all data, keeps the grid
+
+	void AddPoint(double mass, double signal);						//Points outside the grid are ignored
+	void AddPoints(const CHArray<QmsDataPoint>& points);
+	void EndSpectrum() { numSpectra++; }
+
+	void GetStats(QmsSpectrumStats& stats) const;
+
+	int NumBins() const { return counts.Count(); }
+	int NumSpectra() const { return numSpectra; }
+
+private:
+	double start;
+	double step;
+	int numSpectra;
+
+	CHArray<int> counts;		//Number of values in every bin
+	CHArray<double> mean;
+	CHArray<double> m2;			//Sum of squared deviations from the running mean
+	CHArray<double> minVal;
+	CHArray<double> maxVal;
+	CHArray<double> lastVal;
+	CHArray<int> lastValSpectrum;	//Spectrum that lastVal came from, older values are not reported as the latest
+};
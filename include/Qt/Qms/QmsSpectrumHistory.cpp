@@ -0,0 +1,139 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "QmsSpectrumHistory.h"
+#include "fseek_large.h"
+#include <math.h>
+
+QmsSpectrumHistory::QmsSpectrumHistory()
+{
+	start = 0;
+	step = 1;
+	spillFile = 0;
+
+	Clear();
+}
+
+void QmsSpectrumHistory::SetGrid(double theStart, double theEnd, double theStep, int theCapacity)
+{
+	start = theStart;
+	step = (theStep > 0) ? theStep : 1;
+
+	int numBins = int(floor((theEnd - theStart) / step + 0.5)) + 1;
+	if (numBins < 1) numBins = 1;
+	if (theCapacity < 1) theCapacity = 1;
+
+	history.ResizeMatrix(theCapacity, numBins);
+	Clear();
+}
+
+void QmsSpectrumHistory::Clear()
+{
+	history = 0;
+	numAdded = 0;
+	sigMin = 0;
+	sigMax = 0;
+}
+
+int QmsSpectrumHistory::AddSpectrum(const CHArray<double>& mass, const CHArray<double>& signal)
+{
+	if (Capacity() == 0) return -1;
+
+	int slot = numAdded % Capacity();
+	CHArray<float>& target = history[slot];
+	target = 0;
+
+	for (int i = 0; i < mass.Count() && i < signal.Count(); i++)
+	{
+		int bin = int(floor((mass[i] - start) / step + 0.5));
+		if (bin < 0 || bin >= NumBins()) continue;
+
+		double val = signal[i];
+		target[bin] = (float)val;
+
+		if (val > 0 && (sigMin == 0 || val < sigMin)) sigMin = val;
+		if (val > sigMax) sigMax = val;
+	}
+
+	numAdded++;
+
+	if (spillFile)
+	{
+		fwrite(target.arr, sizeof(float), NumBins(), spillFile);
+		fflush(spillFile);
+	}
+
+	return slot;
+}
+
+bool QmsSpectrumHistory::OpenSpillFile(const BString& fileName)
+{
+	CloseSpillFile();
+
+	spillFile = fopen(fileName, "wb");
+	if (!spillFile) return false;
+
+	int numBins = NumBins();
+	fwrite(&numBins, sizeof(int), 1, spillFile);
+	fwrite(&start, sizeof(double), 1, spillFile);
+	fwrite(&step, sizeof(double), 1, spillFile);
+
+	return true;
+}
+
+void QmsSpectrumHistory::CloseSpillFile()
+{
+	if (spillFile) fclose(spillFile);
+	spillFile = 0;
+}
+
+bool QmsSpectrumHistory::ReadSpillFile(const BString& fileName, int from, int count, CMatrix<float>& result, double& theStart, double& theStep)
+{
+	FILE* fp = fopen(fileName, "rb");
+	if (!fp) return false;
+
+	int numBins = 0;
+	bool fOK = fread(&numBins, sizeof(int), 1, fp) == 1
+		&& fread(&theStart, sizeof(double), 1, fp) == 1
+		&& fread(&theStep, sizeof(double), 1, fp) == 1
+		&& numBins > 0;
+
+	if (!fOK) { fclose(fp); return false; }
+
+	//Number of complete spectra in the file
+	int64 headerSize = sizeof(int) + 2 * sizeof(double);
+	int64 specSize = numBins * (int64)sizeof(float);
+	fseek_large(fp, 0, SEEK_END);
+	int64 numSpectra = (ftell_large(fp) - headerSize) / specSize;
+
+	if (from < 0) from = 0;
+	if (from + (int64)count > numSpectra) count = int(numSpectra - from);
+	if (count < 0) count = 0;
+
+	result.ResizeMatrix(count, numBins);
+
+	fseek_large(fp, headerSize + from * specSize, SEEK_SET);
+	fOK = fread(result.theArray.arr, sizeof(float), (size_t)count * numBins, fp) == (size_t)count * numBins;
+
+	fclose(fp);
+	return fOK;
+}
@@ -0,0 +1,75 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "Matrix.h"
+#include <stdio.h>
+
+//Ring-buffered history of the last spectra on a fixed mass grid
+//Every spectrum is a column of a float matrix, so a new spectrum overwrites the oldest column in place
+//Optionally, every spectrum is also appended to a binary spill file, so the whole run can be read back later
+class QmsSpectrumHistory
+{
+public:
+	QmsSpectrumHistory();
+	~QmsSpectrumHistory(){ CloseSpillFile(); }
+
+public:
+	void SetGrid(double theStart, double theEnd, double theStep, int theCapacity);	//Sets the grid and clears the history
+	void Clear();
+
+	//Bins the spectrum onto the grid and stores it in place of the oldest one
+	//Bins without points are set to 0; returns the slot where the spectrum was stored
+	int AddSpectrum(const CHArray<double>& mass, const CHArray<double>& signal);
+
+	int NumBins() const { return history.rows; }
+	int Capacity() const { return history.cols; }
+	int NumAdded() const { return numAdded; }								//Total number of spectra added since the last Clear()
+	int Count() const { return (numAdded < Capacity()) ? numAdded : Capacity(); }
+	int OldestSlot() const { return (numAdded < Capacity()) ? 0 : numAdded % Capacity(); }
+	const float* Slot(int slot) const { return history.theArray.arr + slot * history.rows; }
+
+	double MassStart() const { return start; }
+	double MassStep() const { return step; }
+	double SignalMin() const { return sigMin; }		//Smallest positive signal in all added spectra
+	double SignalMax() const { return sigMax; }
+
+public:
+	//Spill file: int number of bins, double grid start, double grid step, then the spectra as float rows
+	bool OpenSpillFile(const BString& fileName);
+	void CloseSpillFile();
+	bool IsSpilling() const { return spillFile != 0; }
+
+	//Reads count spectra starting from spectrum from; the spectra are placed in the columns of result
+	static bool ReadSpillFile(const BString& fileName, int from, int count, CMatrix<float>& result, double& theStart, double& theStep);
+
+private:
+	CMatrix<float> history;		//One spectrum per column
+	double start;
+	double step;
+	int numAdded;
+	double sigMin;
+	double sigMax;
+
+	FILE* spillFile;
+};
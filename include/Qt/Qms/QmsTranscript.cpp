@@ -0,0 +1,186 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "QmsTranscript.h"
+
+QmsTranscript::QmsTranscript(int theCapacity) :
+ring(theCapacity > 0 ? theCapacity : 1)
+{
+	numAdded = 0;
+	logFile = 0;
+	fStopWriter = false;
+
+	timer.SetTimerZero(0);
+}
+
+void QmsTranscript::Add(bool fSent, const BString& text)
+{
+	QmsTranscriptEntry entry(timer.GetCurTime(0), fSent, text);
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	ring.Append(entry);
+	numAdded++;
+
+	if (logFile)
+	{
+		pending << entry;
+		writerCondition.notify_one();
+	}
+}
+
+void QmsTranscript::Clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	ring.Clear();
+	numAdded = 0;
+}
+
+int QmsTranscript::Count() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return ring.Count();
+}
+
+int QmsTranscript::NumAdded() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return numAdded;
+}
+
+void QmsTranscript::GetEntries(int from, int count, CHArray<QmsTranscriptEntry>& result) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (from < 0) from = 0;
+	if (from + count > ring.Count()) count = ring.Count() - from;
+	if (count < 0) count = 0;
+
+	result.ResizeIfSmaller(count);
+	for (int i = from; i < from + count; i++) result << ring[i];
+}
+
+bool QmsTranscript::StartLog(const BString& fileName)
+{
+	StopLog();
+
+	FILE* fp = fopen(fileName, "wb");
+	if (!fp) return false;
+
+	fwrite("QTR1", 1, 4, fp);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	logFile = fp;
+	fStopWriter = false;
+	pending.Clear();
+
+	writer = std::thread(&QmsTranscript::WriterThread, this);
+	return true;
+}
+
+void QmsTranscript::StopLog()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!logFile) return;
+
+		fStopWriter = true;
+		writerCondition.notify_one();
+	}
+
+	writer.join();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	fclose(logFile);
+	logFile = 0;
+}
+
+void QmsTranscript::WriterThread()
+{
+	CHArray<QmsTranscriptEntry> toWrite;
+
+	while (1)
+	{
+		bool fStop;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			writerCondition.wait(lock, [this]{ return fStopWriter || !pending.IsEmpty(); });
+
+			//Take all pending entries and write them without holding the lock
+			toWrite = pending;
+			pending.Clear();
+			fStop = fStopWriter;
+		}
+
+		for (auto& entry : toWrite)
+		{
+			char fSent = entry.fSent ? 1 : 0;
+			int length = entry.text.GetLength();
+
+			fwrite(&entry.time, sizeof(double), 1, logFile);
+			fwrite(&fSent, 1, 1, logFile);
+			fwrite(&length, sizeof(int), 1, logFile);
+			fwrite(entry.text.c_str(), 1, length, logFile);
+		}
+		fflush(logFile);
+
+		if (fStop) return;
+	}
+}
+
+bool QmsTranscript::ReadLog(const BString& fileName, CHArray<QmsTranscriptEntry>& entries)
+{
+	entries.Clear();
+
+	FILE* fp = fopen(fileName, "rb");
+	if (!fp) return false;
+
+	char magic[4];
+	if (fread(magic, 1, 4, fp) != 4 || std::string(magic, 4) != "QTR1")
+	{
+		fclose(fp);
+		return false;
+	}
+
+	//A truncated last entry is ignored
+	while (1)
+	{
+		QmsTranscriptEntry entry;
+		char fSent;
+		int length;
+
+		if (fread(&entry.time, sizeof(double), 1, fp) != 1) break;
+		if (fread(&fSent, 1, 1, fp) != 1) break;
+		if (fread(&length, sizeof(int), 1, fp) != 1 || length < 0) break;
+
+		std::string text(length, 0);
+		if (length > 0 && fread(&text[0], 1, length, fp) != (size_t)length) break;
+
+		entry.fSent = (fSent != 0);
+		entry.text = text;
+		entries << entry;
+	}
+
+	fclose(fp);
+	return true;
+}
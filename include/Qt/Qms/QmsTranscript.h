@@ -0,0 +1,89 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "CyclicArray.h"
+#include "Timer.h"
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <stdio.h>
+
+//A single command sent to the QMS or a response received from it
+struct QmsTranscriptEntry
+{
+	QmsTranscriptEntry(){}
+
+	QmsTranscriptEntry(double theTime, bool theSent, const BString& theText) :
+	time(theTime), fSent(theSent), text(theText) {}
+
+	double time;		//Seconds since the transcript was created
+	bool fSent;			//true - sent to the QMS, false - received from the QMS
+	BString text;
+};
+
+//Transcript of the serial communication with the QMS
+//The last entries are kept in a ring buffer that the widget reads directly
+//If a log is started, all entries are also written to a binary file by a separate writer thread,
+//so the thread that talks to the QMS never waits for the disk
+class QmsTranscript
+{
+public:
+	QmsTranscript(int theCapacity = 5000);
+	~QmsTranscript(){ StopLog(); }
+
+public:
+	void Add(bool fSent, const BString& text);			//Thread-safe
+	void Clear();
+
+	int Count() const;
+	int NumAdded() const;								//Total number of entries added since the last Clear()
+
+	//Copies count entries starting from entry from; entry 0 is the newest one
+	void GetEntries(int from, int count, CHArray<QmsTranscriptEntry>& result) const;
+
+public:
+	//Binary log: "QTR1", then for every entry: double time, char fSent, int length, length characters
+	bool StartLog(const BString& fileName);
+	void StopLog();
+	bool IsLogging() const { return logFile != 0; }
+
+	//Reads all entries from a log, oldest first
+	static bool ReadLog(const BString& fileName, CHArray<QmsTranscriptEntry>& entries);
+
+private:
+	void WriterThread();
+
+private:
+	mutable std::mutex mutex;
+	mutable CyclicArray<QmsTranscriptEntry> ring;
+	int numAdded;
+	CTimer timer;
+
+	//Log writer
+	FILE* logFile;
+	std::thread writer;
+	std::condition_variable writerCondition;
+	CHArray<QmsTranscriptEntry> pending;		//Entries waiting to be written to the log
+	bool fStopWriter;
+};
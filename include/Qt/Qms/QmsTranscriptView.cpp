@@ -0,0 +1,100 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "QmsTranscriptView.h"
+#include <QPainter>
+#include <QScrollBar>
+
+QmsTranscriptView::QmsTranscriptView(const QmsTranscript& theTranscript, QWidget* parent) :
+QAbstractScrollArea(parent),
+transcript(theTranscript)
+{
+	lastNumAdded = 0;
+
+	setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+	viewport()->setAutoFillBackground(true);
+	viewport()->setBackgroundRole(QPalette::Base);
+}
+
+int QmsTranscriptView::LineHeight() const
+{
+	return fontMetrics().lineSpacing();
+}
+
+int QmsTranscriptView::VisibleLines() const
+{
+	return viewport()->height() / LineHeight() + 1;
+}
+
+void QmsTranscriptView::UpdateScrollBar()
+{
+	int maxFirst = transcript.Count() - VisibleLines() + 1;
+	if (maxFirst < 0) maxFirst = 0;
+
+	verticalScrollBar()->setRange(0, maxFirst);
+	verticalScrollBar()->setPageStep(VisibleLines());
+}
+
+void QmsTranscriptView::Refresh()
+{
+	int numAdded = transcript.NumAdded();
+	int numNew = numAdded - lastNumAdded;
+	lastNumAdded = numAdded;
+
+	UpdateScrollBar();
+
+	//If the user has scrolled away from the newest entries, keep the same entries in view
+	QScrollBar* bar = verticalScrollBar();
+	if (bar->value() > 0 && numNew > 0) bar->setValue(bar->value() + numNew);
+
+	viewport()->update();
+}
+
+void QmsTranscriptView::resizeEvent(QResizeEvent* event)
+{
+	QAbstractScrollArea::resizeEvent(event);
+	UpdateScrollBar();
+}
+
+void QmsTranscriptView::paintEvent(QPaintEvent* event)
+{
+	QPainter painter(viewport());
+	painter.setFont(font());
+
+	int lineHeight = LineHeight();
+	int ascent = fontMetrics().ascent();
+	int width = viewport()->width() - 4;
+
+	transcript.GetEntries(verticalScrollBar()->value(), VisibleLines(), visibleEntries);
+
+	for (int i = 0; i < visibleEntries.Count(); i++)
+	{
+		const QmsTranscriptEntry& entry = visibleEntries[i];
+
+		BString line;
+		line.Format("%.3f %s ", entry.time, entry.fSent ? ">" : "<");
+		line += entry.text;
+
+		painter.setPen(entry.fSent ? Qt::darkBlue : Qt::black);
+		painter.drawText(2, i * lineHeight + ascent, fontMetrics().elidedText(line.c_str(), Qt::ElideRight, width));
+	}
+}
@@ -28,6 +28,7 @@
 
 Q_DECLARE_METATYPE(BString)
 Q_DECLARE_METATYPE(CHArray<QmsDataPoint>)
+Q_DECLARE_METATYPE(QmsSpectrumStats)
 
 //using namespace QtCharts;
 
@@ -58,6 +59,7 @@ QmsWidget::QmsWidget(ExpDeviceQms* theQms, QWidget *parent) :
 	//Set num scans combobox
 	ui.comboNumScans->addItem("Single scan");
 	ui.comboNumScans->addItem("Keep scanning");
+	ui.comboNumScans->addItem("Keep scanning, average");
 
 	//Populate widget lists for enabling/disabling
 	widgetsMode << ui.comboMode;
@@ -70,7 +72,14 @@ QmsWidget::QmsWidget(ExpDeviceQms* theQms, QWidget *parent) :
 	widgetsAutoranging << ui.comboHidenRangeMax << ui.comboHidenRangeMin;
 	widgetsDetectorSEM << ui.spinSemVoltage;
 	widgetsConnection << ui.bnConnect << ui.comboPorts;
-	widgetsSerialComm << ui.textEditCom << ui.editCommand << ui.bnSend;
+	//The transcript view takes the place of the text edit
+	comView = new QmsTranscriptView(qms.Transcript(), ui.textEditCom->parentWidget());
+	comView->setGeometry(ui.textEditCom->geometry());
+	comView->setFont(ui.textEditCom->font());
+	delete ui.textEditCom;
+	ui.textEditCom = nullptr;
+
+	widgetsSerialComm << comView << ui.editCommand << ui.bnSend;
 	widgetsScanControl << ui.bnStartScan << ui.bnStopScanNow << ui.bnStopScanWhenDone;
 	widgetsPowerButtons << ui.bnTurnOn << ui.bnTurnOff;
 
@@ -83,6 +92,7 @@ QmsWidget::QmsWidget(ExpDeviceQms* theQms, QWidget *parent) :
 	{
 		ui.comboPorts->addItem((qms.portList[i] + " - " + qms.portDescList[i]).c_str());
 	}
+	ui.comboPorts->addItem("Replay transcript...");
 
 	//Create the chart
 	chart = new ChartWidget(maxQmsDatasets);
@@ -91,6 +101,11 @@ QmsWidget::QmsWidget(ExpDeviceQms* theQms, QWidget *parent) :
 	ui.verticalLayoutChart->insertWidget(1, chart);
 	chart->SetSciNotationY(true);
 
+	//Heatmap of the spectrum history below the chart
+	heatmap = new HeatmapWidget;
+	heatmap->setMinimumHeight(120);
+	ui.verticalLayoutChart->insertWidget(2, heatmap);
+
 	//Populate range comboboxes
 	PopulateRangeCombo(ui.comboHidenRange);
 	PopulateRangeCombo(ui.comboHidenRangeMin);
@@ -113,10 +128,14 @@ QmsWidget::QmsWidget(ExpDeviceQms* theQms, QWidget *parent) :
 	//Connect the signals from the mass spec
 	qRegisterMetaType<BString>();
 	qRegisterMetaType<CHArray<QmsDataPoint>>();
+	qRegisterMetaType<QmsSpectrumStats>();
 	QObject::connect(&qms, &ExpDeviceQms::SignalNewData, this, &QmsWidget::OnNewData, Qt::QueuedConnection);
 	QObject::connect(&qms, &ExpDeviceQms::SignalNewCom, this, &QmsWidget::OnNewCom, Qt::QueuedConnection);
 	QObject::connect(&qms, &ExpDeviceQms::SignalDatasetStart, this, &QmsWidget::OnDatasetStart, Qt::QueuedConnection);
 	QObject::connect(&qms, &ExpDeviceQms::SignalSpecStart, this, &QmsWidget::OnSpecStart, Qt::QueuedConnection);
+	QObject::connect(&qms, &ExpDeviceQms::SignalSpecEnd, this, &QmsWidget::OnSpecEnd, Qt::QueuedConnection);
+	QObject::connect(&qms, &ExpDeviceQms::SignalDatasetEnd, this, &QmsWidget::OnDatasetEnd, Qt::QueuedConnection);
+	QObject::connect(&qms, &ExpDeviceQms::SignalNewSpectrumStats, this, &QmsWidget::OnNewSpectrumStats, Qt::QueuedConnection);
 	QObject::connect(&qms, &ExpDeviceQms::SignalNewPowerState, this, &QmsWidget::OnNewPowerState, Qt::QueuedConnection);
 	QObject::connect(&qms, &ExpDeviceQms::SignalNewScanState, this, &QmsWidget::OnNewScanState, Qt::QueuedConnection);
 	QObject::connect(&qms, &ExpDeviceQms::SignalNewConnState, this, &QmsWidget::OnNewConnState, Qt::QueuedConnection);
@@ -146,6 +165,7 @@ void QmsWidget::HandleEnabling()
 	//Handle visibility
 	ui.groupBoxSpectrum->setVisible(IsSpectrumMode());
 	ui.groupBoxSigTime->setVisible(!IsSpectrumMode());
+	heatmap->setVisible(IsSpectrumMode() && ui.comboNumScans->currentIndex() != specMode_single);
 
 	//Enable all
 	EnableWidgets(widgetsAll, true);
@@ -216,16 +236,30 @@ bool QmsWidget::IsDetectorSEM() const
 //User requests a connection to qms through a given port
 void QmsWidget::OnBnConnectClicked()
 {
-	if (qms.portList.IsEmpty())
+	bool fConnected;
+
+	//The last item replays a recorded transcript instead of connecting to a port
+	if (ui.comboPorts->currentIndex() == qms.portList.Count())
 	{
-		QtUtils::ErrorBox("Unable to connect: no ports are available.");
-		return;
+		QString name = QFileDialog::getOpenFileName(this, tr("Replay QMS transcript"), "",
+			tr("QMS transcripts (*.qtr);;All Files (*.*)"));
+		if (name.isEmpty()) return;
+
+		fConnected = qms.ConnectReplay(name.toStdString());
 	}
+	else
+	{
+		if (qms.portList.IsEmpty())
+		{
+			QtUtils::ErrorBox("Unable to connect: no ports are available.");
+			return;
+		}
 
-	BString portName = qms.portList[ui.comboPorts->currentIndex()];
-	qms.SetQmsPort(portName);
+		BString portName = qms.portList[ui.comboPorts->currentIndex()];
+		qms.SetQmsPort(portName);
 
-	bool fConnected = qms.Connect();
+		fConnected = qms.Connect();
+	}
 
 	BString statusString;
 	if (fConnected)
@@ -355,12 +389,10 @@ void QmsWidget::SetMassTableColors()
 	}
 }
 
+//The entries are already in the transcript, only the visible lines are redrawn
 void QmsWidget::OnNewCom(BString str)
 {
-	comString = str + "\n\n" + comString;
-	if (comString.GetLength() > 20000) comString = comString.Left(20000);
-
-	ui.textEditCom->setPlainText(comString.c_str());
+	comView->Refresh();
 }
 
 void QmsWidget::OnBnSendClicked()
@@ -394,6 +426,7 @@ void QmsWidget::OnBnStartClicked()
 void QmsWidget::OnDatasetStart()
 {
 	chart->ClearAll();
+	lastStats = QmsSpectrumStats();
 
 	chart->SetYaxisText("Signal");
 
@@ -402,6 +435,18 @@ void QmsWidget::OnDatasetStart()
 		chart->SetXmin(qms.specStart);
 		chart->SetXmax(qms.specEnd);
 		chart->SetXaxisText("m/e, a.m.u.");
+
+		history.SetGrid(qms.specStart, qms.specEnd, qms.specStep, qms.historyLength);
+		heatmap->ResizeMap(history.NumBins(), history.Capacity());
+		heatmap->update();
+
+		//Continuous scans are also written to the history folder, if one is set
+		if (qms.specMode != specMode_single && qms.historyFolder != "")
+		{
+			BString fileName = qms.historyFolder + "/" +
+				QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss").toStdString() + "_spectra.bin";
+			if (!history.OpenSpillFile(fileName)) QtUtils::ErrorBox("Unable to open the spectrum history file " + fileName);
+		}
 	}
 	else if (qms.opMode == opMode_sigTime)
 	{
@@ -413,11 +458,75 @@ void QmsWidget::OnDatasetStart()
 
 void QmsWidget::OnSpecStart()		//A new spectrum is starting
 {
+	if (qms.IsAccumulating()) return;		//The lines are replaced by the statistics at the end of every spectrum
+
 	chart->Line(1).CopyFromLine(chart->Line(0));
 	chart->Line(0).Clear();
 	SetYChartLimits();
 }
 
+//Accumulation mode: line 0 shows the mean, lines 1 and 2 show the min and max
+void QmsWidget::OnNewSpectrumStats(QmsSpectrumStats stats)
+{
+	lastStats = stats;
+	AddToHistory(stats.mass, stats.lastVal);
+
+	CData data(stats.mass.Count());
+	data.xArr = stats.mass;
+
+	data.yArr = stats.mean;
+	chart->SetLineData(data, 0);
+	data.yArr = stats.minVal;
+	chart->SetLineData(data, 1);
+	data.yArr = stats.maxVal;
+	chart->SetLineData(data, 2);
+
+	BString axisText;
+	axisText.Format("Signal, average of %i spectra", stats.numSpectra);
+	chart->SetYaxisText(axisText);
+
+	SetYChartLimits();
+}
+
+void QmsWidget::OnSpecEnd()
+{
+	//In the accumulation mode the spectra come with the statistics
+	if (qms.opMode != opMode_spectrum || qms.IsAccumulating()) return;
+
+	CData spectrum = chart->GetLineData(0);
+	AddToHistory(spectrum.xArr, spectrum.yArr);
+}
+
+void QmsWidget::OnDatasetEnd()
+{
+	history.CloseSpillFile();
+}
+
+void QmsWidget::AddToHistory(const CHArray<double>& mass, const CHArray<double>& signal)
+{
+	int slot = history.AddSpectrum(mass, signal);
+	if (slot < 0) return;
+
+	//Only the new row needs to be colorized unless this is the first spectrum or the signal range has grown
+	if (history.NumAdded() == 1 || history.SignalMin() < heatmap->Lo() || history.SignalMax() > heatmap->Hi()) RedrawHeatmap();
+	else heatmap->SetRow(slot, history.Slot(slot));
+
+	heatmap->SetFirstRow(history.OldestSlot());
+	heatmap->update();
+}
+
+void QmsWidget::RedrawHeatmap()
+{
+	heatmap->SetRange(history.SignalMin(), history.SignalMax(), true);
+
+	int oldest = history.OldestSlot();
+	for (int i = 0; i < history.Count(); i++)
+	{
+		int slot = (oldest + i) % history.Capacity();
+		heatmap->SetRow(slot, history.Slot(slot));
+	}
+}
+
 void QmsWidget::OnNewData(CHArray<QmsDataPoint> newPoints)
 {
 	if (qms.opMode == opMode_spectrum)
@@ -461,7 +570,23 @@ void QmsWidget::OnBnWriteToFileClicked()
 {
 	CMatrix<double> mat;		//Matrix into which all data will be written
 
-	if (qms.opMode == opMode_spectrum)
+	if (qms.IsAccumulating())
+	{
+		//Accumulated statistics: mass, mean, standard deviation, min, max
+		if (lastStats.numSpectra == 0)
+		{
+			QtUtils::ErrorBox("Error: no data to save.");
+			return;
+		}
+
+		mat.ResizeMatrix(5, lastStats.mass.Count());
+		mat[0] = lastStats.mass;
+		mat[1] = lastStats.mean;
+		mat[2] = lastStats.stdDev;
+		mat[3] = lastStats.minVal;
+		mat[4] = lastStats.maxVal;
+	}
+	else if (qms.opMode == opMode_spectrum)
 	{
 		//Is there a second spectrum? If so, get data from it. Else, take data from the first spectrum.
 		CData data;
@@ -27,7 +27,10 @@
 
 #include "Array.h"
 #include "Qt/ChartWidget/ChartWidget.h"
+#include "Qt/ChartWidget/HeatmapWidget.h"
 #include "Qt/Qms/QmsDataPoint.h"
+#include "Qt/Qms/QmsSpectrumHistory.h"
+#include "Qt/Qms/QmsTranscriptView.h"
 #include "Qt/Qms/ExpDeviceQmsHidenHAL.h"
 #include <QtCharts>
 #include "Qt/Qms/ExpDeviceQmsHidenHAL.h"
@@ -59,6 +62,9 @@ public slots:
 	void OnNewCom(BString str);								//New communication between the mass spec and the computer
 	void OnDatasetStart();									//New dataset is starting on the mass spec
 	void OnSpecStart();										//New spec is starting on the mass spec
+	void OnSpecEnd();										//Spectrum has ended on the mass spec
+	void OnDatasetEnd();									//Dataset has ended on the mass spec
+	void OnNewSpectrumStats(QmsSpectrumStats stats);		//Accumulated statistics at the end of a spectrum
 
 	void OnNewPowerState() { HandleEnabling(); }
 	void OnNewConnState() { HandleEnabling(); }
@@ -74,6 +80,9 @@ protected:
 	void SetYChartLimits();
 	void SetTimeAxisLimits();
 
+	void AddToHistory(const CHArray<double>& mass, const CHArray<double>& signal);	//Adds a spectrum to the history and the heatmap
+	void RedrawHeatmap();
+
 	int HidenRangeToMenuIndex(int range);
 	int MenuIndexToHidenRange(int menuIndex);
 
@@ -104,12 +113,14 @@ protected:
 	CHArray<QWidget*> widgetsPowerButtons;
 	CHArray<QWidget*> widgetsAll;
 
-	BString comString;
-
 protected:
 	ExpDeviceQms& qms;
 	ChartWidget* chart;
+	QmsTranscriptView* comView;			//Replaces the text edit from the ui file
+	HeatmapWidget* heatmap;				//Waterfall of the last spectra in continuous scanning
+	QmsSpectrumHistory history;
 	CHArray<double> massTableCopy;		//Copying the mass table for use in the signal-time mode acquisition
+	QmsSpectrumStats lastStats;			//The latest statistics in the accumulation mode
 
 private:
 	Ui::QmsWidgetClass ui;
@@ -47,19 +47,7 @@ tpdEndTime(0)
 	devData.AddChildAndOwn("writer", writerName);
 
 	//SaveData
-	saveData.AddChildAndOwn("setpoint", params.setpoint);
-	saveData.AddChildAndOwn("rate", params.rate);
-	saveData.AddChildAndOwn("fRounded", params.fRounded);
-	saveData.AddChildAndOwn("radius", params.radius);
-	saveData.AddChildAndOwn("PIDprop", params.PIDprop);
-	saveData.AddChildAndOwn("PIDintegral", params.PIDintegral);
-	saveData.AddChildAndOwn("PIDderiv", params.PIDderiv);
-	saveData.AddChildAndOwn("maxControlV", params.maxControlV);
-	saveData.AddChildAndOwn("maxTemp", params.maxTemp);
-	saveData.AddChildAndOwn("xMin", params.xMin);
-	saveData.AddChildAndOwn("yMin", params.yMin);
-	saveData.AddChildAndOwn("xMax", params.xMax);
-	saveData.AddChildAndOwn("yMax", params.yMax);
+	AddSaveSchema(params);
 
 	//Load all data
 	Load();
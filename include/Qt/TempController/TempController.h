@@ -56,6 +56,24 @@ struct TempControlParams
 	double xMax = 1000;
 	double yMin = 280;
 	double yMax = 1000;
+
+	//Saveob schema, saved by the TempController
+	template<class Visitor> void VisitFields(Visitor& v)
+	{
+		v("setpoint", setpoint);
+		v("rate", rate);
+		v("fRounded", fRounded);
+		v("radius", radius);
+		v("PIDprop", PIDprop);
+		v("PIDintegral", PIDintegral);
+		v("PIDderiv", PIDderiv);
+		v("maxControlV", maxControlV);
+		v("maxTemp", maxTemp);
+		v("xMin", xMin);
+		v("yMin", yMin);
+		v("xMax", xMax);
+		v("yMax", yMax);
+	}
 };
 
 class TempController : public ExpDevice
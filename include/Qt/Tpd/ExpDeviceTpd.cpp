@@ -22,9 +22,12 @@
 
 #include "ExpDeviceTpd.h"
 #include "Matrix.h"
+#include <QDir>
+#include <QCoreApplication>
 
 
 Q_DECLARE_METATYPE(CHArray<QmsDataPoint>)
+Q_DECLARE_METATYPE(CHArray<TpdPeak>)
 
 ExpDeviceTpd::ExpDeviceTpd(xml_node& theDevNode, xml_node& theSaveNode, QObject* parent) :
 ExpDevice(theDevNode, theSaveNode, parent)
@@ -45,8 +48,16 @@ ExpDevice(theDevNode, theSaveNode, parent)
 	saveData.AddChildAndOwn("duration", duration);
 	saveData.AddChildAndOwn("folder", folder);
 
+	//Peak analysis parameters
+	saveData.AddChildAndOwn("baselineFraction", analysis.baselineFraction);
+	saveData.AddChildAndOwn("minPeakFraction", analysis.minPeakFraction);
+	saveData.AddChildAndOwn("smoothingPoints", analysis.smoothingPoints);
+	saveData.AddChildAndOwn("preexponential", analysis.preexponential);
+	saveData.AddChildAndOwn("onlineInterval", onlineInterval);
+
 	//initial state
 	state = tpdState_idle;
+	onlineInterval = 5;
 
 	//Load all data
 	Load();
@@ -64,6 +75,7 @@ bool ExpDeviceTpd::Initialize(StdMap<BString, ExpDevice*>& devMap)
 
 	//Connect to the new data signals from temp controller and qms
 	qRegisterMetaType<CHArray<QmsDataPoint>>();
+	qRegisterMetaType<CHArray<TpdPeak>>();
 	QObject::connect(tempControl, &TempController::SignalNewControlData, this, &ExpDeviceTpd::OnNewTempData, Qt::QueuedConnection);
 	QObject::connect(qms, &ExpDeviceQms::SignalNewData, this, &ExpDeviceTpd::OnNewQmsData, Qt::QueuedConnection);
 
@@ -92,13 +104,33 @@ void ExpDeviceTpd::StartTpd()
 	massTable = qms->massTable;
 
 	//Clear and resize all data
+	qmsTimeLog.Resize(massTable.Count(), true);
+	for (auto& cur : qmsTimeLog) cur.Clear();
+
 	qmsTimeData.Resize(massTable.Count(), true);
 	for (auto& cur : qmsTimeData) cur.Clear();
 
 	qmsTempData.Resize(massTable.Count(), true);
 	for (auto& cur : qmsTempData) cur.Clear();
 
+	tempTimeLog.Clear();
 	tempTimeData.Clear();
+	analysis.Clear();
+
+	tempDecimator.Clear();
+	qmsDecimators.Resize(massTable.Count(), true);
+	for (auto& cur : qmsDecimators) cur.Clear();
+
+	//Long runs keep only the latest points of the logs in memory
+	BString spillBase;
+	spillBase.Format("%s/labgenie_%lld_tpd", QDir::tempPath().toStdString().c_str(), (long long)QCoreApplication::applicationPid());
+	tempTimeLog.SetSpillFile(spillBase + "_temp", maxLogPointsInMemory);
+	for (int i = 0; i < qmsTimeLog.Count(); i++)
+	{
+		BString massFile;
+		massFile.Format("%s_mass%i", spillBase.c_str(), i);
+		qmsTimeLog[i].SetSpillFile(massFile, maxLogPointsInMemory);
+	}
 
 	//Create the ramps
 	if (fIsothermal) tempControl->CreateTPDprofileIsothermal(tempFrom, rate, duration);
@@ -106,6 +138,7 @@ void ExpDeviceTpd::StartTpd()
 
 	tpdBeginTime = tempControl->GetTpdBeginTime();
 	tpdEndTime = tempControl->GetTpdEndTime();
+	lastAnalysisTime = 0;
 
 	SetState(tpdState_running);
 }
@@ -141,7 +174,11 @@ void ExpDeviceTpd::WriteData()
 	for (int i = 0; i < targetData.Count(); i++) result[i + 1] = targetData[i].yArr;
 
 	if (fDataIsothermal) result.Write(fileName + "qmsTime" + extension);
-	else result.Write(fileName + "qmsTemp" + extension);
+	else
+	{
+		result.Write(fileName + "qmsTemp" + extension);
+		analysis.Write(fileName + "peaks" + extension);
+	}
 }
 
 void ExpDeviceTpd::OnNewTempData(double measured, double setpoint, double stopwatchTime)
@@ -154,7 +191,7 @@ void ExpDeviceTpd::OnNewTempData(double measured, double setpoint, double stopwa
 	if (curTime >= tpdBeginTime && curTime < tpdEndTime)
 	{
 		//We should record the data
-		tempTimeData.AddPoint(curTime - tpdBeginTime, measured);
+		tempTimeLog.AddPoint(curTime - tpdBeginTime, measured);
 		return;
 	}
 
@@ -182,12 +219,20 @@ void ExpDeviceTpd::OnNewQmsData(CHArray<QmsDataPoint> newData)
 			else tempOrTime = curTemp;
 
 			int index = massTable.PositionOfClosest(point.mass);
-			qmsTimeData[index].AddPoint(point.time, point.signal);
+			qmsTimeLog[index].AddPoint(point.time, point.signal);
 			
 			//emit the signal for the real-time plot
 			emit SignalNewTpdData(TpdChartPoint(index,tempOrTime,point.signal));
 		}
 
+		//Provisional peaks from the points recorded so far
+		double tpdTime = curTime - tpdBeginTime;
+		if (!fIsothermal && onlineInterval > 0 && tpdTime - lastAnalysisTime >= onlineInterval)
+		{
+			lastAnalysisTime = tpdTime;
+			AnalyzeSoFar();
+		}
+
 		return;
 	}
 
@@ -198,7 +243,17 @@ void ExpDeviceTpd::CheckForEndCondition(double curTime)
 {
 	if (curTime >= tpdEndTime)
 	{
-		//TPD has ended, process the data and change the state
+		//TPD has ended, move the recorded points into the arrays used for processing and saving
+		bool fExported = tempTimeLog.ExportTo(tempTimeData);
+		tempTimeLog.Clear();
+		for (int i = 0; i < qmsTimeLog.Count(); i++)
+		{
+			if (!qmsTimeLog[i].ExportTo(qmsTimeData[i])) fExported = false;
+			qmsTimeLog[i].Clear();
+		}
+		if (!fExported) EmitError("Some TPD points could not be read back from the temporary files, they are saved as 0.");
+
+		//Process the data and change the state
 		SetState(tpdState_finished);
 
 		if (massTable.Count() == 0) return;
@@ -220,25 +275,14 @@ void ExpDeviceTpd::CheckForEndCondition(double curTime)
 		//Regular TPD
 		else
 		{
-			//Interpolate the qmsTime data into qmsTemp data
-			//We'll use the times for the first mass in the mass table to interpolate all other masses
-
-			CHArray<double> times = qmsTimeData[0].xArr;
-			CData newTempTime = tempTimeData.InterpolateArray(times);
-			CHArray<double> temps = newTempTime.yArr;
-
-			qmsTempData[0].yArr = qmsTimeData[0].yArr;
-			qmsTempData[0].xArr = temps;
-
-			for (int i = 1; i < qmsTimeData.Count(); i++)
-			{
-				CData newQmsTimeData = qmsTimeData[i].InterpolateArray(times);
-				qmsTempData[i].yArr = newQmsTimeData.yArr;
-				qmsTempData[i].xArr = temps;
-			}
+			InterpolateToTemp();
 
 			//Reset all data in the chart
 			for (int i = 0; i < qmsTempData.Count(); i++) emit SignalResetLineData(qmsTempData[i], i);
+
+			//Find and integrate the desorption peaks
+			analysis.Analyze(qmsTempData, massTable, rate);
+			emit SignalNewPeaks(analysis.Peaks(), true);
 		}
 
 		//Stop heating the sample at the end of the TPD
@@ -249,4 +293,69 @@ void ExpDeviceTpd::CheckForEndCondition(double curTime)
 		emit SignalDataWritten();
 
 	} //end if curTime > tpdEndTime
-}
\ No newline at end of file
+}
+
+//Interpolates the qmsTime data into qmsTemp data
+void ExpDeviceTpd::InterpolateToTemp()
+{
+	//We'll use the times for the first mass in the mass table to interpolate all other masses
+	CHArray<double> times = qmsTimeData[0].xArr;
+	CData newTempTime = tempTimeData.InterpolateArray(times);
+	CHArray<double> temps = newTempTime.yArr;
+
+	qmsTempData[0].yArr = qmsTimeData[0].yArr;
+	qmsTempData[0].xArr = temps;
+
+	for (int i = 1; i < qmsTimeData.Count(); i++)
+	{
+		CData newQmsTimeData = qmsTimeData[i].InterpolateArray(times);
+		qmsTempData[i].yArr = newQmsTimeData.yArr;
+		qmsTempData[i].xArr = temps;
+	}
+}
+
+//Runs the peak analysis on the points recorded so far, while the TPD is running
+//The baseline is fitted to both ends of the traces, so the results settle as the run goes on
+//and are replaced by the final analysis at the end of the TPD
+//The analysis runs on decimated copies of the logs, so it takes the same time at any point of a run
+void ExpDeviceTpd::AnalyzeSoFar()
+{
+	if (massTable.Count() == 0) return;
+
+	//The data arrays are only filled for good at the end of the TPD, until then they hold the decimated copies
+	tempDecimator.Update(tempTimeLog, tempTimeData, maxProvisionalPoints);
+	if (tempTimeData.Count() < 2) return;
+	for (int i = 0; i < qmsTimeLog.Count(); i++)
+	{
+		qmsDecimators[i].Update(qmsTimeLog[i], qmsTimeData[i], maxProvisionalPoints);
+		if (qmsTimeData[i].Count() < 2) return;
+	}
+
+	InterpolateToTemp();
+	analysis.Analyze(qmsTempData, massTable, rate);
+	emit SignalNewPeaks(analysis.Peaks(), false);
+}
+
+void TpdLogDecimator::Update(const CChunkedData& log, CData& result, int maxPoints)
+{
+	//The new points are the latest ones and are still in memory; const access would not load spilled chunks anyway
+	const CChunkedArray<double>& x = log.xArr;
+	const CChunkedArray<double>& y = log.yArr;
+
+	//Point j of result is point j*stride of the log
+	while (next < log.Count())
+	{
+		if (result.Count() >= 2 * maxPoints)
+		{
+			result.xArr.Decimate(2);
+			result.yArr.Decimate(2);
+			stride *= 2;
+			next = (int64)result.Count() * stride;
+			continue;
+		}
+
+		result.xArr.AddAndExtend(x[next]);
+		result.yArr.AddAndExtend(y[next]);
+		next += stride;
+	}
+}
@@ -25,6 +25,8 @@
 #include "Qt/ExpDevice.h"
 #include "Qt/TempController/TempController.h"
 #include "Qt/Qms/ExpDeviceQms.h"
+#include "TpdAnalysis.h"
+#include "ChunkedArray.h"
 
 #define tpdState_idle 0
 #define tpdState_running 1
@@ -42,6 +44,21 @@ struct TpdChartPoint
 	double signal;
 };
 
+//Keeps every stride-th point of a growing log in a CData of at most 2*maxPoints points, the stride doubles when it is full
+//Every call reads only the points added since the previous one, so following a whole run costs O(N)
+class TpdLogDecimator
+{
+public:
+	TpdLogDecimator() { Clear(); }
+
+	void Clear() { next = 0; stride = 1; }
+	void Update(const CChunkedData& log, CData& result, int maxPoints);		//result must only be changed by Update() until Clear()
+
+private:
+	int64 next;			//Index in the log of the next point to take
+	int64 stride;
+};
+
 class ExpDeviceTpd : public ExpDevice
 {
 	Q_OBJECT
@@ -55,6 +72,7 @@ signals:
 	void SignalNewTpdData(TpdChartPoint point);
 	void SignalResetLineData(CData newData, int index);
 	void SignalDataWritten();
+	void SignalNewPeaks(CHArray<TpdPeak> peaks, bool fFinal);		//Provisional peaks while the TPD runs, final ones at the end
 
 public slots:
 	void OnNewTempData(double measured, double setpoint, double stopwatchTime);
@@ -68,6 +86,7 @@ public:
 	void SetTempControl(TempController* newTempControl){ tempControl = newTempControl; }
 	void SetQms(ExpDeviceQms* newQms) { qms = newQms; }
 	TempController* TempControlDev(){ return tempControl; }
+	const TpdAnalysis& Analysis() const { return analysis; }
 
 	int State() { return state; }
 	void SetState(int newState) { state = newState; EmitState(); }
@@ -75,6 +94,8 @@ public:
 
 private:
 	void CheckForEndCondition(double curTime);
+	void InterpolateToTemp();
+	void AnalyzeSoFar();
 
 public:
 	//Pure virtual functions to be redefined in all devices
@@ -94,6 +115,10 @@ private:
 	int state;
 
 	//These store the TPD data and need to be cleared on every TPD launch
+	//Points are recorded into the chunked logs and copied to the CData at the end of the TPD
+	CChunkedData tempTimeLog;
+	CHArray<CChunkedData> qmsTimeLog;
+	static const int64 maxLogPointsInMemory = (int64)1 << 20;		//Per array, spilled to the temp folder beyond that
 	CData tempTimeData;
 	CHArray<CData> qmsTimeData;
 	CHArray<CData> qmsTempData;
@@ -103,6 +128,13 @@ private:
 	double tpdEndTime;
 	bool fDataIsothermal;		//whether the current data was acquired isothermally or in standard TPD
 
+	//Peaks found in qmsTempData during and at the end of a regular TPD
+	TpdAnalysis analysis;
+	double lastAnalysisTime;		//TPD time of the last provisional analysis, s
+	TpdLogDecimator tempDecimator;	//Decimated copies of the logs for the provisional analysis, in tempTimeData and qmsTimeData
+	CHArray<TpdLogDecimator> qmsDecimators;
+	static const int maxProvisionalPoints = 4096;		//The provisional traces keep 4096 to 8192 points
+
 public:
 	double tempFrom;
 	double tempTo;
@@ -111,6 +143,7 @@ public:
 	bool fIsothermal;
 	double duration;
 	BString folder;
+	double onlineInterval;		//Seconds between provisional analyses during a regular TPD, 0 - only at the end
 
 	//Not in saveob
 	int expNumber;
@@ -0,0 +1,176 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "TpdAnalysis.h"
+#include "Matrix.h"
+#include <math.h>
+#include <algorithm>
+
+TpdAnalysis::TpdAnalysis()
+{
+	baselineFraction = 0.05;
+	minPeakFraction = 0.05;
+	smoothingPoints = 5;
+	preexponential = 1e13;
+}
+
+void TpdAnalysis::Analyze(const CHArray<CData>& traces, const CHArray<double>& masses, double rate)
+{
+	Clear();
+
+	for (int i = 0; i < traces.Count() && i < masses.Count(); i++) AnalyzeTrace(traces[i], i, masses[i], rate);
+}
+
+void TpdAnalysis::AnalyzeTrace(const CData& trace, int index, double mass, double rate)
+{
+	int numPoints = trace.Count();
+	if (numPoints < 5) return;
+
+	CData data = trace;
+	SubtractBaseline(data);
+
+	//The smoothed trace is only used to locate the peaks and their limits
+	CData smoothed;
+	smoothed.xArr = data.xArr;
+	smoothed.yArr = data.yArr;
+	smoothed.yArr.AdjacentAveraging(smoothingPoints);
+	CHArray<double>& y = smoothed.yArr;
+
+	double maxVal = y.Max();
+	if (maxVal <= 0) return;
+	double threshold = minPeakFraction * maxVal;
+
+	for (int i = 1; i < numPoints - 1; i++)
+	{
+		//Local maximum; a plateau is counted once, at its right end
+		if (y[i] < y[i - 1] || y[i] <= y[i + 1] || y[i] < threshold) continue;
+
+		//Walk downhill on both sides to the valleys that limit the peak
+		int left = i;
+		while (left > 0 && y[left - 1] <= y[left]) left--;
+
+		int right = i;
+		while (right < numPoints - 1 && y[right + 1] <= y[right]) right++;
+
+		//Noise maxima are rejected by their prominence above the higher valley
+		double prominence = y[i] - std::max(y[left], y[right]);
+		if (prominence < threshold) continue;
+
+		CData part;
+		data.ExportPart(part, left, right - left + 1);
+
+		TpdPeak peak;
+		peak.index = index;
+		peak.mass = mass;
+		peak.tPeak = RefinePeakPosition(smoothed, i);
+		peak.tLeft = data.xArr[left];
+		peak.tRight = data.xArr[right];
+		peak.height = y[i];
+		peak.area = part.Integrate();
+		peak.energy = RedheadEnergy(peak.tPeak, rate, preexponential);
+
+		peaks << peak;
+
+		i = right - 1;		//The next peak can only start at the right valley of this one
+	}
+}
+
+//Subtracts linear baseline fitted to both ends of the trace
+void TpdAnalysis::SubtractBaseline(CData& data) const
+{
+	int numPoints = data.Count();
+	int numEdge = (int)(numPoints * baselineFraction);
+	if (numEdge < 2) numEdge = 2;
+	if (2 * numEdge > numPoints) return;
+
+	CData edges, rightEdge;
+	data.ExportPart(edges, 0, numEdge);
+	data.ExportPart(rightEdge, numPoints - numEdge, numEdge);
+	edges.Concatenate(rightEdge);
+
+	double a, b;
+	edges.LinearFit(a, b);
+
+	//Two-point baseline spanning the whole trace
+	double xMin = data.xArr.Min();
+	double xMax = data.xArr.Max();
+	if (xMin == xMax) return;
+
+	CData baseline(2);
+	baseline.AddPoint(xMin, a * xMin + b);
+	baseline.AddPoint(xMax, a * xMax + b);
+
+	data.Baseline(baseline);
+}
+
+//Finds the peak position from a parabolic fit to the points around the maximum
+//Falls back to the position of the maximum point if the fit is not a maximum within these points
+double TpdAnalysis::RefinePeakPosition(const CData& data, int pos) const
+{
+	int numPoints = data.Count();
+	int from = std::max(0, pos - 2);
+	int to = std::min(numPoints - 1, pos + 2);
+	if (to - from < 2) return data.xArr[pos];
+
+	//Centered on the maximum to keep the sums of powers of x well conditioned
+	double center = data.xArr[pos];
+	CData part(to - from + 1);
+	for (int i = from; i <= to; i++) part.AddPoint(data.xArr[i] - center, data.yArr[i]);
+
+	double param[3];
+	part.ParabolicFit(param);
+	if (!(param[0] < 0)) return center;
+
+	double vertex = -param[1] / (2 * param[0]);
+	if (vertex < part.xArr.Min() || vertex > part.xArr.Max()) return center;
+
+	return center + vertex;
+}
+
+//First-order Redhead activation energy in kJ/mol
+double TpdAnalysis::RedheadEnergy(double tPeak, double rate, double preexponential)
+{
+	if (tPeak <= 0 || rate <= 0 || preexponential <= 0) return 0;
+
+	double gasConstant = 8.314462618e-3;		//kJ/(mol*K)
+	return gasConstant * tPeak * (log(preexponential * tPeak / rate) - 3.64);
+}
+
+bool TpdAnalysis::Write(const BString& fileName) const
+{
+	CMatrix<double> result(7, peaks.Count());
+
+	for (int i = 0; i < peaks.Count(); i++)
+	{
+		const TpdPeak& peak = peaks[i];
+
+		result(0, i) = peak.mass;
+		result(1, i) = peak.tPeak;
+		result(2, i) = peak.tLeft;
+		result(3, i) = peak.tRight;
+		result(4, i) = peak.height;
+		result(5, i) = peak.area;
+		result(6, i) = peak.energy;
+	}
+
+	return result.Write(fileName);
+}
@@ -0,0 +1,84 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "Data.h"
+
+//A single desorption peak found in a TPD trace
+struct TpdPeak
+{
+	TpdPeak(){}
+
+	int index;			//The index of the mass in the mass table
+	double mass;
+	double tPeak;		//Peak temperature, K
+	double tLeft;		//Integration limits, K
+	double tRight;
+	double height;		//Peak height above the baseline
+	double area;		//Peak area above the baseline, signal*K
+	double energy;		//First-order Redhead activation energy, kJ/mol
+};
+
+//Analysis of the TPD traces: baseline subtraction, peak search, peak integration
+//and Redhead activation energies for every peak
+//Traces are analyzed one mass at a time, so the results are available right after the TPD run
+class TpdAnalysis
+{
+public:
+	TpdAnalysis();
+	~TpdAnalysis(){}
+
+public:
+	//Analyzes all traces; masses and traces should have the same number of points
+	//rate is the heating rate, K/s
+	void Analyze(const CHArray<CData>& traces, const CHArray<double>& masses, double rate);
+
+	//Analyzes a single trace and adds its peaks to the list
+	void AnalyzeTrace(const CData& trace, int index, double mass, double rate);
+
+	void Clear() { peaks.Clear(); }
+	const CHArray<TpdPeak>& Peaks() const { return peaks; }
+	int Count() const { return peaks.Count(); }
+
+	//Writes the peak table, one peak per row:
+	//mass, peak temp, left limit, right limit, height, area, energy
+	bool Write(const BString& fileName) const;
+
+	//First-order Redhead activation energy in kJ/mol
+	//E = R*Tp*(ln(nu*Tp/beta) - 3.64)
+	static double RedheadEnergy(double tPeak, double rate, double preexponential);
+
+private:
+	void SubtractBaseline(CData& data) const;					//Subtracts linear baseline fitted to both ends of the trace
+	double RefinePeakPosition(const CData& data, int pos) const;	//Parabolic fit around the maximum
+
+public:
+	//Analysis parameters
+	double baselineFraction;	//Fraction of points at each end of the trace used to fit the baseline
+	double minPeakFraction;		//Peaks with prominence below this fraction of the trace maximum are ignored
+	int smoothingPoints;		//Number of points for adjacent averaging before the peak search
+	double preexponential;		//Pre-exponential factor for the Redhead equation, 1/s
+
+private:
+	CHArray<TpdPeak> peaks;
+};
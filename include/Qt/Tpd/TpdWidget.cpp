@@ -26,6 +26,7 @@
 
 Q_DECLARE_METATYPE(TpdChartPoint)
 Q_DECLARE_METATYPE(CData)
+Q_DECLARE_METATYPE(CHArray<TpdPeak>)
 
 TpdWidget::TpdWidget(ExpDeviceTpd* theTpdDevice, QWidget* parent) :
 devTpd(theTpdDevice),
@@ -66,10 +67,12 @@ ExpWidget(theTpdDevice, parent)
 	//Connect signals
 	qRegisterMetaType<TpdChartPoint>();
 	qRegisterMetaType<CData>();
+	qRegisterMetaType<CHArray<TpdPeak>>();
 	QObject::connect(devTpd, &ExpDeviceTpd::SignalNewState, this, &TpdWidget::OnNewState, Qt::QueuedConnection);
 	QObject::connect(devTpd, &ExpDeviceTpd::SignalNewTpdData, this, &TpdWidget::OnNewTpdData, Qt::QueuedConnection);
 	QObject::connect(devTpd, &ExpDeviceTpd::SignalResetLineData, this, &TpdWidget::OnResetLineData, Qt::QueuedConnection);
 	QObject::connect(devTpd, &ExpDeviceTpd::SignalDataWritten, this, &TpdWidget::OnDataWritten, Qt::QueuedConnection);
+	QObject::connect(devTpd, &ExpDeviceTpd::SignalNewPeaks, this, &TpdWidget::OnNewPeaks, Qt::QueuedConnection);
 
 	FromDevice();
 	CheckIsothermalChanged(0);
@@ -132,6 +135,7 @@ void TpdWidget::OnNewState(int state)
 		ui.bnStopTpd->setEnabled(true);
 		ui.bnSelectFolder->setEnabled(false);
 		ui.labelStatus->setText("TPD: running");
+		ui.labelStatus->setToolTip("");
 	}
 	else if (state == tpdState_finished)
 	{
@@ -201,4 +205,23 @@ void TpdWidget::OnSelectFolderClicked()
 void TpdWidget::OnDataWritten()
 {
 	ui.spinExpNumber->setValue(ui.spinExpNumber->value() + 1);
-}
\ No newline at end of file
+}
+//Peaks found by the device at the end of a regular TPD
+//The status label shows the number of peaks, the tooltip shows the peak table
+void TpdWidget::OnNewPeaks(CHArray<TpdPeak> peaks, bool fFinal)
+{
+	BString status;
+	if (fFinal) status.Format("TPD: finished, %i peaks", peaks.Count());
+	else status.Format("TPD: running, %i peaks so far", peaks.Count());
+	ui.labelStatus->setText(status.c_str());
+
+	BString table = "Mass\tTp, K\tArea\tE, kJ/mol";
+	for (auto& peak : peaks)
+	{
+		BString line;
+		line.Format("\n%.1f\t%.1f\t%.3g\t%.1f", peak.mass, peak.tPeak, peak.area, peak.energy);
+		table += line;
+	}
+
+	ui.labelStatus->setToolTip(table.c_str());
+}
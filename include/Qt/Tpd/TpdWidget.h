@@ -44,6 +44,7 @@ public slots:
 	void OnNewTpdData(TpdChartPoint point);
 	void OnResetLineData(CData data, int index);
 	void OnDataWritten();
+	void OnNewPeaks(CHArray<TpdPeak> peaks, bool fFinal);
 
 	void OnStartTpdClicked();
 	void OnStopTpdClicked();
@@ -0,0 +1,273 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Randomized truncated SVD (Halko, Martinsson, Tropp): the largest singular values and vectors of a matrix
+//without forming A.Transpose(A)
+//
+//A random sample Y=A.Omega of the range of A is improved with power iterations Y <- A.Transpose(A).Y,
+//orthonormalized by QR into Q, and the small matrix Transpose(Q).A is decomposed exactly
+//Every step is a blocked product over a group of columns, so the matrix can be streamed in column chunks
+//(e.g. a spectrum history read from disk) and never has to be in memory at once
+//Memory is O((rows + chunk columns)*(numVecs+oversampling))
+//
+//		CRandomizedSVD<double> svd(10);
+//		svd.Compute([&](int chunkNum)->const CMatrix<double>* {return LoadChunk(chunkNum);}, vals, colVecs);
+//
+//The chunk source is called numPowerIterations+2 times for every chunk and must return the same columns
+//in the same order on every pass, and a null pointer after the last chunk
+
+#pragma once
+#include "Matrix.h"
+#include <functional>
+#include <vector>
+
+template <class theType, class intType=int> class CRandomizedSVD
+{
+public:
+	//Returns chunk number chunkNum (all chunks have the same number of rows), or 0 after the last one
+	//The returned matrix only has to stay valid until the next call
+	typedef std::function<const CMatrix<theType,intType>*(intType chunkNum)> ChunkSource;
+
+	//numVecs - number of singular values and vectors wanted
+	//oversampling - extra random samples, improve the accuracy of the last vectors
+	//numPowerIterations - passes that sharpen a slowly decaying spectrum, 1-3 is usually enough
+	CRandomizedSVD(intType theNumVecs, intType theOversampling=10, int theNumPowerIterations=2, unsigned long long theSeed=1):
+		numVecs(theNumVecs),oversampling(theOversampling),numPowerIterations(theNumPowerIterations),seed(theSeed),
+		numRows(0),numCols(0){};
+
+	//Singular values (largest numVecs, written lowest to largest) and column singular vectors (rows x numVecs)
+	bool Compute(const ChunkSource& source, CHArray<theType,intType>& vals, CMatrix<theType,intType>& colVecs)
+		{return ComputeImpl(&source,0,vals,colVecs);};
+	bool Compute(const CMatrix<theType,intType>& A, CHArray<theType,intType>& vals, CMatrix<theType,intType>& colVecs)
+		{return ComputeImpl(0,&A,vals,colVecs);};
+
+	//Row singular vectors (cols x numVecs) after Compute(), one more pass over the chunks
+	bool RowVectors(const ChunkSource& source, CMatrix<theType,intType>& rowVecs) const
+		{return RowVectorsImpl(&source,0,rowVecs);};
+	bool RowVectors(const CMatrix<theType,intType>& A, CMatrix<theType,intType>& rowVecs) const
+		{return RowVectorsImpl(0,&A,rowVecs);};
+
+	intType NumRows() const {return numRows;};
+	intType NumCols() const {return numCols;};
+
+private:
+	//Called for every chunk with its column-major data and the number of its first column
+	typedef std::function<void(const theType* chunk, intType chunkCols, intType firstCol)> ChunkWork;
+
+	//theRows is taken from the first chunk if it is 0 (first pass of Compute)
+	static bool ForEachChunk(const ChunkSource* source, const CMatrix<theType,intType>* A, const ChunkWork& work,
+							intType& theRows, intType& totalCols);
+	bool ComputeImpl(const ChunkSource* source, const CMatrix<theType,intType>* A,
+					CHArray<theType,intType>& vals, CMatrix<theType,intType>& colVecs);
+	bool RowVectorsImpl(const ChunkSource* source, const CMatrix<theType,intType>* A, CMatrix<theType,intType>& rowVecs) const;
+
+	//Rows firstCol..firstCol+numCols-1 of the random matrix Omega (cols x sampleSize), uniform in [-1,1]
+	//Generated from the element position, so the chunk boundaries do not matter
+	void RandomBlock(intType firstCol, intType chunkCols, intType sampleSize, theType* dst) const;
+
+	intType numVecs;
+	intType oversampling;
+	int numPowerIterations;
+	unsigned long long seed;
+
+	intType numRows;
+	intType numCols;
+	CHArray<theType,intType> singVals;			//Largest numVecs values, lowest to largest
+	CMatrix<theType,intType> leftVecs;			//Corresponding column singular vectors
+};
+
+template <class theType, class intType>
+bool CRandomizedSVD<theType,intType>::ForEachChunk(const ChunkSource* source, const CMatrix<theType,intType>* A,
+													const ChunkWork& work, intType& theRows, intType& totalCols)
+{
+	totalCols=0;
+
+	if(A)
+	{
+		if(A->rows!=theRows || A->cols==0) return false;
+
+		//Chunks of about 4M elements keep the temporaries small
+		intType chunkCols=std::max((intType)1,(intType)((1<<22)/std::max(theRows,(intType)1)));
+		for(intType first=0; first<A->cols; first+=chunkCols)
+		{
+			intType curCols=std::min(chunkCols,A->cols-first);
+			work(A->theArray.arr+(long long)first*theRows,curCols,first);
+		}
+		totalCols=A->cols;
+		return true;
+	}
+
+	for(intType chunkNum=0;; chunkNum++)
+	{
+		const CMatrix<theType,intType>* chunk=(*source)(chunkNum);
+		if(!chunk) break;
+		if(theRows==0) theRows=chunk->rows;
+		if(chunk->rows!=theRows) return false;
+		if(chunk->cols==0) continue;
+
+		work(chunk->theArray.arr,chunk->cols,totalCols);
+		totalCols+=chunk->cols;
+	}
+	return totalCols>0;
+}
+
+template <class theType, class intType>
+void CRandomizedSVD<theType,intType>::RandomBlock(intType firstCol, intType chunkCols, intType sampleSize, theType* dst) const
+{
+	for(intType j=0; j<sampleSize; j++)
+		for(intType i=0; i<chunkCols; i++)
+		{
+			//SplitMix64 of the position in Omega
+			unsigned long long x=seed+0x9E3779B97F4A7C15ULL*((unsigned long long)(firstCol+i)*(unsigned long long)sampleSize+j+1);
+			x=(x^(x>>30))*0xBF58476D1CE4E5B9ULL;
+			x=(x^(x>>27))*0x94D049BB133111EBULL;
+			x^=x>>31;
+			dst[i+(long long)j*chunkCols]=(theType)((double)(x>>11)*(2.0/9007199254740992.0)-1.0);
+		}
+}
+
+template <class theType, class intType>
+bool CRandomizedSVD<theType,intType>::ComputeImpl(const ChunkSource* source, const CMatrix<theType,intType>* A,
+												CHArray<theType,intType>& vals, CMatrix<theType,intType>& colVecs)
+{
+	numCols=0;
+	singVals.ResizeArray(0);
+	leftVecs.ResizeMatrix(0,0);
+
+	//The number of rows comes from the matrix or the first chunk
+	numRows=A ? A->rows : 0;
+	intType sampleSize=0;
+	long long m=0, l=0;
+
+	CHArray<theType,intType> Y, Q;
+	std::vector<theType> work;
+
+	//Y = A.Omega
+	intType totalCols;
+	bool fOk=ForEachChunk(source,A,[&](const theType* chunk, intType chunkCols, intType firstCol)
+	{
+		if(firstCol==0)
+		{
+			if(numVecs<=0 || numVecs>numRows) return;
+			sampleSize=std::min(numVecs+std::max(oversampling,(intType)0),numRows);
+			m=numRows;
+			l=sampleSize;
+			Y.ResizeArray(numRows*sampleSize,true);
+			Q.ResizeArray(numRows*sampleSize,true);
+			Y=0;
+		}
+		if(!sampleSize) return;
+
+		work.resize((size_t)chunkCols*sampleSize);
+		RandomBlock(firstCol,chunkCols,sampleSize,work.data());
+		CLinearAlgebra::Gemm(false,false,m,l,chunkCols,(theType)1,chunk,m,work.data(),chunkCols,(theType)1,Y.arr,m);
+	},numRows,totalCols);
+	if(!fOk || !sampleSize || numVecs>totalCols) return false;
+	numCols=totalCols;
+
+	//Power iterations: Y = A.Transpose(A).Q, Q re-orthonormalized every time to keep the small directions
+	for(int iter=0; iter<numPowerIterations; iter++)
+	{
+		memcpy(Q.arr,Y.arr,sizeof(theType)*m*l);
+		CLinearAlgebra::QR(m,l,Q.arr,m,(theType*)0,0);
+		Y=0;
+
+		fOk=ForEachChunk(source,A,[&](const theType* chunk, intType chunkCols, intType firstCol)
+		{
+			work.resize((size_t)chunkCols*sampleSize);
+			CLinearAlgebra::Gemm(true,false,chunkCols,l,m,(theType)1,chunk,m,Q.arr,m,(theType)0,work.data(),chunkCols);
+			CLinearAlgebra::Gemm(false,false,m,l,chunkCols,(theType)1,chunk,m,work.data(),chunkCols,(theType)1,Y.arr,m);
+		},numRows,totalCols);
+		if(!fOk || totalCols!=numCols) return false;
+	}
+
+	memcpy(Q.arr,Y.arr,sizeof(theType)*m*l);
+	CLinearAlgebra::QR(m,l,Q.arr,m,(theType*)0,0);
+
+	//Transpose(A).Q = Qb.R, accumulated chunk by chunk: QR of R stacked over the rows of the next chunk
+	//Then Transpose(Q).A = Transpose(R).Transpose(Qb), and the SVD of the l x l matrix Transpose(R) finishes the job
+	std::vector<theType> R((size_t)(l*l),0), stacked;
+	fOk=ForEachChunk(source,A,[&](const theType* chunk, intType chunkCols, intType firstCol)
+	{
+		long long stackRows=l+chunkCols;
+		stacked.resize((size_t)(stackRows*l));
+		for(long long j=0; j<l; j++) memcpy(&stacked[(size_t)(j*stackRows)],&R[(size_t)(j*l)],sizeof(theType)*l);
+		CLinearAlgebra::Gemm(true,false,chunkCols,l,m,(theType)1,chunk,m,Q.arr,m,(theType)0,&stacked[(size_t)l],stackRows);
+		CLinearAlgebra::QR(stackRows,l,stacked.data(),stackRows,R.data(),l,false);
+	},numRows,totalCols);
+	if(!fOk || totalCols!=numCols) return false;
+
+	std::vector<theType> smallMat((size_t)(l*l)), smallVals((size_t)l);
+	for(long long j=0; j<l; j++)
+		for(long long i=0; i<l; i++) smallMat[(size_t)(i+j*l)]=R[(size_t)(j+i*l)];
+	bool fConverged=CLinearAlgebra::JacobiSVD(l,l,smallMat.data(),l,smallVals.data());
+
+	//Column vectors Q.U for the numVecs largest values (the last ones)
+	long long first=l-numVecs;
+	singVals.ResizeArray(numVecs,true);
+	singVals.SetNumPoints(numVecs);
+	for(intType i=0; i<numVecs; i++) singVals.arr[i]=smallVals[(size_t)(first+i)];
+
+	leftVecs.ResizeMatrix(numVecs,numRows);
+	CLinearAlgebra::Gemm(false,false,m,numVecs,l,(theType)1,Q.arr,m,&smallMat[(size_t)(first*l)],l,(theType)0,leftVecs.theArray.arr,m);
+
+	vals=singVals;
+	colVecs=leftVecs;
+	return fConverged;
+}
+
+template <class theType, class intType>
+bool CRandomizedSVD<theType,intType>::RowVectorsImpl(const ChunkSource* source, const CMatrix<theType,intType>* A,
+													CMatrix<theType,intType>& rowVecs) const
+{
+	if(numCols==0) return false;
+
+	//Transpose(A).U/sigma, row block by row block
+	rowVecs.ResizeMatrix(numVecs,numCols);
+	long long m=numRows, n=numCols;
+	intType theRows=numRows, totalCols;
+	bool fOk=ForEachChunk(source,A,[&](const theType* chunk, intType chunkCols, intType firstCol)
+	{
+		if(firstCol+chunkCols>numCols) return;
+		CLinearAlgebra::Gemm(true,false,chunkCols,numVecs,m,(theType)1,chunk,m,leftVecs.theArray.arr,m,
+							(theType)0,rowVecs.theArray.arr+firstCol,n);
+	},theRows,totalCols);
+	if(!fOk || totalCols!=numCols) return false;
+
+	for(intType i=0; i<numVecs; i++)
+	{
+		theType val=singVals.arr[i];
+		if(val>0) rowVecs.colArrays[i]*=(theType)1/val;
+	}
+	return true;
+}
+
+//Randomized counterpart of PartialSVD, same layout of the results
+template <class theType, class intType>
+bool CMatrix<theType,intType>::RandomizedSVD(intType numVecs, CHArray<theType,intType>& vals, CMatrix<theType,intType>& colVecs,
+											CMatrix<theType,intType>& rowVecs, int numPowerIterations, intType oversampling) const
+{
+	CRandomizedSVD<theType,intType> svd(numVecs,oversampling,numPowerIterations);
+	bool fResult=svd.Compute(*this,vals,colVecs);
+	if(!svd.NumCols()) return false;
+	return svd.RowVectors(*this,rowVecs) && fResult;
+}
@@ -23,7 +23,7 @@
 #include "Savable.h"
 #include <fstream>
 
-bool Savable::Save(const BString& fileName)
+bool Savable::Save(const BString& fileName, int archiveVersion)
 {
 	std::ofstream outstream(fileName, std::ofstream::binary);
 	if(!outstream)
@@ -32,10 +32,10 @@ bool Savable::Save(const BString& fileName)
 		return false;
 	}
 
-	BArchive ar(outstream);
+	BArchive ar(outstream,archiveVersion);
 	Serialize(ar);
 
-	return true;
+	return ar.Close();
 }
 
 bool Savable::Load(const BString& fileName)
@@ -50,6 +50,14 @@ bool Savable::Load(const BString& fileName)
 	BArchive ar(instream);
 	Serialize(ar);
 	
-	return true;
+	return ar.IsOk();
+}
+
+bool Savable::LoadFromBuffer(const char* buffer, int64 bufferSize)
+{
+	BArchive ar(buffer,bufferSize);
+	Serialize(ar);
+
+	return ar.IsOk();
 }
 
@@ -35,6 +35,8 @@ public:
 	//pure virtual function that must be implemented in the derived classes
 	virtual void Serialize(BArchive& ar)=0;
 
-	virtual bool Save(const BString& fileName);
+	//Saves in the given BArchive version, Load() reads either version
+	virtual bool Save(const BString& fileName, int archiveVersion=BArchive::currentVersion);
 	virtual bool Load(const BString& fileName);
+	bool LoadFromBuffer(const char* buffer, int64 bufferSize);		//E.g. from a memory-mapped file
 };
\ No newline at end of file
@@ -48,6 +48,12 @@ public:
 	virtual void ToStringArray(CHArray<BString>&){}
 	virtual void FromStringArray(const CHArray<BString>&){}
 
+//Packed single-string form of numeric arrays, see SaveobArrayCodec.h
+//Only SaveobTermArray implements these functions
+	virtual int GetXmlEncoding() const {return 0;}		//SaveobArrayCodec::encodingVals - one string per element
+	virtual void ToEncodedString(BString&){}
+	virtual bool FromEncodedString(const char*, int){return false;}
+
 //Convenience functions
 	bool IsSameKind(const Saveob& other){return obInfo.IsSameKind(other.obInfo);}
 	BString GetObName() const {return obInfo.obName;}
@@ -0,0 +1,136 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Single-node XML encodings of numeric arrays, an opt-in replacement for one <val> node per element
+//list - the numbers separated by blanks; floating-point values use the shortest text that reads back exactly
+//base64 - the bytes of the values as they are in memory (little-endian on x86), the smallest and the fastest
+//Arrays of BString always stay as <val> nodes
+
+#pragma once
+#include <string.h>
+#include <type_traits>
+#include "Array.h"
+#include "TextCodec.h"
+
+namespace SaveobArrayCodec
+{
+	enum encoding
+	{
+		encodingVals=0,		//One <val> node per element
+		encodingList=1,
+		encodingBase64=2
+	};
+
+	//Value of the "encoding" attribute
+	inline const char* EncodingName(int encoding)
+	{
+		if(encoding==encodingList) return "list";
+		if(encoding==encodingBase64) return "base64";
+		return "vals";
+	}
+
+	//encodingVals for an unknown name
+	inline int EncodingFromName(const char* name)
+	{
+		if(strcmp(name,"list")==0) return encodingList;
+		if(strcmp(name,"base64")==0) return encodingBase64;
+		return encodingVals;
+	}
+
+	template <class theType> struct IsPackable {static const bool value=std::is_arithmetic<theType>::value;};
+
+	template <class theType>
+	void Encode(const CHArray<theType>& arr, int encoding, BString& result, std::true_type)
+	{
+		int num=arr.Count();
+		if(encoding==encodingBase64) {CTextCodec::EncodeBase64(arr.arr,(long long)num*sizeof(theType),result); return;}
+
+		result.clear();
+		if(num==0) return;
+
+		CTextCodec::CNumberFormat form=CTextCodec::ParseFormat(std::is_floating_point<theType>::value ? "%r" : "%d");
+
+		//Written straight into the string, then cut to the actual length
+		const int maxLength=32;		//Longer than any shortest-form double or 64-bit integer
+		result.resize((size_t)num*(maxLength+1));
+		char* start=&result[0];
+		char* out=start;
+		for(int i=0; i<num; i++)
+		{
+			if(i>0) *out++=' ';
+			int length=CTextCodec::Format(out,maxLength,arr[i],form);
+			if(length>0) out+=length;
+		}
+		result.resize(out-start);
+	}
+
+	template <class theType>
+	void Encode(const CHArray<theType>&, int, BString& result, std::false_type) {result.clear();}
+
+	//Decoding accepts either encoding, whatever the array is set to write
+	template <class theType>
+	bool Decode(const char* text, int encoding, CHArray<theType>& arr, std::true_type)
+	{
+		long long length=(long long)strlen(text);
+
+		if(encoding==encodingList)
+		{
+			//ParseList() reads bad tokens as 0, so they are rejected before arr is touched
+			if(!CTextCodec::IsNumberList(text,length)) return false;
+
+			CTextCodec::ParseList<theType>(text,length,[&](long long count)->theType*
+			{
+				arr.ResizeArray((int)count,true);
+				return arr.arr;
+			});
+			return true;
+		}
+
+		if(encoding==encodingBase64)
+		{
+			long long numBytes=CTextCodec::DecodedBase64Size(text,length);
+			if(numBytes<0 || numBytes%sizeof(theType)!=0) return false;
+
+			arr.ResizeArray((int)(numBytes/sizeof(theType)),true);
+			CTextCodec::DecodeBase64(text,length,arr.arr);
+			return true;
+		}
+
+		return false;
+	}
+
+	template <class theType>
+	bool Decode(const char*, int, CHArray<theType>&, std::false_type) {return false;}
+
+	//Replaces the contents of result; empty for encodingVals and for arrays that cannot be packed
+	template <class theType>
+	void Encode(const CHArray<theType>& arr, int encoding, BString& result)
+	{
+		if(encoding==encodingVals) {result.clear(); return;}
+		Encode(arr,encoding,result,std::integral_constant<bool,IsPackable<theType>::value>());
+	}
+
+	//false if the text is not valid for the encoding, arr is then left as it was
+	template <class theType>
+	bool Decode(const char* text, int encoding, CHArray<theType>& arr)
+	{return Decode(text,encoding,arr,std::integral_constant<bool,IsPackable<theType>::value>());}
+}
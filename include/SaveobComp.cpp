@@ -57,7 +57,7 @@ Saveob& SaveobComp::operator=(Saveob& rhs)
 		Saveob* rhsChild=rhsIter->second.child;
 		if(rhsChild==NULL) continue;	//something's wrong
 
-		BString& rhsName=rhsChild->GetObName();
+		BString rhsName=rhsChild->GetObName();
 		Saveob* child=GetChild(rhsName);
 
 		if(child==NULL)	//No such child in the current object, add it and copy data
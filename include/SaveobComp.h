@@ -82,7 +82,9 @@ public:
 
 	//templated AddChildAndOwn functions, will create a child and own it, but will not own the base data item
 	template <class theType> bool AddChildAndOwn(const BString& fieldName, theType& target);	//adding a scalar
-	template <class theType> bool AddChildAndOwn(const BString& fieldName, CHArray<theType>& target);	//adding an array
+	//adding an array; xmlEncoding is one of SaveobArrayCodec::encoding
+	template <class theType> bool AddChildAndOwn(const BString& fieldName, CHArray<theType>& target,
+												 int xmlEncoding=SaveobArrayCodec::encodingVals);
 
 private:
 	bool InternalAddChild(Saveob* child, bool fOwned);
@@ -103,9 +105,10 @@ template <class theType> inline bool SaveobComp::AddChildAndOwn(const BString& f
 }
 
 //Add an array variable as a child
-template <class theType> inline bool SaveobComp::AddChildAndOwn(const BString& fieldName, CHArray<theType>& target)
+template <class theType> inline bool SaveobComp::AddChildAndOwn(const BString& fieldName, CHArray<theType>& target, int xmlEncoding)
 {
 	SaveobTermArray<theType>* newChild=new SaveobTermArray<theType>(fieldName, target);
+	newChild->SetXmlEncoding(xmlEncoding);
 
 	if(AddChildAndOwn(newChild)) return true;
 	else
@@ -0,0 +1,380 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#pragma once
+#include "SaveobComp.h"
+#include "SaveobToXml.h"
+#include <cstring>
+#include <cstdlib>
+
+//Compile-time field schemas: the SaveobComp layout of a plain struct, without building a SaveobComp
+//
+//The struct lists its fields once, in a template member:
+//
+//	struct TempControlParams
+//	{
+//		double setpoint;
+//		bool fRounded;
+//		CHArray<double> ramp;
+//
+//		template<class Visitor> void VisitFields(Visitor& v)
+//		{
+//			v("setpoint", setpoint);
+//			v("fRounded", fRounded);
+//			v("ramp", ramp);
+//			v("calibration", calibration, SaveobArrayCodec::encodingList);	//Packed XML form, see SaveobArrayCodec.h
+//		}
+//	};
+//
+//The SaveobSchema functions read and write such a struct in the XML layout of SaveobToXml and the buffer layout
+//of SaveobComp, so either side can read what the other wrote. Every field access is inlined by the compiler:
+//no SaveobTerm per field, no child map, no virtual ToString()/FromString().
+//Field types: bool, char, int, uint, int64, float, double, BString and CHArray of any of these.
+//SaveobComp remains the tool for objects whose fields are only known at run time.
+
+//Per-type conversions; the text forms are the ones SaveobTerm uses
+template<class T> struct SaveobSchemaValue;
+
+#define SAVEOB_SCHEMA_INT(theType, enumType) \
+template<> struct SaveobSchemaValue<theType> \
+{ \
+	static SaveobInfo::type ObType() { return enumType; } \
+	static void ToString(const theType& val, BString& str) { str.Format("%i", val); } \
+	static void FromString(const char* str, theType& val) { val = (theType)atoi(str); } \
+};
+
+SAVEOB_SCHEMA_INT(char, SaveobInfo::typeChar)
+SAVEOB_SCHEMA_INT(int, SaveobInfo::typeInt)
+SAVEOB_SCHEMA_INT(uint, SaveobInfo::typeUint)
+
+template<> struct SaveobSchemaValue<int64>
+{
+	static SaveobInfo::type ObType() { return SaveobInfo::typeInt64; }
+	static void ToString(const int64& val, BString& str) { str.Format("%lld", (long long)val); }
+	static void FromString(const char* str, int64& val) { val = (int64)strtoll(str, nullptr, 10); }
+};
+
+template<> struct SaveobSchemaValue<bool>
+{
+	static SaveobInfo::type ObType() { return SaveobInfo::typeBool; }
+	static void ToString(const bool& val, BString& str) { str = val ? "true" : "false"; }
+	static void FromString(const char* str, bool& val) { val = (strcmp(str, "true") == 0); }
+};
+
+template<> struct SaveobSchemaValue<float>
+{
+	static SaveobInfo::type ObType() { return SaveobInfo::typeFloat; }
+	static void ToString(const float& val, BString& str) { str.Format("%.5e", val); }
+	static void FromString(const char* str, float& val) { val = (float)atof(str); }
+};
+
+template<> struct SaveobSchemaValue<double>
+{
+	static SaveobInfo::type ObType() { return SaveobInfo::typeDouble; }
+	static void ToString(const double& val, BString& str) { str.Format("%.5e", val); }
+	static void FromString(const char* str, double& val) { val = atof(str); }
+};
+
+template<> struct SaveobSchemaValue<BString>
+{
+	static SaveobInfo::type ObType() { return SaveobInfo::typeBString; }
+	static void ToString(const BString& val, BString& str) { str = val; }
+	static void FromString(const char* str, BString& val) { val = str; }
+};
+
+namespace SaveobSchema
+{
+	//XML, same layout as SaveobToXml::WriteSaveobDataToNode() / ReadSaveobDataFromNode()
+	//WriteToNode() updates existing nodes in place and returns true if the document changed
+	template<class T> bool WriteToNode(T& ob, xml_node& node);
+	template<class T> void ReadFromNode(T& ob, xml_node& node);		//Fields without a node keep their values
+
+	//Binary, same layout as SaveobComp::WriteToBuffer() / ReadFromBuffer()
+	//Fields are written in declaration order; SaveobComp reads them by name, in any order
+	template<class T> int RequiredSpace(T& ob);
+	template<class T> void WriteToBuffer(T& ob, char*& buffer);
+	template<class T> void ReadFromBuffer(T& ob, char*& buffer);	//Unknown or retyped entries are skipped
+
+	//For code that needs a SaveobComp: adds a term per field, pointing at the field
+	template<class T> void AddToComp(T& ob, SaveobComp& comp);
+
+	//Visitors behind the functions above
+	class NodeWriter
+	{
+	public:
+		NodeWriter(xml_node& theNode) : node(theNode), fChanged(false) {}
+
+		template<class V> void operator()(const char* name, V& val)
+		{
+			SaveobSchemaValue<V>::ToString(val, str);
+			xml_node fieldNode = SaveobToXml::FieldNode(node, name, fChanged);
+			fChanged = SaveobToXml::SetNodeText(fieldNode, str) || fChanged;
+		}
+
+		template<class V> void operator()(const char* name, CHArray<V>& arr, int encoding = SaveobArrayCodec::encodingVals)
+		{
+			if (!SaveobArrayCodec::IsPackable<V>::value) encoding = SaveobArrayCodec::encodingVals;
+
+			xml_node fieldNode = SaveobToXml::FieldNode(node, name, fChanged);
+			fChanged = SaveobToXml::SetArrayEncoding(fieldNode, encoding) || fChanged;
+			if (encoding != SaveobArrayCodec::encodingVals)
+			{
+				SaveobArrayCodec::Encode(arr, encoding, str);
+				fChanged = SaveobToXml::SetNodeText(fieldNode, str) || fChanged;
+				return;
+			}
+
+			xml_node curVal = SaveobToXml::StartVals(fieldNode, fChanged);
+			for (int i = 0; i < arr.Count(); i++)
+			{
+				SaveobSchemaValue<V>::ToString(arr[i], str);
+				fChanged = SaveobToXml::SetValText(fieldNode, curVal, str) || fChanged;
+			}
+			fChanged = SaveobToXml::RemoveVals(fieldNode, curVal) || fChanged;
+		}
+
+		bool IsChanged() const { return fChanged; }
+
+	private:
+		xml_node& node;
+		BString str;		//Reused for every value
+		bool fChanged;
+	};
+
+	class NodeReader
+	{
+	public:
+		NodeReader(xml_node& theNode) : node(theNode) {}
+
+		template<class V> void operator()(const char* name, V& val)
+		{
+			xml_node pcDataNode = node.child(name).first_child();
+			if (!pcDataNode || pcDataNode.type() != pugi::node_pcdata) return;
+
+			SaveobSchemaValue<V>::FromString(pcDataNode.value(), val);
+		}
+
+		//Packed arrays are read whatever the field's own encoding is
+		template<class V> void operator()(const char* name, CHArray<V>& arr, int = SaveobArrayCodec::encodingVals)
+		{
+			xml_node fieldNode = node.child(name);
+			if (!fieldNode) return;
+
+			int encoding = SaveobToXml::GetArrayEncoding(fieldNode);
+			if (encoding != SaveobArrayCodec::encodingVals)
+			{
+				SaveobArrayCodec::Decode(fieldNode.child_value(), encoding, arr);
+				return;
+			}
+
+			int count = 0;
+			for (xml_node curVal = fieldNode.child("val"); curVal; curVal = curVal.next_sibling("val")) count++;
+
+			arr.ResizeIfSmaller(count);
+			arr.Clear();
+
+			V val;
+			for (xml_node curVal = fieldNode.child("val"); curVal; curVal = curVal.next_sibling("val"))
+			{
+				xml_node pcDataNode = curVal.first_child();
+				if (!pcDataNode || pcDataNode.type() != pugi::node_pcdata) continue;
+
+				SaveobSchemaValue<V>::FromString(pcDataNode.value(), val);
+				arr.AddPoint(val);
+			}
+		}
+
+	private:
+		xml_node& node;
+	};
+
+	//Writes and sizes SaveobInfo headers without a SaveobInfo: name, empty designation, type, fArray
+	inline int InfoSpace(const char* name) { return int(strlen(name)) + 1 + 1 + 1 + 1; }
+
+	inline void WriteInfo(const char* name, SaveobInfo::type obType, bool fArray, char*& buffer)
+	{
+		size_t length = strlen(name) + 1;
+		memcpy(buffer, name, length);
+		buffer += length;
+		*buffer++ = 0;
+		*buffer++ = (char)obType;
+		*buffer++ = (char)fArray;
+	}
+
+	template<class V> inline int ValueSpace(V&) { return sizeof(V); }
+	inline int ValueSpace(BString& val) { return val.GetLength() + 1; }
+	template<class V> inline int ValueSpace(CHArray<V>& arr) { return arr.RequiredSpace(); }
+
+	template<class V> inline void WriteValue(V& val, char*& buffer) { memcpy(buffer, &val, sizeof(V)); buffer += sizeof(V); }
+	inline void WriteValue(BString& val, char*& buffer) { memcpy(buffer, val.c_str(), val.GetLength() + 1); buffer += val.GetLength() + 1; }
+	template<class V> inline void WriteValue(CHArray<V>& arr, char*& buffer) { arr.SerializeToBuffer(buffer); }
+
+	template<class V> inline void ReadValue(V& val, char*& buffer) { memcpy(&val, buffer, sizeof(V)); buffer += sizeof(V); }
+	inline void ReadValue(BString& val, char*& buffer) { val = buffer; buffer += val.GetLength() + 1; }
+	template<class V> inline void ReadValue(CHArray<V>& arr, char*& buffer) { arr.SerializeFromBuffer(buffer); }
+
+	template<class V> inline SaveobInfo::type ObType(V&) { return SaveobSchemaValue<V>::ObType(); }
+	template<class V> inline SaveobInfo::type ObType(CHArray<V>&) { return SaveobSchemaValue<V>::ObType(); }
+	template<class V> inline bool IsArray(V&) { return false; }
+	template<class V> inline bool IsArray(CHArray<V>&) { return true; }
+
+	class SpaceCounter
+	{
+	public:
+		SpaceCounter() : space(sizeof(int)), numFields(0) {}
+		template<class V> void operator()(const char* name, V& val) { space += InfoSpace(name) + ValueSpace(val); numFields++; }
+		template<class V> void operator()(const char* name, CHArray<V>& arr, int) { (*this)(name, arr); }	//Encoding is XML only
+
+		int space;
+		int numFields;
+	};
+
+	class BufferWriter
+	{
+	public:
+		BufferWriter(char*& theBuffer) : buffer(theBuffer) {}
+		template<class V> void operator()(const char* name, V& val)
+		{
+			WriteInfo(name, ObType(val), IsArray(val), buffer);
+			WriteValue(val, buffer);
+		}
+		template<class V> void operator()(const char* name, CHArray<V>& arr, int) { (*this)(name, arr); }
+
+	private:
+		char*& buffer;
+	};
+
+	//Reads the value of one buffer entry into the field with the same name and kind, if there is one
+	class BufferReader
+	{
+	public:
+		BufferReader(const char* theName, SaveobInfo::type theObType, bool theFarray, char*& theBuffer, int theIndex) :
+		name(theName), obType(theObType), fArray(theFarray), buffer(theBuffer), index(theIndex), curIndex(0), fFound(false) {}
+
+		template<class V> void operator()(const char* fieldName, V& val)
+		{
+			//Entries written by the same schema come in field order, so the field at the same index is tried first
+			bool fCandidate = !fFound && (curIndex == index || index < 0);
+			curIndex++;
+			if (!fCandidate) return;
+
+			if (ObType(val) != obType || IsArray(val) != fArray || strcmp(fieldName, name) != 0) return;
+
+			ReadValue(val, buffer);
+			fFound = true;
+		}
+		template<class V> void operator()(const char* fieldName, CHArray<V>& arr, int) { (*this)(fieldName, arr); }
+
+		bool IsFound() const { return fFound; }
+		void SearchAll() { index = -1; curIndex = 0; }
+
+	private:
+		const char* name;
+		SaveobInfo::type obType;
+		bool fArray;
+		char*& buffer;
+		int index;
+		int curIndex;
+		bool fFound;
+	};
+
+	class CompAdder
+	{
+	public:
+		CompAdder(SaveobComp& theComp) : comp(theComp) {}
+		template<class V> void operator()(const char* name, V& val) { comp.AddChildAndOwn(name, val); }
+		template<class V> void operator()(const char* name, CHArray<V>& arr, int encoding) { comp.AddChildAndOwn(name, arr, encoding); }
+
+	private:
+		SaveobComp& comp;
+	};
+}
+
+template<class T> bool SaveobSchema::WriteToNode(T& ob, xml_node& node)
+{
+	NodeWriter writer(node);
+	ob.VisitFields(writer);
+	return writer.IsChanged();
+}
+
+template<class T> void SaveobSchema::ReadFromNode(T& ob, xml_node& node)
+{
+	NodeReader reader(node);
+	ob.VisitFields(reader);
+}
+
+template<class T> int SaveobSchema::RequiredSpace(T& ob)
+{
+	SpaceCounter counter;
+	ob.VisitFields(counter);
+	return counter.space;
+}
+
+template<class T> void SaveobSchema::WriteToBuffer(T& ob, char*& buffer)
+{
+	SpaceCounter counter;
+	ob.VisitFields(counter);
+	memcpy(buffer, &counter.numFields, sizeof(int));
+	buffer += sizeof(int);
+
+	BufferWriter writer(buffer);
+	ob.VisitFields(writer);
+}
+
+template<class T> void SaveobSchema::ReadFromBuffer(T& ob, char*& buffer)
+{
+	int numEntries;
+	memcpy(&numEntries, buffer, sizeof(int));
+	buffer += sizeof(int);
+
+	for (int i = 0; i < numEntries; i++)
+	{
+		//SaveobInfo header: name, designation, type, fArray
+		const char* name = buffer;
+		buffer += strlen(buffer) + 1;
+		buffer += strlen(buffer) + 1;
+		SaveobInfo::type obType = (SaveobInfo::type)*buffer++;
+		bool fArray = (*buffer++ != 0);
+
+		BufferReader reader(name, obType, fArray, buffer, i);
+		ob.VisitFields(reader);
+		if (!reader.IsFound())
+		{
+			reader.SearchAll();
+			ob.VisitFields(reader);
+		}
+		if (reader.IsFound()) continue;
+
+		//No such field: read the entry into a throwaway object to step over it
+		SaveobInfo info(name, "", fArray);
+		info.obType = obType;
+		SaveobComp skip("skip");
+		if (!skip.AddChildAndOwn(info)) return;		//Unknown type - the rest of the buffer cannot be parsed
+		skip.GetChild(info.obName)->ReadFromBuffer(buffer);
+	}
+}
+
+template<class T> void SaveobSchema::AddToComp(T& ob, SaveobComp& comp)
+{
+	CompAdder adder(comp);
+	ob.VisitFields(adder);
+}
@@ -23,6 +23,7 @@
 #pragma once
 #include "Saveob.h"
 #include "Array.h"
+#include "SaveobArrayCodec.h"
 
 //Terminating array savable object
 //Serializes an array of simple types to/from string
@@ -42,7 +43,8 @@ private:
 
 private:
 	//Conversions of between scalar values and BString
-	BString ValToString(const theType& val);
+	//ValToString formats into str so that the buffers of a reused string array are reused
+	void ValToString(const theType& val, BString& str);
 	theType StringToVal(const BString& str);
 
 public:
@@ -58,8 +60,19 @@ public:
 	virtual void ToStringArray(CHArray<BString>& result);
 	virtual void FromStringArray(const CHArray<BString>& source);
 
+	//XML form of the array, one of SaveobArrayCodec::encoding; arrays of BString always use encodingVals
+	void SetXmlEncoding(int encoding)
+	{xmlEncoding=SaveobArrayCodec::IsPackable<theType>::value ? encoding : (int)SaveobArrayCodec::encodingVals;}
+	virtual int GetXmlEncoding() const {return xmlEncoding;}
+	virtual void ToEncodedString(BString& result) {SaveobArrayCodec::Encode(*target,xmlEncoding,result);}
+	virtual bool FromEncodedString(const char* text, int encoding) {return SaveobArrayCodec::Decode(text,encoding,*target);}
+
+private:
+	int xmlEncoding;
+
+public:
 	Saveob& operator=(Saveob& rhs);	//Assignment operator
-	Saveob& operator=(SaveobTermArray& rhs){return operator=((Saveob&)rhs)};
+	Saveob& operator=(SaveobTermArray& rhs){return operator=((Saveob&)rhs);}
 };
 
 //Assignment operator
@@ -84,6 +97,7 @@ template<class theType> SaveobTermArray<theType>::SaveobTermArray(SaveobInfo& th
 
 	target=new CHArray<theType>;
 	fOwnsTarget=true;
+	xmlEncoding=SaveobArrayCodec::encodingVals;
 }
 
 template<class theType> SaveobTermArray<theType>::SaveobTermArray(SaveobInfo& theInfo, CHArray<theType>& theTarget)
@@ -93,6 +107,7 @@ template<class theType> SaveobTermArray<theType>::SaveobTermArray(SaveobInfo& th
 
 	target=&theTarget;
 	fOwnsTarget=false;
+	xmlEncoding=SaveobArrayCodec::encodingVals;
 }
 
 template<class theType> SaveobTermArray<theType>::
@@ -103,6 +118,7 @@ template<class theType> SaveobTermArray<theType>::
 
 	target=&theTarget;
 	fOwnsTarget=false;
+	xmlEncoding=SaveobArrayCodec::encodingVals;
 }
 
 //Copy constructor
@@ -114,6 +130,7 @@ template<class theType> SaveobTermArray<theType>::
 
 	target=new CHArray<theType>;
 	fOwnsTarget=true;
+	xmlEncoding=other.xmlEncoding;
 
 	*this=other;
 }
@@ -155,14 +172,14 @@ ENFORCE_INFO_ARR(double, SaveobInfo::typeDouble)
 ENFORCE_INFO_ARR(BString, SaveobInfo::typeBString)
 
 //Conversions of scalar value to string
-template<> inline BString SaveobTermArray<bool>::ValToString(const bool& val) { if (val) return "true"; else return "false"; }	//bool
-template<class theType> inline BString SaveobTermArray<theType>::ValToString(const theType& val)
-								{BString result; result.Format("%i", val); return result;}				//char, int, uint, int64
-template<> inline BString SaveobTermArray<float>::ValToString(const float& val) 
-								{BString result; result.Format("%.5e", val); return result;}			//float
-template<> inline BString SaveobTermArray<double>::ValToString(const double& val)
-								{BString result; result.Format("%.5e", val); return result;}			//double
-template<> inline BString SaveobTermArray<BString>::ValToString(const BString& val) { return val; }		//BString
+template<> inline void SaveobTermArray<bool>::ValToString(const bool& val, BString& str) { if (val) str = "true"; else str = "false"; }	//bool
+template<class theType> inline void SaveobTermArray<theType>::ValToString(const theType& val, BString& str)
+								{str.Format("%i", val);}				//char, int, uint, int64
+template<> inline void SaveobTermArray<float>::ValToString(const float& val, BString& str)
+								{str.Format("%.5e", val);}			//float
+template<> inline void SaveobTermArray<double>::ValToString(const double& val, BString& str)
+								{str.Format("%.5e", val);}			//double
+template<> inline void SaveobTermArray<BString>::ValToString(const BString& val, BString& str) { str = val; }		//BString
 
 //Conversions of string to scalar value
 template<> inline bool SaveobTermArray<bool>::StringToVal(const BString& str) { if (str == "true") return true; else return false; }	//bool
@@ -174,10 +191,12 @@ template<> inline BString SaveobTermArray<BString>::StringToVal(const BString& s
 
 template<class theType> void SaveobTermArray<theType>::ToStringArray(CHArray<BString>& result)
 {
-	result.ResizeIfSmaller(target->Count());
-	result.Clear();
+	//Strings left in result by a previous call keep their capacity and are formatted over
+	int num = target->Count();
+	result.ResizeIfSmaller(num);
+	result.SetNumPoints(num);
 
-	for (auto& x : *target) result.AddPoint(ValToString(x));
+	for (int i = 0; i < num; i++) ValToString((*target)[i], result[i]);
 }
 
 template<class theType> void SaveobTermArray<theType>::FromStringArray(const CHArray<BString>& source)
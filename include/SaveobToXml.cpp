@@ -22,6 +22,7 @@
 
 #include "SaveobToXml.h"
 #include "Common.h"
+#include <cstring>
 
 //Writes the saveob as a single child in a document
 bool SaveobToXml::WriteSaveobToXmlFile(SaveobComp& saveob, const BString& fileName, bool fEscapeEntities, bool fIndented)
@@ -32,20 +33,26 @@ bool SaveobToXml::WriteSaveobToXmlFile(SaveobComp& saveob, const BString& fileNa
 }
 
 //Adds the saveob as a child based on the name in the obInfo
-//If a child with the same name already exists, then clear that child and re-use it
-void SaveobToXml::AddSaveobToNode(SaveobComp& saveob, xml_node& node)
+//If a child with the same name already exists, then update that child in place
+bool SaveobToXml::AddSaveobToNode(SaveobComp& saveob, xml_node& node)
 {
-	xml_node curNode = node.child(saveob.obInfo.obName);
-	if(!node) curNode = node.append_child(saveob.obInfo.obName);
-	WriteSaveobDataToNode(saveob, curNode);
+	bool fChanged = false;
+	xml_node curNode = FieldNode(node, saveob.obInfo.obName, fChanged);
+	return WriteSaveobDataToNode(saveob, curNode) || fChanged;
 }
 
 //Writes the saveob data as children of the given node
-void SaveobToXml::WriteSaveobDataToNode(SaveobComp& saveob, xml_node& node)
+//Nodes that already hold the same text are left alone, so an unchanged saveob leaves the document unchanged
+bool SaveobToXml::WriteSaveobDataToNode(SaveobComp& saveob, xml_node& node)
 {
 	CHArray<Saveob*> children;
 	saveob.GetChildren(children);
 
+	//Reused by every child, so that the strings keep their buffers from one child to the next
+	CHArray<BString> tempArray;
+	BString curString;
+	bool fChanged = false;
+
 	for (int i = 0; i<children.Count(); i++)
 	{
 		Saveob& curChild = *(children[i]);
@@ -53,33 +60,139 @@ void SaveobToXml::WriteSaveobDataToNode(SaveobComp& saveob, xml_node& node)
 		//If it's a comp child, create a subnode for it with a recursive call
 		if (curChild.obInfo.obType == SaveobInfo::typeComp)
 		{
-			AddSaveobToNode((SaveobComp&)curChild, node);
+			fChanged = AddSaveobToNode((SaveobComp&)curChild, node) || fChanged;
 			continue;
 		}
 
-		//Find the node with the same name and clear it, or attach one if it does not exist
-		xml_node mainNode = node.child(curChild.obInfo.obName);
-		if (mainNode) SimplestXml::RemoveAllChildren(mainNode);
-		else mainNode = node.append_child(curChild.obInfo.obName);
+		//Find the node with the same name, or attach one if it does not exist
+		xml_node mainNode = FieldNode(node, curChild.obInfo.obName, fChanged);
 
-		//If it is an array, save its elements into <val> child nodes
+		//If it is an array, save its elements into <val> child nodes, or all of them as one string if it is packed
 		if (curChild.obInfo.fArray)
 		{
-			CHArray<BString> tempArray;
+			int encoding = curChild.GetXmlEncoding();
+			fChanged = SetArrayEncoding(mainNode, encoding) || fChanged;
+			if (encoding != SaveobArrayCodec::encodingVals)
+			{
+				curChild.ToEncodedString(curString);
+				fChanged = SetNodeText(mainNode, curString) || fChanged;
+				continue;
+			}
+
 			curChild.ToStringArray(tempArray);
 
-			for (auto& curString : tempArray)
-				mainNode.append_child("val").append_child(pugi::node_pcdata).set_value(curString);
+			xml_node curVal = StartVals(mainNode, fChanged);
+			for (auto& val : tempArray) fChanged = SetValText(mainNode, curVal, val) || fChanged;
+			fChanged = RemoveVals(mainNode, curVal) || fChanged;
 
 			continue;
 		}
 
 		//By now it's a data saveob and not an array
-		//Append it as a node with a pcdata
-		BString curString;
+		//Store it as the pcdata of the node
 		curChild.ToString(curString);
-		mainNode.append_child(pugi::node_pcdata).set_value(curString);
+		fChanged = SetNodeText(mainNode, curString) || fChanged;
+	}
+
+	return fChanged;
+}
+
+bool SaveobToXml::SetNodeText(xml_node& node, const char* text)
+{
+	xml_node first = node.first_child();
+
+	//The usual case: a single pcdata child
+	if (first && first.type() == pugi::node_pcdata && !first.next_sibling())
+	{
+		if (strcmp(first.value(), text) == 0) return false;
+		first.set_value(text);
+		return true;
+	}
+
+	//An empty string read back from a file has no pcdata at all
+	if (!first && text[0] == 0) return false;
+
+	SimplestXml::RemoveAllChildren(node);
+	node.append_child(pugi::node_pcdata).set_value(text);
+	return true;
+}
+
+xml_node SaveobToXml::FieldNode(xml_node& node, const char* name, bool& fChanged)
+{
+	xml_node fieldNode = node.child(name);
+	if (fieldNode) return fieldNode;
+
+	fChanged = true;
+	return node.append_child(name);
+}
+
+xml_node SaveobToXml::StartVals(xml_node& fieldNode, bool& fChanged)
+{
+	xml_node curVal = fieldNode.child("val");
+
+	//A node that held a scalar before is cleared
+	if (!curVal && fieldNode.first_child())
+	{
+		SimplestXml::RemoveAllChildren(fieldNode);
+		fChanged = true;
+	}
+
+	return curVal;
+}
+
+bool SaveobToXml::SetValText(xml_node& fieldNode, xml_node& curVal, const char* text)
+{
+	bool fChanged = false;
+	if (!curVal)
+	{
+		//Indentation read from a file is kept as pcdata, which would leave new nodes unindented
+		if (fieldNode.last_child().type() == pugi::node_pcdata) RemoveWhitespace(fieldNode);
+		curVal = fieldNode.append_child("val");
+		fChanged = true;
+	}
+
+	fChanged = SetNodeText(curVal, text) || fChanged;
+	curVal = curVal.next_sibling("val");
+	return fChanged;
+}
+
+bool SaveobToXml::RemoveVals(xml_node& fieldNode, xml_node curVal)
+{
+	if (!curVal) return false;
+	RemoveWhitespace(fieldNode);
+
+	bool fChanged = false;
+	while (curVal)
+	{
+		xml_node next = curVal.next_sibling("val");
+		fieldNode.remove_child(curVal);
+		curVal = next;
+		fChanged = true;
 	}
+
+	return fChanged;
+}
+
+bool SaveobToXml::SetArrayEncoding(xml_node& fieldNode, int encoding)
+{
+	pugi::xml_attribute attr = fieldNode.attribute("encoding");
+	if (encoding == SaveobArrayCodec::encodingVals) return fieldNode.remove_attribute(attr);
+
+	const char* name = SaveobArrayCodec::EncodingName(encoding);
+	if (attr && strcmp(attr.value(), name) == 0) return false;
+
+	//The text of the other form is not valid in this one
+	SimplestXml::RemoveAllChildren(fieldNode);
+	if (!attr) attr = fieldNode.append_attribute("encoding");
+	attr.set_value(name);
+	return true;
+}
+
+int SaveobToXml::GetArrayEncoding(const xml_node& fieldNode)
+{
+	pugi::xml_attribute attr = fieldNode.attribute("encoding");
+	if (!attr) return SaveobArrayCodec::encodingVals;
+	return SaveobArrayCodec::EncodingFromName(attr.value());
 }
 
 //Reads the saveob from the document given the name of the saveob
@@ -123,8 +236,16 @@ void SaveobToXml::ReadSaveobDataFromNode(SaveobComp& saveob, xml_node& node)
 		}
 
 		//If it's an array, read its elements from the <val> child nodes in childNode
+		//A packed array is read whatever encoding the saveob itself writes, so that files stay readable when it changes
 		if (curChild.obInfo.fArray)
 		{
+			int encoding = GetArrayEncoding(childNode);
+			if (encoding != SaveobArrayCodec::encodingVals)
+			{
+				curChild.FromEncodedString(childNode.child_value(), encoding);
+				continue;
+			}
+
 			int count = 0;
 			xml_node curVal;
 
@@ -154,3 +275,15 @@ void SaveobToXml::ReadSaveobDataFromNode(SaveobComp& saveob, xml_node& node)
 		curChild.FromString(curString);
 	}
 }
+
+//Removes the whitespace-only pcdata children of node
+void SaveobToXml::RemoveWhitespace(xml_node& node)
+{
+	xml_node child = node.first_child();
+	while (child)
+	{
+		xml_node next = child.next_sibling();
+		if (child.type() == pugi::node_pcdata && child.value()[strspn(child.value(), " \t\r\n")] == 0) node.remove_child(child);
+		child = next;
+	}
+}
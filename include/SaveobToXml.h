@@ -33,9 +33,23 @@ namespace SaveobToXml
 	//Writes the saveob as a single child in a document
 	bool WriteSaveobToXmlFile(SaveobComp& saveob, const BString& fileName, bool fEscapeEntities = false, bool fIndented = false);
 	//Adds the saveob as a child based on the name in the obInfo
-	void AddSaveobToNode(SaveobComp& saveob, xml_node& node);
+	//Both update existing nodes in place and return true if anything in the document changed
+	bool AddSaveobToNode(SaveobComp& saveob, xml_node& node);
 	//Writes the saveob data as children of the given node
-	void WriteSaveobDataToNode(SaveobComp& saveob, xml_node& node);
+	bool WriteSaveobDataToNode(SaveobComp& saveob, xml_node& node);
+
+	//In-place updates, each returns true if the document changed
+	bool SetNodeText(xml_node& node, const char* text);						//Makes text the only content of node, as pcdata
+	xml_node FieldNode(xml_node& node, const char* name, bool& fChanged);	//Child with the name, appended if missing
+	//Array elements: StartVals() returns the first <val> node; SetValText() sets the text of curVal, appending
+	//it if curVal is null, and moves curVal to the next <val>; RemoveVals() drops the ones left over at the end
+	xml_node StartVals(xml_node& fieldNode, bool& fChanged);
+	bool SetValText(xml_node& fieldNode, xml_node& curVal, const char* text);
+	bool RemoveVals(xml_node& fieldNode, xml_node curVal);
+	void RemoveWhitespace(xml_node& node);		//Removes whitespace-only pcdata children
+	//Packed arrays (SaveobArrayCodec.h) keep the whole array as the node text with an "encoding" attribute
+	bool SetArrayEncoding(xml_node& fieldNode, int encoding);	//encodingVals removes the attribute
+	int GetArrayEncoding(const xml_node& fieldNode);
 
 	//Reading from XML
 	//Reads the saveob from the document given the name of the saveob
@@ -1,8 +1,11 @@
 #pragma once
 
 #include <map>
+#include <vector>
+#include <utility>
 #include "Array.h"
 #include "Savable.h"
+#include "HashIndex.h"
 
 template<class keyType, class valType = int>
 class StdMap : public std::map<keyType,valType>, public Savable
@@ -59,20 +62,20 @@ public:
 		for (argIntType i = 0; i < keyArray.Count(); i++)	Insert(keyArray.arr[i], valArray.arr[i]);
 	}
 
-	void Remove(const keyType& key)		{erase(key);}
+	void Remove(const keyType& key)		{this->erase(key);}
 
-	void Clear()	{clear();}
+	void Clear()	{this->clear();}
 
-	bool IsEmpty() const	{return empty();}
+	bool IsEmpty() const	{return this->empty();}
 
 	bool IsPresent(const keyType& key) const
 	{
-		return (count(key) > 0);
+		return (this->count(key) > 0);
 	};
 
 	int Count() const
 	{
-		return size();
+		return (int)this->size();
 	}
 
 	//Is one of array elements present
@@ -86,4 +89,156 @@ public:
 
 		return false;
 	}
-};
\ No newline at end of file
+};
+
+//StdMap interface over a dense array of pairs and an open-addressing hash index
+//Lookups do not walk a tree and entries are not allocated one by one; iteration is in insertion order,
+//Remove() moves the last entry into the hole. Serialize() uses the StdMap format, so archives are interchangeable
+template<class keyType, class valType = int>
+class StdHashMap : public Savable
+{
+public:
+	typedef std::pair<keyType,valType> value_type;
+	typedef typename std::vector<value_type>::iterator iterator;
+	typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+	iterator begin() {return entries.begin();}
+	iterator end() {return entries.end();}
+	const_iterator begin() const {return entries.begin();}
+	const_iterator end() const {return entries.end();}
+
+	void Serialize(BArchive& ar)
+	{
+		CHArray<keyType> keys(Count());
+		CHArray<valType> vals(Count());
+
+		if (ar.IsStoring())
+		{
+			for (auto& curPair : entries)
+			{
+				keys.AddPoint(curPair.first);
+				vals.AddPoint(curPair.second);
+			}
+
+			ar & keys & vals;
+		}
+		else
+		{
+			ar & keys & vals;
+			Clear();
+			index.Reserve(keys.Count());
+			for (int i = 0; i < keys.Count(); i++) Insert(keys[i], vals[i]);
+		}
+	}
+
+	valType& operator[](const keyType& key)		//Inserts a default value if the key is not present
+	{
+		unsigned int fingerprint = Fingerprint(key);
+		int pos = index.Find(fingerprint, [&](int cur){return CHashOf<keyType>::Equal(entries[cur].first, key);});
+		if (pos >= 0) return entries[pos].second;
+
+		index.Insert(fingerprint, (int)entries.size());
+		entries.push_back(value_type(key, valType()));
+		return entries.back().second;
+	}
+
+	valType* Find(const keyType& key)		//0 if the key is not present
+	{
+		int pos = FindPos(key);
+		return (pos >= 0) ? &entries[pos].second : 0;
+	}
+
+	const valType* Find(const keyType& key) const
+	{
+		int pos = FindPos(key);
+		return (pos >= 0) ? &entries[pos].second : 0;
+	}
+
+	//String lookup without a temporary BString - for BString keys
+	valType* FindString(const char* str, int length)
+	{
+		unsigned int fingerprint = CHashIndex::Fingerprint(CHashOf<keyType>::Hash(str, (size_t)length));
+		int pos = index.Find(fingerprint, [&](int cur){return CHashOf<keyType>::Equal(entries[cur].first, str, (size_t)length);});
+		return (pos >= 0) ? &entries[pos].second : 0;
+	}
+
+	void Insert(const keyType& key)		//Insert just a key - the value is assumed to not matter and set to 1
+	{
+		(*this)[key]=(valType)1;
+	}
+
+	void Insert(const keyType& key, const valType& val)		//Insert a value and a key
+	{
+		(*this)[key]=val;
+	}
+
+	//Insert only keys from CHArray
+	template<class argIntType>
+	void InsertFromArray(const CHArray<keyType,argIntType>& keyArray)
+	{
+		for(argIntType i=0; i < keyArray.Count(); i++)	Insert(keyArray.arr[i]);
+	}
+
+	//Insert keys and vals from CHArrays
+	template<class argIntType>
+	void InsertFromArrays(const CHArray<keyType, argIntType>& keyArray,
+							const CHArray<valType, argIntType>& valArray)	
+	{
+		for (argIntType i = 0; i < keyArray.Count(); i++)	Insert(keyArray.arr[i], valArray.arr[i]);
+	}
+
+	void Remove(const keyType& key)		//O(1) - the last entry takes the place of the removed one
+	{
+		int pos = FindPos(key);
+		if (pos < 0) return;
+
+		int last = (int)entries.size() - 1;
+		index.Erase(Fingerprint(key), pos);
+		if (pos != last)
+		{
+			index.Reindex(Fingerprint(entries[last].first), last, pos);
+			entries[pos] = std::move(entries[last]);
+		}
+		entries.pop_back();
+	}
+
+	void Clear()	{entries.clear(); index.Clear();}
+
+	bool IsEmpty() const	{return entries.empty();}
+
+	bool IsPresent(const keyType& key) const	{return FindPos(key) >= 0;}
+	bool IsStringPresent(const char* str) const
+	{
+		size_t length = strlen(str);
+		unsigned int fingerprint = CHashIndex::Fingerprint(CHashOf<keyType>::Hash(str, length));
+		return index.Find(fingerprint, [&](int cur){return CHashOf<keyType>::Equal(entries[cur].first, str, length);}) >= 0;
+	}
+
+	int Count() const
+	{
+		return (int)entries.size();
+	}
+
+	//Is one of array elements present
+	template<class argIntType>
+	bool IsPresentOneOf(const CHArray<keyType,argIntType>& theArray) const
+	{
+		for(argIntType i=0; i < theArray.Count(); i++)
+		{
+			if(IsPresent(theArray.arr[i])) return true;
+		}
+
+		return false;
+	}
+
+private:
+	unsigned int Fingerprint(const keyType& key) const {return CHashIndex::Fingerprint(CHashOf<keyType>::Hash(key));}
+
+	int FindPos(const keyType& key) const
+	{
+		return index.Find(Fingerprint(key), [&](int cur){return CHashOf<keyType>::Equal(entries[cur].first, key);});
+	}
+
+	std::vector<value_type> entries;
+	CHashIndex index;
+};
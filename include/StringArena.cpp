@@ -0,0 +1,166 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "StringArena.h"
+#include <cstdarg>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+//VS2013 has no thread_local; a thread-local POD pointer is supported by both compilers
+#ifdef _MSC_VER
+#define STRING_ARENA_THREAD __declspec(thread)
+#else
+#define STRING_ARENA_THREAD __thread
+#endif
+
+static STRING_ARENA_THREAD CStringArena* threadArena = nullptr;
+
+//A thread-local pointer has no destructor, so the arenas handed out by ForThread() are owned here
+static std::mutex arenaListMutex;
+static std::vector<std::unique_ptr<CStringArena>> arenaList;
+
+CStringArena::CStringArena(size_t theBlockSize)
+{
+	curBlock = 0;
+	curPos = 0;
+	used = 0;
+	blockSize = std::max(theBlockSize, size_t(64));
+}
+
+CStringArena::~CStringArena()
+{
+	for (auto& block : blocks) delete[] block.data;
+}
+
+CStringArena& CStringArena::ForThread()
+{
+	if (threadArena == nullptr)
+	{
+		CStringArena* arena = new CStringArena;
+
+		std::lock_guard<std::mutex> lock(arenaListMutex);
+		arenaList.emplace_back(arena);
+		threadArena = arena;
+	}
+
+	return *threadArena;
+}
+
+BStringView CStringArena::Copy(BStringView str)
+{
+	char* dest = Allocate(str.Size() + 1);
+	memcpy(dest, str.Data(), str.Size());
+	dest[str.Size()] = 0;
+
+	return BStringView(dest, str.Size());
+}
+
+BStringView CStringArena::Concat(BStringView one, BStringView two, BStringView three)
+{
+	size_t length = one.Size() + two.Size() + three.Size();
+	char* dest = Allocate(length + 1);
+
+	memcpy(dest, one.Data(), one.Size());
+	memcpy(dest + one.Size(), two.Data(), two.Size());
+	memcpy(dest + one.Size() + two.Size(), three.Data(), three.Size());
+	dest[length] = 0;
+
+	return BStringView(dest, length);
+}
+
+BStringView CStringArena::Format(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+
+	//First attempt straight into what is left of the current block
+	size_t spare = blocks.empty() ? 0 : blocks[curBlock].size - curPos;
+	char* dest = (spare > 0) ? blocks[curBlock].data + curPos : nullptr;
+
+	va_list listCopy;
+	va_copy(listCopy, args);
+	int res = vsnprintf(dest, spare, format, listCopy);
+	va_end(listCopy);
+
+	if (res < 0) { va_end(args); return BStringView(); }
+
+	//If it fitted, this claims exactly the characters just written; otherwise format again into fresh space
+	bool fFitted = size_t(res) < spare;
+	dest = Allocate(size_t(res) + 1);
+	if (!fFitted) vsnprintf(dest, size_t(res) + 1, format, args);
+	va_end(args);
+
+	return BStringView(dest, size_t(res));
+}
+
+void CStringArena::Rewind(size_t mark)
+{
+	if (mark >= used) return;
+
+	while (curBlock > 0 && blocks[curBlock].start > mark) curBlock--;
+	curPos = mark - blocks[curBlock].start;
+	used = mark;
+}
+
+void CStringArena::Reset()
+{
+	curBlock = 0;
+	curPos = 0;
+	used = 0;
+}
+
+size_t CStringArena::BytesReserved() const
+{
+	size_t total = 0;
+	for (auto& block : blocks) total += block.size;
+	return total;
+}
+
+char* CStringArena::Allocate(size_t size)
+{
+	if (blocks.empty() || curPos + size > blocks[curBlock].size)
+	{
+		//Move on to the next block, or put a new one there if it is missing or too small for this request
+		size_t next = blocks.empty() ? 0 : curBlock + 1;
+		if (next == blocks.size() || blocks[next].size < size)
+		{
+			Block block;
+			block.size = std::max(blockSize, size);
+			block.data = new char[block.size];
+			block.start = 0;
+			blocks.insert(blocks.begin() + next, block);
+		}
+
+		//The rest of the current block is skipped; the starts of the following blocks shift accordingly
+		for (size_t i = next; i < blocks.size(); i++)
+			blocks[i].start = (i == 0) ? 0 : blocks[i - 1].start + blocks[i - 1].size;
+
+		curBlock = next;
+		curPos = 0;
+	}
+
+	char* result = blocks[curBlock].data + curPos;
+	curPos += size;
+	used = blocks[curBlock].start + curPos;
+	return result;
+}
@@ -0,0 +1,88 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#pragma once
+#include "BString.h"
+#include <vector>
+
+//A bump allocator for transient strings: building a command, a file name or a log line without a heap
+//allocation per piece. Everything it returns is a BStringView whose characters are zero-terminated and stay
+//valid until Reset() or a Rewind() past them. Blocks are kept across Reset(), so a steady workload stops
+//allocating after the first round.
+//Not thread-safe; ForThread() hands every thread its own arena.
+class CStringArena
+{
+public:
+	CStringArena(size_t theBlockSize = 1 << 16);
+	~CStringArena();
+
+	//The calling thread's arena, created on first use and freed at program exit
+	static CStringArena& ForThread();
+
+	BStringView Copy(BStringView str);
+	BStringView Concat(BStringView one, BStringView two, BStringView three = BStringView());
+	BStringView Format(const char* format, ...);
+
+	//Rewind() releases everything allocated after the matching Mark(); Reset() releases everything
+	size_t Mark() const { return used; }
+	void Rewind(size_t mark);
+	void Reset();
+
+	size_t BytesUsed() const { return used; }
+	size_t BytesReserved() const;
+
+private:
+	CStringArena(const CStringArena&);					//Not copyable - views point into the blocks
+	CStringArena& operator=(const CStringArena&);
+
+	char* Allocate(size_t size);		//size bytes, contiguous, in the current block or the next one
+
+	struct Block
+	{
+		char* data;
+		size_t size;
+		size_t start;			//Value of used at the beginning of this block
+	};
+
+	std::vector<Block> blocks;
+	size_t curBlock;			//Block that new allocations go to
+	size_t curPos;				//Position within blocks[curBlock]
+	size_t used;				//blocks[curBlock].start + curPos: bytes handed out, counting skipped block ends
+	size_t blockSize;
+};
+
+//Rewinds the arena to where it was when the scope was entered
+class CStringArenaScope
+{
+public:
+	CStringArenaScope(CStringArena& theArena = CStringArena::ForThread()) : arena(theArena), mark(theArena.Mark()) {}
+	~CStringArenaScope() { arena.Rewind(mark); }
+
+	CStringArena& Arena() { return arena; }
+
+private:
+	CStringArenaScope(const CStringArenaScope&);
+	CStringArenaScope& operator=(const CStringArenaScope&);
+
+	CStringArena& arena;
+	size_t mark;
+};
@@ -0,0 +1,161 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Work-stealing pool for recursive divide-and-conquer work (e.g. PDDP splits)
+//A task is a small value (e.g. a column range); processing a task may push new tasks
+//Every thread keeps its own deque: it pushes and takes its newest tasks from the back (depth first, cache-warm),
+//idle threads steal the oldest tasks of the others from the front - those are the largest subtrees
+//Threads that find nothing to steal sleep until a task is pushed or the last one finishes
+//With more than one thread, parallel code called from a task (sorts, CLinearAlgebra products) runs on the task's thread
+//
+//		CTaskPool<range> pool(CParallelSort::NumThreads());
+//		pool.Run(range(0,n),[&](const range& cur, int threadNum)
+//		{
+//			if(cur.count>1) {pool.Push(threadNum,left); pool.Push(threadNum,right);}
+//		});
+
+#pragma once
+#include "ParallelSort.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+template <class taskType> class CTaskPool
+{
+public:
+	explicit CTaskPool(int theNumThreads):numThreads(theNumThreads<1 ? 1 : theNumThreads),pending(0),queued(0),numIdle(0)
+	{
+		for(int t=0; t<numThreads; t++) queues.push_back(std::unique_ptr<CQueue>(new CQueue));
+	};
+
+	//Runs func(task, threadNum) for root and for every task pushed while running, returns when all are done
+	template <class funcType> void Run(const taskType& root, funcType func);
+
+	//Adds a task to the deque of the calling thread, only from within func
+	void Push(int threadNum, const taskType& task)
+	{
+		pending++;
+		{
+			CQueue& queue=*queues[(size_t)threadNum];
+			std::lock_guard<std::mutex> guard(queue.lock);
+			queue.tasks.push_back(task);
+		}
+		queued++;
+
+		//A thread counts itself idle before it checks queued, so either it sees this task or it is woken
+		if(numIdle>0) Wake(false);
+	};
+
+	int NumThreads() const {return numThreads;};
+
+private:
+	struct CQueue
+	{
+		std::mutex lock;
+		std::deque<taskType> tasks;
+	};
+
+	//Own newest task, or the oldest task of another thread
+	bool Pop(int threadNum, taskType& task);
+
+	//Sleeps until a task is queued or all are finished
+	void WaitForWork()
+	{
+		std::unique_lock<std::mutex> guard(idleLock);
+		numIdle++;
+		idleCondition.wait(guard,[this](){return queued>0 || pending==0;});
+		numIdle--;
+	}
+
+	void Wake(bool fAll)
+	{
+		std::lock_guard<std::mutex> guard(idleLock);
+		if(fAll) idleCondition.notify_all();
+		else idleCondition.notify_one();
+	}
+
+	int numThreads;
+	std::vector<std::unique_ptr<CQueue> > queues;
+	std::atomic<long long> pending;			//Pushed and not finished yet
+	std::atomic<long long> queued;			//In the deques, not taken yet
+	std::atomic<int> numIdle;				//Threads in WaitForWork()
+	std::mutex idleLock;
+	std::condition_variable idleCondition;
+};
+
+template <class taskType>
+bool CTaskPool<taskType>::Pop(int threadNum, taskType& task)
+{
+	{
+		CQueue& own=*queues[(size_t)threadNum];
+		std::lock_guard<std::mutex> guard(own.lock);
+		if(!own.tasks.empty())
+		{
+			task=own.tasks.back();
+			own.tasks.pop_back();
+			queued--;
+			return true;
+		}
+	}
+
+	for(int i=1; i<numThreads; i++)
+	{
+		CQueue& victim=*queues[(size_t)((threadNum+i)%numThreads)];
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if(!victim.tasks.empty())
+		{
+			task=victim.tasks.front();
+			victim.tasks.pop_front();
+			queued--;
+			return true;
+		}
+	}
+	return false;
+}
+
+template <class taskType>
+template <class funcType>
+void CTaskPool<taskType>::Run(const taskType& root, funcType func)
+{
+	Push(0,root);
+
+	CParallelSort::ParallelFor(numThreads,[&](int t)
+	{
+		CParallelSort::CSerialScope serial(numThreads>1);
+
+		taskType task;
+		while(true)
+		{
+			if(Pop(t,task))
+			{
+				func(task,t);
+				if(--pending==0) Wake(true);		//After func, so the tasks it pushed are already counted
+			}
+			else if(pending==0) break;
+			else WaitForWork();
+		}
+	});
+}
@@ -0,0 +1,505 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#include "TextCodec.h"
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <string>
+
+//std::to_chars/from_chars for floating point arrived with VS2019 16.4 and GCC 11
+#if defined(_MSC_VER) && _MSC_VER>=1924
+	#define TEXTCODEC_CHARCONV
+#elif defined(__has_include)
+	#if __has_include(<charconv>) && __cplusplus>=201703L
+		#include <charconv>
+		#if defined(__cpp_lib_to_chars)
+			#define TEXTCODEC_CHARCONV
+		#endif
+	#endif
+#endif
+
+#if defined(TEXTCODEC_CHARCONV)
+	#include <charconv>
+#endif
+
+CTextCodec::CNumberFormat CTextCodec::ParseFormat(const char* form)
+{
+	CNumberFormat result;
+	result.spec=form;
+	result.conversion=0;
+	result.precision=-1;
+
+	//Text before the conversion
+	std::string prefix;
+	const char* p=form;
+	while(*p)
+	{
+		if(p[0]=='%' && p[1]=='%') {prefix+='%'; p+=2;}
+		else if(p[0]=='%') break;
+		else prefix+=*p++;
+	}
+	if(*p==0) return result;	//No conversion at all - printf will just print the text
+	p++;
+
+	//Only a precision and length modifiers are allowed on the fast path
+	int precision=-1;
+	if(*p=='.')
+	{
+		p++;
+		precision=0;
+		while(*p>='0' && *p<='9') precision=precision*10+(*p++ -'0');
+	}
+	bool fLength=false;
+	while(*p=='l' || *p=='h' || *p=='L' || *p=='z') {fLength=true; p++;}
+	if(p[0]=='I' && p[1]=='6' && p[2]=='4') {fLength=true; p+=3;}
+
+	char conversion=*p;
+	if(conversion==0) return result;
+	p++;
+
+	if(conversion=='e' || conversion=='f' || conversion=='g')
+	{
+		if(fLength) return result;
+		if(precision<0) precision=6;
+	}
+	else if(conversion=='d' || conversion=='i')
+	{
+		if(precision>=0) return result;
+		conversion='d';
+	}
+	else if(conversion=='r')
+	{
+		if(precision>=0 || fLength) return result;
+	}
+	else return result;
+
+	//Text after the conversion, no other conversions allowed
+	std::string suffix;
+	while(*p)
+	{
+		if(p[0]=='%' && p[1]=='%') {suffix+='%'; p+=2;}
+		else if(p[0]=='%') return result;
+		else suffix+=*p++;
+	}
+
+	result.prefix=prefix.c_str();
+	result.suffix=suffix.c_str();
+	result.conversion=conversion;
+	result.precision=precision;
+
+	return result;
+}
+
+//Copies the prefix, calls writeNumber(from,to) that returns the end of the number or NULL, copies the suffix
+template <class writeFunc>
+static int FormatAround(char* buf, int bufSize, const CTextCodec::CNumberFormat& form, writeFunc writeNumber)
+{
+	int prefixLength=form.prefix.GetLength();
+	int suffixLength=form.suffix.GetLength();
+	if(prefixLength+suffixLength>=bufSize) return -1;
+
+	memcpy(buf,(const char*)form.prefix,prefixLength);
+	char* end=writeNumber(buf+prefixLength,buf+bufSize-suffixLength);
+	if(end==NULL) return -1;
+
+	memcpy(end,(const char*)form.suffix,suffixLength);
+	return (int)(end-buf)+suffixLength;
+}
+
+#if !defined(TEXTCODEC_CHARCONV)
+//Shortest round trip through printf, when to_chars is not there
+static const char* RoundTripSpec(double) {return "%.17g";}
+static const char* RoundTripSpec(float) {return "%.9g";}
+#endif
+
+template <class floatType>
+static int FormatFloating(char* buf, int bufSize, floatType val, const CTextCodec::CNumberFormat& form)
+{
+	return FormatAround(buf,bufSize,form,[&](char* from, char* to)->char*
+	{
+#if defined(TEXTCODEC_CHARCONV)
+		std::to_chars_result res;
+		switch(form.conversion)
+		{
+		case 'e': res=std::to_chars(from,to,val,std::chars_format::scientific,form.precision); break;
+		case 'f': res=std::to_chars(from,to,val,std::chars_format::fixed,form.precision); break;
+		case 'g': res=std::to_chars(from,to,val,std::chars_format::general,form.precision); break;
+		case 'r': res=std::to_chars(from,to,val); break;
+		default: res=std::to_chars(from,to,(long long)val); break;	//%d on a floating value, printed as an integer
+		}
+		return (res.ec==std::errc()) ? res.ptr : NULL;
+#else
+		char spec[16];
+		switch(form.conversion)
+		{
+		case 'r': strcpy(spec,RoundTripSpec(val)); break;
+		case 'd': strcpy(spec,"%.0f"); break;
+		default: sprintf(spec,"%%.%d%c",form.precision,form.conversion); break;
+		}
+		#if defined(_MSC_VER) && _MSC_VER<1900
+			int length=_snprintf(from,to-from,spec,(double)(form.conversion=='d' ? (double)(long long)val : val));
+		#else
+			int length=snprintf(from,to-from,spec,(double)(form.conversion=='d' ? (double)(long long)val : val));
+		#endif
+		return (length<0 || length>=to-from) ? NULL : from+length;
+#endif
+	});
+}
+
+template <class intType>
+static int FormatIntegral(char* buf, int bufSize, intType val, const CTextCodec::CNumberFormat& form)
+{
+	if(form.conversion!='d' && form.conversion!='r') return FormatFloating(buf,bufSize,(double)val,form);
+
+	return FormatAround(buf,bufSize,form,[&](char* from, char* to)->char*
+	{
+		char digits[24];
+		int numDigits=0;
+
+		bool fNegative=val<0;
+		unsigned long long absVal=fNegative ? 0ULL-(unsigned long long)val : (unsigned long long)val;
+		do
+		{
+			digits[numDigits++]=(char)('0'+absVal%10);
+			absVal/=10;
+		}
+		while(absVal!=0);
+
+		if(to-from<numDigits+1) return NULL;
+		if(fNegative) *from++='-';
+		while(numDigits>0) *from++=digits[--numDigits];
+		return from;
+	});
+}
+
+int CTextCodec::FormatFast(char* buf, int bufSize, double val, const CNumberFormat& form)
+{return FormatFloating(buf,bufSize,val,form);}
+
+int CTextCodec::FormatFast(char* buf, int bufSize, float val, const CNumberFormat& form)
+{
+	//Fixed precision formats print the value promoted to double, as printf does
+	if(form.conversion=='r') return FormatFloating(buf,bufSize,val,form);
+	return FormatFloating(buf,bufSize,(double)val,form);
+}
+
+int CTextCodec::FormatFast(char* buf, int bufSize, long long val, const CNumberFormat& form)
+{return FormatIntegral(buf,bufSize,val,form);}
+
+int CTextCodec::FormatFast(char* buf, int bufSize, unsigned long long val, const CNumberFormat& form)
+{return FormatIntegral(buf,bufSize,val,form);}
+
+//strtod() on a zero-terminated copy of the token
+static double ParseWithStrtod(const char* from, const char* to)
+{
+	char local[64];
+	size_t length=to-from;
+	if(length<sizeof(local))
+	{
+		memcpy(local,from,length);
+		local[length]=0;
+		return strtod(local,NULL);
+	}
+
+	std::string copy(from,to);
+	return strtod(copy.c_str(),NULL);
+}
+
+double CTextCodec::ParseDouble(const char* from, const char* to)
+{
+#if defined(TEXTCODEC_CHARCONV)
+	//from_chars takes no '+' and no hex prefix, such tokens and out-of-range values go to strtod
+	double val=0;
+	std::from_chars_result res=std::from_chars(from,to,val);
+	if(res.ec==std::errc() && res.ptr==to) return val;
+#endif
+	return ParseWithStrtod(from,to);
+}
+
+bool CTextCodec::IsNumber(const char* from, const char* to)
+{
+	if(from==to) return false;
+
+	char local[64];
+	std::string copy;
+	const char* start=local;
+	size_t length=to-from;
+	if(length<sizeof(local))
+	{
+		memcpy(local,from,length);
+		local[length]=0;
+	}
+	else
+	{
+		copy.assign(from,to);
+		start=copy.c_str();
+	}
+
+	char* end=NULL;
+	strtod(start,&end);
+	return end==start+length;
+}
+
+bool CTextCodec::IsNumberList(const char* text, long long length)
+{
+	int threads=(length<minParallelLength) ? 1 : CParallelSort::NumThreads();
+
+	std::vector<long long> bounds;
+	SplitText(text,length,threads,false,bounds);
+
+	std::vector<char> fValid(threads,1);
+	CParallelSort::ParallelFor(threads,[&](int t)
+	{
+		const char* p=text+bounds[t];
+		const char* end=text+bounds[t+1];
+		while(true)
+		{
+			while(p<end && IsBlank(*p)) p++;
+			if(p==end) break;
+
+			const char* tokenStart=p;
+			while(p<end && !IsBlank(*p)) p++;
+			if(!IsNumber(tokenStart,p)) {fValid[t]=0; break;}
+		}
+	});
+
+	for(int t=0; t<threads; t++) if(!fValid[t]) return false;
+	return true;
+}
+
+long long CTextCodec::ParseInteger(const char* from, const char* to)
+{
+	const char* p=from;
+	bool fNegative=false;
+	if(p<to && (*p=='-' || *p=='+')) fNegative=(*p++=='-');
+
+	if(p==to) return (long long)ParseDouble(from,to);
+
+	//Unsigned accumulation covers the whole range of both signed and unsigned 64-bit types
+	unsigned long long val=0;
+	for(; p<to; p++)
+	{
+		if(*p<'0' || *p>'9') return (long long)ParseDouble(from,to);
+
+		unsigned long long digit=(unsigned long long)(*p-'0');
+		if(val>(ULLONG_MAX-digit)/10) return (long long)ParseDouble(from,to);	//Overflow
+		val=val*10+digit;
+	}
+
+	return fNegative ? (long long)(0ULL-val) : (long long)val;
+}
+
+void CTextCodec::SplitText(const char* text, long long length, int numChunks, bool fAtLines, std::vector<long long>& bounds)
+{
+	bounds.assign(numChunks+1,length);
+	bounds[0]=0;
+
+	for(int i=1; i<numChunks; i++)
+	{
+		long long pos=std::max(bounds[i-1],length*i/numChunks);
+		while(pos<length && pos>0 && (fAtLines ? text[pos-1]!='\n' : !IsBlank(text[pos-1]))) pos++;
+		bounds[i]=pos;
+	}
+}
+
+long long CTextCodec::CountTokens(const char* from, const char* to)
+{
+	long long count=0;
+	bool fPrevBlank=true;
+	for(const char* p=from; p<to; p++)
+	{
+		bool fBlank=IsBlank(*p);
+		if(fPrevBlank && !fBlank) count++;
+		fPrevBlank=fBlank;
+	}
+	return count;
+}
+
+long long CTextCodec::CountLines(const char* from, const char* to)
+{
+	long long count=0;
+	while(from<to)
+	{
+		const char* lf=(const char*)memchr(from,'\n',to-from);
+		if(lf==NULL) break;
+		count++;
+		from=lf+1;
+	}
+	return count;
+}
+
+static const char base64Chars[]="ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+//Six-bit value of each base64 char, -1 for anything else
+static const signed char base64Values[256]=
+{
+	-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+	-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+	-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,62,-1,-1,-1,63,
+	52,53,54,55,56,57,58,59,60,61,-1,-1,-1,-1,-1,-1,
+	-1,0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,
+	15,16,17,18,19,20,21,22,23,24,25,-1,-1,-1,-1,-1,
+	-1,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40,
+	41,42,43,44,45,46,47,48,49,50,51,-1,-1,-1,-1,-1,
+	-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+	-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+	-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+	-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+	-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+	-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+	-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+	-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+};
+
+void CTextCodec::EncodeBase64(const void* data, long long size, BString& result)
+{
+	result.clear();
+	if(size<=0) return;
+
+	const unsigned char* in=(const unsigned char*)data;
+	result.resize((size_t)((size+2)/3*4));
+	char* out=&result[0];
+
+	long long i=0;
+	for(; i+3<=size; i+=3)
+	{
+		unsigned int triple=(in[i]<<16) | (in[i+1]<<8) | in[i+2];
+		*out++=base64Chars[(triple>>18)&63];
+		*out++=base64Chars[(triple>>12)&63];
+		*out++=base64Chars[(triple>>6)&63];
+		*out++=base64Chars[triple&63];
+	}
+
+	//One or two bytes left
+	if(i<size)
+	{
+		unsigned int triple=in[i]<<16;
+		if(i+1<size) triple|=in[i+1]<<8;
+		*out++=base64Chars[(triple>>18)&63];
+		*out++=base64Chars[(triple>>12)&63];
+		*out++=(i+1<size) ? base64Chars[(triple>>6)&63] : '=';
+		*out++='=';
+	}
+}
+
+long long CTextCodec::DecodedBase64Size(const char* text, long long length)
+{
+	long long numChars=0;
+	int numPadding=0;
+	for(long long i=0; i<length; i++)
+	{
+		char c=text[i];
+		if(base64Values[(unsigned char)c]>=0 && numPadding==0) {numChars++; continue;}
+
+		if(IsBlank(c)) continue;
+		if(c!='=') return -1;		//Data after the padding, or a foreign char
+		numPadding++;
+		numChars++;
+	}
+
+	if(numChars%4!=0 || numPadding>2) return -1;
+	return numChars/4*3-numPadding;
+}
+
+void CTextCodec::DecodeBase64(const char* text, long long length, void* dest)
+{
+	const unsigned char* in=(const unsigned char*)text;
+	unsigned char* out=(unsigned char*)dest;
+	unsigned int bits=0;
+	int numBits=0;
+	long long i=0;
+	while(i<length)
+	{
+		//Whole groups of four chars without blanks or padding, the usual case
+		if(numBits==0 && i+4<=length)
+		{
+			int a=base64Values[in[i]], b=base64Values[in[i+1]], c=base64Values[in[i+2]], d=base64Values[in[i+3]];
+			if((a|b|c|d)>=0)
+			{
+				unsigned int group=((unsigned int)a<<18) | ((unsigned int)b<<12) | ((unsigned int)c<<6) | (unsigned int)d;
+				out[0]=(unsigned char)(group>>16);
+				out[1]=(unsigned char)(group>>8);
+				out[2]=(unsigned char)group;
+				out+=3;
+				i+=4;
+				continue;
+			}
+		}
+
+		int val=base64Values[in[i++]];
+		if(val<0) continue;		//Blanks and padding
+
+		bits=(bits<<6) | (unsigned int)val;
+		numBits+=6;
+		if(numBits>=8)
+		{
+			numBits-=8;
+			*out++=(unsigned char)(bits>>numBits);
+		}
+	}
+}
+
+bool CTextWriter::Open(const BString& fileName, bool fTextMode)
+{
+	Close();
+
+	fp=fopen(fileName,fTextMode ? "w" : "wb");
+	if(fp==NULL) return false;
+
+	buffer.resize(bufferSize);
+	pos=0;
+	fError=false;
+	return true;
+}
+
+bool CTextWriter::Close()
+{
+	if(fp==NULL) return false;
+
+	Flush();
+	if(fclose(fp)!=0) fError=true;
+	fp=NULL;
+
+	return !fError;
+}
+
+void CTextWriter::Put(const char* str, size_t length)
+{
+	if(fp==NULL) {fError=true; return;}
+
+	while(length>0)
+	{
+		if(pos==buffer.size()) Flush();
+
+		size_t toCopy=std::min(length,buffer.size()-pos);
+		memcpy(&buffer[pos],str,toCopy);
+		pos+=toCopy;
+		str+=toCopy;
+		length-=toCopy;
+	}
+}
+
+void CTextWriter::Flush()
+{
+	if(fp!=NULL && pos>0 && fwrite(&buffer[0],1,pos,fp)!=pos) fError=true;
+	pos=0;
+}
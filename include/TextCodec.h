@@ -0,0 +1,260 @@
+/* Copyright (c) 2018 Peter Kondratyuk. All Rights Reserved.
+*
+* You may use, distribute and modify the code in this file under the terms of the MIT License, however
+* if this file is included as part of a larger project, the project as a whole may be distributed under a different
+* license.
+*
+* MIT license:
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+* documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+* to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions
+* of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+* TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+* CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+//Number <-> text conversion behind the CHArray, CMatrix and CData Read()/Write()
+//Output goes through CTextWriter, a large block buffer written with fwrite
+//Common printf formats (%.Ne, %.Nf, %.Ng, %d) are formatted with std::to_chars when the library has it,
+//"%r" gives the shortest text that reads back to the same value
+//Anything else (flags, widths, %x...) is passed to snprintf, so old formats keep working
+//Reading splits the text into chunks at blanks and parses them on several threads
+//Base64 is there for binary data that has to live in a text file (packed arrays in XML saves)
+
+#pragma once
+#include <stdio.h>
+#include <vector>
+#include <type_traits>
+#include <BString.h>
+#include <ParallelSort.h>
+
+class CTextCodec
+{
+public:
+	//A printf-style format for a single number, parsed once per write
+	struct CNumberFormat
+	{
+		BString spec;			//The whole format, used when the fast path does not apply
+		BString prefix;			//Text before and after the conversion, %% already unescaped
+		BString suffix;
+		char conversion;		//'e', 'f', 'g', 'd', 'r', or 0 - printf only
+		int precision;			//-1 if not given
+	};
+
+	static CNumberFormat ParseFormat(const char* form);
+
+	//Formats val into buf, returns the number of chars written (no terminating zero), or -1 if it did not fit
+	template <class theType>
+	static int Format(char* buf, int bufSize, const theType& val, const CNumberFormat& form)
+	{return FormatValue(buf,bufSize,val,form,std::is_arithmetic<theType>());}
+
+	//atof()-like parsing of the token [from,to): the longest valid prefix, 0 if there is none
+	static double ParseDouble(const char* from, const char* to);
+	static long long ParseInteger(const char* from, const char* to);	//Fractions and exponents go through ParseDouble
+
+	template <class theType>
+	static theType Parse(const char* from, const char* to)
+	{return ParseValue<theType>(from,to,std::is_integral<theType>());}
+
+	//Whether the whole token [from,to) reads as a number, ParseDouble() would accept a prefix of it
+	static bool IsNumber(const char* from, const char* to);
+	static bool IsNumberList(const char* text, long long length);	//Every whitespace-separated token is a number
+
+	//Whitespace-separated numbers; resize(count) must return storage for count values
+	template <class theType, class resizeFunc>
+	static void ParseList(const char* text, long long length, resizeFunc resize);
+
+	//One row per line, the number of columns is taken from the first line
+	//resize(cols,rows) prepares the storage, store(col,row,val) saves a value
+	template <class theType, class resizeFunc, class storeFunc>
+	static void ParseTable(const char* text, long long length, resizeFunc resize, storeFunc store);
+
+	//Base64 (standard alphabet, padded) of raw bytes, replaces the contents of result
+	static void EncodeBase64(const void* data, long long size, BString& result);
+	//Blanks are skipped; -1 if the text is not valid base64
+	static long long DecodedBase64Size(const char* text, long long length);
+	//dest takes DecodedBase64Size() bytes; the text must have passed DecodedBase64Size()
+	static void DecodeBase64(const char* text, long long length, void* dest);
+
+	//Text shorter than this is parsed on the calling thread
+	static const long long minParallelLength=1<<20;
+
+	static bool IsBlank(char c) {return c<=32;}
+
+private:
+	static int FormatFast(char* buf, int bufSize, double val, const CNumberFormat& form);
+	static int FormatFast(char* buf, int bufSize, float val, const CNumberFormat& form);
+	static int FormatFast(char* buf, int bufSize, long long val, const CNumberFormat& form);
+	static int FormatFast(char* buf, int bufSize, unsigned long long val, const CNumberFormat& form);
+
+	template <class theType>
+	static int FormatValue(char* buf, int bufSize, const theType& val, const CNumberFormat& form, std::true_type)
+	{
+		typedef typename std::conditional<std::is_floating_point<theType>::value,
+					typename std::conditional<sizeof(theType)==sizeof(float),float,double>::type,
+					typename std::conditional<std::is_signed<theType>::value,long long,unsigned long long>::type>::type fastType;
+
+		if(form.conversion==0) return Print(buf,bufSize,form.spec,val);
+		return FormatFast(buf,bufSize,(fastType)val,form);
+	}
+
+	template <class theType>
+	static int FormatValue(char* buf, int bufSize, const theType& val, const CNumberFormat& form, std::false_type)
+	{return Print(buf,bufSize,form.spec,val);}
+
+	template <class theType>
+	static int Print(char* buf, int bufSize, const char* spec, const theType& val)
+	{
+#if defined(_MSC_VER) && _MSC_VER<1900
+		int res=_snprintf(buf,bufSize,spec,val);
+#else
+		int res=snprintf(buf,bufSize,spec,val);
+#endif
+		return (res<0 || res>=bufSize) ? -1 : res;
+	}
+
+	template <class theType>
+	static theType ParseValue(const char* from, const char* to, std::true_type) {return (theType)ParseInteger(from,to);}
+	template <class theType>
+	static theType ParseValue(const char* from, const char* to, std::false_type) {return (theType)ParseDouble(from,to);}
+
+	//Chunk boundaries for threads, each starts after a blank (fAtLines - after a line feed)
+	static void SplitText(const char* text, long long length, int numChunks, bool fAtLines, std::vector<long long>& bounds);
+	static long long CountTokens(const char* from, const char* to);
+	static long long CountLines(const char* from, const char* to);	//Number of line feeds
+};
+
+//Buffered text output to a file
+class CTextWriter
+{
+public:
+	CTextWriter():fp(NULL),pos(0),fError(false){}
+	~CTextWriter(){Close();}
+
+	bool Open(const BString& fileName, bool fTextMode=false);	//fTextMode - CRLF line ends on Windows
+	bool Close();												//Flushes, false if any write failed
+
+	//Writing to a writer that is not open only sets the error, Close() then returns false
+	void Put(char c) {if(fp==NULL) {fError=true; return;} if(pos==buffer.size()) Flush(); buffer[pos++]=c;}
+	void Put(const char* str, size_t length);
+
+	template <class theType>
+	void PutNumber(const theType& val, const CTextCodec::CNumberFormat& form)
+	{
+		if(fp==NULL) {fError=true; return;}
+		if(buffer.size()-pos<numberSpace) Flush();
+
+		int length=CTextCodec::Format(&buffer[pos],(int)(buffer.size()-pos),val,form);
+		if(length>=0) {pos+=length; return;}
+
+		//Very long output
+		BString text;
+		text.Format(form.spec,val);
+		Put(text,text.GetLength());
+	}
+
+private:
+	void Flush();
+
+	FILE* fp;
+	std::vector<char> buffer;
+	size_t pos;
+	bool fError;
+
+	static const size_t bufferSize=1<<20;
+	static const size_t numberSpace=256;	//Free space kept for a single number
+};
+
+template <class theType, class resizeFunc>
+void CTextCodec::ParseList(const char* text, long long length, resizeFunc resize)
+{
+	int threads=(length<minParallelLength) ? 1 : CParallelSort::NumThreads();
+
+	std::vector<long long> bounds;
+	SplitText(text,length,threads,false,bounds);
+
+	//Count, then parse each chunk into its own range of the output
+	std::vector<long long> offsets(threads+1,0);
+	CParallelSort::ParallelFor(threads,[&](int t)
+	{
+		offsets[t+1]=CountTokens(text+bounds[t],text+bounds[t+1]);
+	});
+	for(int t=0; t<threads; t++) offsets[t+1]+=offsets[t];
+
+	theType* out=resize(offsets[threads]);
+
+	CParallelSort::ParallelFor(threads,[&](int t)
+	{
+		theType* cur=out+offsets[t];
+		const char* p=text+bounds[t];
+		const char* end=text+bounds[t+1];
+		while(true)
+		{
+			while(p<end && IsBlank(*p)) p++;
+			if(p==end) break;
+
+			const char* tokenStart=p;
+			while(p<end && !IsBlank(*p)) p++;
+			*cur++=Parse<theType>(tokenStart,p);
+		}
+	});
+}
+
+template <class theType, class resizeFunc, class storeFunc>
+void CTextCodec::ParseTable(const char* text, long long length, resizeFunc resize, storeFunc store)
+{
+	//Trailing CRs and one terminating LF do not make another row
+	while(length>0 && text[length-1]=='\r') length--;
+	if(length>0 && text[length-1]=='\n') length--;
+	while(length>0 && text[length-1]=='\r') length--;
+	if(length==0) {resize(0,0); return;}
+
+	int threads=(length<minParallelLength) ? 1 : CParallelSort::NumThreads();
+
+	std::vector<long long> bounds;
+	SplitText(text,length,threads,true,bounds);
+
+	std::vector<long long> firstRows(threads+1,0);
+	CParallelSort::ParallelFor(threads,[&](int t)
+	{
+		firstRows[t+1]=CountLines(text+bounds[t],text+bounds[t+1]);
+	});
+	for(int t=0; t<threads; t++) firstRows[t+1]+=firstRows[t];
+
+	long long firstLineEnd=0;
+	while(firstLineEnd<length && text[firstLineEnd]!='\n') firstLineEnd++;
+	long long cols=CountTokens(text,text+firstLineEnd);
+	if(cols==0) cols=1;
+	long long rows=firstRows[threads]+1;
+
+	resize(cols,rows);
+
+	CParallelSort::ParallelFor(threads,[&](int t)
+	{
+		long long row=firstRows[t];
+		long long col=0;
+		const char* p=text+bounds[t];
+		const char* end=text+bounds[t+1];
+		while(true)
+		{
+			while(p<end && IsBlank(*p))
+			{
+				if(*p=='\n') {row++; col=0;}
+				p++;
+			}
+			if(p==end) break;
+
+			const char* tokenStart=p;
+			while(p<end && !IsBlank(*p)) p++;
+			if(col<cols) store(col,row,Parse<theType>(tokenStart,p));	//Extra values in a row are ignored
+			col++;
+		}
+	});
+}